@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "buzzer_manager.h"
+#include "esp_log.h"
+
+// Priority front-end for audible alerts, on top of BuzzerManager.
+//
+// Every alert belongs to a priority class. An alert of a higher class than
+// whatever is sounding or queued stops the buzzer and plays at once; the
+// buzzer renders in SLICE_MS slices, so the request-to-sound time of the top
+// class is bounded by one slice plus a task switch. Same-class alerts queue
+// in call order; lower-class alerts raised while a higher one is active are
+// suppressed rather than left to play late.
+//
+// An alert that is still queued or playing absorbs repeats of itself
+// (coalesced), and each alert has a minimum spacing between playbacks
+// (rate-limited). Request-to-sound latency is recorded per class.
+class AlertScheduler
+{
+public:
+    enum Priority
+    {
+        PRIORITY_INFO,
+        PRIORITY_WARNING,
+        PRIORITY_ERROR,
+        PRIORITY_CRITICAL,
+        PRIORITY_COUNT
+    };
+
+    enum Alert
+    {
+        ALERT_BOOT,
+        ALERT_NOTICE,
+        ALERT_WARNING,        // e.g. SD write trouble
+        ALERT_ERROR,          // capture or init failure
+        ALERT_LANE_DEPARTURE, // critical
+        ALERT_COUNT
+    };
+
+    // Upper bounds in ms; the last bucket takes everything above
+    static const int LATENCY_BUCKETS = 8;
+    static const uint16_t BUCKET_LIMITS_MS[LATENCY_BUCKETS - 1];
+    // Worst-case request-to-sound budget for PRIORITY_CRITICAL
+    static const unsigned long CRITICAL_BUDGET_MS = 50;
+
+    struct Histogram
+    {
+        uint32_t buckets[LATENCY_BUCKETS];
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t totalUs;
+    };
+
+    struct Stats
+    {
+        uint32_t raised;
+        uint32_t played;
+        uint32_t coalesced;
+        uint32_t rateLimited;
+        uint32_t suppressed;  // lower class than the active alert
+        uint32_t preemptions;
+        uint32_t dropped;     // buzzer muted or queue full
+        Histogram latency[PRIORITY_COUNT];
+    };
+
+    static AlertScheduler &getInstance()
+    {
+        static AlertScheduler instance;
+        return instance;
+    }
+
+    // Hooks the buzzer's start handler; call after BuzzerManager::begin()
+    bool begin();
+    // Returns true when the alert was queued to sound
+    bool raise(Alert alert);
+
+    Stats getStats();
+    void resetStats();
+
+    static Priority priorityOf(Alert alert);
+    static const char *alertName(Alert alert);
+    static const char *priorityName(Priority priority);
+
+private:
+    struct Policy
+    {
+        BuzzerManager::Pattern pattern;
+        Priority priority;
+        uint16_t minSpacingMs;
+    };
+
+    static const char *TAG;
+    static const Policy POLICIES[ALERT_COUNT];
+
+    SemaphoreHandle_t mutex;
+    bool started = false;
+    uint16_t nextTag = 1;
+    uint32_t doneMark[ALERT_COUNT]; // BuzzerManager::queuedMark() after the alert's last pattern
+    uint16_t pendingTag[ALERT_COUNT];
+    unsigned long requestedUs[ALERT_COUNT];
+    unsigned long lastQueuedMs[ALERT_COUNT];
+    bool everQueued[ALERT_COUNT];
+    Stats stats;
+
+    AlertScheduler();
+    AlertScheduler(const AlertScheduler &) = delete;
+    AlertScheduler &operator=(const AlertScheduler &) = delete;
+
+    void onPatternStart(uint16_t tag);
+    static void record(Histogram &histogram, uint32_t latencyUs);
+};
@@ -2,8 +2,11 @@
 
 #include <ArduinoJson.h>
 #include "config.h"
-#include <NimBLEDevice.h>
+#include "hal/ble_transport.h"
+#include "command_bus.h"
 #include "esp_log.h"
+#include <atomic>
+#include <functional>
 #include <map>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
@@ -18,37 +21,6 @@
 
 #define BLE_LOG_LEVEL ESP_LOG_INFO // Change to ESP_LOG_DEBUG or ESP_LOG_VERBOSE for more detail
 
-class CustomBLEService;                    // Forward declaration
-extern CustomBLEService *globalBLEService; // Global instance pointer
-
-class ServerCallbacks : public NimBLEServerCallbacks
-{
-private:
-    static const char *TAG;
-
-public:
-    void onConnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo) override;
-    void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo, int reason) override;
-};
-
-class ControlCallbacks : public NimBLECharacteristicCallbacks
-{
-private:
-    static const char *TAG;
-
-public:
-    void onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo& connInfo) override;
-};
-
-class PreviewInfoCallbacks : public NimBLECharacteristicCallbacks
-{
-private:
-    static const char *TAG;
-
-public:
-    void onRead(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo& connInfo) override;
-};
-
 class CustomBLEService
 {
 public:
@@ -69,114 +41,53 @@ public:
         CONNECTED
     };
 
-    CustomBLEService();
+    CustomBLEService(BleTransport &transport = defaultBleTransport());
     ~CustomBLEService()
     {
-        if (mutex != nullptr)
-        {
-            vSemaphoreDelete(mutex);
-            mutex = nullptr;
-        }
-        globalBLEService = nullptr;
         cleanup();
     }
     bool begin();
     void loop();
     bool isConnected() { return connectionState == CONNECTED; }
-    bool isOperationEnabled() { return captureEnabled; }
-    bool isPreviewEnabled() { return previewEnabled; }
-    bool isInferenceEnabled() { return inferenceEnabled; }
+    // Mode queries; ModeController owns the mode
+    bool isOperationEnabled() { return isCaptureEnabled(); }
+    bool isPreviewEnabled();
+    bool isInferenceEnabled();
     void updateConnectionState(ConnectionState newState);
-    void handleControlCallback(NimBLECharacteristic *pCharacteristic);
     void notifyClients(const std::string &message);
 
-    using StateChangeCallback = std::function<void(bool enabled)>;
-    void setOperationCallback(StateChangeCallback cb) { operationCallback = cb; }
-    void setPreviewCallback(StateChangeCallback cb) { previewCallback = cb; }
-    void setInferenceCallback(StateChangeCallback cb) { inferenceCallback = cb; }
-
     void updateServiceStatus(const std::string &service, const std::string &status);
     void updateServiceMetrics(const std::string &service, const std::string &metrics);
 
     void updatePreviewInfo(const std::string &info);
 
+    // Restarts advertising; ModeController calls it after dropping to idle
     void handleDisconnection();
     void cleanup();
-    bool updateState(bool &stateVar, bool newValue);
     void checkConnectionHealth();
 
-    bool isDisconnecting() const;
-    bool wasExplicitlyStopped() const;
-
-    void setExplicitStop(bool value);
-
-    static bool isCaptureEnabled() { return captureEnabled; }
-
-    void handleControlCallback(Command cmd)
-    {
-        std::string value(1, static_cast<char>(cmd));
-        handleControlCallback(value);
-    }
+    static bool isCaptureEnabled();
 
+    // Queues a command on CommandBus without blocking; the mode changes when
+    // ModeController applies it. Safe from NimBLE callbacks.
+    bool postCommand(Command cmd, CommandBus::Source source = CommandBus::SOURCE_BLE);
     void handleControlCallback(const std::string &value);
 
-    bool handleControlCommand(Command cmd)
-    {
-        if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-        {
-            switch (cmd)
-            {
-            case Command::START_PREVIEW:
-                previewEnabled = true;
-                xSemaphoreGive(mutex);
-
-                if (previewCallback)
-                {
-                    previewCallback(true);
-                }
-                updateServiceStatus("preview", "starting");
-                notifyClients("Preview Starting");
-                ESP_LOGI(TAG, "Preview Mode Activated - Initializing stream...");
-                return true;
-
-                // ... other cases if needed
-
-            default:
-                xSemaphoreGive(mutex);
-                return false;
-            }
-        }
-        return false;
-    }
+    // A JSON object written to the control characteristic carries settings
+    // instead of a command. It is queued on CommandBus behind the commands
+    // already posted; on ModeController's task the handler applies it and
+    // returns the reply that is notified to the clients.
+    using SettingsHandler = std::function<std::string(const JsonDocument &settings)>;
+    void setSettingsHandler(SettingsHandler handler) { settingsHandler = handler; }
+    // Controller task only: parses and applies the settings queued in slot
+    void applySettings(uint8_t slot);
 
 private:
     static const char *TAG; // Define if not already defined
 
-    bool createControlCharacteristic();
-    bool createStatusCharacteristic();
-    bool createPreviewCharacteristic();
-    bool createMenuCharacteristic();
-    bool createServiceStatusCharacteristic();
-    bool createServiceMetricsCharacteristic();
-
-    static bool captureEnabled;
-    static bool previewEnabled;
-    static bool inferenceEnabled;
-    bool m_explicitStop;
-    bool m_disconnecting;
     ConnectionState connectionState;
 
-    NimBLEServer *pServer;
-    NimBLEService *pService;
-    NimBLECharacteristic *pControlCharacteristic;
-    NimBLECharacteristic *pStatusCharacteristic;
-    NimBLECharacteristic *pPreviewInfoCharacteristic;
-    NimBLECharacteristic *pServiceStatusCharacteristic;
-    NimBLECharacteristic *pServiceMetricsCharacteristic;
-
-    StateChangeCallback operationCallback;
-    StateChangeCallback previewCallback;
-    StateChangeCallback inferenceCallback;
+    BleTransport &transport;
 
     unsigned long lastKeepAlive;
     const unsigned long KEEPALIVE_INTERVAL = 1000;
@@ -185,4 +96,11 @@ private:
     void sendStatusUpdate();
 
     SemaphoreHandle_t mutex;
+    SettingsHandler settingsHandler;
+
+    // Settings writes waiting for the controller task; a slot is claimed by
+    // the BLE callback and freed once applied
+    static const int SETTINGS_SLOTS = 4;
+    std::string pendingSettings[SETTINGS_SLOTS];
+    std::atomic<bool> settingsSlotBusy[SETTINGS_SLOTS];
 };
\ No newline at end of file
@@ -1,10 +1,55 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
+#include <functional>
 #include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "esp_log.h"
+#include "hal/buzzer_backend.h"
 
+// Asynchronous buzzer. Every play*() call turns its melody into Note
+// descriptors and queues them; a low-priority task renders the queue through
+// the backend, so callers return in microseconds. A pattern is queued whole
+// or not at all. Tones and rests are rendered in slices of at most SLICE_MS,
+// so stop() takes effect within one slice.
 class BuzzerManager
 {
+public:
+    struct Note {
+        uint16_t halfPeriodUs;  // 0 for a rest
+        uint16_t durationMs;    // per step when sweeping
+        uint16_t gapMs;         // silence after the note
+        uint16_t sweepToUs;     // 0 for a fixed tone, else glide to this half period
+        uint16_t sweepStepUs;
+        uint16_t tag;           // non-zero: reported to the start handler when rendering begins
+    };
+
+    // Fixed patterns, also used by AlertScheduler
+    enum Pattern {
+        PATTERN_BOOT,
+        PATTERN_LOW,
+        PATTERN_MEDIUM,
+        PATTERN_HIGH,
+        PATTERN_CRITICAL
+    };
+
+    using StartHandler = std::function<void(uint16_t tag)>;
+
+    struct Stats {
+        uint32_t patternsQueued;
+        uint32_t patternsDropped;  // queue full or pattern longer than the queue
+        uint32_t notesPlayed;
+        uint32_t maxQueueDepth;
+        uint32_t maxEnqueueUs;     // slowest play*() call
+    };
+
+    static const int QUEUE_LENGTH = 64;
+    static const int SLICE_MS = 20;
+
 private:
     static BuzzerManager *instance;
     static const char *TAG;
@@ -33,17 +78,37 @@ private:
     static const int CRITICAL_HIGH_FREQ = 2500;
     static const int CRITICAL_LOW_FREQ = 1800;
 
+    // Queue entry; notes queued before a stop() carry an older generation
+    struct QueuedNote {
+        Note note;
+        uint32_t generation;
+    };
+
     // Instance variables
     int buzzerPin;
     bool isMuted;
     bool isInitialized;
+    BuzzerBackend* backend;
+    QueueHandle_t noteQueue;
+    SemaphoreHandle_t enqueueMutex;
+    TaskHandle_t taskHandle;
+    std::atomic<uint32_t> queuedNotes;     // running totals; equal when idle
+    std::atomic<uint32_t> finishedNotes;   // played or dropped by stop()
+    std::atomic<uint32_t> stopGeneration;
+    Stats stats;
+    StartHandler startHandler;
 
     // Private constructor
-    BuzzerManager() : buzzerPin(-1), isMuted(false), isInitialized(false) {}
+    BuzzerManager();
 
     // Private helper methods
-    void playTone(int tone, int duration);
-    void playNote(char note, int duration);
+    static int noteTone(char note);
+    static Note tone(int halfPeriodUs, int durationMs, int gapMs = 0);
+    static Note sweep(int fromUs, int toUs, int stepUs, int durationMs);
+    static size_t patternNotes(Pattern pattern, Note* out);
+    static void buzzerTask(void* parameter);
+    void render(const Note& note, uint32_t generation);
+    bool hold(int halfPeriodUs, int durationMs, uint32_t generation);
 
 public:
     // Keep all existing public methods unchanged
@@ -51,6 +116,23 @@ public:
     bool begin(int pin);
     bool isReady() const;
     void setMute(bool mute);
+    void setBackend(BuzzerBackend* newBackend);
+
+    // Queues a pattern; false when muted or it does not fit in the queue.
+    // A non-zero tag is reported through the start handler once it sounds.
+    bool play(const Note* notes, size_t count, uint16_t tag = 0);
+    bool playPattern(Pattern pattern, uint16_t tag = 0);
+    // Called from the buzzer task; keep it short
+    void setStartHandler(StartHandler handler) { startHandler = handler; }
+    // Drops queued notes and cuts the one playing short
+    void stop();
+    bool isIdle() const { return finishedNotes.load() == queuedNotes.load(); }
+    // Running count of queued notes; a pattern is done once finished() reaches
+    // the value read right after queueing it
+    uint32_t queuedMark() const { return queuedNotes.load(); }
+    bool finished(uint32_t mark) const { return static_cast<int32_t>(finishedNotes.load() - mark) >= 0; }
+    Stats getStats();
+
     void playBootTone();
     void playLowImportance();
     void playMediumImportance();
@@ -71,7 +153,7 @@ public:
         int delayBetweenNotes;
     };
 
-    // Keep all existing methods
+    // Keep all existing methods; all of them return immediately
     static SongConfig getDefaultFoxConfig();
     static SongConfig getDefaultCucarachaConfig();
     void playWhatTheFoxSaid(const SongConfig& config);
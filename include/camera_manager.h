@@ -2,33 +2,88 @@
 
 #include <Arduino.h>
 #include "config.h"  // Must be first for camera model selection
-#include <eloquent_esp32cam.h>
+#include "camera_profile.h"
+#include "frame_pool.h"
+#include "hal/camera_backend.h"
 #include "esp_log.h"
 
+#ifndef NATIVE_BUILD
+#include <eloquent_esp32cam.h>
 using namespace Eloquent::Esp32cam;
+#endif
 
 class CameraManager {
 public:
+    struct ProfileStats {
+        uint32_t switches;        // switches into this profile
+        uint32_t reallocations;   // of those, full driver restarts
+        uint32_t failures;        // no valid frame within MAX_SETTLE_FRAMES
+        uint32_t lastSettingsWritten; // register delta; 0 after a restart
+        uint32_t lastDiscarded;   // stale or invalid frames dropped after the switch
+        uint32_t lastFirstFrameUs; // switch start to first valid frame
+        uint32_t maxFirstFrameUs;
+        uint64_t totalFirstFrameUs;
+    };
+
+    // Frames the driver may have captured before a settings change
+    static const int STALE_FRAMES = 2;
+    static const int MAX_SETTLE_FRAMES = 8;
+
     static CameraManager& getInstance() {
         static CameraManager instance;
         return instance;
     }
 
-    bool begin(bool isPreviewMode = false);
-    Camera::Camera* getCamera() { return &camera; }
-    void releaseCamera() { 
-        if (initialized) {
-            ESP_LOGI(TAG, "Releasing camera resources");
-            initialized = false;
-        }
-    }
-    
+    // Starts the camera in profile, or switches a running camera to it with
+    // the fewest changes: a sensor register delta when the frame buffers
+    // fit, a driver restart otherwise. Returns once a frame that matches the
+    // profile has come out of the sensor.
+    bool begin(CameraProfile::Id profile = CameraProfile::DATASET);
+    bool isInitialized() const { return initialized; }
+    CameraProfile::Id activeProfile() const { return active; }
+    ProfileStats getProfileStats(CameraProfile::Id profile);
+    void resetProfileStats();
+
+    // Grab a frame from the active backend; hand it back with release()
+    camera_fb_t* capture();
+    void release(camera_fb_t* fb);
+    const char* lastError() const { return poolError ? poolError : backend->lastError(); }
+
+    // Grab a frame into the shared pool. The driver buffer is returned right
+    // away; every consumer then reads the same pooled copy.
+    FrameRef captureShared();
+    // Most recent shared frame, for preview/inference/display readers
+    FrameRef getLatestFrame();
+    FramePool::Stats getPoolStats() { return framePool.getStats(); }
+
+    // Shuts the sensor down so the next begin() configures it from scratch,
+    // and frees the frame pool. Pooled frames still referenced stay valid.
+    void releaseCamera();
+
+    // Swap the frame source (host harnesses); only valid while released
+    void setBackend(CameraBackend* newBackend);
+
+#ifndef NATIVE_BUILD
+    // Driver access for device-only consumers such as the MJPEG server
+    Camera::Camera* getCamera();
+#endif
+
 private:
-    CameraManager() {}
+    CameraManager();
     static const char* TAG;
-    Camera::Camera camera;
+    CameraBackend* backend;
     bool initialized = false;
-    
-    bool initializePins();
-    bool configureCamera(bool isPreviewMode);
-}; 
\ No newline at end of file
+    CameraProfile::Id active = CameraProfile::DATASET;
+    SemaphoreHandle_t statsMutex;
+    ProfileStats profileStats[CameraProfile::COUNT];
+    FramePool framePool;
+    bool poolPending = false; // begin() found frames from the ended pool still held
+    FrameRef latestFrame;
+    const char* poolError = nullptr;
+    SemaphoreHandle_t latestMutex;
+
+    void setLatestFrame(const FrameRef& frame);
+    bool startDriver(const CameraProfile& profile);
+    // Drops frames until one matches profile; returns how many were dropped or -1
+    int awaitValidFrame(const CameraProfile& profile, int skip);
+};
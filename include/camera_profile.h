@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <esp_camera.h>
+
+// Named sensor configuration for one use of the camera. Switching between
+// profiles that keep the driver's frame buffers (same pixel format; for raw
+// formats also the same frame size, for JPEG a frame size within bufferSize)
+// only rewrites the sensor settings that differ. Anything else tears the
+// driver down and brings it back up with buffers for the new profile.
+struct CameraProfile
+{
+    enum Id
+    {
+        PREVIEW,   // MJPEG stream to a phone
+        DATASET,   // raw frames written to the SD card for training
+        INFERENCE, // raw frames for the on-device model, same geometry as DATASET
+        COUNT
+    };
+
+    const char *name;
+    pixformat_t format;
+    framesize_t frameSize;
+    framesize_t bufferSize; // driver buffers are allocated for this size
+    uint8_t jpegQuality;    // 0-63, lower is better; JPEG only
+
+    // Sensor settings, written through sensor_t
+    bool autoExposure;
+    int8_t aeLevel;      // -2..2
+    bool autoGain;
+    uint8_t gainCeiling; // gainceiling_t: 0 = 2x .. 6 = 128x
+    bool autoWhiteBalance;
+    int8_t brightness;   // -2..2
+    int8_t contrast;     // -2..2
+    int8_t saturation;   // -2..2
+
+    static const CameraProfile &get(Id id);
+
+    // Pixel dimensions of a frame size; false for FRAMESIZE_INVALID
+    static bool dimensions(framesize_t size, uint16_t &width, uint16_t &height);
+
+    // True when going from running to target needs new frame buffers
+    static bool needsReallocation(const CameraProfile &running, const CameraProfile &target);
+    // Sensor settings a delta switch writes, i.e. the fields that differ
+    static int delta(const CameraProfile &running, const CameraProfile &target);
+
+    // The frame has the profile's format and size, and a JPEG frame starts
+    // with SOI and ends with EOI (so it is not a half-written buffer)
+    static bool isValidFrame(const CameraProfile &profile, const camera_fb_t *fb);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include "esp_log.h"
+
+// Persisted frame and session counters, replacing the root directory scan.
+//
+// The record is double-buffered across two small files; each write goes to
+// the slot not holding the newest valid copy, so a torn write can only ever
+// lose the update in progress. A record is valid when its magic and CRC-32
+// match, and the higher sequence number wins. Start-up reads both slots
+// whatever the card holds; the directory scan only runs when neither slot
+// is valid.
+//
+// Frame numbers are leased in blocks: the persisted nextFrame is always at
+// or past every frame index already written to the card, so a crash skips
+// at most FRAME_LEASE numbers and never reuses one.
+class CaptureManifest
+{
+public:
+    static const uint32_t FRAME_LEASE = 64;
+
+    static CaptureManifest &getInstance()
+    {
+        static CaptureManifest instance;
+        return instance;
+    }
+
+    // Loads the newest valid slot, rebuilding from the card if both are bad
+    bool load();
+    bool isLoaded() const { return loaded; }
+    bool wasRebuilt() const { return rebuilt; }
+    unsigned long loadTimeMs() const { return loadMs; }
+
+    uint32_t nextFrame() const { return frameCounter; }
+    uint32_t nextSession() const { return sessionCounter; }
+
+    // Reserves the next unused session number and persists it
+    uint32_t beginSession();
+    // Extends the persisted lease before frameIndex is written to the card
+    bool reserveFrame(uint32_t frameIndex);
+    // Records the exact next frame number on a clean stop
+    bool endSession(uint32_t nextFrameIndex);
+
+private:
+    struct __attribute__((packed)) Record
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t sequence;
+        uint32_t nextFrame;
+        uint32_t nextSession;
+        uint32_t crc; // over all preceding fields
+    };
+
+    static const char *TAG;
+    static const uint32_t RECORD_MAGIC = 0x4D584D46; // "FMXM"
+    static const uint16_t RECORD_VERSION = 1;
+
+    CaptureManifest() {}
+    CaptureManifest(const CaptureManifest &) = delete;
+    CaptureManifest &operator=(const CaptureManifest &) = delete;
+
+    bool loaded = false;
+    bool rebuilt = false;
+    unsigned long loadMs = 0;
+    uint32_t sequence = 0;
+    uint32_t frameCounter = 1;
+    uint32_t frameLease = 1;
+    uint32_t sessionCounter = 1;
+
+    bool readSlot(int slot, Record &out);
+    bool persist(uint32_t leaseFrame);
+    void rebuildFromCard();
+};
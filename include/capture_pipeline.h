@@ -0,0 +1,168 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "camera_manager.h"
+#include "capture_trigger.h"
+#include "duplicate_filter.h"
+#include "esp_log.h"
+#include "parallel_jpeg_encoder.h"
+#include "session_container.h"
+
+// Capture -> encode -> store pipeline used by DataCollector.
+//
+// Each stage is its own FreeRTOS task. Frames travel between them as slot
+// pointers over bounded queues, and a fixed set of slots circulates through
+// a free queue. A slot holds a shared handle to the pooled camera frame (no
+// copy of its own) and a JPEG buffer that is reused across frames; the encode
+// stage fills it from MCU-row stripes encoded on both cores (see
+// ParallelJpegEncoder) without a full-frame RGB888 intermediate, and the
+// store stage compresses the raw frame losslessly (rgbz_codec.h) into one
+// buffer of its own before appending it. Memory use is constant and a slow
+// SD card back-pressures the pipeline instead of delaying the sensor: when
+// no slot is free the capture stage drops that exposure and counts a stall.
+//
+// The capture stage probes the camera at the trigger's minimum interval;
+// only frames CaptureTrigger picks and DuplicateFilter does not recognise
+// travel on and get a frame index, the others go straight back to the pool
+// before any encoding or SD traffic. Each run writes one packed session
+// (see session_container.h).
+class CapturePipeline
+{
+public:
+    static const int SLOT_COUNT = 3;
+
+    enum Stage
+    {
+        CAPTURE,
+        ENCODE,
+        STORE,
+        STAGE_COUNT
+    };
+
+    struct StageStats
+    {
+        uint32_t processed;
+        uint32_t stalls;      // capture: no free slot, encode: store queue full
+        uint32_t errors;
+        uint32_t queueDepth;  // frames waiting at this stage's input (capture: slots in flight)
+        uint32_t maxQueueDepth;
+        uint32_t busyMs;      // time spent working, excluding queue waits
+    };
+
+    struct TriggerStats
+    {
+        uint32_t probes;
+        uint32_t skipped;
+        uint32_t changeStores;      // includes the first frame of a run
+        uint32_t maxIntervalStores;
+        uint8_t lastScore;
+    };
+
+    struct DedupStats
+    {
+        uint32_t checked;   // frames hashed
+        uint32_t rejected;
+        uint8_t lastDistance;
+        uint32_t hashUs;    // total hash and lookup time
+        uint32_t maxHashUs;
+    };
+
+    struct Stats
+    {
+        StageStats stages[STAGE_COUNT];
+        TriggerStats trigger;
+        DedupStats dedup;
+        int nextIndex;
+        uint32_t sessionId;
+        uint64_t storedBytes;
+        uint64_t rawBytes;    // raw frames before compression
+        uint64_t rawPacked;   // what they took in the session
+        unsigned long runningMs;
+    };
+
+    using ErrorHandler = std::function<void(Stage stage, const char *message)>;
+
+    CapturePipeline();
+    ~CapturePipeline();
+
+    // False, among other reasons, while stages of the previous run that
+    // outlived its stop() are still running
+    bool start(int firstIndex);
+    // Stops capturing and lets frames already in flight reach the card.
+    // Stages that do not exit in time stay counted and block start().
+    void stop();
+    bool isRunning() const { return running; }
+
+    Stats getStats();
+    // Settings may change while running; they apply from the next probe
+    CaptureTrigger &getTrigger() { return trigger; }
+    DuplicateFilter &getDuplicateFilter() { return duplicates; }
+    void setErrorHandler(ErrorHandler handler) { errorHandler = handler; }
+
+    static const char *stageName(Stage stage);
+
+private:
+    struct Slot
+    {
+        FrameRef frame;
+        uint8_t *jpeg = nullptr;
+        size_t jpegLen = 0;
+        size_t jpegCapacity = 0;
+        int index = 0;
+        unsigned long capturedAtMs = 0;
+    };
+
+    static const char *TAG;
+
+    Slot slots[SLOT_COUNT];
+    QueueHandle_t freeQueue;
+    QueueHandle_t encodeQueue;
+    QueueHandle_t storeQueue;
+    SemaphoreHandle_t statsMutex;
+    SemaphoreHandle_t stageExited;
+
+    volatile bool running;
+    volatile bool captureDone;
+    volatile bool encodeDone;
+    int startedStages; // started and not yet seen to exit
+    unsigned long startedAt;
+    int nextIndex;
+    uint32_t sessionId;
+    uint64_t storedBytes;
+    uint64_t rawBytes;
+    uint64_t rawPacked;
+    StageStats stats[STAGE_COUNT];
+    TriggerStats triggerStats;
+    DedupStats dedupStats;
+    ErrorHandler errorHandler;
+    Session::Writer session;
+    CaptureTrigger trigger;      // decisions: capture task only
+    DuplicateFilter duplicates;  // checks: capture task only
+    ParallelJpegEncoder encoder; // encode task only
+    uint8_t *packed = nullptr;   // store task only
+    size_t packedCapacity = 0;
+
+    static void captureTask(void *parameter);
+    static void encodeTask(void *parameter);
+    static void storeTask(void *parameter);
+    void closeSession();
+
+    bool captureFrame(Slot *slot);
+    bool triggerFrame(Slot *slot);
+    bool dedupFrame(Slot *slot);
+    bool encodeFrame(Slot *slot);
+    bool storeFrame(Slot *slot);
+    size_t packFrame(const Slot *slot);
+    static size_t appendJpeg(void *arg, size_t index, const void *data, size_t len);
+
+    void recordWork(Stage stage, unsigned long startedMs, bool ok);
+    void recordStall(Stage stage);
+    void recordDepth(Stage stage, uint32_t depth);
+    void reportError(Stage stage, const char *message);
+    void releaseBuffers();
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_camera.h>
+#include "config.h"
+
+// Decides which probed camera frames are worth storing.
+//
+// Each probe is reduced to a GRID x GRID thumbnail of mean luma, sampled
+// every SAMPLE_STEP pixels, and scored by its mean absolute difference from
+// the thumbnail of the last stored frame (0..255). A frame is stored when
+// the score reaches the threshold, or when the maximum interval has passed
+// without a stored frame; probes closer than the minimum interval to the
+// last stored frame are never stored. Comparing against the last stored
+// frame, not the previous probe, lets slow drift add up until it counts,
+// so the store rate follows how fast the scene changes: the minimum
+// interval while driving through a bend, the maximum while parked.
+//
+// shouldStore() only decides; the caller commits the probe once the frame is
+// actually kept, so a frame dropped later (as a near-duplicate) neither
+// becomes the reference nor restarts the intervals.
+//
+// Settings may be changed from any task; shouldStore(), commit() and reset()
+// belong to the capture task.
+class CaptureTrigger
+{
+public:
+    static const int GRID = 16;
+    static const int SAMPLE_STEP = 4;
+
+    enum Decision
+    {
+        SKIP,
+        STORE_FIRST,       // no reference yet
+        STORE_CHANGE,      // score reached the threshold
+        STORE_MAX_INTERVAL // nothing stored for the maximum interval
+    };
+
+    struct Settings
+    {
+        uint32_t minIntervalMs;
+        uint32_t maxIntervalMs;
+        uint8_t threshold; // 0 stores every probe
+    };
+
+    CaptureTrigger();
+
+    // False, leaving the settings unchanged, when minMs > maxMs
+    bool setIntervals(uint32_t minMs, uint32_t maxMs);
+    void setThreshold(uint8_t value) { threshold.store(value); }
+    Settings getSettings() const;
+    // How often the capture task should probe
+    uint32_t probeIntervalMs() const { return minIntervalMs.load(); }
+
+    Decision shouldStore(const camera_fb_t *fb, unsigned long nowMs);
+    // Makes the last probe the stored reference; call only after a STORE
+    // decision for a frame that is kept
+    void commit(unsigned long nowMs);
+    // Forget the reference frame; the next probe is stored
+    void reset() { hasReference = false; }
+    uint8_t lastScore() const { return score; }
+
+    static const char *decisionName(Decision decision);
+
+private:
+    std::atomic<uint32_t> minIntervalMs;
+    std::atomic<uint32_t> maxIntervalMs;
+    std::atomic<uint8_t> threshold;
+
+    bool hasReference = false;
+    bool judged = false; // the last probe produced a thumbnail
+    unsigned long storedAtMs = 0;
+    uint8_t score = 0;
+    uint8_t reference[GRID * GRID];
+    uint8_t thumbnail[GRID * GRID];
+
+    bool computeThumbnail(const camera_fb_t *fb);
+};
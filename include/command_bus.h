@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "esp_log.h"
+
+// Inbound command path. NimBLE callbacks, the button handler and internal
+// events post here; ModeController's task is the only consumer and the only
+// code that changes the operating mode.
+//
+// post() never blocks and takes no lock: the ring is a bounded MPSC queue
+// where each cell carries a sequence number, so producers claim a slot with
+// one compare-and-swap and publish it with a release store. The only time a
+// command is refused is when CAPACITY commands are already waiting; the
+// caller gets false and the refusal is counted.
+class CommandBus
+{
+public:
+    enum Source : uint8_t
+    {
+        SOURCE_BLE,
+        SOURCE_MENU,
+        SOURCE_SYSTEM,
+        SOURCE_COUNT
+    };
+
+    // Codes outside CustomBLEService::Command, posted by the firmware itself
+    enum SystemCode : uint8_t
+    {
+        CONNECTION_LOST = 0x80,
+        STOP_ACTIVE = 0x81,   // menu "Stop Service": whatever mode is running
+        APPLY_SETTINGS = 0x82 // BLE settings write; payload is its slot in CustomBLEService
+    };
+
+    struct Message
+    {
+        uint8_t code; // CustomBLEService::Command or SystemCode
+        Source source;
+        uint8_t payload;        // code-specific, 0 when unused
+        uint32_t sequence;      // bus-wide post order
+        unsigned long postedUs; // micros() at post time
+    };
+
+    struct Stats
+    {
+        uint32_t posted[SOURCE_COUNT];
+        uint32_t rejected; // queue full
+        uint32_t maxDepth;
+    };
+
+    static const uint32_t CAPACITY = 16; // power of two
+
+    static CommandBus &getInstance()
+    {
+        static CommandBus instance;
+        return instance;
+    }
+
+    // Safe from any task; returns false only when the queue is full
+    bool post(uint8_t code, Source source, uint8_t payload = 0);
+    // Consumer side, one task only
+    bool receive(Message &out, TickType_t wait);
+    uint32_t depth() const;
+
+    Stats getStats() const;
+    uint32_t totalPosted() const;
+
+    static const char *sourceName(Source source);
+
+private:
+    struct Cell
+    {
+        std::atomic<uint32_t> sequence;
+        Message message;
+    };
+
+    static const char *TAG;
+
+    Cell cells[CAPACITY];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos; // written by the consumer only
+    std::atomic<uint32_t> nextSequence;
+    SemaphoreHandle_t wake;
+
+    std::atomic<uint32_t> posted[SOURCE_COUNT];
+    std::atomic<uint32_t> rejected;
+    std::atomic<uint32_t> maxDepth;
+
+    CommandBus();
+    CommandBus(const CommandBus &) = delete;
+    CommandBus &operator=(const CommandBus &) = delete;
+
+    bool tryPop(Message &out);
+};
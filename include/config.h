@@ -17,10 +17,132 @@ enum OperationMode
 #define LED_PIN 21
 #define BUZZER_PIN 4 // Adjust pin number according to your hardware
 #define BUTTON_PIN D1
-// Time intervals
-#define CAPTURE_INTERVAL_MS 5000 // 5 seconds
+// Adaptive capture (CaptureTrigger). The camera is probed every
+// CAPTURE_MIN_INTERVAL_MS; a probe is stored when its 16x16 luma thumbnail
+// differs from the last stored frame's by CAPTURE_CHANGE_THRESHOLD or more
+// (mean absolute difference, 0..255), or when CAPTURE_MAX_INTERVAL_MS passed
+// without a stored frame. All three can be changed at runtime over BLE.
+#ifndef CAPTURE_MIN_INTERVAL_MS
+#define CAPTURE_MIN_INTERVAL_MS 500
+#endif
+#ifndef CAPTURE_MAX_INTERVAL_MS
+#define CAPTURE_MAX_INTERVAL_MS 15000
+#endif
+#ifndef CAPTURE_CHANGE_THRESHOLD
+#define CAPTURE_CHANGE_THRESHOLD 12 // 0 stores every probe
+#endif
+// Near-duplicate rejection (DuplicateFilter): a frame the trigger picked is
+// still dropped when its 64-bit perceptual hash is within
+// CAPTURE_DEDUP_DISTANCE bits of one of the last CAPTURE_DEDUP_WINDOW stored
+// frames. Changeable at runtime over BLE.
+#ifndef CAPTURE_DEDUP_DISTANCE
+#define CAPTURE_DEDUP_DISTANCE 3 // -1 disables the filter
+#endif
+#ifndef CAPTURE_DEDUP_WINDOW
+#define CAPTURE_DEDUP_WINDOW 64
+#endif
+
+// Lane model (ModelInference): an int8 .tflite file on the SD card, planned
+// into a statically reserved arena in internal RAM
+#define INFERENCE_MODEL_PATH "/models/lane.tflite"
+#ifndef INFERENCE_ARENA_BYTES
+#define INFERENCE_ARENA_BYTES (128 * 1024)
+#endif
+#define INFERENCE_MIN_CONFIDENCE 0.5f // a lane line counts as found from here
+// Classical lane detector (LaneDetector): inference mode runs it when no
+// model loads. Paint edges are Sobel responses of LANE_EDGE_THRESHOLD or
+// more on the luma image; frames taking longer than LANE_DETECTOR_BUDGET_US
+// are counted in the inference metrics.
+#ifndef LANE_DETECTOR_FALLBACK
+#define LANE_DETECTOR_FALLBACK 1 // 0: inference mode needs a model
+#endif
+#define LANE_EDGE_THRESHOLD 120
+#define LANE_DETECTOR_BUDGET_US 20000
+// Lane tracking (LaneTracker): the model or detector runs on one frame in
+// LANE_TRACK_INTERVAL and the other frames get the tracks extrapolated to
+// their capture time; 1 detects every frame. A detection comes sooner when a
+// track fades under LANE_TRACK_MIN_CONFIDENCE (detection confidence, falling
+// to 0 over LANE_TRACK_MAX_AGE_MS) or the last one landed more than
+// LANE_TRACK_GATE (fraction of the frame width) from the prediction.
+#ifndef LANE_TRACK_INTERVAL
+#define LANE_TRACK_INTERVAL 4
+#endif
+#define LANE_TRACK_ALPHA 0.8f // share of a residual taken into the position
+#define LANE_TRACK_BETA 0.5f  // share taken into the rate
+#define LANE_TRACK_GATE 0.05f
+#define LANE_TRACK_MIN_CONFIDENCE 0.25f
+#define LANE_TRACK_MAX_AGE_MS 1000
+// Lane departure: inference raises the lane departure alert when the car's
+// offset from the lane centre (lane half-widths, 1 on a line) reaches
+// LANE_DEPARTURE_OFFSET, and again only after it has come back under
+// LANE_DEPARTURE_CLEAR.
+#ifndef LANE_DEPARTURE_OFFSET
+#define LANE_DEPARTURE_OFFSET 0.75f
+#endif
+#define LANE_DEPARTURE_CLEAR 0.5f
+// Bird's-eye view (InversePerspectiveMap): the ground trapezoid whose sides
+// meet at the vanishing point (IPM_VANISH_X/Y, fractions of the frame),
+// from the bottom corners of the frame up to IPM_TOP of the frame height,
+// is remapped to an IPM_WIDTH x IPM_HEIGHT top-down luma image. The remap
+// table is built once and cached on the card at IPM_LUT_PATH.
+#define IPM_VANISH_X 0.5f
+#define IPM_VANISH_Y 0.4f
+#define IPM_TOP 0.55f
+#define IPM_WIDTH 80
+#define IPM_HEIGHT 120
+#define IPM_LUT_PATH "/calib/ipm.lut"
+// Camera mount (MountCalibration): the vanishing point, and with it the
+// horizon, estimated from a batch of collected frames and kept on the card.
+// Stages that only need the road start MOUNT_ROAD_MARGIN (fraction of the
+// frame height) below the horizon; the default keeps the detector's crop at
+// LaneResult::ROI_TOP for the configured mount. An estimate needs lane
+// boundaries in CALIBRATION_MIN_FRAMES frames, with the middle half of their
+// crossings within CALIBRATION_MAX_SPREAD of the height.
+#define MOUNT_CALIBRATION_PATH "/calib/mount.cal"
+#define MOUNT_ROAD_MARGIN 0.1f
+#define CALIBRATION_MIN_FRAMES 20
+#define CALIBRATION_MAX_SPREAD 0.05f
+
+// Shared PSRAM frame buffers: pipeline slots + latest frame + one reader
+#define FRAME_POOL_SIZE 5
+
+// Define CAMERA_REPLAY_SOURCE (a directory of .rgb/.jpg frames or a session
+// such as "/session0003" on the SD card) to feed the camera from recorded
+// frames instead of the sensor; see FileCameraBackend and [env:replay].
+#ifndef CAMERA_REPLAY_FPS
+#define CAMERA_REPLAY_FPS 0 // 0 = as fast as the card reads
+#endif
+
+// JPEG copy of each captured frame (JpegStreamEncoder). Output reaches the
+// pipeline slot in JPEG_STREAM_CHUNK_BYTES pieces while it is encoded.
+#ifndef CAPTURE_JPEG_QUALITY
+#define CAPTURE_JPEG_QUALITY 100 // 1..100, IJG scaling
+#endif
+#ifndef CAPTURE_JPEG_SUBSAMPLE_420
+#define CAPTURE_JPEG_SUBSAMPLE_420 1 // 0 = full-resolution chroma (4:4:4)
+#endif
+#define JPEG_STREAM_CHUNK_BYTES 1024
+#ifndef CAPTURE_JPEG_WORKERS
+#define CAPTURE_JPEG_WORKERS 2 // cores encoding restart-interval stripes; 1 = single pass
+#endif
+
+// Raw frames are stored losslessly compressed (Rgbz, see rgbz_codec.h) by
+// the pipeline's store stage; 0 writes plain RGB565 records.
+#ifndef CAPTURE_RAW_COMPRESSION
+#define CAPTURE_RAW_COMPRESSION 1
+#endif
+
+// SD write-behind cache (SDManager::openStream). A chunk is one device write
+// and should be a multiple of the card's cluster size (32 KB on FAT32 cards
+// up to 64 GB); PSRAM use is SD_WRITE_CHUNKS x SD_WRITE_CHUNK_BYTES.
+#define SD_WRITE_CHUNK_BYTES 32768
+#define SD_WRITE_CHUNKS 8
+#ifndef SD_SYNC_INTERVAL_MS
+#define SD_SYNC_INTERVAL_MS 1000 // FAT/directory update cadence
+#endif
 
 // File paths and formats
 #define IMAGE_PREFIX "picture"
 #define RGB_EXTENSION ".rgb"
+#define RGBZ_EXTENSION ".rgbz"
 #define JPG_EXTENSION ".jpg"
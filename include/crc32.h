@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected, as used by zlib). Pass the previous result
+// as `crc` to checksum data in pieces.
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+inline uint32_t crc32(const void *data, size_t len)
+{
+    return crc32Update(0, data, len);
+}
@@ -2,9 +2,13 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "alert_scheduler.h"
 #include "ble_service.h"
 #include "camera_manager.h"
+#include "capture_manifest.h"
+#include "capture_pipeline.h"
 #include "config.h"
+#include "mode_controller.h"
 #include "esp_log.h"
 #include "sd_manager.h"
 #include "buzzer_manager.h"
@@ -15,18 +19,23 @@ public:
     DataCollector(CustomBLEService *ble);
     ~DataCollector();
     bool begin();
+    // Capture mode enter/exit, run by ModeController
+    bool start();
+    void stop();
     void loop();
     void cleanup();
+    CapturePipeline::Stats getPipelineStats() { return pipeline.getStats(); }
 
 private:
-    Camera::Camera *camera;
-    unsigned long lastCapture;
+    bool cameraReady;
+    unsigned long lastMetricsUpdate;
     int imageCount;
     CustomBLEService *bleService;
     static const char *TAG;
     SemaphoreHandle_t cameraMutex;
+    CapturePipeline pipeline;
     bool initSD();
-    int getNextImageCount();
-    bool convert_rgb565_to_jpeg(const uint8_t *rgb565_data, int width, int height,
-                                uint8_t **jpg_buf_out, size_t *jpg_len_out);
+    void stopPipeline();
+    void publishMetrics();
+    std::string applySettings(const JsonDocument &settings);
 };
\ No newline at end of file
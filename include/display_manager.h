@@ -1,39 +1,76 @@
 #pragma once
 #include <Arduino.h>
-#include "U8g2lib.h"
-#include "xbm_icon.h"
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "hal/display_backend.h"
 #include "config.h"
 #include "esp_log.h"
 
+// Display compositor. The backend's drawing buffer is the back buffer: any
+// task may draw a whole frame into it under the frame lock with compose().
+// A single compositor task owns the panel; on each flush request it diffs
+// the back buffer against a copy of what the panel shows (the front buffer)
+// and sends only the pages that changed.
 class DisplayManager
 {
+public:
+    using DrawRequest = std::function<void(DisplayBackend &canvas)>;
+
+    struct Stats
+    {
+        uint32_t flushRequests;
+        uint32_t framesSent;      // at least one page changed
+        uint32_t framesUnchanged; // nothing to send
+        uint32_t pagesSent;
+        uint64_t bytesSent;
+        uint32_t bytesPerSecond;  // over the last full second
+    };
+
+    // Caps the flush rate; requests in between are merged into one frame
+    static const unsigned long MIN_FRAME_INTERVAL_MS = 20;
+
 private:
     static const char *TAG;
     static DisplayManager *instance;
-    DISPLAY_MODEL *display;
+    DisplayBackend *display;
     bool initialized;
 
+    uint8_t *frontBuffer;
+    size_t bufferSize;
+    SemaphoreHandle_t drawMutex;
+    SemaphoreHandle_t flushRequested;
+    SemaphoreHandle_t statsMutex;
+    TaskHandle_t compositorHandle;
+    volatile bool forceFullFlush;
+    Stats stats;
+    uint64_t bytesAtWindowStart;
+    unsigned long windowStart;
+
     DisplayManager();
     void setupDefaults();
-    void checkInit();
+
+    static void compositorTask(void *parameter);
+    void flush();
+    // Requests a flush of the back buffer; returns immediately
+    void refresh();
 
 public:
     static DisplayManager &getInstance();
     ~DisplayManager();
 
     bool begin();
-    void clear();
-    void refresh();
-    void print(const char *text);
-    void printAt(const char *text, int x, int y);
-    void drawXBM(const XBMIcon &icon, int x, int y);
-    void drawXBM(int x, int y, int width, int height, const unsigned char *bitmap);
-    void setFont(const uint8_t *font);
-    void drawFrame(int x, int y, int width, int height);
-    void drawBox(int x, int y, int width, int height);
-
-    u8g2_uint_t getDisplayWidth() const;
-    u8g2_uint_t getDisplayHeight() const;
+    // Clears the back buffer, runs draw on it under the frame lock and
+    // requests a flush. Draw only on canvas inside the callback.
+    void compose(const DrawRequest &draw);
+
+    uint16_t getDisplayWidth() const;
+    uint16_t getDisplayHeight() const;
     bool isInitialized() const { return initialized && display != nullptr; }
-    DISPLAY_MODEL *getDisplay() { return display; }
-};
\ No newline at end of file
+    DisplayBackend *getDisplay() { return display; }
+    Stats getStats();
+
+    // Swap the drawing surface (host harnesses); only valid before begin()
+    void setBackend(DisplayBackend *backend);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_camera.h>
+#include "config.h"
+
+// Rejects frames that look like one stored recently.
+//
+// Each frame gets a 64-bit difference hash (dHash): the luma plane is
+// averaged down to a 9x8 grid and every bit records whether a cell is
+// brighter than its right-hand neighbour by more than EDGE_MARGIN. The hash
+// follows the scene's structure rather than its brightness, so sensor noise,
+// auto-exposure steps and small shifts change only a few bits. Hashes of the last WINDOW
+// admitted frames are kept in a ring; a frame whose hash is within the
+// maximum Hamming distance of any of them is a duplicate. Unlike
+// CaptureTrigger, which compares with the last stored frame only, this
+// also catches a scene coming back (the same junction after a lap, the
+// same queue at a light).
+//
+// The distance may be changed from any task; check() and reset() belong to
+// the capture task.
+class DuplicateFilter
+{
+public:
+    static const int HASH_COLUMNS = 9; // 8 comparisons per row
+    static const int HASH_ROWS = 8;
+    static const int SAMPLE_STEP = 2;
+    static const int EDGE_MARGIN = 2; // luma steps between neighbouring cells
+    static const int WINDOW = CAPTURE_DEDUP_WINDOW;
+    static_assert(WINDOW > 0, "CAPTURE_DEDUP_WINDOW must keep at least one hash");
+
+    struct Result
+    {
+        bool duplicate;
+        bool hashed;       // false for frames that cannot be hashed (admitted)
+        uint8_t distance;  // to the nearest recent hash, 64 when there is none
+        uint64_t hash;
+    };
+
+    DuplicateFilter();
+
+    // Negative disables the filter; 0 rejects identical hashes only
+    void setMaxDistance(int value) { maxDistance.store(value); }
+    int getMaxDistance() const { return maxDistance.load(); }
+
+    // Hashes the frame and compares it with the window; an admitted frame's
+    // hash joins the window
+    Result check(const camera_fb_t *fb);
+    // Empties the window
+    void reset();
+
+    static bool computeHash(const camera_fb_t *fb, uint64_t &hash);
+    static int distance(uint64_t a, uint64_t b) { return __builtin_popcountll(a ^ b); }
+
+private:
+    std::atomic<int> maxDistance;
+    uint64_t recent[WINDOW];
+    int count = 0;
+    int next = 0;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "hal/camera_backend.h"
+#include "session_container.h"
+
+// Camera source that plays back frames collected earlier, for reproducible
+// encode, storage and inference benchmarks. Files are read through
+// SDManager, so the same code replays from the SD card on the device and from
+// the host card directory in the native build.
+//
+// The source is either a directory of loose frames (picture<N>.rgb/.rgbz/.jpg,
+// played in frame-number order) or a packed session ("/session0007"). Only
+// frames in the active profile's format are served: raw RGB565 records for
+// the dataset and inference profiles, JPEG for preview. Compressed raw frames
+// (Rgbz) are read into a side buffer and unpacked into the frame. Frames come out as
+// the camera_fb_t the sensor driver would hand out.
+//
+// A non-zero frame rate paces acquire() like the sensor would; zero serves
+// frames as fast as they can be read. The source loops at the end unless
+// looping is turned off, in which case acquire() returns nullptr.
+class FileCameraBackend : public CameraBackend
+{
+public:
+    struct Stats
+    {
+        uint32_t served;
+        uint32_t readErrors;
+        uint32_t loops;      // times the source wrapped around
+        uint64_t bytesRead;
+        uint64_t readUs;     // time spent reading and checking frames
+    };
+
+    static FileCameraBackend &getInstance();
+
+    bool init(const CameraProfile &profile) override;
+    void deinit() override;
+    int reconfigure(const CameraProfile &running, const CameraProfile &target) override;
+    camera_fb_t *acquire() override;
+    void release(camera_fb_t *fb) override;
+    const char *lastError() const override { return error.c_str(); }
+
+    // Set while the camera is released; they take effect on the next init()
+    void setSource(const std::string &path) { source = path; }
+    void setFrameRate(unsigned int fps) { frameRate = fps; }
+    void setLooping(bool loop) { looping = loop; }
+
+    const std::string &getSource() const { return source; }
+    size_t frameCount() const;
+    Stats getStats() const { return stats; }
+
+private:
+    FileCameraBackend() {}
+    static const char *TAG;
+
+    std::string source;
+    unsigned int frameRate = 0;
+    bool looping = true;
+
+    CameraProfile profile = {};
+    uint32_t sessionId = 0;
+    bool isSession = false;
+    Session::Reader reader;
+    std::vector<Session::IndexEntry> records; // session frames of the profile's format
+    std::vector<std::string> files;           // loose frames of the profile's format
+    size_t next = 0;
+    unsigned long nextFrameDueUs = 0;
+
+    uint8_t *buffer = nullptr;
+    size_t capacity = 0;
+    uint8_t *packed = nullptr;
+    size_t packedCapacity = 0;
+    bool inUse = false;
+    camera_fb_t frame = {};
+    Stats stats = {};
+    std::string error;
+
+    bool scanSession();
+    bool scanDirectory();
+    bool reserve(uint8_t *&target, size_t &targetCapacity, size_t bytes);
+    bool readNext(size_t &len);
+    bool unpack(size_t &len);
+    bool describe(size_t len);
+    void waitForFrameTime();
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "esp_camera.h"
+#include "esp_log.h"
+
+class FramePool;
+
+// Shared, reference-counted handle to a pooled frame. Copies are cheap and
+// point at the same pixels; the buffer goes back to its pool when the last
+// handle is destroyed or reset. Frames are read-only once handed out.
+class FrameRef
+{
+public:
+    FrameRef() {}
+    FrameRef(const FrameRef &other);
+    FrameRef(FrameRef &&other) noexcept;
+    FrameRef &operator=(const FrameRef &other);
+    FrameRef &operator=(FrameRef &&other) noexcept;
+    ~FrameRef() { reset(); }
+
+    void reset();
+    explicit operator bool() const { return slot != nullptr; }
+
+    const camera_fb_t *get() const;
+    const camera_fb_t *operator->() const { return get(); }
+    const uint8_t *data() const { return get()->buf; }
+    size_t size() const { return get()->len; }
+    int useCount() const;
+
+private:
+    friend class FramePool;
+    struct Slot;
+    explicit FrameRef(Slot *slot) : slot(slot) {}
+    Slot *slot = nullptr;
+};
+
+// Fixed set of PSRAM frame buffers owned by CameraManager. Buffers are
+// allocated on first use at the size actually needed and reused after that,
+// so steady-state capture does no heap allocation.
+class FramePool
+{
+public:
+    struct Stats
+    {
+        uint32_t capacity;
+        uint32_t inUse;
+        uint32_t peakInUse;
+        uint32_t acquired;
+        uint32_t exhausted;     // acquire() found every buffer referenced
+        uint32_t allocFailures; // PSRAM allocation failed
+        size_t allocatedBytes;
+    };
+
+    static const int MAX_BUFFERS = 8;
+
+    FramePool();
+    ~FramePool();
+
+    // False while frames from before the last end() are still referenced
+    bool begin(int bufferCount);
+    // Frees the buffers; handles still alive keep theirs until released,
+    // and the last of them frees the pool storage
+    void end();
+
+    // Empty handle when no buffer is free or PSRAM is exhausted. The buffer
+    // is sized for `bytes`; fill it through writable() before sharing.
+    FrameRef acquire(size_t bytes);
+    static camera_fb_t *writable(FrameRef &frame);
+
+    Stats getStats();
+
+private:
+    friend class FrameRef;
+    static const char *TAG;
+
+    FrameRef::Slot *slots;
+    int slotCount;
+    int retiredCount; // slots still referenced after end(), under statsMutex
+    QueueHandle_t freeSlots;
+    SemaphoreHandle_t statsMutex;
+    Stats stats;
+
+    // Drops one reference; the last one returns the slot or, after end(),
+    // frees it
+    void release(FrameRef::Slot *slot);
+};
+
+struct FrameRef::Slot
+{
+    FramePool *pool;
+    camera_fb_t frame;
+    size_t capacity;
+    std::atomic<int> refs; // increments are lock-free, decrements under statsMutex
+    bool retired; // pool ended while the frame was still referenced
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Turns an RGB565 frame into a model's int8 input tensor in one pass.
+//
+// Unpacking, colour conversion, cropping, resampling and quantisation are
+// fused: each output row reads the source rows it covers once, straight
+// from the frame buffer, and writes finished tensor values, so there is no
+// full-frame grey or RGB888 copy and no intermediate resized image.
+//
+// Resampling is integer-only and identical on every target:
+// - AREA averages the box of source pixels each output pixel covers, with
+//   box edges at floor(i * roi / size) and the mean rounded half up. It is
+//   the right filter when shrinking; it cannot enlarge.
+// - BILINEAR samples at pixel centres (half-pixel offset, edges clamped)
+//   with 8-bit weights: the horizontal pass keeps 16 bits, the vertical
+//   pass rounds to 8.
+// Luma is (77 R + 150 G + 29 B) >> 8 of the 8-bit channels, computed as two
+// table lookups per pixel (one per RGB565 byte). The resulting 8-bit value
+// goes through the caller's 256-entry quantisation table.
+//
+// configure() precomputes the column tables; run() does no allocation.
+class FramePreprocessor
+{
+public:
+    static const int MAX_WIDTH = 320; // output columns
+    static const int MAX_CHANNELS = 3;
+
+    enum Resample
+    {
+        AREA,
+        BILINEAR
+    };
+
+    // Source pixels; a zero width or height means the whole frame
+    struct Region
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    struct Layout
+    {
+        int sourceWidth;
+        int sourceHeight;
+        Region roi;
+        int width; // output tensor [height, width, channels]
+        int height;
+        int channels; // 1: luma, 3: RGB
+        Resample resample;
+    };
+
+    FramePreprocessor();
+
+    // false when the layout cannot be produced (ROI outside the frame, AREA
+    // asked to enlarge, output wider than MAX_WIDTH, 2 channels...)
+    bool configure(const Layout &layout, const int8_t quantize[256]);
+    bool isConfigured() const { return configured; }
+    void reset() { configured = false; }
+    // With the ROI resolved to source pixels
+    const Layout &getLayout() const { return layout; }
+
+    // `frame` is a big-endian RGB565 frame of the configured source size;
+    // `out` receives height * width * channels values
+    void run(const uint8_t *frame, int8_t *out);
+
+private:
+    static const char *TAG;
+
+    Layout layout;
+    bool configured;
+    int8_t quantize[256];
+    uint16_t lumaHigh[256]; // rgb565LumaTables()
+    uint16_t lumaLow[256];
+    // Per output column: AREA box [start, end); BILINEAR left source column,
+    // right source column and right weight (0..256)
+    uint16_t columnStart[MAX_WIDTH];
+    uint16_t columnEnd[MAX_WIDTH];
+    uint16_t columnWeight[MAX_WIDTH];
+    union
+    {
+        uint32_t sums[MAX_WIDTH * MAX_CHANNELS];         // AREA row accumulators
+        uint16_t rows[2][MAX_WIDTH * MAX_CHANNELS];      // BILINEAR horizontal passes
+    };
+    int cachedRows[2]; // source rows held in rows[], -1 when empty
+
+    template <int CHANNELS>
+    void load(const uint8_t *pixel, int *values) const;
+    template <int CHANNELS>
+    void runArea(const uint8_t *frame, int8_t *out);
+    template <int CHANNELS>
+    void runBilinear(const uint8_t *frame, int8_t *out);
+    template <int CHANNELS>
+    void horizontal(const uint8_t *row, uint16_t *out) const;
+};
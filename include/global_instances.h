@@ -4,6 +4,7 @@
 #include "ble_service.h"
 #include "preview_service.h"
 #include "data_collector.h"
+#include "model_inference.h"
 #include "display_manager.h"
 #include "buzzer_manager.h"
 #include "rtc_manager.h"
@@ -14,8 +15,5 @@ extern DisplayManager& display;
 extern BuzzerManager& buzzer;
 extern RTCManager& rtc;
 
-#ifdef PRODUCTION_MODE
-extern ModelInference inference;
-#else
 extern DataCollector collector;
-#endif
\ No newline at end of file
+extern ModelInference inference;
\ No newline at end of file
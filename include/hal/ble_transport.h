@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// GATT plumbing behind CustomBLEService. The device implementation owns the
+// NimBLE server and characteristics; the native build uses an in-process
+// loopback that records notifications and lets the host inject writes.
+class BleTransport
+{
+public:
+    enum class Channel
+    {
+        STATUS,
+        PREVIEW_INFO,
+        SERVICE_STATUS,
+        SERVICE_METRICS
+    };
+
+    using WriteHandler = std::function<void(const std::string &value)>;
+    using ConnectionHandler = std::function<void(bool connected)>;
+
+    virtual ~BleTransport() = default;
+
+    virtual bool begin(const char *deviceName, const std::string &commandMenu) = 0;
+    virtual void setHandlers(WriteHandler onWrite, ConnectionHandler onConnection) = 0;
+
+    // Sets the characteristic value and notifies subscribed clients.
+    virtual bool publish(Channel channel, const std::string &value) = 0;
+
+    virtual int connectedCount() = 0;
+    virtual bool startAdvertising() = 0;
+    virtual bool isAdvertising() = 0;
+    virtual void stopAdvertising() = 0;
+};
+
+// Provided by the platform translation units (src/esp32 or src/native).
+BleTransport &defaultBleTransport();
@@ -0,0 +1,19 @@
+#pragma once
+
+// Tone output behind BuzzerManager. Tones are given as the half period in
+// microseconds, matching BuzzerManager's note table. Only the buzzer task
+// calls into the backend, so playTone() and rest() may block for their
+// duration; silence() ends the current tone.
+class BuzzerBackend
+{
+public:
+    virtual ~BuzzerBackend() = default;
+
+    virtual bool begin(int pin) = 0;
+    virtual void playTone(int halfPeriodUs, int durationMs) = 0;
+    virtual void rest(int durationMs) = 0;
+    virtual void silence() = 0;
+};
+
+// Provided by the platform translation units (src/esp32 or src/native).
+BuzzerBackend &defaultBuzzerBackend();
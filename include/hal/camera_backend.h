@@ -0,0 +1,31 @@
+#pragma once
+
+#include <esp_camera.h>
+#include "camera_profile.h"
+
+// Frame producer behind CameraManager. The device implementation drives the
+// OV sensor through esp32-camera; the native build replays frames from disk.
+class CameraBackend
+{
+public:
+    virtual ~CameraBackend() = default;
+
+    // Brings the driver up with frame buffers and sensor settings for profile
+    virtual bool init(const CameraProfile &profile) = 0;
+    virtual void deinit() = 0;
+
+    // Writes the sensor settings in which target differs from the running
+    // profile, keeping the frame buffers (see CameraProfile::needsReallocation).
+    // Returns the number of settings written, or -1 if the sensor refused one.
+    virtual int reconfigure(const CameraProfile &running, const CameraProfile &target) = 0;
+
+    // Returns the next frame or nullptr. Every acquired frame must be handed
+    // back with release() before the backend can reuse its buffer.
+    virtual camera_fb_t *acquire() = 0;
+    virtual void release(camera_fb_t *fb) = 0;
+
+    virtual const char *lastError() const = 0;
+};
+
+// Provided by the platform translation units (src/esp32 or src/native).
+CameraBackend &defaultCameraBackend();
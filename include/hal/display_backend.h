@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Drawing surface behind DisplayManager. The buffer uses the SSD1306/U8g2
+// page layout: one byte per 8-pixel column slice, width bytes per page.
+class DisplayBackend
+{
+public:
+    virtual ~DisplayBackend() = default;
+
+    // Initialises the panel with the default font (4x6, top-aligned).
+    virtual bool begin() = 0;
+
+    virtual void clearBuffer() = 0;
+    virtual void sendBuffer() = 0;
+    // Sends one page (width bytes, 8 pixel rows) from data, which need not
+    // be the drawing buffer
+    virtual void sendPage(uint8_t page, const uint8_t *data) = 0;
+
+    virtual void drawStr(int x, int y, const char *text) = 0;
+    virtual void drawXBM(int x, int y, int width, int height, const uint8_t *bitmap) = 0;
+    virtual void drawFrame(int x, int y, int width, int height) = 0;
+    virtual void drawBox(int x, int y, int width, int height) = 0;
+    virtual void setFont(const uint8_t *font) = 0;
+
+    virtual int cursorX() const = 0;
+    virtual int cursorY() const = 0;
+    virtual uint16_t width() const = 0;
+    virtual uint16_t height() const = 0;
+    virtual uint8_t *buffer() = 0;
+};
+
+// Provided by the platform translation units (src/esp32 or src/native).
+DisplayBackend &defaultDisplayBackend();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interpreter behind ModelInference. Runs a fully int8-quantised .tflite
+// model with every tensor planned into a caller-owned arena. The device
+// implementation is TensorFlow Lite Micro (TensorFlowLite_ESP32); the
+// native build interprets the same file with TFLM's reference integer
+// arithmetic, so host and device outputs for the same input can be compared.
+class InferenceBackend
+{
+public:
+    struct Tensor
+    {
+        int8_t *data;
+        int dims[4];  // NHWC, dimCount of them used
+        int dimCount;
+        size_t bytes;
+        float scale;  // real = scale * (q - zeroPoint)
+        int zeroPoint;
+    };
+
+    virtual ~InferenceBackend() = default;
+
+    // Parses the model, which must stay valid until unload(), and plans its
+    // tensors into the arena. Fails on unsupported operators or types, or
+    // when the plan does not fit.
+    virtual bool load(const uint8_t *model, size_t modelBytes, uint8_t *arena, size_t arenaBytes) = 0;
+    virtual void unload() = 0;
+
+    // First input and output of the loaded model; data lives in the arena
+    virtual Tensor input() = 0;
+    virtual Tensor output() = 0;
+    virtual bool invoke() = 0;
+
+    // Arena high-water mark of the loaded model
+    virtual size_t arenaUsedBytes() const = 0;
+    virtual const char *name() const = 0;
+    virtual const char *lastError() const = 0;
+};
+
+// Provided by the platform translation units (src/esp32 or src/native).
+InferenceBackend &defaultInferenceBackend();
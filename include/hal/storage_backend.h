@@ -0,0 +1,22 @@
+#pragma once
+
+#include <FS.h>
+
+// Filesystem behind SDManager. On the device this is the SPI SD card; the
+// native build maps the card root onto a host directory.
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() = default;
+
+    virtual bool mount() = 0;
+    virtual void unmount() = 0;
+
+    virtual File open(const char *path, const char *mode) = 0;
+    virtual bool exists(const char *path) = 0;
+    virtual bool remove(const char *path) = 0;
+    virtual bool mkdir(const char *path) = 0;
+};
+
+// Provided by the platform translation units (src/esp32 or src/native).
+StorageBackend &defaultStorageBackend();
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Bird's-eye view of the road through a precomputed remap table.
+//
+// A ground quad in the camera frame (in practice a trapezoid whose sides
+// meet at the vanishing point) is mapped onto a width x height top-down
+// image by the homography taking the output's corners to the quad's. The
+// homography is only evaluated by build(), once per calibration: every
+// output pixel gets one 32-bit table entry holding the index of the top-left
+// source pixel of its 2x2 neighbourhood and the sample position's fraction
+// in 1/16 pixel steps (FRACTION_BITS) in x and y. Output pixels whose source
+// lies outside the frame get INVALID and come out black.
+//
+// warp() then runs per frame without any floating point: output rows in
+// order, each entry a gather of two adjacent pixels on two adjacent source
+// rows, luma from two byte lookups per pixel and a 4-bit bilinear blend.
+// Only the source rows under the quad are read. Neighbouring entries point
+// at neighbouring pixels on the same one or two source rows, so the reads
+// stream through the cache even from PSRAM.
+//
+// The table lives in PSRAM. begin() loads it from a file on the card when
+// that was built for the same layout (magic, version, layout and CRC-32
+// must match) and otherwise builds it and writes the file.
+class InversePerspectiveMap
+{
+public:
+    static const int FRACTION_BITS = 4;
+    static const uint32_t INVALID = 0xFFFFFFFF;
+
+    // Source corners of the output's top-left, top-right, bottom-right and
+    // bottom-left corners, as fractions of the frame width and height
+    struct Quad
+    {
+        float x[4];
+        float y[4];
+
+        // From the frame's bottom corners towards the vanishing point, cut
+        // at row `top` (fractions of the frame): lines parallel on the road
+        // come out parallel in the top-down view
+        static Quad fromVanishingPoint(float vanishX, float vanishY, float top);
+    };
+
+    struct Layout
+    {
+        int sourceWidth;
+        int sourceHeight;
+        int width; // top-down image
+        int height;
+        Quad quad;
+    };
+
+    InversePerspectiveMap();
+    ~InversePerspectiveMap();
+
+    // Loads the table for `layout` from `path`, or builds and saves it
+    bool begin(const Layout &layout, const char *path);
+    // Computes the homography and fills the table
+    bool build(const Layout &layout);
+    bool load(const char *path, const Layout &layout);
+    bool save(const char *path) const;
+    bool isReady() const { return table != nullptr; }
+    bool wasLoaded() const { return loaded; }
+
+    const Layout &getLayout() const { return layout; }
+    const uint32_t *getTable() const { return table; }
+    size_t tableBytes() const { return static_cast<size_t>(layout.width) * layout.height * sizeof(uint32_t); }
+    // Source rows warp() reads, [first, last]
+    int firstSourceRow() const { return firstRow; }
+    int lastSourceRow() const { return lastRow; }
+
+    // `frame` is a big-endian RGB565 frame of the layout's source size;
+    // `out` receives width * height luma values, row by row
+    void warp(const uint8_t *frame, uint8_t *out) const;
+
+private:
+    struct __attribute__((packed)) FileHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        int32_t sourceWidth;
+        int32_t sourceHeight;
+        int32_t width;
+        int32_t height;
+        float quadX[4];
+        float quadY[4];
+        uint32_t tableCrc;
+        uint32_t crc; // over all preceding fields
+    };
+
+    static const char *TAG;
+    static const uint32_t FILE_MAGIC = 0x50584D46; // "FMXP"
+    static const uint16_t FILE_VERSION = 1;
+
+    Layout layout;
+    uint32_t *table;
+    bool loaded;
+    int firstRow;
+    int lastRow;
+    uint16_t lumaHigh[256]; // rgb565LumaTables()
+    uint16_t lumaLow[256];
+
+    bool allocate(const Layout &wanted);
+    void release();
+    void findSourceRows();
+    FileHeader header() const;
+};
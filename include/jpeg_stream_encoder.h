@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "config.h"
+
+// Baseline JPEG encoder that reads an RGB565 frame one MCU (8x8 or 16x16
+// pixels) at a time and hands the output to a sink in CHUNK_BYTES pieces as
+// it is produced. Nothing is allocated: the working set is the encoder
+// object itself (a few KB), against a full-frame RGB888 copy plus a
+// worst-case output buffer for frame2jpg.
+//
+// The coding follows toojpeg: Annex K quantisation tables scaled by quality
+// (IJG scaling, 1..100), an AAN float DCT and the standard Huffman tables.
+// Chroma is either kept at full resolution (4:4:4) or averaged over 2x2
+// pixels (4:2:0, the device converter's default). Not thread-safe; use one
+// encoder per task.
+class JpegStreamEncoder
+{
+public:
+    enum Subsampling
+    {
+        SUBSAMPLE_444,
+        SUBSAMPLE_420
+    };
+
+    // Same contract as jpg_out_cb: index is the offset of data within the
+    // output; returns the bytes consumed. Anything short aborts the encode.
+    typedef size_t (*Sink)(void *arg, size_t index, const void *data, size_t len);
+
+    static const size_t CHUNK_BYTES = JPEG_STREAM_CHUNK_BYTES;
+
+    explicit JpegStreamEncoder(uint8_t quality = CAPTURE_JPEG_QUALITY, Subsampling subsampling = SUBSAMPLE_420);
+
+    void setQuality(uint8_t quality);
+    uint8_t getQuality() const { return quality; }
+    void setSubsampling(Subsampling mode) { subsampling = mode; }
+    Subsampling getSubsampling() const { return subsampling; }
+
+    // Encodes a big-endian RGB565 frame (esp32-camera byte order)
+    bool encode(const camera_fb_t *fb, Sink sink, void *arg);
+    // Bytes emitted by the last call
+    size_t encodedBytes() const { return emitted + fill; }
+
+    // Pieces for splitting a frame into restart intervals (ParallelJpegEncoder).
+    // Headers run from SOI to SOS and carry a DRI of restartInterval MCUs when
+    // non-zero. Rows are the entropy-coded data of whole MCU rows, starting
+    // from fresh DC predictors and padded to a byte; the caller writes the
+    // RSTn markers between them and the EOI.
+    bool encodeHeaders(const camera_fb_t *fb, uint16_t restartInterval, Sink sink, void *arg);
+    bool encodeRows(const camera_fb_t *fb, int firstRow, int rowCount, Sink sink, void *arg);
+    int mcuSize() const { return subsampling == SUBSAMPLE_420 ? 16 : 8; }
+    static bool isEncodable(const camera_fb_t *fb);
+
+private:
+    static const char *TAG;
+
+    uint8_t quality;
+    Subsampling subsampling;
+    // Reciprocal quantiser per coefficient, natural order, AAN scale folded in
+    float lumaScale[64];
+    float chromaScale[64];
+    uint8_t lumaTable[64];
+    uint8_t chromaTable[64];
+
+    // Output state for one encode()
+    Sink sink = nullptr;
+    void *sinkArg = nullptr;
+    uint8_t chunk[CHUNK_BYTES];
+    size_t fill = 0;
+    size_t emitted = 0;
+    bool failed = false;
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    int previousDc[3];
+
+    // One MCU: up to four luma blocks and one block per chroma component
+    float blocks[6][64];
+
+    void startOutput(Sink output, void *arg);
+    bool finishOutput();
+    void writeHeaders(uint16_t width, uint16_t height, uint16_t restartInterval);
+    void writeRows(const camera_fb_t *fb, int firstRow, int rowCount);
+    void loadMcu(const uint8_t *pixels, int width, int height, int mcuX, int mcuY);
+    void encodeBlock(float *block, const float *scale, int component);
+    void putByte(uint8_t byte);
+    void putBytes(const uint8_t *data, size_t len);
+    void putMarker(uint8_t marker, uint16_t length);
+    void putBits(uint32_t code, int length);
+    void flushBits();
+    void flushChunk();
+};
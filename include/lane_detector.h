@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "config.h"
+#include "frame_preprocessor.h"
+#include "lane_result.h"
+
+// Classical lane finder: a deterministic baseline for the model and the
+// fallback when none is loaded. Integer arithmetic on fixed buffers; the
+// only floating point is the final line fit.
+//
+// 1. The frame below the road top (LaneResult::ROI_TOP unless the mount
+//    calibration moves it) is area-averaged to a WORK_WIDTH x WORK_HEIGHT
+//    luma image (FramePreprocessor).
+// 2. A 3x3 Sobel pass finds paint: a rising horizontal gradient followed
+//    within MAX_MARKING_WIDTH pixels by a falling one (bright stripe on
+//    darker road) marks one point midway. Both gradients must be at least
+//    the edge threshold and steeper than the vertical gradient, which drops
+//    shadows, the horizon and car bumpers.
+// 3. The densest column of points near the bottom on each side of the image
+//    seeds a stack of WINDOWS search windows, searched up and then down from
+//    the seed's window. Each is re-centred on the points it holds, or carried
+//    along the current direction when it holds none, as across a dash gap.
+// 4. A least-squares line through each stack's points gives the boundary's
+//    x at the bottom row and at ROI_TOP, wherever the crop starts. A
+//    boundary counts as found when at least MIN_WINDOWS windows held paint;
+//    confidence is the fraction.
+//
+// Not thread safe: one task detects.
+class LaneDetector
+{
+public:
+    static const int WORK_WIDTH = 120;
+    static const int WORK_HEIGHT = 60;
+    static const int MAX_MARKING_WIDTH = 8; // work pixels between a stripe's edges
+    static const int MAX_ROW_POINTS = 8;
+    static const int WINDOWS = 10;
+    static const int WINDOW_MARGIN = 8; // work pixels either side of a window's centre
+    static const int MIN_WINDOW_POINTS = 2;
+    static const int MIN_WINDOWS = 3;
+    static constexpr float MIN_ROAD_TOP = 0.1f;
+    static constexpr float MAX_ROAD_TOP = 0.8f;
+
+    LaneDetector();
+
+    void setEdgeThreshold(int value) { edgeThreshold = value; }
+    int getEdgeThreshold() const { return edgeThreshold; }
+    // First row of the crop as a fraction of the frame height, clamped to
+    // [MIN_ROAD_TOP, MAX_ROAD_TOP]; below the horizon, so no sky is searched
+    void setRoadTop(float fraction);
+    float getRoadTop() const { return roadTop; }
+
+    // Fills `result` (frameMs and latencyUs included); false when the frame
+    // is not RGB565 or too small to work on
+    bool detect(const camera_fb_t *fb, LaneResult &result);
+
+    // Paint points found in the last frame, for harnesses
+    int pointCount() const;
+
+private:
+    static const char *TAG;
+
+    FramePreprocessor preprocessor;
+    int edgeThreshold;
+    float roadTop;
+    float resultRow; // work row (pixel-centre coordinates) of ROI_TOP
+    int8_t luma[WORK_WIDTH * WORK_HEIGHT]; // luma - 128
+    // Per work row: marking centres in half pixels (left + right edge)
+    uint8_t points[WORK_HEIGHT][MAX_ROW_POINTS];
+    uint8_t rowPoints[WORK_HEIGHT];
+
+    bool prepare(const camera_fb_t *fb);
+    void findMarkings();
+    int findBase(int from, int to, int &row) const;
+    void trace(int base, int baseRow, LaneLine &line) const;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+// Lane boundaries found in one camera frame. Every lane detector (the model
+// in ModelInference, and anything that replaces or checks it) reports in
+// this form so later stages do not care where a result came from.
+//
+// A boundary is the straight segment between the bottom row of the frame
+// and the row at ROI_TOP of the frame height, given by its x at both ends as
+// a fraction of the frame width (0 left edge, 1 right edge; values outside
+// the frame are allowed).
+struct LaneLine
+{
+    bool found;
+    float bottomX;
+    float topX;
+    float confidence; // 0..1
+};
+
+struct LaneResult
+{
+    static constexpr float ROI_TOP = 0.5f;
+
+    LaneLine left;
+    LaneLine right;
+    unsigned long frameMs; // capture time of the frame
+    uint32_t latencyUs;    // frame to result
+
+    bool valid() const { return left.found && right.found; }
+
+    // Camera position between the boundaries at the bottom row: -1 on the
+    // left line, 0 centred, 1 on the right line; 0 without both lines
+    float offset() const
+    {
+        float width = right.bottomX - left.bottomX;
+        if (!valid() || width <= 0)
+        {
+            return 0;
+        }
+        return (0.5f - (left.bottomX + right.bottomX) / 2) / (width / 2);
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "lane_result.h"
+
+// Follows the lane between detections, so the model or the classical
+// detector only runs on some frames while every frame still gets a result.
+//
+// Each boundary is tracked as its bottom x and its heading (top x minus
+// bottom x), each by an alpha-beta filter: the value moves at a constant
+// rate between detections, and a detection corrects it by LANE_TRACK_ALPHA
+// of the residual and the rate by LANE_TRACK_BETA of the residual per
+// second. A detection further than LANE_TRACK_GATE from the prediction is a
+// jump (a lane change, a bad detection) and restarts the track from it.
+//
+// check() asks for a detection on every interval-th frame, and sooner when
+// a boundary has no track, a track's confidence has faded under
+// LANE_TRACK_MIN_CONFIDENCE, or the last detection jumped. A boundary the
+// detector misses keeps its track, still reported while confident enough.
+//
+// Not thread safe: one task tracks.
+class LaneTracker
+{
+public:
+    enum Reason
+    {
+        REASON_NONE,       // the prediction stands in for a detection
+        REASON_SCHEDULED,  // the interval-th frame
+        REASON_NO_TRACK,   // a boundary is not tracked
+        REASON_CONFIDENCE, // a track faded under LANE_TRACK_MIN_CONFIDENCE
+        REASON_JUMP,       // the last detection was further than the gate
+    };
+
+    LaneTracker();
+
+    // Frames per detection; at 1 every frame is detected and results pass
+    // through unfiltered
+    void setInterval(int frames);
+    int getInterval() const { return interval; }
+    // Drops both tracks; the next frame is detected
+    void reset();
+
+    // Whether the frame captured at `frameMs` needs a detection, and why
+    Reason check(unsigned long frameMs) const;
+    // Folds a detection of the frame at result.frameMs into the tracks and
+    // replaces the result with the filtered estimate
+    void update(LaneResult &result);
+    // The tracks extrapolated to a frame captured at `frameMs`
+    void predict(unsigned long frameMs, LaneResult &result);
+
+private:
+    struct Filter
+    {
+        float value;
+        float rate; // per second
+
+        float at(float seconds) const { return value + rate * seconds; }
+    };
+
+    struct Track
+    {
+        bool active;
+        float confidence;        // of the last detection
+        unsigned long updatedMs; // capture time the filters refer to
+        Filter bottom;
+        Filter heading;
+    };
+
+    int interval;
+    int predicted; // frames since the last detection
+    bool jumped;
+    Track tracks[2]; // left, right
+
+    float confidence(const Track &track, unsigned long frameMs) const;
+    void correct(Track &track, const LaneLine &line, unsigned long frameMs);
+    void fill(const Track &track, unsigned long frameMs, LaneLine &line) const;
+};
@@ -1,9 +1,10 @@
 #pragma once
 
 #include <AceButton.h>
-#include <U8g2lib.h>
+#include <U8g2lib.h> // fonts
 #include <esp_log.h>
 #include "config.h"
+#include "display_manager.h"
 #include "system_init.h"
 #include "global_instances.h"
 #include "Version.h"
@@ -14,18 +15,20 @@ using namespace ace_button;
 class MenuHandler
 {
 public:
-    MenuHandler(U8G2 &display);
+    MenuHandler(DisplayManager &display);
     void begin();
     void update();
     void handleEvent(AceButton *button, uint8_t eventType, uint8_t buttonState);
 
 private:
     static void buttonEventHandler(AceButton *button, uint8_t eventType, uint8_t buttonState);
-    void drawMenu();
+    void drawMenu(DisplayBackend &canvas);
     void executeMenuItem();
-    void drawDefaultScreen();
+    void showMessage(const char *text);
+    void drawDefaultScreen(DisplayBackend &canvas);
+    void drawLane(DisplayBackend &canvas, const LaneResult &result);
 
-    U8G2 &display;
+    DisplayManager &display;
     AceButton button;
     ButtonConfig buttonConfig;
 
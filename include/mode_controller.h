@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "ble_service.h"
+#include "command_bus.h"
+#include "esp_log.h"
+
+// Owns the operating mode. A single task drains CommandBus in post order and
+// runs the mode state machine, so mode changes never race each other no
+// matter where the command came from. BLE settings writes are applied on the
+// same task, in order with the commands around them.
+//
+// Modes are exclusive. Switching tears the current mode down through its
+// exit handler (WiFi, MJPEG server, capture session) and brings the new one
+// up through its enter handler, in place; nothing restarts the chip. The
+// mode reads idle while its exit handler runs, and the handler returns only
+// once the main task is out of the mode's loop. The camera stays powered between active modes, which switch its profile, and
+// is released when the device goes idle. A mode whose enter handler fails
+// leaves the device idle. Both the time from
+// post() to the command being applied and the teardown + bring-up time of
+// every switch are recorded.
+class ModeController
+{
+public:
+    enum Mode : uint8_t
+    {
+        MODE_IDLE,
+        MODE_PREVIEW,
+        MODE_CAPTURE,
+        MODE_INFERENCE,
+        MODE_COUNT
+    };
+
+    using EnterHandler = std::function<bool()>;
+    using ExitHandler = std::function<void()>;
+
+    struct Stats
+    {
+        uint32_t applied;
+        uint32_t unknown;    // code not recognised, reported back over BLE
+        uint32_t outOfOrder; // per-source FIFO violated; must stay 0
+        uint32_t appliedBySource[CommandBus::SOURCE_COUNT];
+        uint32_t lastLatencyUs;
+        uint32_t maxLatencyUs;
+        uint64_t totalLatencyUs;
+
+        uint32_t switches;
+        uint32_t switchFailures; // enter handler failed, left idle
+        uint32_t overBudget;     // switch slower than SWITCH_BUDGET_MS
+        uint32_t lastSwitchUs;
+        uint32_t maxSwitchUs;
+        uint64_t totalSwitchUs;
+    };
+
+    // Target for teardown + bring-up of one switch
+    static const unsigned long SWITCH_BUDGET_MS = 500;
+
+    static ModeController &getInstance()
+    {
+        static ModeController instance;
+        return instance;
+    }
+
+    // Registers how a mode is brought up and torn down. Either may be empty.
+    void setHandlers(Mode mode, EnterHandler enter, ExitHandler exit);
+
+    // Starts the controller task; commands posted earlier are already queued
+    bool begin(CustomBLEService &service);
+    bool isRunning() const { return taskHandle != nullptr; }
+    Mode mode() const { return current.load(); }
+
+    // Waits until every command posted so far has been applied
+    bool drain(unsigned long timeoutMs);
+
+    Stats getStats();
+    void resetStats();
+
+    static const char *modeName(Mode mode);
+
+private:
+    struct Handlers
+    {
+        EnterHandler enter;
+        ExitHandler exit;
+    };
+
+    static const char *TAG;
+
+    CustomBLEService *service = nullptr;
+    TaskHandle_t taskHandle = nullptr;
+    std::atomic<Mode> current;
+    Handlers handlers[MODE_COUNT];
+    SemaphoreHandle_t statsMutex;
+    Stats stats;
+    uint32_t appliedTotal = 0; // not cleared by resetStats(), for drain()
+    uint32_t lastSequence[CommandBus::SOURCE_COUNT];
+    bool seen[CommandBus::SOURCE_COUNT];
+
+    ModeController();
+    ModeController(const ModeController &) = delete;
+    ModeController &operator=(const ModeController &) = delete;
+
+    static void controllerTask(void *parameter);
+    void apply(const CommandBus::Message &message);
+    bool targetFor(uint8_t code, Mode &target);
+    void switchTo(Mode target);
+};
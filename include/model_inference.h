@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "ble_service.h"
+#include "camera_manager.h"
+#include "config.h"
+#include "esp_log.h"
+#include "frame_preprocessor.h"
+#include "hal/inference_backend.h"
+#include "lane_detector.h"
+#include "lane_result.h"
+#include "lane_tracker.h"
+
+// On-device lane model, run in inference mode.
+//
+// The model is an int8 .tflite file (INFERENCE_MODEL_PATH on the SD card)
+// planned once into a statically reserved tensor arena of
+// INFERENCE_ARENA_BYTES; nothing is allocated per frame. Its contract:
+//
+//   input  [1, H, W, C] int8, C = 1 (luma) or 3 (RGB), pixel values 0..1
+//          quantised with the tensor's scale and zero point
+//   output 6 int8 values: left bottomX, left topX, left confidence logit,
+//          right bottomX, right topX, right confidence logit (see LaneResult)
+//
+// Each frame is written into the input tensor by FramePreprocessor in one
+// pass (area-averaged to H x W, or interpolated for a model larger than the
+// frame, through a 256-entry lookup that folds in the input quantisation),
+// run through the InferenceBackend
+// (TFLite Micro on the device, the reference
+// interpreter on the host) and decoded into a LaneResult. Invoke latency
+// and the arena high-water mark are published as `inference` metrics.
+//
+// Without a model (LANE_DETECTOR_FALLBACK) inference mode runs LaneDetector
+// instead; results, metrics and the display work the same, with backend
+// "classical" and the detection time standing in for the invoke time.
+//
+// loop() detects on one frame in LANE_TRACK_INTERVAL and LaneTracker
+// extrapolates the lane for the frames between, so results keep the camera's
+// rate; the metrics report how many frames were tracked instead of detected.
+class ModelInference
+{
+public:
+    struct Stats
+    {
+        uint32_t frames;  // results produced by loop()
+        uint32_t tracked; // of which predicted by the tracker
+        uint32_t forced;  // detections the tracker asked for ahead of schedule
+        uint32_t invokes;
+        uint32_t failures;
+        uint32_t lastInvokeUs;
+        uint32_t maxInvokeUs;
+        uint64_t totalInvokeUs;
+        uint64_t totalPreprocessUs;
+        size_t arenaUsed; // high-water mark of the loaded model
+        size_t arenaSize;
+        uint32_t overBudget; // classical frames over LANE_DETECTOR_BUDGET_US
+        uint32_t departures; // lane departure alerts raised
+    };
+
+    static const int OUTPUT_VALUES = 6;
+
+    ModelInference(CustomBLEService *ble);
+    ~ModelInference();
+
+    // Loads INFERENCE_MODEL_PATH from the SD card into the arena
+    bool begin();
+    // Loads a model the caller keeps alive while it is loaded (host harnesses)
+    bool loadModel(const uint8_t *model, size_t bytes);
+    bool isLoaded() const { return loaded; }
+    // True while inference mode runs the classical detector
+    bool isClassical() const { return classical; }
+    const char *lastError() const { return error; }
+
+    // Inference mode enter/exit, run by ModeController. stop() returns once
+    // a loop() in progress on the main task has finished.
+    bool start();
+    void stop();
+    // Produces the result for a fresh frame, detected or tracked; called
+    // from the main task
+    void loop();
+
+    // Scales, quantises, invokes and decodes one RGB565 frame
+    bool run(const camera_fb_t *fb, LaneResult &result);
+    // The first step of run(): fills the input tensor with the frame as the
+    // model sees it. The backend may reuse the input's memory for later
+    // activations, so the input is only meaningful until the next invoke.
+    bool preprocess(const camera_fb_t *fb, const InferenceBackend::Tensor &input);
+
+    LaneResult getLastResult();
+    Stats getStats();
+    InferenceBackend &getBackend() { return backend; }
+    LaneDetector &getDetector() { return detector; }
+    LaneTracker &getTracker() { return tracker; }
+
+private:
+    static const char *TAG;
+
+    InferenceBackend &backend;
+    CustomBLEService *bleService;
+    SemaphoreHandle_t statsMutex;
+    SemaphoreHandle_t loopMutex; // held across loop(), taken by stop() to wait for it
+    uint8_t *modelFile; // owned copy read from the SD card
+    bool loaded;
+    bool classical;
+    volatile bool running;
+    const char *error;
+    unsigned long lastMetricsUpdate;
+    int8_t quantize[256]; // 8-bit channel value -> input tensor value
+    FramePreprocessor preprocessor; // set up for the first frame after a load
+    LaneDetector detector;
+    LaneTracker tracker;
+    Stats stats;
+    LaneResult lastResult;
+    bool departing; // past LANE_DEPARTURE_OFFSET, not yet back under LANE_DEPARTURE_CLEAR
+
+    void step();
+    bool validateModel();
+    bool runDetector(const camera_fb_t *fb, LaneResult &result);
+    void decode(const InferenceBackend::Tensor &output, LaneResult &result);
+    bool checkDeparture(const LaneResult &result);
+    void publishMetrics();
+    void releaseModel();
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include "esp_log.h"
+#include "config.h"
+#include "inverse_perspective_map.h"
+#include "vanishing_point_estimator.h"
+
+// Where the camera looks, as measured from the road rather than assumed.
+//
+// The mount is the vanishing point of the road ahead, as fractions of the
+// frame; its row is the horizon. Nothing above it is road, so stages that
+// only need the road (the lane detector's crop, the bird's-eye quad) start
+// MOUNT_ROAD_MARGIN below it. The estimate comes from a batch of collected
+// frames (VanishingPointEstimator, on the device or through the host
+// `calibrate` command) and is kept in a small record at
+// MOUNT_CALIBRATION_PATH. A record is valid when its magic, version and
+// CRC-32 match and the point lies in the frame; without one the mount is
+// the configured IPM_VANISH_X, IPM_VANISH_Y and isCalibrated() is false.
+class MountCalibration
+{
+public:
+    struct Mount
+    {
+        float vanishX; // fractions of the frame width and height
+        float vanishY;
+        float spread;     // interquartile range of the estimate's rows
+        uint32_t frames;  // frames it was estimated from
+    };
+
+    static MountCalibration &getInstance()
+    {
+        static MountCalibration instance;
+        return instance;
+    }
+
+    // Reads the record; false (and the configured defaults) when there is no
+    // valid one
+    bool load();
+    bool isLoaded() const { return loaded; }
+    bool isCalibrated() const { return calibrated; }
+    const Mount &get() const { return mount; }
+
+    // Adopts and persists an estimate; false when the estimator did not
+    // settle (too few frames, too much spread) or the write failed
+    bool apply(VanishingPointEstimator &estimator);
+    bool save(const Mount &value);
+
+    float horizon() const { return mount.vanishY; }
+    // First row fraction worth processing for the road
+    float roadTop() const;
+    // The bird's-eye layout for this mount: the quad keeps the configured
+    // distance between IPM_VANISH_Y and IPM_TOP below the horizon
+    InversePerspectiveMap::Layout ipmLayout(int sourceWidth, int sourceHeight) const;
+
+private:
+    struct __attribute__((packed)) Record
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        float vanishX;
+        float vanishY;
+        float spread;
+        uint32_t frames;
+        uint32_t crc; // over all preceding fields
+    };
+
+    static const char *TAG;
+    static const uint32_t RECORD_MAGIC = 0x43584D46; // "FMXC"
+    static const uint16_t RECORD_VERSION = 1;
+
+    MountCalibration() : mount({IPM_VANISH_X, IPM_VANISH_Y, 0, 0}) {}
+    MountCalibration(const MountCalibration &) = delete;
+    MountCalibration &operator=(const MountCalibration &) = delete;
+
+    bool loaded = false;
+    bool calibrated = false;
+    Mount mount;
+
+    static bool plausible(float vanishX, float vanishY);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "jpeg_stream_encoder.h"
+
+// Splits a frame into horizontal stripes of whole MCU rows and encodes them
+// on several cores at once. Each stripe is one restart interval: its DC
+// predictors start from zero and it ends byte-aligned, so the stripes can be
+// coded independently and joined with RSTn markers into one baseline JPEG
+// whose DRI is the stripe's MCU count. The coefficients are the same as a
+// single JpegStreamEncoder pass; only the entropy coding restarts.
+//
+// The calling task is worker 0; begin() starts one helper task per extra
+// worker (helper k on core k % 2, so with two workers the helper runs on
+// the core the caller is not on when encoding from Pipe_Encode). Workers
+// pull stripes from a shared counter, which balances uneven content. Stripe
+// output is staged in PSRAM buffers that grow to the largest frame seen;
+// once every stripe is done the caller hands headers, stripes, markers and
+// EOI to the sink in order, in at most CHUNK_BYTES pieces.
+//
+// With one worker, or before begin(), encode() is the single streaming pass.
+class ParallelJpegEncoder
+{
+public:
+    static const int MAX_WORKERS = 4;
+    static const int MAX_STRIPES = 64;
+
+    struct Stats
+    {
+        uint32_t frames;
+        uint32_t stripes;
+        uint32_t lastEncodeUs;
+        uint32_t maxEncodeUs;
+        uint32_t workerStripes[MAX_WORKERS];
+        uint32_t workerBusyUs[MAX_WORKERS];
+    };
+
+    ParallelJpegEncoder(uint8_t quality = CAPTURE_JPEG_QUALITY,
+                        JpegStreamEncoder::Subsampling subsampling = JpegStreamEncoder::SUBSAMPLE_420,
+                        int workers = CAPTURE_JPEG_WORKERS);
+    ~ParallelJpegEncoder();
+    ParallelJpegEncoder(const ParallelJpegEncoder &) = delete;
+    ParallelJpegEncoder &operator=(const ParallelJpegEncoder &) = delete;
+
+    // Starts the helper tasks; end() stops them and frees the stripe buffers
+    bool begin();
+    void end();
+    bool isRunning() const { return helpersRunning > 0; }
+
+    bool encode(const camera_fb_t *fb, JpegStreamEncoder::Sink sink, void *arg);
+
+    void setQuality(uint8_t quality);
+    // MCU rows per stripe; raised as needed to stay within MAX_STRIPES
+    void setStripeRows(int rows) { stripeRows = rows < 1 ? 1 : rows; }
+    int getWorkers() const { return workers; }
+
+    // Written by the encoding task; read it from there
+    Stats getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    struct Stripe
+    {
+        uint8_t *data;
+        size_t len;
+        size_t capacity;
+        bool ok;
+    };
+
+    struct Helper
+    {
+        ParallelJpegEncoder *owner;
+        int worker;
+        SemaphoreHandle_t go;
+        TaskHandle_t task;
+    };
+
+    static const char *TAG;
+
+    int workers;
+    int stripeRows = 1;
+    JpegStreamEncoder *encoders[MAX_WORKERS];
+    Helper helpers[MAX_WORKERS];
+    int helpersRunning = 0;
+    SemaphoreHandle_t finished;
+    volatile bool stopping = false;
+
+    // Current frame, shared with the helpers between go and finished
+    const camera_fb_t *frame = nullptr;
+    int frameRows = 0;
+    int frameStripeRows = 0;
+    int stripeCount = 0;
+    std::atomic<int> nextStripe;
+    Stripe stripes[MAX_STRIPES];
+
+    Stats stats;
+
+    static void helperTask(void *parameter);
+    static size_t appendStripe(void *arg, size_t index, const void *data, size_t len);
+    void work(int worker);
+    bool encodeStriped(const camera_fb_t *fb, int mcusPerRow, JpegStreamEncoder::Sink sink, void *arg);
+    bool emit(JpegStreamEncoder::Sink sink, void *arg, size_t &offset, const uint8_t *data, size_t len);
+};
@@ -8,6 +8,7 @@
 #include "esp_log.h"
 #include "camera_manager.h"
 #include "ble_service.h"
+#include "mode_controller.h"
 #include <ArduinoJson.h>
 
 using namespace Eloquent::Esp32cam;
@@ -18,9 +19,10 @@ class PreviewService
 public:
     PreviewService(CustomBLEService* ble);
     bool begin();
-    void loop();
-    void enable();
+    // Preview mode enter/exit, run by ModeController
+    bool start();
     void disable();
+    void loop();
     bool isEnabled() { return streamEnabled; }
     String getStreamAddress() { return streamAddress; }
 
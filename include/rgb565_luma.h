@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// BT.601 luma of one RGB565 pixel, with the weights applied to the 8-bit
+// expansion of each channel: 0..255
+inline int rgb565Luma(uint16_t pixel)
+{
+    return (77 * ((pixel >> 11) << 3) + 150 * (((pixel >> 5) & 0x3F) << 2) + 29 * ((pixel & 0x1F) << 3)) >> 8;
+}
+
+// Same, for the big-endian byte pair the camera delivers
+inline int rgb565Luma(const uint8_t *pixel)
+{
+    return rgb565Luma(static_cast<uint16_t>((pixel[0] << 8) | pixel[1]));
+}
+
+// Byte tables for the per-pixel loops: (high[p[0]] + low[p[1]]) >> 8 is
+// rgb565Luma(p). Luma is linear in R, G and B, and each byte of the pair
+// holds whole bits of them: high = RRRRRGGG, low = GGGBBBBB
+inline void rgb565LumaTables(uint16_t high[256], uint16_t low[256])
+{
+    for (int value = 0; value < 256; value++)
+    {
+        high[value] = 77 * (value & 0xF8) + 150 * ((value & 0x07) << 5);
+        low[value] = 150 * ((value >> 5) << 2) + 29 * ((value & 0x1F) << 3);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lossless compression for raw RGB565 frames (.rgbz).
+//
+// Each pixel is split into its 5/6/5-bit channels and every channel is
+// predicted from its left, upper and upper-left neighbours (the LOCO-I
+// median predictor). Green is coded first; its prediction error is then
+// added, halved, to the red and blue predictions, since an edge or
+// exposure change usually moves all three channels together. The residuals
+// are Rice coded with a parameter that adapts per channel and per local
+// activity (flat, textured, edge), so flat road and sky cost a few bits
+// and noisy texture roughly the sensor's noise level.
+//
+// Coding is a single pass with no tables and no allocation: the encoder
+// reads the source frame and the decoder reconstructs in place in the
+// output frame, using the rows it has already decoded as context. When a
+// frame does not compress (pure noise), it is stored verbatim instead, so
+// the output is never more than HEADER_BYTES larger than the input.
+//
+// File layout: a 20-byte header, then the payload. All integers are
+// little-endian; pixels are big-endian RGB565 as the camera delivers them.
+namespace Rgbz
+{
+    static const uint32_t MAGIC = 0x5A424752; // "RGBZ"
+    static const uint8_t VERSION = 1;
+
+    enum Method : uint8_t
+    {
+        METHOD_STORED = 0, // payload is the frame as is
+        METHOD_RICE = 1
+    };
+
+    struct __attribute__((packed)) Header
+    {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t method;
+        uint16_t width;
+        uint16_t height;
+        uint16_t reserved;
+        uint32_t crc;    // CRC-32 of the decoded frame
+        uint32_t length; // payload bytes after the header
+    };
+
+    static_assert(sizeof(Header) == 20, "Header layout");
+    static const size_t HEADER_BYTES = sizeof(Header);
+
+    inline size_t frameBytes(uint16_t width, uint16_t height)
+    {
+        return static_cast<size_t>(width) * height * 2;
+    }
+
+    // Output capacity that always suffices for encode()
+    inline size_t maxEncodedSize(uint16_t width, uint16_t height)
+    {
+        return HEADER_BYTES + frameBytes(width, height);
+    }
+
+    // Returns the bytes written to out (header included), 0 if capacity is
+    // below maxEncodedSize() and the frame does not fit compressed
+    size_t encode(const uint8_t *pixels, uint16_t width, uint16_t height, uint8_t *out, size_t capacity);
+
+    // Validates magic, version, method and payload length against len
+    bool readHeader(const uint8_t *data, size_t len, Header &out);
+
+    // Decodes into pixels, which must hold frameBytes(width, height); fails
+    // on a malformed stream or a CRC mismatch
+    bool decode(const uint8_t *data, size_t len, uint8_t *pixels, size_t capacity);
+}
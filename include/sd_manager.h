@@ -1,17 +1,20 @@
 #pragma once
 
-#include <SD.h>
+#include <FS.h>
+#include "hal/storage_backend.h"
+#include "sd_write_cache.h"
 #include "esp_log.h"
 
 class SDManager {
 private:
     static SDManager* instance;
     static const char* TAG;
-    const int SD_CS_PIN = D2;  // XIAO Expansion Board SD CS pin
+    StorageBackend* backend;
     bool isInitialized = false;
+    SDWriteCache cache;
+
+    SDManager() : backend(&defaultStorageBackend()) {}  // Private constructor
 
-    SDManager() {}  // Private constructor
-    
 public:
     static SDManager& getInstance() {
         if (instance == nullptr) {
@@ -23,10 +26,18 @@ public:
     bool begin();
     bool end();
     bool isReady() const { return isInitialized; }
-    
+
+    // Swap the filesystem (host harnesses); only valid while unmounted
+    void setBackend(StorageBackend* newBackend);
+
     // Wrapper methods for common SD operations
     File openFile(const char* path, const char* mode);
     bool exists(const char* path);
     bool remove(const char* path);
+    bool mkdir(const char* path);
     File openDir(const char* path);
-}; 
\ No newline at end of file
+
+    // Creates (truncates) path as a write-behind stream; see SDWriteCache
+    SDStream openStream(const char* path);
+    SDWriteCache& writeCache() { return cache; }
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "esp_log.h"
+
+class SDWriteCache;
+
+// Append-only file written behind the caller by SDWriteCache. write() copies
+// into PSRAM and returns at memory speed. sync() queues the staged tail;
+// close() queues the tail and closes the file once it is written. Move-only;
+// destroying an open stream closes it.
+//
+// A stream built from a File instead writes straight through, with sync()
+// as a flush: SDManager's fallback when the cache is not running. A cache
+// stream whose slot was closed by SDWriteCache::end() writes nothing.
+class SDStream
+{
+public:
+    SDStream() {}
+    explicit SDStream(File file) : direct(file) {}
+    SDStream(SDStream &&other) noexcept;
+    SDStream &operator=(SDStream &&other) noexcept;
+    SDStream(const SDStream &) = delete;
+    SDStream &operator=(const SDStream &) = delete;
+    ~SDStream() { close(); }
+
+    size_t write(const uint8_t *data, size_t len);
+    void sync();
+    void close();
+    explicit operator bool() const { return cache != nullptr || static_cast<bool>(direct); }
+
+private:
+    friend class SDWriteCache;
+    SDStream(SDWriteCache *owner, int slot, uint32_t slotGeneration)
+        : cache(owner), id(slot), generation(slotGeneration) {}
+    SDWriteCache *cache = nullptr;
+    int id = -1;
+    uint32_t generation = 0; // of the slot when it was handed out
+    File direct;
+};
+
+// Write-behind layer of SDManager. Streams stage their data in a shared set
+// of CHUNK_COUNT PSRAM chunks; a full chunk is written by the SD_Writer task
+// in one CHUNK_BYTES write at a chunk-aligned file offset, which the FAT
+// driver turns into a multi-block transfer of whole clusters. A tail pushed
+// out by sync() is written from the same aligned offset and rewritten once
+// its chunk fills, so every write starts on a cluster boundary.
+//
+// FAT and directory updates (File::flush) are deferred to one pass over the
+// streams written since the last one, every syncInterval ms, and to close().
+// Callers only block when every chunk is queued (a stall).
+class SDWriteCache
+{
+public:
+    struct Stats
+    {
+        uint64_t bytesAccepted;  // handed to write()
+        uint64_t bytesWritten;   // sent to the card; rewritten tails count again
+        uint32_t bytesPerSecond; // sent, over the last full second
+        uint32_t writes;
+        uint32_t alignedWrites;  // whole chunks at a chunk boundary
+        uint32_t tailWrites;     // partial chunks pushed out by sync()/close()
+        uint32_t syncs;          // metadata flushes
+        uint32_t stalls;         // write() waited for a free chunk
+        uint32_t errors;
+        uint32_t queueDepth;
+        uint32_t maxQueueDepth;
+        // Device write latency over the last LATENCY_WINDOW writes
+        uint32_t writeP50Us;
+        uint32_t writeP90Us;
+        uint32_t writeP99Us;
+        uint32_t writeMaxUs;
+    };
+
+    static const size_t CHUNK_BYTES = SD_WRITE_CHUNK_BYTES;
+    static const int CHUNK_COUNT = SD_WRITE_CHUNKS;
+    static const int MAX_STREAMS = 4;
+    static const int LATENCY_WINDOW = 256;
+    static const unsigned long STALL_TIMEOUT_MS = 2000;
+
+    SDWriteCache();
+
+    // Allocates the chunks and starts the writer task
+    bool begin();
+    // Writes out and closes every open stream, then stops the writer task
+    // and frees the chunks; false (still running) when the writes do not
+    // finish within timeoutMs. Owners must have stopped writing.
+    bool end(unsigned long timeoutMs);
+    bool isRunning() const { return taskHandle != nullptr; }
+
+    // Takes over an open, empty file; an empty handle when all stream slots are in use
+    SDStream open(File file);
+    // Waits until everything queued so far is written and synced
+    bool drain(unsigned long timeoutMs);
+
+    void setSyncInterval(unsigned long ms) { syncIntervalMs = ms; }
+    unsigned long getSyncInterval() const { return syncIntervalMs; }
+
+    Stats getStats();
+    void resetStats();
+
+private:
+    friend class SDStream;
+
+    struct Chunk
+    {
+        uint8_t *data;
+        size_t fill;
+    };
+
+    enum JobKind : uint8_t
+    {
+        JOB_WRITE,
+        JOB_SYNC, // metadata sync of every stream written since the last one
+        JOB_CLOSE
+    };
+
+    struct Job
+    {
+        JobKind kind;
+        uint8_t stream;
+        bool recycle; // chunk goes back to the free list after the write
+        Chunk *chunk;
+        uint32_t offset;
+        uint32_t len;
+    };
+
+    struct StreamSlot
+    {
+        // Writer task side
+        File file;
+        bool dirty;
+        // Caller side
+        bool inUse;
+        uint32_t generation; // bumped each time the slot is handed out
+        Chunk *current;
+        uint32_t chunkOffset; // file offset of current->data[0]
+    };
+
+    static const char *TAG;
+
+    Chunk chunks[CHUNK_COUNT];
+    StreamSlot streams[MAX_STREAMS];
+    QueueHandle_t freeChunks;
+    QueueHandle_t jobs;
+    SemaphoreHandle_t mutex;
+    TaskHandle_t taskHandle = nullptr;
+    std::atomic<uint32_t> jobsQueued;
+    std::atomic<uint32_t> jobsDone;
+    unsigned long syncIntervalMs = SD_SYNC_INTERVAL_MS;
+
+    Stats stats;
+    uint32_t latencies[LATENCY_WINDOW];
+    uint32_t latencyCount = 0;
+    uint64_t bytesAtWindowStart = 0;
+    unsigned long windowStart = 0;
+
+    static void writerTask(void *parameter);
+    void process(const Job &job);
+    void syncDirty();
+    void enqueue(const Job &job);
+    bool owns(int stream, uint32_t generation);
+
+    size_t write(int stream, const uint8_t *data, size_t len);
+    void sync(int stream, bool recycle);
+    void close(int stream);
+};
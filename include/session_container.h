@@ -0,0 +1,154 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+#include "esp_log.h"
+#include "sd_write_cache.h"
+
+// Packed capture session on the SD card.
+//
+// A session is one directory holding append-only segment files and a side
+// index, instead of two loose files per frame in the card root:
+//
+//   /session0007/seg000.mfs    segment: 16-byte header, then records
+//   /session0007/seg001.mfs    next segment once SEGMENT_MAX_BYTES is reached
+//   /session0007/index.mfi     16-byte header, then one 16-byte entry per record
+//
+// Record: 20-byte header {magic, type, frame index, payload length, CRC-32}
+// followed by the payload. Index entry k sits at a fixed offset, so record k
+// is one seek away. All integers are little-endian.
+//
+// The writer streams both files through SDManager's write-behind cache and
+// pushes out the staged tails every FLUSH_INTERVAL frames, segment before
+// index; the cache syncs file metadata at its own cadence. After a power loss
+// the index may be missing entries or name records whose data never reached
+// the card; SessionReader drops the latter and rebuilds the index by walking
+// the length-prefixed records.
+//
+// A record cut short by a failed write is never indexed and ends its
+// segment: the writer goes on in the next one, so the records after it are
+// still found by offset and by the walk. After a short index write the
+// writer stops indexing and the reader rebuilds from the segments.
+namespace Session
+{
+    enum RecordType : uint8_t
+    {
+        RECORD_RAW = 1,  // sensor frame as captured (RGB565)
+        RECORD_JPEG = 2, // encoded copy
+        RECORD_META = 3, // JSON: frame index, size, format, timestamp
+        RECORD_RAWZ = 4  // sensor frame, lossless Rgbz (rgbz_codec.h)
+    };
+
+    static const uint32_t SEGMENT_MAGIC = 0x53584D46; // "FMXS"
+    static const uint32_t INDEX_MAGIC = 0x49584D46;   // "FMXI"
+    static const uint32_t RECORD_MAGIC = 0x52584D46;  // "FMXR"
+    static const uint16_t FORMAT_VERSION = 1;
+    static const uint32_t SEGMENT_MAX_BYTES = 128UL * 1024 * 1024;
+    static const uint32_t FLUSH_INTERVAL = 8;
+
+    struct __attribute__((packed)) FileHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t segment; // segment number; 0 in the index header
+        uint32_t sessionId;
+        uint32_t reserved;
+    };
+
+    struct __attribute__((packed)) RecordHeader
+    {
+        uint32_t magic;
+        uint8_t type;
+        uint8_t reserved[3];
+        uint32_t frameIndex;
+        uint32_t length;
+        uint32_t crc;
+    };
+
+    struct __attribute__((packed)) IndexEntry
+    {
+        uint32_t frameIndex;
+        uint32_t offset; // of the record header within its segment
+        uint32_t length; // payload bytes
+        uint16_t segment;
+        uint8_t type;
+        uint8_t reserved;
+    };
+
+    static_assert(sizeof(FileHeader) == 16, "FileHeader layout");
+    static_assert(sizeof(RecordHeader) == 20, "RecordHeader layout");
+    static_assert(sizeof(IndexEntry) == 16, "IndexEntry layout");
+
+    void sessionDirPath(char *out, size_t size, uint32_t sessionId);
+    void segmentPath(char *out, size_t size, uint32_t sessionId, uint16_t segment);
+    void indexPath(char *out, size_t size, uint32_t sessionId);
+
+    class Writer
+    {
+    public:
+        Writer() {}
+        ~Writer() { close(); }
+
+        // Creates /sessionNNNN; fails if it already exists
+        bool open(uint32_t sessionId);
+        bool append(RecordType type, uint32_t frameIndex, const uint8_t *data, size_t len);
+        // Called once per frame; queues the staged tails every FLUSH_INTERVAL frames
+        void endFrame();
+        void flush();
+        void close();
+
+        bool isOpen() const { return opened; }
+        uint32_t getSessionId() const { return sessionId; }
+        uint32_t recordCount() const { return records; }
+        uint64_t bytesWritten() const { return totalBytes; }
+
+    private:
+        static const char *TAG;
+
+        SDStream segmentFile;
+        SDStream indexFile;
+        bool opened = false;
+        uint32_t sessionId = 0;
+        uint16_t segment = 0;
+        uint32_t segmentBytes = 0;
+        uint32_t records = 0;
+        uint32_t framesSinceFlush = 0;
+        uint64_t totalBytes = 0;
+        bool indexing = false;
+
+        bool openSegment(uint16_t number);
+        bool nextSegment();
+    };
+
+    class Reader
+    {
+    public:
+        Reader() {}
+        ~Reader() { close(); }
+
+        bool open(uint32_t sessionId);
+        void close();
+
+        size_t recordCount() const { return count; }
+        bool recovered() const { return !rebuilt.empty(); }
+        bool entry(size_t record, IndexEntry &out);
+        // Reads and checksums one payload; buffer must hold entry.length bytes
+        bool read(const IndexEntry &entry, uint8_t *buffer);
+        // First record of the given type for a frame (binary search)
+        bool findFrame(uint32_t frameIndex, RecordType type, IndexEntry &out);
+
+    private:
+        static const char *TAG;
+
+        File indexFile;
+        File segmentFile;
+        int openSegmentNumber = -1;
+        uint32_t sessionId = 0;
+        size_t count = 0;
+        std::vector<IndexEntry> rebuilt;
+
+        bool selectSegment(uint16_t number);
+        bool rebuildIndex(size_t indexedRecords);
+    };
+}
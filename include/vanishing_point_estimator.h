@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "config.h"
+#include "lane_detector.h"
+
+// Finds where the road's lane boundaries meet in the image (the vanishing
+// point, whose row is the horizon) from a batch of frames.
+//
+// Each frame goes through a LaneDetector cropped to the bottom of the frame,
+// below ROAD_TOP, which is under the horizon of any usable mount. Its
+// least-squares fits of the two boundaries are extended upwards to where
+// they cross. Fits are used rather than votes from per-pixel gradient
+// orientations: the Sobel kernel's angle error, extrapolated up long lines,
+// biased a gradient accumulator's crossing 2-5 px vertically.
+//
+// One frame's crossing moves with the car's heading, pitch and the bends in
+// the road; the batch's does not. The estimate is therefore
+// the median of each coordinate, and the spread is the interquartile range
+// of the rows. A frame without both boundaries, or whose boundaries do not
+// converge above the crop, adds nothing.
+//
+// Samples live in fixed arrays; nothing is allocated. Not thread safe.
+class VanishingPointEstimator
+{
+public:
+    static const int MAX_FRAMES = 512;
+    static constexpr float ROAD_TOP = 0.65f;
+
+    struct Estimate
+    {
+        float vanishX; // fractions of the frame width and height
+        float vanishY;
+        float spread; // interquartile range of the rows, fraction of the height
+        uint32_t frames;
+    };
+
+    VanishingPointEstimator();
+
+    void reset() { count = 0; }
+
+    // Adds one frame's crossing; false when the frame is not RGB565, shows
+    // no converging pair of boundaries or MAX_FRAMES are already in
+    bool addFrame(const camera_fb_t *fb);
+    uint32_t framesUsed() const { return count; }
+
+    // The medians so far, sorting the samples in place; false below
+    // CALIBRATION_MIN_FRAMES frames or above CALIBRATION_MAX_SPREAD. `out`
+    // is filled either way.
+    bool estimate(Estimate &out);
+
+private:
+    static const char *TAG;
+
+    LaneDetector detector;
+    float xs[MAX_FRAMES];
+    float ys[MAX_FRAMES];
+    uint32_t count;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+// Minimal Arduino core surface for the native (host) build. Only what the
+// portable translation units use is provided; anything that talks to real
+// peripherals lives behind the backends in include/hal/.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define LED_BUILTIN 21
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+void *ps_malloc(size_t size);
+uint32_t esp_get_free_heap_size();
+
+class EspClass
+{
+public:
+    // There is nothing to reboot on the host; the process exits instead.
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getFreePsram();
+    uint32_t getPsramSize();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,66 @@
+#pragma once
+
+// Host implementation of the Arduino fs::File API on top of stdio/dirent, so
+// code written against SDManager's File handles runs unchanged on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+    enum SeekMode
+    {
+        SeekSet = 0,
+        SeekCur = 1,
+        SeekEnd = 2
+    };
+
+    class File
+    {
+    public:
+        File() = default;
+
+        // Opens hostPath (a directory or a regular file). displayPath is the
+        // path as seen by the firmware, e.g. "/picture1.jpg".
+        static File openHost(const std::string &hostPath, const std::string &displayPath, const char *mode);
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t *buf, size_t size);
+        int available();
+        int read();
+        int peek();
+        size_t read(uint8_t *buf, size_t size);
+        void flush();
+        bool seek(uint32_t pos, SeekMode mode = SeekSet);
+        size_t position() const;
+        size_t size() const;
+        void close();
+        operator bool() const;
+        const char *path() const;
+        const char *name() const;
+
+        bool isDirectory() const;
+        File openNextFile(const char *mode = FILE_READ);
+        void rewindDirectory();
+
+    private:
+        struct Impl;
+        std::shared_ptr<Impl> impl;
+    };
+}
+
+namespace fs
+{
+    // Host only: the write that takes the file at displayPath more than
+    // `bytes` further comes back short, once, as after a card error
+    void injectShortWrite(const std::string &displayPath, size_t bytes);
+}
+
+using fs::File;
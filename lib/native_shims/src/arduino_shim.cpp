@@ -0,0 +1,141 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <mutex>
+#include <thread>
+
+EspClass ESP;
+
+namespace
+{
+    const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+    std::mutex logMutex;
+    uint8_t pinLevels[64] = {};
+}
+
+unsigned long millis()
+{
+    auto elapsed = std::chrono::steady_clock::now() - bootTime;
+    return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+unsigned long micros()
+{
+    auto elapsed = std::chrono::steady_clock::now() - bootTime;
+    return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+void delay(uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin < sizeof(pinLevels))
+    {
+        pinLevels[pin] = value;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+void *ps_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+uint32_t esp_get_free_heap_size()
+{
+    return 0;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+    (void)caps;
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+    return aligned_alloc(alignment, rounded);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+void EspClass::restart()
+{
+    ESP_LOGW("ESP", "restart() requested - exiting host process");
+    fflush(stderr);
+    exit(0);
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return 0;
+}
+
+uint32_t EspClass::getFreePsram()
+{
+    return 0;
+}
+
+uint32_t EspClass::getPsramSize()
+{
+    return 0;
+}
+
+void native_log_write(char level, const char *tag, const char *format, ...)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    fprintf(stderr, "[%8lu][%c][%s] ", millis(), level, tag ? tag : "");
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    (void)level;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Host copy of the esp32-camera frame types so frame producers and consumers
+// share the exact camera_fb_t layout the device driver hands out.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "sensor.h"
+
+typedef enum
+{
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_YUV420,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+    PIXFORMAT_RGB888,
+    PIXFORMAT_RAW,
+    PIXFORMAT_RGB444,
+    PIXFORMAT_RGB555,
+} pixformat_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;
+} camera_fb_t;
@@ -0,0 +1,34 @@
+#pragma once
+
+// Host replacement for the ESP-IDF logging macros. Output goes to stderr with
+// the same level letters as the device log, filtered by CORE_DEBUG_LEVEL.
+
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL 3
+#endif
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void native_log_write(char level, const char *tag, const char *format, ...);
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+#define NATIVE_LOG_AT(lvl, letter, tag, format, ...)                  \
+    do                                                                \
+    {                                                                 \
+        if (CORE_DEBUG_LEVEL >= (lvl))                                \
+            native_log_write(letter, tag, format, ##__VA_ARGS__);     \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) NATIVE_LOG_AT(1, 'E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) NATIVE_LOG_AT(2, 'W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) NATIVE_LOG_AT(3, 'I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) NATIVE_LOG_AT(4, 'D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) NATIVE_LOG_AT(5, 'V', tag, format, ##__VA_ARGS__)
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct NativeTask;
+typedef NativeTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskCode, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *createdTask,
+                                   BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char *name, uint32_t stackDepth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *createdTask);
+
+// Deleting the calling task unwinds it immediately. Deleting another task is
+// cooperative: the target exits at its next vTaskDelay or blocking wait.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xPortGetCoreID();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
@@ -0,0 +1,368 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct NativeTask
+{
+    std::string name;
+    BaseType_t coreId;
+    std::atomic<bool> deleteRequested{false};
+};
+
+namespace
+{
+    // Thrown inside a task to unwind it back to the trampoline on vTaskDelete.
+    struct TaskExit
+    {
+    };
+
+    thread_local NativeTask *currentTask = nullptr;
+
+    const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+    // Blocking waits are sliced so a cooperative vTaskDelete is noticed promptly.
+    const std::chrono::milliseconds WAIT_SLICE(5);
+
+    void checkDeleted()
+    {
+        if (currentTask && currentTask->deleteRequested.load())
+        {
+            throw TaskExit();
+        }
+    }
+
+    std::chrono::steady_clock::time_point deadlineFor(TickType_t ticks)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        return std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks * portTICK_PERIOD_MS);
+    }
+
+    // Waits on cv until pred() holds or the deadline passes; returns pred().
+    template <typename Pred>
+    bool waitUntil(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                   std::chrono::steady_clock::time_point deadline, Pred pred)
+    {
+        while (!pred())
+        {
+            checkDeleted();
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                return false;
+            }
+            auto slice = std::min<std::chrono::steady_clock::duration>(deadline - now, WAIT_SLICE);
+            cv.wait_for(lock, slice);
+        }
+        return true;
+    }
+}
+
+struct NativeSemaphore
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+struct NativeQueue
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+// ---- Tasks ----
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskCode, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *createdTask,
+                                   BaseType_t coreId)
+{
+    (void)stackDepth;
+    (void)priority;
+
+    NativeTask *task = new NativeTask();
+    task->name = name ? name : "";
+    task->coreId = coreId;
+
+    if (createdTask)
+    {
+        *createdTask = task;
+    }
+
+    std::thread([task, taskCode, parameters]()
+                {
+        currentTask = task;
+        try
+        {
+            taskCode(parameters);
+        }
+        catch (const TaskExit &)
+        {
+        } })
+        .detach();
+
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char *name, uint32_t stackDepth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *createdTask)
+{
+    return xTaskCreatePinnedToCore(taskCode, name, stackDepth, parameters, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr || task == currentTask)
+    {
+        if (currentTask)
+        {
+            throw TaskExit();
+        }
+        return;
+    }
+    task->deleteRequested.store(true);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    auto deadline = deadlineFor(ticks);
+    do
+    {
+        checkDeleted();
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero())
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(remaining, WAIT_SLICE));
+    } while (true);
+    checkDeleted();
+}
+
+TickType_t xTaskGetTickCount()
+{
+    auto elapsed = std::chrono::steady_clock::now() - bootTime;
+    return static_cast<TickType_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return currentTask;
+}
+
+BaseType_t xPortGetCoreID()
+{
+    if (currentTask && currentTask->coreId != tskNO_AFFINITY)
+    {
+        return currentTask->coreId;
+    }
+    return 1; // Arduino loop task runs on core 1
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void)task;
+    return 0;
+}
+
+// ---- Semaphores ----
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    NativeSemaphore *sem = new NativeSemaphore();
+    sem->maxCount = maxCount;
+    sem->count = initialCount;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    if (!semaphore)
+    {
+        return pdFALSE;
+    }
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (!waitUntil(semaphore->cv, lock, deadlineFor(ticksToWait), [semaphore]()
+                   { return semaphore->count > 0; }))
+    {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    if (!semaphore)
+    {
+        return pdFALSE;
+    }
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    if (semaphore->count >= semaphore->maxCount)
+    {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore)
+{
+    if (!semaphore)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    return semaphore->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    delete semaphore;
+}
+
+// ---- Queues ----
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    if (length == 0)
+    {
+        return nullptr;
+    }
+    NativeQueue *queue = new NativeQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait, bool toFront)
+{
+    if (!queue)
+    {
+        return errQUEUE_FULL;
+    }
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!waitUntil(queue->cv, lock, deadlineFor(ticksToWait), [queue]()
+                   { return queue->items.size() < queue->length; }))
+    {
+        return errQUEUE_FULL;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(item);
+    std::vector<uint8_t> copy(bytes, bytes + queue->itemSize);
+    if (toFront)
+    {
+        queue->items.push_front(std::move(copy));
+    }
+    else
+    {
+        queue->items.push_back(std::move(copy));
+    }
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait, bool remove)
+{
+    if (!queue)
+    {
+        return errQUEUE_EMPTY;
+    }
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!waitUntil(queue->cv, lock, deadlineFor(ticksToWait), [queue]()
+                   { return !queue->items.empty(); }))
+    {
+        return errQUEUE_EMPTY;
+    }
+    memcpy(buffer, queue->items.front().data(), queue->itemSize);
+    if (remove)
+    {
+        queue->items.pop_front();
+        queue->cv.notify_all();
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    return queueReceive(queue, buffer, ticksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    return queueReceive(queue, buffer, ticksToWait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    if (!queue)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return static_cast<UBaseType_t>(queue->items.size());
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    if (!queue)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->length - static_cast<UBaseType_t>(queue->items.size());
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    if (!queue)
+    {
+        return pdFAIL;
+    }
+    std::lock_guard<std::mutex> lock(queue->lock);
+    queue->items.clear();
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
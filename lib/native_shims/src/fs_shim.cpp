@@ -0,0 +1,275 @@
+#include "FS.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace fs
+{
+    struct File::Impl
+    {
+        std::string hostPath;
+        std::string displayPath;
+        FILE *file = nullptr;
+        bool directory = false;
+        std::vector<std::string> entries;
+        size_t nextEntry = 0;
+
+        ~Impl()
+        {
+            if (file)
+            {
+                fclose(file);
+            }
+        }
+    };
+
+    static std::string shortWritePath;
+    static size_t shortWriteBudget = 0;
+
+    void injectShortWrite(const std::string &displayPath, size_t bytes)
+    {
+        shortWritePath = displayPath;
+        shortWriteBudget = bytes;
+    }
+
+    static std::string baseName(const std::string &path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    File File::openHost(const std::string &hostPath, const std::string &displayPath, const char *mode)
+    {
+        File result;
+        struct stat st;
+        bool existsOnHost = stat(hostPath.c_str(), &st) == 0;
+        bool readOnly = mode == nullptr || strcmp(mode, FILE_READ) == 0;
+
+        auto impl = std::make_shared<Impl>();
+        impl->hostPath = hostPath;
+        impl->displayPath = displayPath;
+
+        if (existsOnHost && S_ISDIR(st.st_mode))
+        {
+            if (!readOnly)
+            {
+                return result;
+            }
+            DIR *dir = opendir(hostPath.c_str());
+            if (!dir)
+            {
+                return result;
+            }
+            while (struct dirent *entry = readdir(dir))
+            {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                {
+                    continue;
+                }
+                impl->entries.push_back(entry->d_name);
+            }
+            closedir(dir);
+            // FAT returns entries in creation order; sorting keeps host runs repeatable.
+            std::sort(impl->entries.begin(), impl->entries.end());
+            impl->directory = true;
+            result.impl = impl;
+            return result;
+        }
+
+        if (readOnly && !existsOnHost)
+        {
+            return result;
+        }
+
+        const char *stdioMode = "rb";
+        if (mode && strcmp(mode, FILE_WRITE) == 0)
+        {
+            stdioMode = "wb";
+        }
+        else if (mode && strcmp(mode, FILE_APPEND) == 0)
+        {
+            stdioMode = "ab";
+        }
+        else if (mode && strcmp(mode, "r+") == 0)
+        {
+            stdioMode = "r+b";
+        }
+        else if (mode && strcmp(mode, "w+") == 0)
+        {
+            stdioMode = "w+b";
+        }
+
+        impl->file = fopen(hostPath.c_str(), stdioMode);
+        if (!impl->file)
+        {
+            return result;
+        }
+        result.impl = impl;
+        return result;
+    }
+
+    size_t File::write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+
+    size_t File::write(const uint8_t *buf, size_t size)
+    {
+        if (!impl || !impl->file)
+        {
+            return 0;
+        }
+        if (!shortWritePath.empty() && impl->displayPath == shortWritePath)
+        {
+            if (size > shortWriteBudget)
+            {
+                size = shortWriteBudget;
+                shortWritePath.clear();
+            }
+            else
+            {
+                shortWriteBudget -= size;
+            }
+        }
+        return fwrite(buf, 1, size, impl->file);
+    }
+
+    int File::available()
+    {
+        if (!impl || !impl->file)
+        {
+            return 0;
+        }
+        return static_cast<int>(size() - position());
+    }
+
+    int File::read()
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int File::peek()
+    {
+        if (!impl || !impl->file)
+        {
+            return -1;
+        }
+        int c = fgetc(impl->file);
+        if (c != EOF)
+        {
+            ungetc(c, impl->file);
+        }
+        return c == EOF ? -1 : c;
+    }
+
+    size_t File::read(uint8_t *buf, size_t size)
+    {
+        if (!impl || !impl->file)
+        {
+            return 0;
+        }
+        return fread(buf, 1, size, impl->file);
+    }
+
+    void File::flush()
+    {
+        if (impl && impl->file)
+        {
+            fflush(impl->file);
+        }
+    }
+
+    bool File::seek(uint32_t pos, SeekMode mode)
+    {
+        if (!impl || !impl->file)
+        {
+            return false;
+        }
+        int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+        return fseek(impl->file, static_cast<long>(pos), whence) == 0;
+    }
+
+    size_t File::position() const
+    {
+        if (!impl || !impl->file)
+        {
+            return 0;
+        }
+        long pos = ftell(impl->file);
+        return pos < 0 ? 0 : static_cast<size_t>(pos);
+    }
+
+    size_t File::size() const
+    {
+        if (!impl || !impl->file)
+        {
+            return 0;
+        }
+        fflush(impl->file);
+        struct stat st;
+        if (fstat(fileno(impl->file), &st) != 0)
+        {
+            return 0;
+        }
+        return static_cast<size_t>(st.st_size);
+    }
+
+    void File::close()
+    {
+        impl.reset();
+    }
+
+    File::operator bool() const
+    {
+        return impl && (impl->file || impl->directory);
+    }
+
+    const char *File::path() const
+    {
+        return impl ? impl->displayPath.c_str() : nullptr;
+    }
+
+    const char *File::name() const
+    {
+        if (!impl)
+        {
+            return nullptr;
+        }
+        size_t slash = impl->displayPath.find_last_of('/');
+        return slash == std::string::npos ? impl->displayPath.c_str() : impl->displayPath.c_str() + slash + 1;
+    }
+
+    bool File::isDirectory() const
+    {
+        return impl && impl->directory;
+    }
+
+    File File::openNextFile(const char *mode)
+    {
+        if (!impl || !impl->directory || impl->nextEntry >= impl->entries.size())
+        {
+            return File();
+        }
+        const std::string &entry = impl->entries[impl->nextEntry++];
+        std::string display = impl->displayPath;
+        if (display.empty() || display.back() != '/')
+        {
+            display += '/';
+        }
+        return openHost(impl->hostPath + "/" + entry, display + baseName(entry), mode);
+    }
+
+    void File::rewindDirectory()
+    {
+        if (impl)
+        {
+            impl->nextEntry = 0;
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "esp_camera.h"
+
+// Same contract as the esp32-camera converter: *out is malloc'd and owned by
+// the caller. On the host the encoder is toojpeg, so sizes and timings are
+// representative of a software baseline rather than of the device.
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+
+// Streams the encoded bytes through cb instead of allocating; index is the
+// offset of data within the output. cb returns the bytes it consumed.
+typedef size_t (*jpg_out_cb)(void *arg, size_t index, const void *data, size_t len);
+bool frame2jpg_cb(camera_fb_t *fb, uint8_t quality, jpg_out_cb cb, void *arg);
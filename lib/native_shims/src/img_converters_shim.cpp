@@ -0,0 +1,85 @@
+#include "img_converters.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "toojpeg.h"
+
+namespace
+{
+    // toojpeg emits through a plain function pointer, so the sink is thread-local.
+    thread_local std::vector<uint8_t> *jpegSink = nullptr;
+
+    void writeJpegByte(unsigned char byte)
+    {
+        jpegSink->push_back(byte);
+    }
+
+    bool encodeFrame(camera_fb_t *fb, uint8_t quality, std::vector<uint8_t> &encoded)
+    {
+        if (!fb || !fb->buf || fb->format != PIXFORMAT_RGB565)
+        {
+            return false;
+        }
+
+        // Mirror the device converter: expand the whole frame to RGB888 first.
+        size_t pixels = fb->width * fb->height;
+        std::vector<uint8_t> rgb(pixels * 3);
+        for (size_t i = 0; i < pixels; i++)
+        {
+            // esp32-camera stores RGB565 big-endian
+            uint16_t px = (uint16_t)(fb->buf[i * 2] << 8) | fb->buf[i * 2 + 1];
+            rgb[i * 3 + 0] = (uint8_t)(((px >> 11) & 0x1F) * 255 / 31);
+            rgb[i * 3 + 1] = (uint8_t)(((px >> 5) & 0x3F) * 255 / 63);
+            rgb[i * 3 + 2] = (uint8_t)((px & 0x1F) * 255 / 31);
+        }
+
+        encoded.reserve(pixels / 2);
+        jpegSink = &encoded;
+        bool ok = TooJpeg::writeJpeg(writeJpegByte, rgb.data(), (unsigned short)fb->width,
+                                     (unsigned short)fb->height, true, quality, false, nullptr);
+        jpegSink = nullptr;
+        return ok && !encoded.empty();
+    }
+}
+
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len)
+{
+    std::vector<uint8_t> encoded;
+    if (!out || !out_len || !encodeFrame(fb, quality, encoded))
+    {
+        return false;
+    }
+
+    *out = (uint8_t *)malloc(encoded.size());
+    if (!*out)
+    {
+        return false;
+    }
+    memcpy(*out, encoded.data(), encoded.size());
+    *out_len = encoded.size();
+    return true;
+}
+
+bool frame2jpg_cb(camera_fb_t *fb, uint8_t quality, jpg_out_cb cb, void *arg)
+{
+    std::vector<uint8_t> encoded;
+    if (!cb || !encodeFrame(fb, quality, encoded))
+    {
+        return false;
+    }
+
+    // The device encoder emits in small chunks; 1 KB keeps callers honest
+    const size_t CHUNK = 1024;
+    for (size_t index = 0; index < encoded.size(); index += CHUNK)
+    {
+        size_t len = encoded.size() - index < CHUNK ? encoded.size() - index : CHUNK;
+        if (cb(arg, index, encoded.data() + index, len) != len)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,18 @@
+#include "sensor.h"
+
+const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    {96, 96, ASPECT_RATIO_1X1},     // 96x96
+    {160, 120, ASPECT_RATIO_4X3},   // QQVGA
+    {176, 144, ASPECT_RATIO_5X4},   // QCIF
+    {240, 176, ASPECT_RATIO_3X2},   // HQVGA
+    {240, 240, ASPECT_RATIO_1X1},   // 240x240
+    {320, 240, ASPECT_RATIO_4X3},   // QVGA
+    {400, 296, ASPECT_RATIO_4X3},   // CIF
+    {480, 320, ASPECT_RATIO_3X2},   // HVGA
+    {640, 480, ASPECT_RATIO_4X3},   // VGA
+    {800, 600, ASPECT_RATIO_4X3},   // SVGA
+    {1024, 768, ASPECT_RATIO_4X3},  // XGA
+    {1280, 720, ASPECT_RATIO_16X9}, // HD
+    {1280, 1024, ASPECT_RATIO_5X4}, // SXGA
+    {1600, 1200, ASPECT_RATIO_4X3}, // UXGA
+};
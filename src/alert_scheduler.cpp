@@ -0,0 +1,206 @@
+#include "alert_scheduler.h"
+#include <string.h>
+
+const char *AlertScheduler::TAG = "AlertScheduler";
+
+const uint16_t AlertScheduler::BUCKET_LIMITS_MS[LATENCY_BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100};
+
+// Spacing keeps a flapping condition from turning into a continuous beep
+const AlertScheduler::Policy AlertScheduler::POLICIES[ALERT_COUNT] = {
+    {BuzzerManager::PATTERN_BOOT, PRIORITY_INFO, 0},
+    {BuzzerManager::PATTERN_LOW, PRIORITY_INFO, 500},
+    {BuzzerManager::PATTERN_MEDIUM, PRIORITY_WARNING, 2000},
+    {BuzzerManager::PATTERN_HIGH, PRIORITY_ERROR, 1000},
+    {BuzzerManager::PATTERN_CRITICAL, PRIORITY_CRITICAL, 500},
+};
+
+AlertScheduler::AlertScheduler()
+{
+    mutex = xSemaphoreCreateMutex();
+    memset(pendingTag, 0, sizeof(pendingTag));
+    memset(requestedUs, 0, sizeof(requestedUs));
+    memset(lastQueuedMs, 0, sizeof(lastQueuedMs));
+    memset(everQueued, 0, sizeof(everQueued));
+    memset(doneMark, 0, sizeof(doneMark));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool AlertScheduler::begin()
+{
+    BuzzerManager &buzzer = BuzzerManager::getInstance();
+    if (!buzzer.isReady())
+    {
+        ESP_LOGE(TAG, "Buzzer not initialized");
+        return false;
+    }
+
+    buzzer.setStartHandler([this](uint16_t tag)
+                           { onPatternStart(tag); });
+    started = true;
+    return true;
+}
+
+bool AlertScheduler::raise(Alert alert)
+{
+    if (!started || alert >= ALERT_COUNT)
+    {
+        return false;
+    }
+
+    BuzzerManager &buzzer = BuzzerManager::getInstance();
+    const Policy &policy = POLICIES[alert];
+    unsigned long now = millis();
+    bool queued = false;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    stats.raised++;
+
+    // Highest class still queued or sounding; -1 when the buzzer is idle or
+    // only plays something queued directly (a melody), which any alert preempts
+    int activePriority = -1;
+    for (int i = 0; i < ALERT_COUNT; i++)
+    {
+        if (!buzzer.finished(doneMark[i]) && POLICIES[i].priority > activePriority)
+        {
+            activePriority = POLICIES[i].priority;
+        }
+    }
+
+    if (!buzzer.finished(doneMark[alert]))
+    {
+        stats.coalesced++;
+    }
+    else if (everQueued[alert] && now - lastQueuedMs[alert] < policy.minSpacingMs)
+    {
+        stats.rateLimited++;
+    }
+    else if (activePriority > policy.priority)
+    {
+        stats.suppressed++;
+    }
+    else
+    {
+        if (!buzzer.isIdle() && policy.priority > activePriority)
+        {
+            // Everything queued is of a lower class: cut it off
+            buzzer.stop();
+            stats.preemptions++;
+            memset(pendingTag, 0, sizeof(pendingTag));
+        }
+
+        uint16_t tag = nextTag++;
+        if (nextTag == 0)
+        {
+            nextTag = 1;
+        }
+        pendingTag[alert] = tag;
+        requestedUs[alert] = micros();
+
+        queued = buzzer.playPattern(policy.pattern, tag);
+        if (queued)
+        {
+            doneMark[alert] = buzzer.queuedMark();
+            lastQueuedMs[alert] = now;
+            everQueued[alert] = true;
+        }
+        else
+        {
+            pendingTag[alert] = 0;
+            stats.dropped++;
+        }
+    }
+    xSemaphoreGive(mutex);
+
+    ESP_LOGD(TAG, "%s alert %s", alertName(alert), queued ? "queued" : "not queued");
+    return queued;
+}
+
+void AlertScheduler::onPatternStart(uint16_t tag)
+{
+    unsigned long now = micros();
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < ALERT_COUNT; i++)
+    {
+        if (pendingTag[i] == tag)
+        {
+            pendingTag[i] = 0;
+            stats.played++;
+            record(stats.latency[POLICIES[i].priority], now - requestedUs[i]);
+            break;
+        }
+    }
+    xSemaphoreGive(mutex);
+}
+
+void AlertScheduler::record(Histogram &histogram, uint32_t latencyUs)
+{
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && latencyUs > BUCKET_LIMITS_MS[bucket] * 1000UL)
+    {
+        bucket++;
+    }
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.totalUs += latencyUs;
+    if (latencyUs > histogram.maxUs)
+    {
+        histogram.maxUs = latencyUs;
+    }
+}
+
+AlertScheduler::Stats AlertScheduler::getStats()
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(mutex);
+    return snapshot;
+}
+
+void AlertScheduler::resetStats()
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    memset(&stats, 0, sizeof(stats));
+    xSemaphoreGive(mutex);
+}
+
+AlertScheduler::Priority AlertScheduler::priorityOf(Alert alert)
+{
+    return alert < ALERT_COUNT ? POLICIES[alert].priority : PRIORITY_INFO;
+}
+
+const char *AlertScheduler::alertName(Alert alert)
+{
+    switch (alert)
+    {
+    case ALERT_BOOT:
+        return "boot";
+    case ALERT_NOTICE:
+        return "notice";
+    case ALERT_WARNING:
+        return "warning";
+    case ALERT_ERROR:
+        return "error";
+    case ALERT_LANE_DEPARTURE:
+        return "lane_departure";
+    default:
+        return "unknown";
+    }
+}
+
+const char *AlertScheduler::priorityName(Priority priority)
+{
+    switch (priority)
+    {
+    case PRIORITY_INFO:
+        return "info";
+    case PRIORITY_WARNING:
+        return "warning";
+    case PRIORITY_ERROR:
+        return "error";
+    case PRIORITY_CRITICAL:
+        return "critical";
+    default:
+        return "unknown";
+    }
+}
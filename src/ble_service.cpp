@@ -1,156 +1,78 @@
 #include "ble_service.h"
+#include <Arduino.h>
+#include "mode_controller.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
 const char *CustomBLEService::TAG = "BLEService";
-const char *ServerCallbacks::TAG = "BLEServer";
-const char *ControlCallbacks::TAG = "BLEControl";
-const char *PreviewInfoCallbacks::TAG = "BLEPreview";
-
-bool CustomBLEService::captureEnabled = false;
-bool CustomBLEService::previewEnabled = false;
-bool CustomBLEService::inferenceEnabled = false;
-CustomBLEService *globalBLEService = nullptr;
 
 static const unsigned long STATUS_UPDATE_INTERVAL = 5000;  // 5 seconds for general status
 static const unsigned long SERVICE_UPDATE_INTERVAL = 1000; // 1 second for service updates
 
-void ServerCallbacks::onConnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo)
+CustomBLEService::CustomBLEService(BleTransport &transport) : transport(transport)
 {
-    ESP_LOGI(TAG, "Client Connected - Address: %s",
-             connInfo.getAddress().toString().c_str());
-    if (globalBLEService)
+    connectionState = DISCONNECTED;
+    lastKeepAlive = millis();
+    // Create mutex
+    mutex = xSemaphoreCreateMutex();
+    for (int i = 0; i < SETTINGS_SLOTS; i++)
     {
-        globalBLEService->updateConnectionState(CustomBLEService::CONNECTED);
+        settingsSlotBusy[i].store(false);
     }
 }
 
-void ServerCallbacks::onDisconnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo, int reason)
+bool CustomBLEService::postCommand(Command cmd, CommandBus::Source source)
 {
-    ESP_LOGI(TAG, "Client Disconnected - Details:"
-                  "\n\tPeer Address: %s"
-                  "\n\tConnection Handle: %d"
-                  "\n\tReason: %d",
-             connInfo.getAddress().toString().c_str(),
-             connInfo.getConnHandle(),
-             reason);
-
-    if (globalBLEService)
-    {
-        globalBLEService->updateConnectionState(CustomBLEService::DISCONNECTED);
-        globalBLEService->handleDisconnection();
-    }
-
-    pServer->startAdvertising();
+    return CommandBus::getInstance().post(static_cast<uint8_t>(cmd), source);
 }
 
-void ControlCallbacks::onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo& connInfo)
+bool CustomBLEService::isPreviewEnabled()
 {
-    if (globalBLEService)
-    {
-        globalBLEService->handleControlCallback(pCharacteristic);
-    }
+    return ModeController::getInstance().mode() == ModeController::MODE_PREVIEW;
 }
 
-void PreviewInfoCallbacks::onRead(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo& connInfo)
+bool CustomBLEService::isInferenceEnabled()
 {
-    // Implementation if needed
+    return ModeController::getInstance().mode() == ModeController::MODE_INFERENCE;
 }
 
-CustomBLEService::CustomBLEService()
+bool CustomBLEService::isCaptureEnabled()
 {
-    globalBLEService = this;
-    connectionState = DISCONNECTED;
-    lastKeepAlive = millis();
-    // Create mutex
-    mutex = xSemaphoreCreateMutex();
+    return ModeController::getInstance().mode() == ModeController::MODE_CAPTURE;
 }
 
-void CustomBLEService::handleControlCallback(NimBLECharacteristic *pCharacteristic)
+void CustomBLEService::handleControlCallback(const std::string &value)
 {
-    std::string value = pCharacteristic->getValue();
-    if (value.length() > 0)
+    if (value.length() > 0 && value[0] == '{')
     {
-        ESP_LOGD(TAG, "Received control value: %c (ASCII: %d)", value[0], (int)value[0]);
-
-        switch (value[0])
+        // Applied on the controller task; only the copy happens here
+        int slot = 0;
+        bool expected = false;
+        while (slot < SETTINGS_SLOTS && !settingsSlotBusy[slot].compare_exchange_strong(expected, true))
         {
-        case Command::START_PREVIEW:
-            if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-            {
-                previewEnabled = true;
-                xSemaphoreGive(mutex);
-
-                // First notify the preview callback to initialize
-                if (previewCallback)
-                {
-                    previewCallback(true);
-                }
-
-                // Then update status and notify clients
-                updateServiceStatus("preview", "starting");
-                notifyClients("Preview Starting");
-                ESP_LOGI(TAG, "Preview Mode Activated - Initializing stream...");
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Failed to take mutex in START_PREVIEW");
-            }
-            break;
-        case Command::STOP_PREVIEW:
-            if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
+            expected = false;
+            slot++;
+        }
+        if (slot < SETTINGS_SLOTS)
+        {
+            pendingSettings[slot] = value;
+            if (CommandBus::getInstance().post(CommandBus::APPLY_SETTINGS, CommandBus::SOURCE_BLE, slot))
             {
-                previewEnabled = false;
-                m_explicitStop = true; // Set flag for explicit stop
-                xSemaphoreGive(mutex);
-
-                if (previewCallback)
-                    previewCallback(false);
-                notifyClients("Preview Stopped");
-                ESP_LOGI(TAG, "Preview Stopped - Streaming disabled");
+                return;
             }
-            break;
-        case Command::START_DATA_COLLECTION:
-            if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-            {
-                captureEnabled = true;
-                xSemaphoreGive(mutex);
+            settingsSlotBusy[slot].store(false);
+        }
+        ESP_LOGE(TAG, "Settings queue full, rejecting %s", value.c_str());
+        notifyClients("Busy: settings rejected, retry");
+    }
+    else if (value.length() > 0)
+    {
+        ESP_LOGD(TAG, "Received control value: %c (ASCII: %d)", value[0], (int)value[0]);
 
-                if (operationCallback)
-                    operationCallback(true);
-                notifyClients("Operation Started");
-                ESP_LOGI(TAG, "Operation Started - Device is now capturing");
-            }
-            break;
-        case Command::STOP_DATA_COLLECTION:
-            if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-            {
-                captureEnabled = false;
-                m_explicitStop = true; // Set flag for explicit stop
-                xSemaphoreGive(mutex);
-
-                if (operationCallback)
-                    operationCallback(false);
-                notifyClients("Operation Stopped");
-                ESP_LOGI(TAG, "Operation Stopped - Device is now idle");
-            }
-            break;
-        case Command::START_INFERENCE:
-            inferenceEnabled = true;
-            notifyClients("Inference Started");
-            ESP_LOGI(TAG, "Inference Started - Device is now infering");
-            break;
-        case Command::STOP_INFERENCE:
-            inferenceEnabled = false;
-            m_explicitStop = true; // Set flag for explicit stop
-            notifyClients("Inference Stopped");
-            ESP_LOGI(TAG, "Inference Stopped - Device is now idle");
-            break;
-        default:
-            ESP_LOGW(TAG, "Unknown control command received: %c (ASCII: %d)",
-                     value[0], (int)value[0]);
-            notifyClients("Unknown Command: " + std::string(1, value[0]) + " (ASCII: " + std::to_string((int)value[0]) + ")");
-            break;
+        if (!CommandBus::getInstance().post(static_cast<uint8_t>(value[0]), CommandBus::SOURCE_BLE))
+        {
+            ESP_LOGE(TAG, "Command queue full, rejecting %c", value[0]);
+            notifyClients("Busy: command " + std::string(1, value[0]) + " rejected, retry");
         }
     }
     else
@@ -159,6 +81,26 @@ void CustomBLEService::handleControlCallback(NimBLECharacteristic *pCharacterist
     }
 }
 
+void CustomBLEService::applySettings(uint8_t slot)
+{
+    if (slot >= SETTINGS_SLOTS)
+    {
+        return;
+    }
+    JsonDocument settings;
+    if (deserializeJson(settings, pendingSettings[slot]) || !settings.is<JsonObject>() || !settingsHandler)
+    {
+        ESP_LOGW(TAG, "Rejected settings: %s", pendingSettings[slot].c_str());
+        notifyClients("Settings rejected: expected a JSON object");
+    }
+    else
+    {
+        notifyClients(settingsHandler(settings));
+    }
+    pendingSettings[slot].clear();
+    settingsSlotBusy[slot].store(false);
+}
+
 bool CustomBLEService::begin()
 {
     ESP_LOGI(TAG, "=== Starting BLE Service Initialization ===");
@@ -178,82 +120,7 @@ bool CustomBLEService::begin()
         return true;
     }
 
-    ESP_LOGI(TAG, "1️⃣ Initializing NimBLE Device...");
-    NimBLEDevice::init(HOSTNAME);
-    ESP_LOGD(TAG, "Setting BLE parameters...");
-    NimBLEDevice::setPower(ESP_PWR_LVL_P9);
-    NimBLEDevice::setSecurityAuth(false, false, true);
-    NimBLEDevice::setMTU(185);
-
-    ESP_LOGI(TAG, "2️⃣ Creating BLE Server...");
-    pServer = NimBLEDevice::createServer();
-    if (!pServer)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create BLE server");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-    pServer->setCallbacks(new ServerCallbacks());
-
-    ESP_LOGI(TAG, "3️⃣ Creating BLE Service...");
-    pService = pServer->createService(SERVICE_UUID);
-    if (!pService)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create BLE service");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-
-    ESP_LOGI(TAG, "4️⃣ Creating Characteristics...");
-
-    // Control Characteristic
-    ESP_LOGD(TAG, "Creating Control characteristic...");
-    pControlCharacteristic = pService->createCharacteristic(
-        CONTROL_CHAR_UUID,
-        NIMBLE_PROPERTY::WRITE);
-    if (!pControlCharacteristic)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create Control characteristic");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-    pControlCharacteristic->setCallbacks(new ControlCallbacks());
-
-    // Status Characteristic
-    ESP_LOGD(TAG, "Creating Status characteristic...");
-    pStatusCharacteristic = pService->createCharacteristic(
-        STATUS_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    if (!pStatusCharacteristic)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create Status characteristic");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-
-    // Preview Info Characteristic
-    ESP_LOGD(TAG, "Creating Preview Info characteristic...");
-    pPreviewInfoCharacteristic = pService->createCharacteristic(
-        PREVIEW_INFO_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    if (!pPreviewInfoCharacteristic)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create Preview Info characteristic");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-
-    // Menu Characteristic
-    ESP_LOGD(TAG, "Creating Menu characteristic...");
-    NimBLECharacteristic *pMenuCharacteristic = pService->createCharacteristic(
-        MENU_CHAR_UUID,
-        NIMBLE_PROPERTY::READ);
-    if (!pMenuCharacteristic)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create Menu characteristic");
-        xSemaphoreGive(mutex);
-        return false;
-    }
+    ESP_LOGI(TAG, "1️⃣ Starting BLE transport...");
     std::string commandDescription =
         "Available Commands:\n"
         "1: Start Preview\n"
@@ -261,51 +128,26 @@ bool CustomBLEService::begin()
         "3: Start Operation\n"
         "4: Stop Operation\n"
         "5: Start Inference\n"
-        "6: Stop Inference";
-    pMenuCharacteristic->setValue(commandDescription);
-
-    // Service Status Characteristic
-    ESP_LOGD(TAG, "Creating Service Status characteristic...");
-    pServiceStatusCharacteristic = pService->createCharacteristic(
-        SERVICE_STATUS_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    if (!pServiceStatusCharacteristic)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create Service Status characteristic");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-
-    // Service Metrics Characteristic
-    ESP_LOGD(TAG, "Creating Service Metrics characteristic...");
-    pServiceMetricsCharacteristic = pService->createCharacteristic(
-        SERVICE_METRICS_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    if (!pServiceMetricsCharacteristic)
-    {
-        ESP_LOGE(TAG, "❌ Failed to create Service Metrics characteristic");
-        xSemaphoreGive(mutex);
-        return false;
-    }
+        "6: Stop Inference\n"
+        "{\"capture\":{\"min_ms\":500,\"max_ms\":15000,\"threshold\":12},\"dedup\":{\"max_distance\":3}}: Capture settings";
 
-    ESP_LOGI(TAG, "5️⃣ Starting BLE Service...");
-    if (!pService->start())
-    {
-        ESP_LOGE(TAG, "❌ Failed to start BLE service");
-        xSemaphoreGive(mutex);
-        return false;
-    }
-
-    ESP_LOGI(TAG, "6️⃣ Starting Advertising...");
-    NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
-    pAdvertising->addServiceUUID(SERVICE_UUID);
-    pAdvertising->enableScanResponse(true);
-    pAdvertising->setMinInterval(0x06);
-    pAdvertising->setMaxInterval(0x12);
+    transport.setHandlers(
+        [this](const std::string &value)
+        { handleControlCallback(value); },
+        [this](bool connected)
+        {
+            updateConnectionState(connected ? CONNECTED : DISCONNECTED);
+            if (!connected)
+            {
+                // Mode teardown runs on the controller task, after any
+                // command already queued
+                CommandBus::getInstance().post(CommandBus::CONNECTION_LOST, CommandBus::SOURCE_SYSTEM);
+            }
+        });
 
-    if (!pAdvertising->start())
+    if (!transport.begin(HOSTNAME, commandDescription))
     {
-        ESP_LOGE(TAG, "❌ Failed to start advertising");
+        ESP_LOGE(TAG, "❌ Failed to start BLE transport");
         xSemaphoreGive(mutex);
         return false;
     }
@@ -318,72 +160,6 @@ bool CustomBLEService::begin()
     return true;
 }
 
-bool CustomBLEService::createControlCharacteristic()
-{
-    pControlCharacteristic = pService->createCharacteristic(
-        CONTROL_CHAR_UUID,
-        NIMBLE_PROPERTY::WRITE);
-    if (!pControlCharacteristic)
-        return false;
-    pControlCharacteristic->setCallbacks(new ControlCallbacks());
-    return true;
-}
-
-bool CustomBLEService::createStatusCharacteristic()
-{
-    pStatusCharacteristic = pService->createCharacteristic(
-        STATUS_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    return pStatusCharacteristic != nullptr;
-}
-
-bool CustomBLEService::createPreviewCharacteristic()
-{
-    pPreviewInfoCharacteristic = pService->createCharacteristic(
-        PREVIEW_INFO_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    if (!pPreviewInfoCharacteristic)
-        return false;
-    pPreviewInfoCharacteristic->setCallbacks(new PreviewInfoCallbacks());
-    return true;
-}
-
-bool CustomBLEService::createMenuCharacteristic()
-{
-    auto pMenuChar = pService->createCharacteristic(
-        MENU_CHAR_UUID,
-        NIMBLE_PROPERTY::READ);
-    if (!pMenuChar)
-        return false;
-
-    std::string commandDescription =
-        "Available Commands:\n"
-        "1: Start Preview\n"
-        "2: Stop Preview\n"
-        "3: Start Operation\n"
-        "4: Stop Operation\n"
-        "5: Start Inference\n"
-        "6: Stop Inference";
-    pMenuChar->setValue(commandDescription);
-    return true;
-}
-
-bool CustomBLEService::createServiceStatusCharacteristic()
-{
-    pServiceStatusCharacteristic = pService->createCharacteristic(
-        SERVICE_STATUS_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    return pServiceStatusCharacteristic != nullptr;
-}
-
-bool CustomBLEService::createServiceMetricsCharacteristic()
-{
-    pServiceMetricsCharacteristic = pService->createCharacteristic(
-        SERVICE_METRICS_CHAR_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-    return pServiceMetricsCharacteristic != nullptr;
-}
-
 void CustomBLEService::loop()
 {
     static unsigned long lastCheck = 0;
@@ -398,12 +174,12 @@ void CustomBLEService::loop()
             lastCheck = now;
             ESP_LOGV(TAG, "Performing connection check...");
 
-            if (isConnected() && !pServer->getConnectedCount())
+            if (isConnected() && !transport.connectedCount())
             {
                 ESP_LOGW(TAG, "⚠️ Connection state mismatch detected");
                 ESP_LOGD(TAG, "Internal state: Connected, Server count: 0");
                 updateConnectionState(DISCONNECTED);
-                handleDisconnection();
+                CommandBus::getInstance().post(CommandBus::CONNECTION_LOST, CommandBus::SOURCE_SYSTEM);
             }
         }
 
@@ -426,7 +202,7 @@ void CustomBLEService::loop()
 
 void CustomBLEService::notifyClients(const std::string &message)
 {
-    if (pStatusCharacteristic && isConnected())
+    if (isConnected())
     {
         JsonDocument doc;
         doc["type"] = "notification";
@@ -435,8 +211,7 @@ void CustomBLEService::notifyClients(const std::string &message)
         std::string output;
         serializeJsonPretty(doc, output);
 
-        pStatusCharacteristic->setValue(output);
-        pStatusCharacteristic->notify();
+        transport.publish(BleTransport::Channel::STATUS, output);
     }
 }
 
@@ -451,10 +226,10 @@ void CustomBLEService::updateConnectionState(ConnectionState newState)
                  esp_get_free_heap_size());
 
         // If disconnected, ensure advertising is restarted
-        if (newState == DISCONNECTED && !NimBLEDevice::getAdvertising()->isAdvertising())
+        if (newState == DISCONNECTED && !transport.isAdvertising())
         {
             ESP_LOGI(TAG, "Restarting advertising after disconnect");
-            NimBLEDevice::getAdvertising()->start(0);
+            transport.startAdvertising();
         }
 
         xSemaphoreGive(mutex);
@@ -465,7 +240,7 @@ void CustomBLEService::updateServiceStatus(const std::string &service, const std
 {
     if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-        if (pStatusCharacteristic && isConnected())
+        if (isConnected())
         {
             JsonDocument doc;
             doc["type"] = "service_status";
@@ -475,8 +250,7 @@ void CustomBLEService::updateServiceStatus(const std::string &service, const std
             std::string output;
             serializeJsonPretty(doc, output);
 
-            pStatusCharacteristic->setValue(output);
-            pStatusCharacteristic->notify();
+            transport.publish(BleTransport::Channel::STATUS, output);
         }
         xSemaphoreGive(mutex);
     }
@@ -486,7 +260,7 @@ void CustomBLEService::updateServiceMetrics(const std::string &service, const st
 {
     if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-        if (pStatusCharacteristic && isConnected())
+        if (isConnected())
         {
             JsonDocument doc;
             doc["service"] = service;
@@ -496,8 +270,7 @@ void CustomBLEService::updateServiceMetrics(const std::string &service, const st
             std::string output;
             serializeJsonPretty(doc, output);
 
-            pStatusCharacteristic->setValue(output);
-            pStatusCharacteristic->notify();
+            transport.publish(BleTransport::Channel::STATUS, output);
         }
         xSemaphoreGive(mutex);
     }
@@ -514,11 +287,11 @@ void CustomBLEService::updatePreviewInfo(const std::string &info)
         if (error)
         {
             ESP_LOGE(TAG, "Invalid JSON in updatePreviewInfo: %s", error.c_str());
+            xSemaphoreGive(mutex);
             return;
         }
 
-        pPreviewInfoCharacteristic->setValue(info);
-        pPreviewInfoCharacteristic->notify();
+        transport.publish(BleTransport::Channel::PREVIEW_INFO, info);
         ESP_LOGD(TAG, "Preview info updated: %s", info.c_str());
         xSemaphoreGive(mutex);
     }
@@ -528,31 +301,13 @@ void CustomBLEService::handleDisconnection()
 {
     ESP_LOGI(TAG, "Handling disconnection...");
 
-    m_disconnecting = true; // Set disconnecting flag before callbacks
-
-    // Reset states but don't restart
-    captureEnabled = false;
-    previewEnabled = false;
-    inferenceEnabled = false;
-    m_explicitStop = false; // Reset explicit stop flag on disconnection
-
-    // Notify callbacks with explicit disconnect flag
-    if (operationCallback)
-        operationCallback(false);
-    if (previewCallback)
-        previewCallback(false);
-    if (inferenceCallback)
-        inferenceCallback(false);
-
-    m_disconnecting = false; // Reset disconnecting flag after callbacks
-
     // Restart advertising with retry mechanism
     const int MAX_RETRY = 3;
     const int RETRY_DELAY = 1000;
 
     for (int i = 0; i < MAX_RETRY; i++)
     {
-        if (NimBLEDevice::getAdvertising()->start())
+        if (transport.startAdvertising())
         {
             ESP_LOGI(TAG, "Advertising restarted successfully");
             return;
@@ -564,20 +319,11 @@ void CustomBLEService::handleDisconnection()
     ESP_LOGE(TAG, "Failed to restart advertising after all retries");
 }
 
-bool CustomBLEService::isDisconnecting() const
-{
-    return m_disconnecting;
-}
-
 void CustomBLEService::cleanup()
 {
     if (xSemaphoreTake(mutex, pdMS_TO_TICKS(1000)) == pdTRUE)
     {
-        if (pServer)
-        {
-            pServer->stopAdvertising();
-            pServer = nullptr;
-        }
+        transport.stopAdvertising();
         xSemaphoreGive(mutex);
     }
 
@@ -588,17 +334,6 @@ void CustomBLEService::cleanup()
     }
 }
 
-bool CustomBLEService::updateState(bool &stateVar, bool newValue)
-{
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-    {
-        stateVar = newValue;
-        xSemaphoreGive(mutex);
-        return true;
-    }
-    return false;
-}
-
 void CustomBLEService::checkConnectionHealth()
 {
     static unsigned long lastCheck = 0;
@@ -609,7 +344,7 @@ void CustomBLEService::checkConnectionHealth()
         if (isConnected())
         {
             // Verify connection is still active
-            if (!pServer->getConnectedCount())
+            if (!transport.connectedCount())
             {
                 ESP_LOGW(TAG, "Connection state mismatch detected");
                 updateConnectionState(DISCONNECTED);
@@ -618,6 +353,3 @@ void CustomBLEService::checkConnectionHealth()
         lastCheck = millis();
     }
 }
-
-bool CustomBLEService::wasExplicitlyStopped() const { return m_explicitStop; }
-void CustomBLEService::setExplicitStop(bool value) { m_explicitStop = value; }
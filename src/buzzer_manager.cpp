@@ -1,4 +1,5 @@
 #include "buzzer_manager.h"
+#include <string.h>
 
 // Initialize static members
 BuzzerManager* BuzzerManager::instance = nullptr;
@@ -39,34 +40,197 @@ BuzzerManager& BuzzerManager::getInstance() {
     return *instance;
 }
 
+BuzzerManager::BuzzerManager()
+    : buzzerPin(-1), isMuted(false), isInitialized(false), backend(&defaultBuzzerBackend()),
+      taskHandle(nullptr), queuedNotes(0), finishedNotes(0), stopGeneration(0) {
+    noteQueue = xQueueCreate(QUEUE_LENGTH, sizeof(QueuedNote));
+    enqueueMutex = xSemaphoreCreateMutex();
+    memset(&stats, 0, sizeof(stats));
+}
+
 bool BuzzerManager::begin(int pin) {
     if (pin < 0) return false;
 
+    if (!backend->begin(pin)) return false;
     buzzerPin = pin;
-    pinMode(buzzerPin, OUTPUT);
-    digitalWrite(buzzerPin, LOW);
+
+    // Lowest priority on core 0: tone timing tolerates a few ms of jitter
+    if (!taskHandle &&
+        xTaskCreatePinnedToCore(buzzerTask, "Buzzer_Task", 2048, this, 1, &taskHandle, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create buzzer task");
+        return false;
+    }
+
     isInitialized = true;
     return true;
 }
 
-void BuzzerManager::playTone(int tone, int duration) {
-    if (!isReady() || isMuted) return;
-    
-    for (long i = 0; i < duration * 1000L; i += tone * 2) {
-        digitalWrite(buzzerPin, HIGH);
-        delayMicroseconds(tone);
-        digitalWrite(buzzerPin, LOW);
-        delayMicroseconds(tone);
+void BuzzerManager::setBackend(BuzzerBackend* newBackend) {
+    stop();
+    backend = newBackend ? newBackend : &defaultBuzzerBackend();
+    if (isInitialized) {
+        backend->begin(buzzerPin);
+    }
+}
+
+bool BuzzerManager::play(const Note* notes, size_t count, uint16_t tag) {
+    if (!isReady() || isMuted || count == 0) return false;
+
+    unsigned long startUs = micros();
+    bool queued = false;
+
+    // Serialise producers so two patterns never interleave
+    xSemaphoreTake(enqueueMutex, portMAX_DELAY);
+    if (uxQueueSpacesAvailable(noteQueue) >= count) {
+        queuedNotes += count;
+        QueuedNote entry = {notes[0], stopGeneration.load()};
+        entry.note.tag = tag;
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) entry.note = notes[i];
+            xQueueSend(noteQueue, &entry, 0);
+        }
+        queued = true;
+    }
+
+    uint32_t depth = uxQueueMessagesWaiting(noteQueue);
+    uint32_t elapsedUs = micros() - startUs;
+    if (queued) {
+        stats.patternsQueued++;
+    } else {
+        stats.patternsDropped++;
+    }
+    if (depth > stats.maxQueueDepth) stats.maxQueueDepth = depth;
+    if (elapsedUs > stats.maxEnqueueUs) stats.maxEnqueueUs = elapsedUs;
+    xSemaphoreGive(enqueueMutex);
+
+    if (!queued) {
+        ESP_LOGW(TAG, "Buzzer queue full, dropped %u note pattern", (unsigned)count);
     }
+    return queued;
 }
 
-void BuzzerManager::playNote(char note, int duration) {
+void BuzzerManager::stop() {
+    xSemaphoreTake(enqueueMutex, portMAX_DELAY);
+    stopGeneration++;
+    QueuedNote dropped;
+    while (xQueueReceive(noteQueue, &dropped, 0) == pdTRUE) {
+        finishedNotes++;
+    }
+    xSemaphoreGive(enqueueMutex);
+}
+
+BuzzerManager::Stats BuzzerManager::getStats() {
+    xSemaphoreTake(enqueueMutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(enqueueMutex);
+    return snapshot;
+}
+
+void BuzzerManager::buzzerTask(void* parameter) {
+    BuzzerManager* self = static_cast<BuzzerManager*>(parameter);
+    QueuedNote entry;
+
+    while (true) {
+        if (xQueueReceive(self->noteQueue, &entry, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // A stop() may land between receive and render; the stamp catches it
+        if (entry.generation == self->stopGeneration.load()) {
+            if (entry.note.tag && self->startHandler) {
+                self->startHandler(entry.note.tag);
+            }
+            self->render(entry.note, entry.generation);
+            self->stats.notesPlayed++;
+        }
+        self->finishedNotes++;
+    }
+}
+
+void BuzzerManager::render(const Note& note, uint32_t generation) {
+    if (note.sweepToUs == 0) {
+        hold(note.halfPeriodUs, note.durationMs, generation);
+    } else {
+        // Sweeps can run for seconds; stop() cuts them between steps
+        int step = note.sweepStepUs ? note.sweepStepUs : 1;
+        int direction = note.sweepToUs > note.halfPeriodUs ? step : -step;
+        for (int halfPeriod = note.halfPeriodUs;
+             direction > 0 ? halfPeriod <= note.sweepToUs : halfPeriod >= note.sweepToUs;
+             halfPeriod += direction) {
+            if (!hold(halfPeriod, note.durationMs, generation)) break;
+        }
+    }
+    backend->silence();
+
+    if (note.gapMs) {
+        hold(0, note.gapMs, generation);
+    }
+}
+
+bool BuzzerManager::hold(int halfPeriodUs, int durationMs, uint32_t generation) {
+    // Long notes are split so a preempting stop() is heard within one slice
+    while (durationMs > 0) {
+        if (stopGeneration.load() != generation) return false;
+        int slice = durationMs < SLICE_MS ? durationMs : SLICE_MS;
+        if (halfPeriodUs) {
+            backend->playTone(halfPeriodUs, slice);
+        } else {
+            backend->rest(slice);
+        }
+        durationMs -= slice;
+    }
+    return stopGeneration.load() == generation;
+}
+
+int BuzzerManager::noteTone(char note) {
     for (int i = 0; i < NOTE_COUNT; i++) {
         if (NOTE_NAMES[i] == note) {
-            playTone(NOTE_TONES[i], duration);
-            return;
+            return NOTE_TONES[i];
+        }
+    }
+    return 0;
+}
+
+BuzzerManager::Note BuzzerManager::tone(int halfPeriodUs, int durationMs, int gapMs) {
+    return {static_cast<uint16_t>(halfPeriodUs), static_cast<uint16_t>(durationMs),
+            static_cast<uint16_t>(gapMs), 0, 0, 0};
+}
+
+BuzzerManager::Note BuzzerManager::sweep(int fromUs, int toUs, int stepUs, int durationMs) {
+    return {static_cast<uint16_t>(fromUs), static_cast<uint16_t>(durationMs), 0,
+            static_cast<uint16_t>(toUs), static_cast<uint16_t>(stepUs), 0};
+}
+
+size_t BuzzerManager::patternNotes(Pattern pattern, Note* out) {
+    switch (pattern) {
+    case PATTERN_BOOT:
+        out[0] = tone(noteTone('G'), 100, 50);
+        out[1] = tone(noteTone('c'), 200);
+        return 2;
+    case PATTERN_LOW:
+        out[0] = tone(noteTone('C'), 100);
+        return 1;
+    case PATTERN_MEDIUM:
+        out[0] = tone(noteTone('G'), 100, 50);
+        out[1] = tone(noteTone('G'), 100);
+        return 2;
+    case PATTERN_HIGH:
+        for (int i = 0; i < 3; i++) {
+            out[i] = tone(noteTone('c'), 100, 50);
+        }
+        return 3;
+    case PATTERN_CRITICAL:
+        for (int i = 0; i < 6; i += 2) {
+            out[i] = tone(CRITICAL_HIGH_FREQ, DEFAULT_CRITICAL_ALARM_SPEED, DEFAULT_CRITICAL_ALARM_SPEED);
+            out[i + 1] = tone(CRITICAL_LOW_FREQ, DEFAULT_CRITICAL_ALARM_SPEED, DEFAULT_CRITICAL_ALARM_SPEED);
         }
+        return 6;
     }
+    return 0;
+}
+
+bool BuzzerManager::playPattern(Pattern pattern, uint16_t tag) {
+    Note notes[6];
+    return play(notes, patternNotes(pattern, notes), tag);
 }
 
 bool BuzzerManager::isReady() const {
@@ -75,33 +239,25 @@ bool BuzzerManager::isReady() const {
 
 void BuzzerManager::setMute(bool mute) {
     isMuted = mute;
+    if (mute) {
+        stop();
+    }
 }
 
 void BuzzerManager::playBootTone() {
-    if (!isReady() || isMuted) return;
-    playNote('G', 100);
-    delay(50);
-    playNote('c', 200);
+    playPattern(PATTERN_BOOT);
 }
 
 void BuzzerManager::playLowImportance() {
-    if (!isReady() || isMuted) return;
-    playNote('C', 100);
+    playPattern(PATTERN_LOW);
 }
 
 void BuzzerManager::playMediumImportance() {
-    if (!isReady() || isMuted) return;
-    playNote('G', 100);
-    delay(50);
-    playNote('G', 100);
+    playPattern(PATTERN_MEDIUM);
 }
 
 void BuzzerManager::playHighImportance() {
-    if (!isReady() || isMuted) return;
-    for (int i = 0; i < 3; i++) {
-        playNote('c', 100);
-        delay(50);
-    }
+    playPattern(PATTERN_HIGH);
 }
 
 BuzzerManager::SongConfig BuzzerManager::getDefaultFoxConfig() {
@@ -135,81 +291,57 @@ void BuzzerManager::playCucaracha(int tempo) {
 }
 
 void BuzzerManager::playWhatTheFoxSaid(const SongConfig& config) {
-    if (!isReady() || isMuted) return;
-    
+    Note pattern[FOX_LENGTH];
     for (int i = 0; i < FOX_LENGTH; i++) {
-        if (FOX_SONG[i] != ' ') {
-            playNote(FOX_SONG[i], FOX_BEATS[i] * config.tempo);
-        }
-        delay(config.delayBetweenNotes);
+        pattern[i] = FOX_SONG[i] != ' '
+                         ? tone(noteTone(FOX_SONG[i]), FOX_BEATS[i] * config.tempo, config.delayBetweenNotes)
+                         : tone(0, config.delayBetweenNotes);
     }
+    play(pattern, FOX_LENGTH);
 }
 
 void BuzzerManager::playCucaracha(const SongConfig& config) {
-    if (!isReady() || isMuted) return;
-    
+    Note pattern[CUCARACHA_LENGTH];
     for (int i = 0; i < CUCARACHA_LENGTH; i++) {
-        if (CUCARACHA_SONG[i] != ' ') {
-            playNote(CUCARACHA_SONG[i], CUCARACHA_BEATS[i] * config.tempo);
-        }
-        delay(config.delayBetweenNotes);
+        pattern[i] = CUCARACHA_SONG[i] != ' '
+                         ? tone(noteTone(CUCARACHA_SONG[i]), CUCARACHA_BEATS[i] * config.tempo, config.delayBetweenNotes)
+                         : tone(0, config.delayBetweenNotes);
     }
+    play(pattern, CUCARACHA_LENGTH);
 }
 
 void BuzzerManager::playSequence(const std::vector<ToneSequence>& sequence) {
-    if (!isReady() || isMuted) return;
-    
-    for (const auto& tone : sequence) {
-        playTone(tone.frequency, tone.duration);
-        delay(50);
+    std::vector<Note> pattern;
+    pattern.reserve(sequence.size());
+    for (const auto& step : sequence) {
+        pattern.push_back(tone(step.frequency, step.duration, 50));
     }
+    play(pattern.data(), pattern.size());
 }
 
 void BuzzerManager::playAlarmSiren(int speed) {
-    if (!isReady() || isMuted) return;
-    
-    for (int i = 1000; i < 2000; i += 10) {
-        playTone(i, speed);
-    }
-    for (int i = 2000; i > 1000; i -= 10) {
-        playTone(i, speed);
-    }
+    const Note pattern[] = {sweep(1000, 1990, 10, speed), sweep(2000, 1010, 10, speed)};
+    play(pattern, 2);
 }
 
 void BuzzerManager::playAmbulanceSiren(int speed) {
-    if (!isReady() || isMuted) return;
-    
-    playTone(1500, speed);
-    delay(50);
-    playTone(2000, speed);
-    delay(50);
+    const Note pattern[] = {tone(1500, speed, 50), tone(2000, speed, 50)};
+    play(pattern, 2);
 }
 
 void BuzzerManager::playIncreasingPitch(int speed) {
-    if (!isReady() || isMuted) return;
-    
-    for (int i = 500; i < 2000; i += 10) {
-        playTone(i, speed);
-    }
+    const Note pattern[] = {sweep(500, 1990, 10, speed)};
+    play(pattern, 1);
 }
 
 void BuzzerManager::playDecreasingPitch(int speed) {
-    if (!isReady() || isMuted) return;
-    
-    for (int i = 2000; i > 500; i -= 10) {
-        playTone(i, speed);
-    }
+    const Note pattern[] = {sweep(2000, 510, 10, speed)};
+    play(pattern, 1);
 }
 
 void BuzzerManager::playCriticalAlarm(int speed) {
-    if (!isReady() || isMuted) return;
-    
-    for (int i = 0; i < 3; i++) {
-        playTone(CRITICAL_HIGH_FREQ, speed);
-        delay(speed);
-        playTone(CRITICAL_LOW_FREQ, speed);
-        delay(speed);
-    }
+    const Note high = tone(CRITICAL_HIGH_FREQ, speed, speed);
+    const Note low = tone(CRITICAL_LOW_FREQ, speed, speed);
+    const Note pattern[] = {high, low, high, low, high, low};
+    play(pattern, 6);
 }
-
-// Implement all methods here... 
\ No newline at end of file
@@ -1,83 +1,251 @@
 #include "camera_manager.h"
+#include <string.h>
+#include <utility>
 
 const char *CameraManager::TAG = "CameraManager";
 
-bool CameraManager::begin(bool isPreviewMode)
+CameraManager::CameraManager()
+    : backend(&defaultCameraBackend()), statsMutex(xSemaphoreCreateMutex()), latestMutex(xSemaphoreCreateMutex())
 {
-    if (initialized)
+    memset(profileStats, 0, sizeof(profileStats));
+}
+
+bool CameraManager::begin(CameraProfile::Id profile)
+{
+    if (profile >= CameraProfile::COUNT)
+    {
+        ESP_LOGE(TAG, "Unknown camera profile %d", profile);
+        return false;
+    }
+    if (initialized && profile == active)
     {
-        ESP_LOGW(TAG, "Camera already initialized");
         return true;
     }
 
-    ESP_LOGI(TAG, "Initializing camera...");
+    const CameraProfile &target = CameraProfile::get(profile);
+    unsigned long start = micros();
+    bool reallocate = !initialized || CameraProfile::needsReallocation(CameraProfile::get(active), target);
+    int written = 0;
+
+    // Readers must not pick up a frame shot with the previous settings
+    setLatestFrame(FrameRef());
 
-    if (!initializePins())
+    if (!reallocate)
     {
-        ESP_LOGE(TAG, "Failed to initialize camera pins");
-        return false;
+        written = backend->reconfigure(CameraProfile::get(active), target);
+        if (written < 0)
+        {
+            ESP_LOGW(TAG, "Register delta to %s failed (%s), restarting the driver", target.name,
+                     backend->lastError());
+            reallocate = true;
+        }
     }
+    if (reallocate)
+    {
+        if (initialized)
+        {
+            backend->deinit();
+            initialized = false;
+        }
+        if (!startDriver(target))
+        {
+            xSemaphoreTake(statsMutex, portMAX_DELAY);
+            profileStats[profile].failures++;
+            xSemaphoreGive(statsMutex);
+            return false;
+        }
+        written = 0;
+    }
+    initialized = true;
+    active = profile;
+
+    // A restart starts with empty buffers; after a delta the ring may still
+    // hold frames exposed with the old settings
+    int discarded = awaitValidFrame(target, written > 0 ? STALE_FRAMES : 0);
+    uint32_t firstFrameUs = micros() - start;
 
-    if (!configureCamera(isPreviewMode))
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    ProfileStats &stats = profileStats[profile];
+    stats.switches++;
+    stats.reallocations += reallocate ? 1 : 0;
+    stats.failures += discarded < 0 ? 1 : 0;
+    stats.lastSettingsWritten = written;
+    stats.lastDiscarded = discarded < 0 ? MAX_SETTLE_FRAMES : discarded;
+    stats.lastFirstFrameUs = firstFrameUs;
+    stats.totalFirstFrameUs += firstFrameUs;
+    if (firstFrameUs > stats.maxFirstFrameUs)
     {
-        ESP_LOGE(TAG, "Failed to configure camera");
-        return false;
+        stats.maxFirstFrameUs = firstFrameUs;
     }
+    xSemaphoreGive(statsMutex);
 
-    if (!camera.begin().isOk())
+    if (discarded < 0)
     {
-        ESP_LOGE(TAG, "Camera initialization failed: %s", camera.exception.toString().c_str());
+        ESP_LOGE(TAG, "No valid %s frame after %d tries", target.name, MAX_SETTLE_FRAMES);
+        releaseCamera();
         return false;
     }
 
-    initialized = true;
-    ESP_LOGI(TAG, "Camera initialized successfully");
+    if (reallocate)
+    {
+        ESP_LOGI(TAG, "Camera restarted in %s profile, first valid frame after %lu ms (%d dropped)",
+                 target.name, static_cast<unsigned long>(firstFrameUs / 1000), discarded);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Camera switched to %s profile with %d register writes, first valid frame after %lu ms (%d dropped)",
+                 target.name, written, static_cast<unsigned long>(firstFrameUs / 1000), discarded);
+    }
     return true;
 }
 
-bool CameraManager::initializePins()
+bool CameraManager::startDriver(const CameraProfile &profile)
 {
-    ESP_LOGD(TAG, "Configuring camera pins");
-    camera.pinout.pins.d0 = Y2_GPIO_NUM;
-    camera.pinout.pins.d1 = Y3_GPIO_NUM;
-    camera.pinout.pins.d2 = Y4_GPIO_NUM;
-    camera.pinout.pins.d3 = Y5_GPIO_NUM;
-    camera.pinout.pins.d4 = Y6_GPIO_NUM;
-    camera.pinout.pins.d5 = Y7_GPIO_NUM;
-    camera.pinout.pins.d6 = Y8_GPIO_NUM;
-    camera.pinout.pins.d7 = Y9_GPIO_NUM;
-    camera.pinout.pins.xclk = XCLK_GPIO_NUM;
-    camera.pinout.pins.pclk = PCLK_GPIO_NUM;
-    camera.pinout.pins.vsync = VSYNC_GPIO_NUM;
-    camera.pinout.pins.href = HREF_GPIO_NUM;
-    camera.pinout.pins.sccb_sda = SIOD_GPIO_NUM;
-    camera.pinout.pins.sccb_scl = SIOC_GPIO_NUM;
-    camera.pinout.pins.pwdn = PWDN_GPIO_NUM;
-    camera.pinout.pins.reset = RESET_GPIO_NUM;
+    ESP_LOGI(TAG, "Initializing camera for %s profile...", profile.name);
+
+    if (!backend->init(profile))
+    {
+        ESP_LOGE(TAG, "Camera initialization failed: %s", backend->lastError());
+        return false;
+    }
+
+    poolPending = !framePool.begin(FRAME_POOL_SIZE);
+    if (poolPending)
+    {
+        ESP_LOGW(TAG, "Frame pool unavailable, shared capture waits for the held frames");
+    }
     return true;
 }
 
-bool CameraManager::configureCamera(bool isPreviewMode)
+int CameraManager::awaitValidFrame(const CameraProfile &profile, int skip)
 {
-    ESP_LOGD(TAG, "Configuring camera for %s mode", isPreviewMode ? "preview" : "capture");
+    for (int i = 0; i < MAX_SETTLE_FRAMES; i++)
+    {
+        camera_fb_t *fb = backend->acquire();
+        bool valid = fb && i >= skip && CameraProfile::isValidFrame(profile, fb);
+        release(fb);
+        if (valid)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
 
-    camera.brownout.disable();
-    if (isPreviewMode)
+CameraManager::ProfileStats CameraManager::getProfileStats(CameraProfile::Id profile)
+{
+    ProfileStats snapshot = {};
+    if (profile < CameraProfile::COUNT)
     {
-        camera.resolution.vga();
-        camera.quality.high();
+        xSemaphoreTake(statsMutex, portMAX_DELAY);
+        snapshot = profileStats[profile];
+        xSemaphoreGive(statsMutex);
     }
-    else
+    return snapshot;
+}
+
+void CameraManager::resetProfileStats()
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    memset(profileStats, 0, sizeof(profileStats));
+    xSemaphoreGive(statsMutex);
+}
+
+camera_fb_t *CameraManager::capture()
+{
+    if (!initialized)
     {
-        camera.pixformat.rgb565();
-        camera.resolution.face();
-        camera.quality.best();
+        ESP_LOGE(TAG, "Capture requested before camera initialization");
+        return nullptr;
     }
+    return backend->acquire();
+}
+
+void CameraManager::release(camera_fb_t *fb)
+{
+    if (fb)
+    {
+        backend->release(fb);
+    }
+}
 
-    camera.sensor.enableAutomaticExposureControl();
-    camera.sensor.enableAutomaticGainControl();
-    camera.sensor.enableAutomaticWhiteBalance();
-    camera.sensor.enableAutomaticWhiteBalanceGain();
+FrameRef CameraManager::captureShared()
+{
+    poolError = nullptr;
+    camera_fb_t *fb = capture();
+    if (!fb)
+    {
+        return FrameRef();
+    }
 
-    return true;
-}
\ No newline at end of file
+    // Frames held over the last releaseCamera() kept the pool from restarting
+    if (poolPending)
+    {
+        poolPending = !framePool.begin(FRAME_POOL_SIZE);
+    }
+
+    // One copy out of the driver buffer so the sensor never waits on a
+    // slow consumer; everything downstream shares this copy
+    FrameRef frame = framePool.acquire(fb->len);
+    camera_fb_t *pooled = FramePool::writable(frame);
+    if (pooled)
+    {
+        memcpy(pooled->buf, fb->buf, fb->len);
+        pooled->width = fb->width;
+        pooled->height = fb->height;
+        pooled->format = fb->format;
+        pooled->timestamp = fb->timestamp;
+    }
+    release(fb);
+
+    if (!frame)
+    {
+        poolError = "No free frame buffer in pool";
+        return frame;
+    }
+    setLatestFrame(frame);
+    return frame;
+}
+
+FrameRef CameraManager::getLatestFrame()
+{
+    xSemaphoreTake(latestMutex, portMAX_DELAY);
+    FrameRef frame = latestFrame;
+    xSemaphoreGive(latestMutex);
+    return frame;
+}
+
+void CameraManager::setLatestFrame(const FrameRef &frame)
+{
+    // The previous frame may be released here, outside the lock
+    FrameRef previous;
+    xSemaphoreTake(latestMutex, portMAX_DELAY);
+    previous = std::move(latestFrame);
+    latestFrame = frame;
+    xSemaphoreGive(latestMutex);
+}
+
+void CameraManager::releaseCamera()
+{
+    if (!initialized)
+    {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Releasing camera resources");
+    setLatestFrame(FrameRef());
+    backend->deinit();
+    // Frames still held by consumers keep their buffers until released
+    framePool.end();
+    initialized = false;
+}
+
+void CameraManager::setBackend(CameraBackend *newBackend)
+{
+    if (initialized)
+    {
+        ESP_LOGW(TAG, "Cannot swap camera backend while initialized");
+        return;
+    }
+    backend = newBackend ? newBackend : &defaultCameraBackend();
+}
@@ -0,0 +1,97 @@
+#include "camera_profile.h"
+#include <sensor.h>
+
+// INFERENCE keeps the DATASET geometry so the model sees frames shaped like
+// the ones it was trained on, and switching between the two is a register
+// delta. It trades exposure for gain to keep lane markings sharp at speed.
+static const CameraProfile PROFILES[CameraProfile::COUNT] = {
+    // name, format, frame size, buffer size, quality, AEC, AE level, AGC, gain ceiling, AWB, brightness, contrast, saturation
+    {"preview", PIXFORMAT_JPEG, FRAMESIZE_VGA, FRAMESIZE_VGA, 12, true, 0, true, 2, true, 0, 0, 0},
+    {"dataset", PIXFORMAT_RGB565, FRAMESIZE_240X240, FRAMESIZE_240X240, 0, true, 0, true, 2, true, 0, 0, 0},
+    {"inference", PIXFORMAT_RGB565, FRAMESIZE_240X240, FRAMESIZE_240X240, 0, true, -1, true, 4, true, 0, 1, 0},
+};
+
+const CameraProfile &CameraProfile::get(Id id)
+{
+    return PROFILES[id < COUNT ? id : DATASET];
+}
+
+bool CameraProfile::dimensions(framesize_t size, uint16_t &width, uint16_t &height)
+{
+    if (size < 0 || size >= FRAMESIZE_INVALID)
+    {
+        return false;
+    }
+    // The driver's own table follows its framesize_t, whichever sizes the
+    // installed esp32-camera release defines
+    width = resolution[size].width;
+    height = resolution[size].height;
+    return true;
+}
+
+bool CameraProfile::needsReallocation(const CameraProfile &running, const CameraProfile &target)
+{
+    if (running.format != target.format || running.bufferSize != target.bufferSize)
+    {
+        return true;
+    }
+    // A raw frame fills its buffer exactly; JPEG frames only need to fit
+    if (target.format != PIXFORMAT_JPEG)
+    {
+        return running.frameSize != target.frameSize;
+    }
+    uint16_t width, height, bufferWidth, bufferHeight;
+    return !dimensions(target.frameSize, width, height) ||
+           !dimensions(running.bufferSize, bufferWidth, bufferHeight) ||
+           width * height > bufferWidth * bufferHeight;
+}
+
+int CameraProfile::delta(const CameraProfile &running, const CameraProfile &target)
+{
+    int changed = 0;
+    changed += running.frameSize != target.frameSize;
+    changed += target.format == PIXFORMAT_JPEG && running.jpegQuality != target.jpegQuality;
+    changed += running.autoExposure != target.autoExposure;
+    changed += running.aeLevel != target.aeLevel;
+    changed += running.autoGain != target.autoGain;
+    changed += running.gainCeiling != target.gainCeiling;
+    changed += running.autoWhiteBalance != target.autoWhiteBalance;
+    changed += running.brightness != target.brightness;
+    changed += running.contrast != target.contrast;
+    changed += running.saturation != target.saturation;
+    return changed;
+}
+
+bool CameraProfile::isValidFrame(const CameraProfile &profile, const camera_fb_t *fb)
+{
+    uint16_t width, height;
+    if (!fb || !fb->buf || fb->format != profile.format ||
+        !dimensions(profile.frameSize, width, height) || fb->width != width || fb->height != height)
+    {
+        return false;
+    }
+
+    if (profile.format == PIXFORMAT_RGB565)
+    {
+        return fb->len == static_cast<size_t>(width) * height * 2;
+    }
+    if (profile.format != PIXFORMAT_JPEG)
+    {
+        return fb->len > 0;
+    }
+
+    if (fb->len < 4 || fb->buf[0] != 0xFF || fb->buf[1] != 0xD8)
+    {
+        return false;
+    }
+    // The driver may pad the buffer after EOI
+    size_t stop = fb->len > 1024 ? fb->len - 1024 : 2;
+    for (size_t i = fb->len - 1; i > stop; i--)
+    {
+        if (fb->buf[i - 1] == 0xFF && fb->buf[i] == 0xD9)
+        {
+            return true;
+        }
+    }
+    return false;
+}
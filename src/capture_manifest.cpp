@@ -0,0 +1,199 @@
+#include "capture_manifest.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "crc32.h"
+#include "sd_manager.h"
+#include "session_container.h"
+
+const char *CaptureManifest::TAG = "CaptureManifest";
+
+static const char *SLOT_PATHS[2] = {"/manifest0.mfm", "/manifest1.mfm"};
+
+bool CaptureManifest::readSlot(int slot, Record &out)
+{
+    File file = SDManager::getInstance().openFile(SLOT_PATHS[slot], FILE_READ);
+    if (!file)
+    {
+        return false;
+    }
+    size_t read = file.read(reinterpret_cast<uint8_t *>(&out), sizeof(out));
+    file.close();
+
+    return read == sizeof(out) &&
+           out.magic == RECORD_MAGIC &&
+           out.version == RECORD_VERSION &&
+           out.crc == crc32(&out, offsetof(Record, crc));
+}
+
+bool CaptureManifest::load()
+{
+    unsigned long start = millis();
+    rebuilt = false;
+
+    Record slots[2];
+    bool valid[2] = {readSlot(0, slots[0]), readSlot(1, slots[1])};
+
+    if (valid[0] || valid[1])
+    {
+        int newest = !valid[0] ? 1 : !valid[1] ? 0 : (slots[1].sequence > slots[0].sequence ? 1 : 0);
+        sequence = slots[newest].sequence;
+        frameCounter = slots[newest].nextFrame;
+        frameLease = frameCounter;
+        sessionCounter = slots[newest].nextSession;
+        if (!valid[newest ^ 1])
+        {
+            ESP_LOGW(TAG, "Manifest slot %d invalid, using slot %d", newest ^ 1, newest);
+        }
+    }
+    else
+    {
+        ESP_LOGW(TAG, "No valid manifest, rebuilding from card contents");
+        rebuildFromCard();
+        rebuilt = true;
+        if (!persist(frameCounter))
+        {
+            loadMs = millis() - start;
+            return false;
+        }
+    }
+
+    loaded = true;
+    loadMs = millis() - start;
+    ESP_LOGI(TAG, "Next frame %u, next session %u (%lu ms%s)",
+             static_cast<unsigned>(frameCounter), static_cast<unsigned>(sessionCounter),
+             loadMs, rebuilt ? ", rebuilt" : "");
+    return true;
+}
+
+bool CaptureManifest::persist(uint32_t leaseFrame)
+{
+    Record record = {};
+    record.magic = RECORD_MAGIC;
+    record.version = RECORD_VERSION;
+    record.sequence = sequence + 1;
+    record.nextFrame = leaseFrame;
+    record.nextSession = sessionCounter;
+    record.crc = crc32(&record, offsetof(Record, crc));
+
+    // Alternate slots so the previous record survives a torn write
+    const char *path = SLOT_PATHS[record.sequence & 1];
+    File file = SDManager::getInstance().openFile(path, FILE_WRITE);
+    if (!file)
+    {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return false;
+    }
+    size_t written = file.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record));
+    file.close();
+
+    if (written != sizeof(record))
+    {
+        ESP_LOGE(TAG, "Short write to %s", path);
+        return false;
+    }
+
+    sequence = record.sequence;
+    frameLease = leaseFrame;
+    return true;
+}
+
+uint32_t CaptureManifest::beginSession()
+{
+    // Guards against a manifest restored from an older card image
+    char path[32];
+    Session::sessionDirPath(path, sizeof(path), sessionCounter);
+    while (SDManager::getInstance().exists(path))
+    {
+        ESP_LOGW(TAG, "Session %u already on card, skipping", static_cast<unsigned>(sessionCounter));
+        Session::sessionDirPath(path, sizeof(path), ++sessionCounter);
+    }
+
+    uint32_t session = sessionCounter++;
+    if (!persist(frameLease))
+    {
+        ESP_LOGW(TAG, "Session counter not persisted");
+    }
+    return session;
+}
+
+bool CaptureManifest::reserveFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= frameCounter)
+    {
+        frameCounter = frameIndex + 1;
+    }
+    if (frameIndex < frameLease)
+    {
+        return true;
+    }
+    return persist(frameIndex + FRAME_LEASE);
+}
+
+bool CaptureManifest::endSession(uint32_t nextFrameIndex)
+{
+    frameCounter = nextFrameIndex;
+    return persist(nextFrameIndex);
+}
+
+void CaptureManifest::rebuildFromCard()
+{
+    unsigned long start = millis();
+    uint32_t maxFrame = 0;
+    uint32_t maxSession = 0;
+    int scannedEntries = 0;
+
+    File root = SDManager::getInstance().openDir("/");
+    if (!root)
+    {
+        ESP_LOGE(TAG, "Failed to open root directory");
+    }
+
+    while (root)
+    {
+        File entry = root.openNextFile();
+        if (!entry)
+        {
+            break;
+        }
+        scannedEntries++;
+
+        const char *fileName = entry.name();
+        unsigned int num = 0;
+        char extension[8] = {0};
+        if (sscanf(fileName, IMAGE_PREFIX "%u%7s", &num, extension) == 2 &&
+            strcmp(extension, JPG_EXTENSION) == 0)
+        {
+            // Loose files from firmware before session containers
+            if (num > maxFrame)
+            {
+                maxFrame = num;
+            }
+        }
+        else if (entry.isDirectory() && sscanf(fileName, "session%u", &num) == 1)
+        {
+            if (num > maxSession)
+            {
+                maxSession = num;
+            }
+            Session::Reader reader;
+            Session::IndexEntry last;
+            if (reader.open(num) && reader.recordCount() > 0 &&
+                reader.entry(reader.recordCount() - 1, last) && last.frameIndex > maxFrame)
+            {
+                maxFrame = last.frameIndex;
+            }
+        }
+        entry.close();
+    }
+    if (root)
+    {
+        root.close();
+    }
+
+    frameCounter = maxFrame + 1;
+    frameLease = frameCounter;
+    sessionCounter = maxSession + 1;
+    ESP_LOGI(TAG, "Rebuild scanned %d entries in %lu ms", scannedEntries, millis() - start);
+}
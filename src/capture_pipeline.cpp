@@ -0,0 +1,573 @@
+#include "capture_pipeline.h"
+#include <string.h>
+#include <ArduinoJson.h>
+#include "capture_manifest.h"
+#include "config.h"
+#include "esp_heap_caps.h"
+#include "rgbz_codec.h"
+#include "sd_manager.h"
+
+const char *CapturePipeline::TAG = "CapturePipeline";
+
+static const size_t JPEG_INITIAL_CAPACITY = 32 * 1024;
+static const TickType_t STAGE_POLL_TICKS = pdMS_TO_TICKS(50);
+static const TickType_t STOP_TIMEOUT_TICKS = pdMS_TO_TICKS(10000);
+
+CapturePipeline::CapturePipeline()
+    : encoder(CAPTURE_JPEG_QUALITY,
+              CAPTURE_JPEG_SUBSAMPLE_420 ? JpegStreamEncoder::SUBSAMPLE_420 : JpegStreamEncoder::SUBSAMPLE_444,
+              CAPTURE_JPEG_WORKERS)
+{
+    memset(stats, 0, sizeof(stats));
+    memset(&triggerStats, 0, sizeof(triggerStats));
+    freeQueue = xQueueCreate(SLOT_COUNT, sizeof(Slot *));
+    encodeQueue = xQueueCreate(SLOT_COUNT, sizeof(Slot *));
+    storeQueue = xQueueCreate(SLOT_COUNT, sizeof(Slot *));
+    statsMutex = xSemaphoreCreateMutex();
+    stageExited = xSemaphoreCreateCounting(STAGE_COUNT, 0);
+    running = false;
+    captureDone = true;
+    encodeDone = true;
+    startedAt = 0;
+    nextIndex = 0;
+    sessionId = 0;
+    storedBytes = 0;
+    rawBytes = 0;
+    rawPacked = 0;
+    startedStages = 0;
+}
+
+CapturePipeline::~CapturePipeline()
+{
+    stop();
+    // The queues, slots and semaphores below are still in use by any stage
+    // stop() gave up on, so wait for those without a timeout
+    if (startedStages > 0)
+    {
+        ESP_LOGW(TAG, "Waiting for %d stages to exit before freeing the pipeline", startedStages);
+        while (startedStages > 0)
+        {
+            xSemaphoreTake(stageExited, portMAX_DELAY);
+            startedStages--;
+        }
+        encoder.end();
+    }
+    releaseBuffers();
+    vQueueDelete(freeQueue);
+    vQueueDelete(encodeQueue);
+    vQueueDelete(storeQueue);
+    vSemaphoreDelete(statsMutex);
+    vSemaphoreDelete(stageExited);
+}
+
+const char *CapturePipeline::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case CAPTURE:
+        return "capture";
+    case ENCODE:
+        return "encode";
+    case STORE:
+        return "store";
+    default:
+        return "unknown";
+    }
+}
+
+bool CapturePipeline::start(int firstIndex)
+{
+    if (running)
+    {
+        ESP_LOGW(TAG, "Pipeline already running");
+        return true;
+    }
+
+    // Stages a timed-out stop() left behind still hold the queues and the
+    // session; new ones only start once every one of them has exited
+    bool leftovers = startedStages > 0;
+    while (startedStages > 0 && xSemaphoreTake(stageExited, 0) == pdTRUE)
+    {
+        startedStages--;
+    }
+    if (startedStages > 0)
+    {
+        ESP_LOGE(TAG, "%d stages of the previous run still running, not restarting", startedStages);
+        return false;
+    }
+    if (leftovers)
+    {
+        encoder.end();
+    }
+
+    xQueueReset(freeQueue);
+    xQueueReset(encodeQueue);
+    xQueueReset(storeQueue);
+    for (int i = 0; i < SLOT_COUNT; i++)
+    {
+        Slot *slot = &slots[i];
+        xQueueSend(freeQueue, &slot, 0);
+    }
+
+    if (!session.open(CaptureManifest::getInstance().beginSession()))
+    {
+        ESP_LOGE(TAG, "Failed to open capture session");
+        return false;
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    memset(stats, 0, sizeof(stats));
+    memset(&triggerStats, 0, sizeof(triggerStats));
+    memset(&dedupStats, 0, sizeof(dedupStats));
+    nextIndex = firstIndex;
+    sessionId = session.getSessionId();
+    storedBytes = 0;
+    rawBytes = 0;
+    rawPacked = 0;
+    xSemaphoreGive(statsMutex);
+
+    // Without its helpers the encoder still works, on the encode core alone
+    encoder.begin();
+
+    // Every run starts with a stored frame
+    trigger.reset();
+    duplicates.reset();
+    startedAt = millis();
+    captureDone = false;
+    encodeDone = false;
+    running = true;
+
+    // Storage shares core 1 with capture at a lower priority so SD writes
+    // soak up idle time between exposures; encoding gets core 0 to itself.
+    // Downstream stages start first so they are waiting when frames arrive.
+    if (xTaskCreatePinnedToCore(storeTask, "Pipe_Store", 6144, this, 1, nullptr, 1) == pdPASS)
+    {
+        startedStages++;
+        if (xTaskCreatePinnedToCore(encodeTask, "Pipe_Encode", 8192, this, 2, nullptr, 0) == pdPASS)
+        {
+            startedStages++;
+            if (xTaskCreatePinnedToCore(captureTask, "Pipe_Capture", 4096, this, 3, nullptr, 1) == pdPASS)
+            {
+                startedStages++;
+            }
+        }
+    }
+
+    if (startedStages != STAGE_COUNT)
+    {
+        ESP_LOGE(TAG, "Failed to create pipeline tasks");
+        // Let the stages that did start see an exhausted upstream and exit.
+        // A started store stage closes the session on its way out.
+        captureDone = true;
+        encodeDone = startedStages < 2;
+        if (startedStages == 0)
+        {
+            closeSession();
+        }
+        stop();
+        return false;
+    }
+
+    CaptureTrigger::Settings settings = trigger.getSettings();
+    ESP_LOGI(TAG, "Pipeline started at index %d, storing every %u-%u ms, change threshold %u, duplicate distance %d",
+             firstIndex, static_cast<unsigned>(settings.minIntervalMs), static_cast<unsigned>(settings.maxIntervalMs),
+             settings.threshold, duplicates.getMaxDistance());
+    return true;
+}
+
+void CapturePipeline::stop()
+{
+    if (!running && startedStages == 0)
+    {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Stopping pipeline, draining in-flight frames...");
+    running = false;
+
+    // Every stage that was started signals once on exit
+    while (startedStages > 0 && xSemaphoreTake(stageExited, STOP_TIMEOUT_TICKS) == pdTRUE)
+    {
+        startedStages--;
+    }
+    if (startedStages > 0)
+    {
+        // A stuck encode stage may still be waiting on the encoder helpers;
+        // the stages stay counted until they are seen to exit
+        ESP_LOGW(TAG, "%d stages still running after %lu ms", startedStages,
+                 static_cast<unsigned long>(STOP_TIMEOUT_TICKS * portTICK_PERIOD_MS));
+        return;
+    }
+    encoder.end();
+
+    ESP_LOGI(TAG, "Pipeline stopped. Next index: %d", nextIndex);
+}
+
+CapturePipeline::Stats CapturePipeline::getStats()
+{
+    Stats snapshot;
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    memcpy(snapshot.stages, stats, sizeof(stats));
+    snapshot.trigger = triggerStats;
+    snapshot.dedup = dedupStats;
+    snapshot.nextIndex = nextIndex;
+    snapshot.sessionId = sessionId;
+    snapshot.storedBytes = storedBytes;
+    snapshot.rawBytes = rawBytes;
+    snapshot.rawPacked = rawPacked;
+    xSemaphoreGive(statsMutex);
+
+    snapshot.stages[CAPTURE].queueDepth = SLOT_COUNT - uxQueueMessagesWaiting(freeQueue);
+    snapshot.stages[ENCODE].queueDepth = uxQueueMessagesWaiting(encodeQueue);
+    snapshot.stages[STORE].queueDepth = uxQueueMessagesWaiting(storeQueue);
+    snapshot.runningMs = running ? millis() - startedAt : 0;
+    return snapshot;
+}
+
+void CapturePipeline::captureTask(void *parameter)
+{
+    CapturePipeline *self = static_cast<CapturePipeline *>(parameter);
+    unsigned long lastCapture = millis() - self->trigger.probeIntervalMs();
+
+    while (self->running)
+    {
+        // Re-read every pass so a new interval applies without a restart
+        unsigned long interval = self->trigger.probeIntervalMs();
+        unsigned long elapsed = millis() - lastCapture;
+        if (elapsed < interval)
+        {
+            unsigned long wait = interval - elapsed;
+            vTaskDelay(pdMS_TO_TICKS(wait < 20 ? wait : 20));
+            continue;
+        }
+        lastCapture = millis();
+
+        Slot *slot = nullptr;
+        if (xQueueReceive(self->freeQueue, &slot, 0) != pdTRUE)
+        {
+            // Every slot is still being encoded or written: skip this exposure
+            self->recordStall(CAPTURE);
+            vTaskDelay(1);
+            continue;
+        }
+        self->recordDepth(CAPTURE, SLOT_COUNT - uxQueueMessagesWaiting(self->freeQueue));
+
+        unsigned long workStart = millis();
+        bool ok = self->captureFrame(slot);
+        bool keep = ok && self->triggerFrame(slot) && self->dedupFrame(slot);
+        self->recordWork(CAPTURE, workStart, ok);
+
+        if (!keep)
+        {
+            slot->frame.reset();
+            xQueueSend(self->freeQueue, &slot, 0);
+            continue;
+        }
+        // Change and intervals count from the last frame actually kept
+        self->trigger.commit(slot->capturedAtMs);
+
+        // Only stored frames use up a frame number
+        xSemaphoreTake(self->statsMutex, portMAX_DELAY);
+        slot->index = self->nextIndex++;
+        xSemaphoreGive(self->statsMutex);
+
+        xQueueSend(self->encodeQueue, &slot, portMAX_DELAY);
+        self->recordDepth(ENCODE, uxQueueMessagesWaiting(self->encodeQueue));
+    }
+
+    self->captureDone = true;
+    xSemaphoreGive(self->stageExited);
+    vTaskDelete(nullptr);
+}
+
+void CapturePipeline::encodeTask(void *parameter)
+{
+    CapturePipeline *self = static_cast<CapturePipeline *>(parameter);
+
+    while (!(self->captureDone && uxQueueMessagesWaiting(self->encodeQueue) == 0))
+    {
+        Slot *slot = nullptr;
+        if (xQueueReceive(self->encodeQueue, &slot, STAGE_POLL_TICKS) != pdTRUE)
+        {
+            continue;
+        }
+
+        unsigned long workStart = millis();
+        bool ok = self->encodeFrame(slot);
+        self->recordWork(ENCODE, workStart, ok);
+
+        // Raw data is still stored when JPEG conversion fails
+        if (xQueueSend(self->storeQueue, &slot, 0) != pdTRUE)
+        {
+            self->recordStall(ENCODE);
+            xQueueSend(self->storeQueue, &slot, portMAX_DELAY);
+        }
+        self->recordDepth(STORE, uxQueueMessagesWaiting(self->storeQueue));
+    }
+
+    self->encodeDone = true;
+    xSemaphoreGive(self->stageExited);
+    vTaskDelete(nullptr);
+}
+
+void CapturePipeline::storeTask(void *parameter)
+{
+    CapturePipeline *self = static_cast<CapturePipeline *>(parameter);
+
+    while (!(self->encodeDone && uxQueueMessagesWaiting(self->storeQueue) == 0))
+    {
+        Slot *slot = nullptr;
+        if (xQueueReceive(self->storeQueue, &slot, STAGE_POLL_TICKS) != pdTRUE)
+        {
+            continue;
+        }
+
+        unsigned long workStart = millis();
+        bool ok = self->storeFrame(slot);
+        self->recordWork(STORE, workStart, ok);
+
+        // Drop our reference; the pool gets the frame back once no other
+        // consumer holds it. The JPEG buffer stays with the slot.
+        slot->frame.reset();
+        xQueueSend(self->freeQueue, &slot, portMAX_DELAY);
+    }
+
+    self->closeSession();
+    xSemaphoreGive(self->stageExited);
+    vTaskDelete(nullptr);
+}
+
+void CapturePipeline::closeSession()
+{
+    session.close();
+    CaptureManifest::getInstance().endSession(nextIndex);
+}
+
+bool CapturePipeline::captureFrame(Slot *slot)
+{
+    CameraManager &cameraManager = CameraManager::getInstance();
+
+    digitalWrite(LED_BUILTIN, LOW); // Turn ON while exposing
+    slot->frame = cameraManager.captureShared();
+    digitalWrite(LED_BUILTIN, HIGH); // Turn OFF
+
+    if (!slot->frame)
+    {
+        std::string errorMsg = "Capture failed: ";
+        errorMsg += cameraManager.lastError();
+        reportError(CAPTURE, errorMsg.c_str());
+        return false;
+    }
+    slot->capturedAtMs = millis();
+    return true;
+}
+
+bool CapturePipeline::triggerFrame(Slot *slot)
+{
+    CaptureTrigger::Decision decision = trigger.shouldStore(slot->frame.get(), slot->capturedAtMs);
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    triggerStats.probes++;
+    triggerStats.lastScore = trigger.lastScore();
+    switch (decision)
+    {
+    case CaptureTrigger::SKIP:
+        triggerStats.skipped++;
+        break;
+    case CaptureTrigger::STORE_MAX_INTERVAL:
+        triggerStats.maxIntervalStores++;
+        break;
+    default:
+        triggerStats.changeStores++;
+        break;
+    }
+    xSemaphoreGive(statsMutex);
+
+    ESP_LOGD(TAG, "Probe score %u: %s", trigger.lastScore(), CaptureTrigger::decisionName(decision));
+    return decision != CaptureTrigger::SKIP;
+}
+
+bool CapturePipeline::dedupFrame(Slot *slot)
+{
+    unsigned long start = micros();
+    DuplicateFilter::Result result = duplicates.check(slot->frame.get());
+    uint32_t elapsedUs = micros() - start;
+    if (!result.hashed)
+    {
+        return true;
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    dedupStats.checked++;
+    dedupStats.rejected += result.duplicate ? 1 : 0;
+    dedupStats.lastDistance = result.distance;
+    dedupStats.hashUs += elapsedUs;
+    dedupStats.maxHashUs = elapsedUs > dedupStats.maxHashUs ? elapsedUs : dedupStats.maxHashUs;
+    xSemaphoreGive(statsMutex);
+
+    ESP_LOGD(TAG, "Hash %016llx, nearest %u bits%s", static_cast<unsigned long long>(result.hash), result.distance,
+             result.duplicate ? ": duplicate" : "");
+    return !result.duplicate;
+}
+
+size_t CapturePipeline::appendJpeg(void *arg, size_t index, const void *data, size_t len)
+{
+    Slot *slot = static_cast<Slot *>(arg);
+    if (index + len > slot->jpegCapacity)
+    {
+        // Grows to the largest frame seen, then stays put
+        size_t capacity = slot->jpegCapacity ? slot->jpegCapacity : JPEG_INITIAL_CAPACITY;
+        while (capacity < index + len)
+        {
+            capacity *= 2;
+        }
+        uint8_t *grown = static_cast<uint8_t *>(heap_caps_realloc(slot->jpeg, capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (!grown)
+        {
+            return 0;
+        }
+        slot->jpeg = grown;
+        slot->jpegCapacity = capacity;
+    }
+    memcpy(slot->jpeg + index, data, len);
+    slot->jpegLen = index + len;
+    return len;
+}
+
+bool CapturePipeline::encodeFrame(Slot *slot)
+{
+    slot->jpegLen = 0;
+    if (!encoder.encode(slot->frame.get(), appendJpeg, slot) || slot->jpegLen == 0)
+    {
+        slot->jpegLen = 0;
+        reportError(ENCODE, "JPEG conversion failed");
+        return false;
+    }
+
+    ESP_LOGD(TAG, "Frame %d encoded, JPEG size: %u", slot->index, slot->jpegLen);
+    return true;
+}
+
+bool CapturePipeline::storeFrame(Slot *slot)
+{
+    char meta[128];
+    JsonDocument doc;
+    doc["frame"] = slot->index;
+    doc["width"] = slot->frame->width;
+    doc["height"] = slot->frame->height;
+    doc["format"] = static_cast<int>(slot->frame->format);
+    doc["ms"] = slot->capturedAtMs;
+    size_t metaLen = serializeJson(doc, meta, sizeof(meta));
+
+    if (!CaptureManifest::getInstance().reserveFrame(slot->index))
+    {
+        ESP_LOGW(TAG, "Frame lease not persisted for frame %d", slot->index);
+    }
+
+    // An uncompressible or unpackable frame is kept as plain RGB565
+    size_t packedLen = CAPTURE_RAW_COMPRESSION ? packFrame(slot) : 0;
+    Session::RecordType rawType = packedLen ? Session::RECORD_RAWZ : Session::RECORD_RAW;
+    const uint8_t *raw = packedLen ? packed : slot->frame.data();
+    size_t rawLen = packedLen ? packedLen : slot->frame.size();
+
+    bool ok = session.append(rawType, slot->index, raw, rawLen) &&
+              (!slot->jpegLen || session.append(Session::RECORD_JPEG, slot->index, slot->jpeg, slot->jpegLen)) &&
+              session.append(Session::RECORD_META, slot->index, reinterpret_cast<const uint8_t *>(meta), metaLen);
+    session.endFrame();
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    storedBytes = session.bytesWritten();
+    rawBytes += slot->frame.size();
+    rawPacked += rawLen;
+    xSemaphoreGive(statsMutex);
+
+    if (!ok)
+    {
+        reportError(STORE, "Failed to append frame to session");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Frame %d stored", slot->index);
+    return true;
+}
+
+size_t CapturePipeline::packFrame(const Slot *slot)
+{
+    const camera_fb_t *fb = slot->frame.get();
+    if (fb->format != PIXFORMAT_RGB565 || fb->len != Rgbz::frameBytes(fb->width, fb->height))
+    {
+        return 0;
+    }
+
+    // Sized for the largest frame seen; stored-mode fallback always fits
+    size_t needed = Rgbz::maxEncodedSize(fb->width, fb->height);
+    if (needed > packedCapacity)
+    {
+        heap_caps_free(packed);
+        packed = static_cast<uint8_t *>(heap_caps_malloc(needed, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        packedCapacity = packed ? needed : 0;
+        if (!packed)
+        {
+            ESP_LOGW(TAG, "No memory to compress frame %d, storing it raw", slot->index);
+            return 0;
+        }
+    }
+
+    size_t len = Rgbz::encode(fb->buf, fb->width, fb->height, packed, packedCapacity);
+    ESP_LOGD(TAG, "Frame %d packed to %u of %u bytes", slot->index, len, fb->len);
+    return len;
+}
+
+void CapturePipeline::recordWork(Stage stage, unsigned long startedMs, bool ok)
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats[stage].busyMs += millis() - startedMs;
+    if (ok)
+    {
+        stats[stage].processed++;
+    }
+    else
+    {
+        stats[stage].errors++;
+    }
+    xSemaphoreGive(statsMutex);
+}
+
+void CapturePipeline::recordStall(Stage stage)
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats[stage].stalls++;
+    xSemaphoreGive(statsMutex);
+}
+
+void CapturePipeline::recordDepth(Stage stage, uint32_t depth)
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (depth > stats[stage].maxQueueDepth)
+    {
+        stats[stage].maxQueueDepth = depth;
+    }
+    xSemaphoreGive(statsMutex);
+}
+
+void CapturePipeline::reportError(Stage stage, const char *message)
+{
+    ESP_LOGE(TAG, "[%s] %s", stageName(stage), message);
+    if (errorHandler)
+    {
+        errorHandler(stage, message);
+    }
+}
+
+void CapturePipeline::releaseBuffers()
+{
+    for (int i = 0; i < SLOT_COUNT; i++)
+    {
+        slots[i].frame.reset();
+        heap_caps_free(slots[i].jpeg);
+        slots[i] = Slot();
+    }
+    heap_caps_free(packed);
+    packed = nullptr;
+    packedCapacity = 0;
+}
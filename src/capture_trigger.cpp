@@ -0,0 +1,130 @@
+#include "capture_trigger.h"
+#include <stdlib.h>
+#include <string.h>
+#include "rgb565_luma.h"
+
+CaptureTrigger::CaptureTrigger()
+    : minIntervalMs(CAPTURE_MIN_INTERVAL_MS), maxIntervalMs(CAPTURE_MAX_INTERVAL_MS),
+      threshold(CAPTURE_CHANGE_THRESHOLD)
+{
+    memset(reference, 0, sizeof(reference));
+    memset(thumbnail, 0, sizeof(thumbnail));
+}
+
+bool CaptureTrigger::setIntervals(uint32_t minMs, uint32_t maxMs)
+{
+    if (minMs > maxMs)
+    {
+        return false;
+    }
+    minIntervalMs.store(minMs);
+    maxIntervalMs.store(maxMs);
+    return true;
+}
+
+CaptureTrigger::Settings CaptureTrigger::getSettings() const
+{
+    return {minIntervalMs.load(), maxIntervalMs.load(), threshold.load()};
+}
+
+const char *CaptureTrigger::decisionName(Decision decision)
+{
+    switch (decision)
+    {
+    case SKIP:
+        return "skip";
+    case STORE_FIRST:
+        return "first";
+    case STORE_CHANGE:
+        return "change";
+    case STORE_MAX_INTERVAL:
+        return "max_interval";
+    default:
+        return "unknown";
+    }
+}
+
+bool CaptureTrigger::computeThumbnail(const camera_fb_t *fb)
+{
+    if (!fb || fb->format != PIXFORMAT_RGB565 || fb->width < GRID || fb->height < GRID ||
+        fb->len < static_cast<size_t>(fb->width) * fb->height * 2)
+    {
+        return false;
+    }
+
+    uint32_t sums[GRID * GRID] = {};
+    uint16_t counts[GRID * GRID] = {};
+    for (int y = 0; y < static_cast<int>(fb->height); y += SAMPLE_STEP)
+    {
+        const uint8_t *row = fb->buf + static_cast<size_t>(y) * fb->width * 2;
+        int cellRow = y * GRID / fb->height * GRID;
+        for (int x = 0; x < static_cast<int>(fb->width); x += SAMPLE_STEP)
+        {
+            int luma = rgb565Luma(row + x * 2);
+            int cell = cellRow + x * GRID / fb->width;
+            sums[cell] += luma;
+            counts[cell]++;
+        }
+    }
+    for (int i = 0; i < GRID * GRID; i++)
+    {
+        thumbnail[i] = counts[i] ? sums[i] / counts[i] : 0;
+    }
+    return true;
+}
+
+CaptureTrigger::Decision CaptureTrigger::shouldStore(const camera_fb_t *fb, unsigned long nowMs)
+{
+    Settings settings = getSettings();
+    unsigned long elapsed = nowMs - storedAtMs;
+    if (hasReference && elapsed < settings.minIntervalMs)
+    {
+        return SKIP;
+    }
+
+    // Frames the trigger cannot judge are always stored
+    judged = computeThumbnail(fb);
+    if (!judged)
+    {
+        score = 255;
+        return STORE_CHANGE;
+    }
+
+    Decision decision = SKIP;
+    if (!hasReference)
+    {
+        score = 255;
+        decision = STORE_FIRST;
+    }
+    else
+    {
+        uint32_t total = 0;
+        for (int i = 0; i < GRID * GRID; i++)
+        {
+            total += abs(thumbnail[i] - reference[i]);
+        }
+        score = total / (GRID * GRID);
+        if (score >= settings.threshold)
+        {
+            decision = STORE_CHANGE;
+        }
+        else if (elapsed >= settings.maxIntervalMs)
+        {
+            decision = STORE_MAX_INTERVAL;
+        }
+    }
+
+    return decision;
+}
+
+void CaptureTrigger::commit(unsigned long nowMs)
+{
+    // A stored frame the trigger could not judge leaves nothing to compare
+    // against, so the next probe is stored too
+    if (judged)
+    {
+        memcpy(reference, thumbnail, sizeof(reference));
+    }
+    hasReference = judged;
+    storedAtMs = nowMs;
+}
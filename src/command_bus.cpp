@@ -0,0 +1,143 @@
+#include "command_bus.h"
+
+const char *CommandBus::TAG = "CommandBus";
+
+static_assert((CommandBus::CAPACITY & (CommandBus::CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+CommandBus::CommandBus() : enqueuePos(0), dequeuePos(0), nextSequence(0), rejected(0), maxDepth(0)
+{
+    for (uint32_t i = 0; i < CAPACITY; i++)
+    {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < SOURCE_COUNT; i++)
+    {
+        posted[i].store(0, std::memory_order_relaxed);
+    }
+    wake = xSemaphoreCreateBinary();
+}
+
+bool CommandBus::post(uint8_t code, Source source, uint8_t payload)
+{
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true)
+    {
+        cell = &cells[pos & (CAPACITY - 1)];
+        uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int32_t diff = static_cast<int32_t>(sequence - pos);
+        if (diff == 0)
+        {
+            // Slot is free for this lap; claim it
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Consumer has not freed this slot yet: the ring is full
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            ESP_LOGW(TAG, "Queue full, %s command 0x%02x refused", sourceName(source), code);
+            return false;
+        }
+        else
+        {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->message.code = code;
+    cell->message.source = source;
+    cell->message.payload = payload;
+    cell->message.sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+    cell->message.postedUs = micros();
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    posted[source < SOURCE_COUNT ? source : SOURCE_SYSTEM].fetch_add(1, std::memory_order_relaxed);
+    uint32_t queued = pos + 1 - dequeuePos.load(std::memory_order_relaxed);
+    uint32_t peak = maxDepth.load(std::memory_order_relaxed);
+    while (queued > peak && !maxDepth.compare_exchange_weak(peak, queued, std::memory_order_relaxed))
+    {
+    }
+
+    xSemaphoreGive(wake);
+    return true;
+}
+
+bool CommandBus::tryPop(Message &out)
+{
+    uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell &cell = cells[pos & (CAPACITY - 1)];
+    uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<int32_t>(sequence - (pos + 1)) < 0)
+    {
+        // Empty, or the producer that claimed this slot is still writing it
+        return false;
+    }
+
+    out = cell.message;
+    cell.sequence.store(pos + CAPACITY, std::memory_order_release);
+    dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CommandBus::receive(Message &out, TickType_t wait)
+{
+    if (tryPop(out))
+    {
+        return true;
+    }
+    // Every post gives the semaphore after publishing, so a post that lands
+    // between the check above and this wait still wakes us
+    while (xSemaphoreTake(wake, wait) == pdTRUE)
+    {
+        if (tryPop(out))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t CommandBus::depth() const
+{
+    return enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
+}
+
+CommandBus::Stats CommandBus::getStats() const
+{
+    Stats stats;
+    for (int i = 0; i < SOURCE_COUNT; i++)
+    {
+        stats.posted[i] = posted[i].load(std::memory_order_relaxed);
+    }
+    stats.rejected = rejected.load(std::memory_order_relaxed);
+    stats.maxDepth = maxDepth.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint32_t CommandBus::totalPosted() const
+{
+    uint32_t total = 0;
+    for (int i = 0; i < SOURCE_COUNT; i++)
+    {
+        total += posted[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+const char *CommandBus::sourceName(Source source)
+{
+    switch (source)
+    {
+    case SOURCE_BLE:
+        return "ble";
+    case SOURCE_MENU:
+        return "menu";
+    case SOURCE_SYSTEM:
+        return "system";
+    default:
+        return "unknown";
+    }
+}
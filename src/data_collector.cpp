@@ -1,133 +1,41 @@
 #include "data_collector.h"
 
-using namespace Eloquent::Esp32cam;
-static Camera::Camera camera;
-
 // Define the static TAG member
 const char *DataCollector::TAG = "DataCollector";
 
-bool DataCollector::convert_rgb565_to_jpeg(const uint8_t *rgb565_data, int width, int height,
-                                           uint8_t **jpg_buf_out, size_t *jpg_len_out)
-{
-    if (!rgb565_data || !jpg_buf_out || !jpg_len_out)
-    {
-        ESP_LOGE(TAG, "Invalid parameters");
-        return false;
-    }
-
-    camera_fb_t fb = {
-        .buf = (uint8_t *)rgb565_data,
-        .len = static_cast<size_t>(width * height * 2),
-        .width = static_cast<size_t>(width),
-        .height = static_cast<size_t>(height),
-        .format = PIXFORMAT_RGB565};
-
-    bool success = frame2jpg(&fb, 100, jpg_buf_out, jpg_len_out);
-
-    if (success && *jpg_len_out > 0)
-    {
-        ESP_LOGI(TAG, "JPEG conversion successful, size: %d", *jpg_len_out);
-        return true;
-    }
-
-    ESP_LOGE(TAG, "JPEG conversion failed");
-    return false;
-}
+static const unsigned long METRICS_INTERVAL_MS = 1000;
 
 bool DataCollector::initSD()
 {
     return SDManager::getInstance().begin();
 }
 
-int DataCollector::getNextImageCount()
-{
-    ESP_LOGI(TAG, "Starting getNextImageCount()");
-    File root = SDManager::getInstance().openDir("/");
-    int maxCount = 0;
-
-    if (!root)
-    {
-        ESP_LOGE(TAG, "Failed to open root directory");
-        return -1; // Return error code
-    }
-
-    ESP_LOGI(TAG, "Scanning files...");
-    int scannedFiles = 0;
-    const int MAX_FILES_TO_SCAN = 1000; // Safety limit to prevent hangs
-    
-    while (scannedFiles < MAX_FILES_TO_SCAN)
-    {
-        File entry = root.openNextFile();
-        if (!entry)
-            break;
-
-        scannedFiles++;
-        String fileName = String(entry.name());
-        ESP_LOGD(TAG, "Found file: %s", fileName.c_str());
-
-        if (fileName.startsWith("picture") && fileName.endsWith(".jpg"))
-        {
-            String numStr = fileName.substring(7, fileName.length() - 4);
-            int num = numStr.toInt();
-            ESP_LOGD(TAG, "Found picture number: %d", num);
-            if (num > maxCount)
-                maxCount = num;
-        }
-        entry.close();
-    }
-
-    root.close();
-    
-    if (scannedFiles >= MAX_FILES_TO_SCAN) {
-        ESP_LOGW(TAG, "Reached maximum file scan limit (%d files)", MAX_FILES_TO_SCAN);
-    }
-    
-    ESP_LOGI(TAG, "Scan complete. Scanned %d files. Next image number will be: %d", scannedFiles, maxCount + 1);
-    return maxCount + 1;
-}
-
 DataCollector::DataCollector(CustomBLEService *ble) : bleService(ble)
 {
     ESP_LOGI(TAG, "Initializing DataCollector");
-    lastCapture = 0;
+    lastMetricsUpdate = 0;
     imageCount = 0;
-    camera = nullptr;
+    cameraReady = false;
     cameraMutex = xSemaphoreCreateMutex();
 
-    bleService->setOperationCallback([this](bool enabled)
-                                     {
-        ESP_LOGI(TAG, "Data collection callback triggered: %s", enabled ? "START" : "STOP");
-        if (enabled) {
-            if (!camera && !begin()) {
-                ESP_LOGE(TAG, "Failed to initialize data collector");
-                BuzzerManager::getInstance().playHighImportance(); // Error sound
-                return;
-            }
-            // Start capturing
-            lastCapture = 0;  // Force immediate first capture
+    pipeline.setErrorHandler([this](CapturePipeline::Stage stage, const char *message)
+                             {
+        bleService->updateServiceStatus("collector", message);
+        if (stage == CapturePipeline::STORE) {
+            AlertScheduler::getInstance().raise(AlertScheduler::ALERT_WARNING); // Warning sound
         } else {
-            // Only restart if this was triggered by a stop command, not disconnection
-            // and only if we need to terminate completely
-            if (bleService->wasExplicitlyStopped() && !bleService->isDisconnecting()) {
-                // Instead of restarting, just clean up resources
-                ESP_LOGI(TAG, "Explicit stop command received - Cleaning up resources");
-                bleService->notifyClients("Stopping data collection mode");
-                
-                // Release camera resources but don't restart
-                if (camera) {
-                    camera = nullptr; // CameraManager owns the camera
-                    CameraManager::getInstance().releaseCamera();
-                }
-                
-                // Only restart if we detect an error condition
-                if (SDManager::getInstance().isReady() == false) {
-                    ESP_LOGE(TAG, "SD card in bad state, restarting device");
-                    bleService->notifyClients("SD card error, restarting...");
-                    delay(1000);
-                    ESP.restart();
-                }
-            }
+            AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
         } });
+
+    bleService->setSettingsHandler([this](const JsonDocument &settings)
+                                   { return applySettings(settings); });
+
+    ModeController::getInstance().setHandlers(
+        ModeController::MODE_CAPTURE,
+        [this]()
+        { return start(); },
+        [this]()
+        { stop(); });
 }
 
 DataCollector::~DataCollector()
@@ -137,12 +45,13 @@ DataCollector::~DataCollector()
 
 void DataCollector::cleanup()
 {
+    stopPipeline();
     if (cameraMutex)
     {
         vSemaphoreDelete(cameraMutex);
         cameraMutex = nullptr;
     }
-    camera = nullptr; // Don't delete, it's managed by CameraManager
+    cameraReady = false; // Don't deinit, it's managed by CameraManager
 }
 
 bool DataCollector::begin()
@@ -164,170 +73,228 @@ bool DataCollector::begin()
     
     if (retries >= MAX_RETRIES) {
         ESP_LOGE(TAG, "SD Card initialization failed after %d attempts", MAX_RETRIES);
-        BuzzerManager::getInstance().playHighImportance(); // Error sound
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
         return false;
     }
 
     // Verify SD card is writable with proper error handling
-    File testFile = SD.open("/test.txt", FILE_WRITE);
+    SDManager &sd = SDManager::getInstance();
+    File testFile = sd.openFile("/test.txt", FILE_WRITE);
     if (!testFile)
     {
         ESP_LOGE(TAG, "Failed to create test file - SD card may be write-protected or not properly mounted");
-        BuzzerManager::getInstance().playHighImportance(); // Error sound
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
         return false;
     }
     testFile.close();
-    SD.remove("/test.txt");
-
-    // Get camera instance and configure for capture mode
-    camera = CameraManager::getInstance().getCamera();
-    if (!camera)
-    {
-        ESP_LOGE(TAG, "Failed to get camera instance");
-        return false;
-    }
+    sd.remove("/test.txt");
 
     // Configure camera for capture mode (not preview)
-    if (!CameraManager::getInstance().begin(false))
+    if (!CameraManager::getInstance().begin(CameraProfile::DATASET))
     {
         ESP_LOGE(TAG, "Failed to initialize camera in capture mode");
         return false;
     }
+    cameraReady = true;
 
-    // Get the next available image count with improved error handling
-    int nextImageNum = getNextImageCount();
-    if (nextImageNum < 0) {
+    // Frame numbering comes from the persisted manifest, not a card scan
+    CaptureManifest &manifest = CaptureManifest::getInstance();
+    if (!manifest.isLoaded() && !manifest.load()) {
         ESP_LOGE(TAG, "Failed to determine next image number");
-        BuzzerManager::getInstance().playHighImportance(); // Error sound
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
         return false;
     }
-    
-    imageCount = nextImageNum;
-    ESP_LOGI(TAG, "Image counter initialized. Starting from: %d", imageCount);
+
+    imageCount = manifest.nextFrame();
+    ESP_LOGI(TAG, "Image counter initialized. Starting from: %d (manifest loaded in %lu ms)",
+             imageCount, manifest.loadTimeMs());
 
     ESP_LOGI(TAG, "=== DataCollector Initialization Complete ===");
     return true;
 }
 
-void DataCollector::loop()
+bool DataCollector::start()
 {
-    if (!bleService->isCaptureEnabled())
+    ESP_LOGI(TAG, "Starting data collection");
+    if (!cameraReady && !begin())
     {
-        return;
+        ESP_LOGE(TAG, "Failed to initialize data collector");
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
+        return false;
     }
 
-    if (!camera)
+    // The previous mode may have left the sensor in another profile
+    if (!CameraManager::getInstance().begin(CameraProfile::DATASET))
     {
-        ESP_LOGE(TAG, "Camera not initialized");
-        BuzzerManager::getInstance().playHighImportance(); // Error sound
-        return;
+        ESP_LOGE(TAG, "Failed to switch camera to the dataset profile");
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
+        return false;
     }
 
-    unsigned long currentTime = millis();
-    if (currentTime - lastCapture >= CAPTURE_INTERVAL_MS)
+    ESP_LOGD(TAG, "=== Starting Capture Pipeline ===");
+    if (!pipeline.start(imageCount))
     {
-        ESP_LOGD(TAG, "=== Starting New Capture Cycle ===");
-
-        // Visual feedback
-        digitalWrite(LED_BUILTIN, LOW); // Turn ON
-        delay(100);
-        digitalWrite(LED_BUILTIN, HIGH); // Turn OFF
-
-        if (!camera->capture().isOk())
-        {
-            std::string errorMsg = "Capture failed: ";
-            errorMsg += camera->exception.toString().c_str();
-            bleService->updateServiceStatus("collector", errorMsg);
-            BuzzerManager::getInstance().playHighImportance(); // Error sound
-            return;
-        }
+        bleService->updateServiceStatus("collector", "Failed to start capture pipeline");
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR); // Error sound
+        return false;
+    }
+    bleService->updateServiceStatus("collector", "Capture pipeline running");
+    lastMetricsUpdate = millis();
+    return true;
+}
 
-        bleService->updateServiceStatus("collector", "Image captured successfully");
-
-        // Save RGB565 raw data with better error handling
-        String rgb_path = "/picture" + String(imageCount) + ".rgb";
-        File rgb_file = SD.open(rgb_path.c_str(), FILE_WRITE);
-        if (!rgb_file)
-        {
-            ESP_LOGE(TAG, "Failed to create RGB file: %s", rgb_path.c_str());
-            bleService->updateServiceStatus("collector", "Failed to create RGB file");
-            BuzzerManager::getInstance().playMediumImportance(); // Warning sound
-            return;
-        }
+void DataCollector::stop()
+{
+    ESP_LOGI(TAG, "Stopping data collection");
+    stopPipeline();
 
-        size_t bytesWritten = rgb_file.write(camera->frame->buf, camera->frame->len);
-        rgb_file.close();
+    if (!SDManager::getInstance().isReady())
+    {
+        ESP_LOGE(TAG, "SD card in bad state");
+        bleService->notifyClients("SD card error, reinsert the card");
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_WARNING);
+    }
+}
 
-        if (bytesWritten != camera->frame->len)
-        {
-            ESP_LOGE(TAG, "Failed to write complete RGB data. Written: %u, Expected: %u",
-                     bytesWritten, camera->frame->len);
-            bleService->updateServiceStatus("collector", "Failed to write complete RGB data");
-            BuzzerManager::getInstance().playMediumImportance(); // Warning sound
-            return;
-        }
+void DataCollector::loop()
+{
+    if (!pipeline.isRunning())
+    {
+        return;
+    }
 
-        ESP_LOGI(TAG, "RGB file saved: %s (Size: %u bytes)", rgb_path.c_str(), bytesWritten);
-
-        // Convert and save JPEG with better error handling
-        uint8_t *jpg_buf = NULL;
-        size_t jpg_len = 0;
-        bool converted = convert_rgb565_to_jpeg(camera->frame->buf, camera->frame->width,
-                                                camera->frame->height, &jpg_buf, &jpg_len);
-
-        if (converted && jpg_buf != NULL && jpg_len > 0)
-        {
-            String jpg_path = "/picture" + String(imageCount) + ".jpg";
-            File jpg_file = SD.open(jpg_path.c_str(), FILE_WRITE);
-            if (!jpg_file)
-            {
-                ESP_LOGE(TAG, "Failed to create JPG file: %s", jpg_path.c_str());
-                free(jpg_buf);
-                bleService->updateServiceStatus("collector", "Failed to create JPG file");
-                BuzzerManager::getInstance().playMediumImportance(); // Warning sound
-                return;
-            }
-
-            size_t jpgBytesWritten = jpg_file.write(jpg_buf, jpg_len);
-            jpg_file.close();
-
-            if (jpgBytesWritten != jpg_len)
-            {
-                ESP_LOGE(TAG, "Failed to write complete JPG data. Written: %u, Expected: %u",
-                         jpgBytesWritten, jpg_len);
-                free(jpg_buf);
-                bleService->updateServiceStatus("collector", "Failed to write complete JPG data");
-                BuzzerManager::getInstance().playMediumImportance(); // Warning sound
-                return;
-            }
-
-            ESP_LOGI(TAG, "Saved JPG file: %s (Size: %u bytes)", jpg_path.c_str(), jpg_len);
-            free(jpg_buf);
-            imageCount++;
-            // BuzzerManager::getInstance().playLowImportance(); // Success beep
-        }
-        else
-        {
-            ESP_LOGE(TAG, "JPEG conversion failed");
-            bleService->updateServiceStatus("collector", "JPEG conversion failed");
-            if (jpg_buf)
-                free(jpg_buf);
-            BuzzerManager::getInstance().playHighImportance(); // Error sound
-            return;
-        }
+    if (millis() - lastMetricsUpdate >= METRICS_INTERVAL_MS)
+    {
+        lastMetricsUpdate = millis();
+        publishMetrics();
+    }
+}
+
+void DataCollector::stopPipeline()
+{
+    if (pipeline.isRunning())
+    {
+        pipeline.stop();
+        imageCount = pipeline.getStats().nextIndex;
+        ESP_LOGI(TAG, "Capture pipeline stopped. Next image: %d", imageCount);
+    }
+}
+
+// {"capture": {"min_ms": 500, "max_ms": 15000, "threshold": 8}}; any subset
+// of the keys, applied from the next probe even while capturing
+std::string DataCollector::applySettings(const JsonDocument &settings)
+{
+    JsonObjectConst capture = settings["capture"];
+    JsonObjectConst dedup = settings["dedup"];
+    if (capture.isNull() && dedup.isNull())
+    {
+        return "Settings rejected: nothing to apply";
+    }
 
-        lastCapture = currentTime;
-        ESP_LOGI(TAG, "=== Capture Cycle Complete ===");
-        ESP_LOGD(TAG, "Total images captured: %d", imageCount);
+    // Validate everything before applying anything
+    CaptureTrigger &trigger = pipeline.getTrigger();
+    CaptureTrigger::Settings current = trigger.getSettings();
+    uint32_t minMs = capture["min_ms"] | current.minIntervalMs;
+    uint32_t maxMs = capture["max_ms"] | current.maxIntervalMs;
+    int threshold = capture["threshold"] | static_cast<int>(current.threshold);
+    if (minMs > maxMs || threshold < 0 || threshold > 255)
+    {
+        return "Settings rejected: need min_ms <= max_ms and threshold 0-255";
+    }
+    DuplicateFilter &duplicates = pipeline.getDuplicateFilter();
+    int distance = dedup["max_distance"] | duplicates.getMaxDistance();
+    if (distance < -1 || distance > 64)
+    {
+        return "Settings rejected: need max_distance -1 (off) to 64";
+    }
+
+    trigger.setIntervals(minMs, maxMs);
+    trigger.setThreshold(threshold);
+    duplicates.setMaxDistance(distance);
 
-        // Update metrics
-        JsonDocument doc;
-        doc["image_count"] = imageCount;
-        doc["last_capture"] = millis() - lastCapture;
-        doc["next_capture"] = CAPTURE_INTERVAL_MS - (millis() - lastCapture);
+    char reply[96];
+    snprintf(reply, sizeof(reply), "Capture trigger: %u-%u ms, threshold %d, duplicate distance %d",
+             static_cast<unsigned>(minMs), static_cast<unsigned>(maxMs), threshold, distance);
+    ESP_LOGI(TAG, "%s", reply);
+    return reply;
+}
 
-        std::string metrics;
-        serializeJsonPretty(doc, metrics);
-        bleService->updateServiceMetrics("collector", metrics);
+void DataCollector::publishMetrics()
+{
+    CapturePipeline::Stats stats = pipeline.getStats();
+    const CapturePipeline::StageStats &stored = stats.stages[CapturePipeline::STORE];
+
+    JsonDocument doc;
+    doc["image_count"] = stats.nextIndex;
+    doc["session"] = stats.sessionId;
+    doc["stored_kb"] = static_cast<uint32_t>(stats.storedBytes / 1024);
+    doc["raw_ratio"] = stats.rawPacked ? static_cast<float>(stats.rawBytes) / stats.rawPacked : 0.0f;
+    doc["fps"] = stats.runningMs ? stored.processed * 1000.0f / stats.runningMs : 0.0f;
+    for (int i = 0; i < CapturePipeline::STAGE_COUNT; i++)
+    {
+        const CapturePipeline::StageStats &stage = stats.stages[i];
+        JsonObject entry = doc[CapturePipeline::stageName(static_cast<CapturePipeline::Stage>(i))].to<JsonObject>();
+        entry["processed"] = stage.processed;
+        entry["errors"] = stage.errors;
+        entry["stalls"] = stage.stalls;
+        entry["depth"] = stage.queueDepth;
+        entry["max_depth"] = stage.maxQueueDepth;
+        entry["avg_ms"] = stage.processed ? stage.busyMs / stage.processed : 0;
     }
-}
\ No newline at end of file
+
+    CaptureTrigger::Settings trigger = pipeline.getTrigger().getSettings();
+    JsonObject triggerEntry = doc["trigger"].to<JsonObject>();
+    triggerEntry["min_ms"] = trigger.minIntervalMs;
+    triggerEntry["max_ms"] = trigger.maxIntervalMs;
+    triggerEntry["threshold"] = trigger.threshold;
+    triggerEntry["probes"] = stats.trigger.probes;
+    triggerEntry["skipped"] = stats.trigger.skipped;
+    triggerEntry["on_change"] = stats.trigger.changeStores;
+    triggerEntry["on_max"] = stats.trigger.maxIntervalStores;
+    triggerEntry["score"] = stats.trigger.lastScore;
+
+    JsonObject dedupEntry = doc["dedup"].to<JsonObject>();
+    dedupEntry["max_distance"] = pipeline.getDuplicateFilter().getMaxDistance();
+    dedupEntry["checked"] = stats.dedup.checked;
+    dedupEntry["rejected"] = stats.dedup.rejected;
+    dedupEntry["distance"] = stats.dedup.lastDistance;
+    dedupEntry["hash_us"] = stats.dedup.checked ? stats.dedup.hashUs / stats.dedup.checked : 0;
+    dedupEntry["max_hash_us"] = stats.dedup.maxHashUs;
+
+    FramePool::Stats pool = CameraManager::getInstance().getPoolStats();
+    JsonObject poolEntry = doc["pool"].to<JsonObject>();
+    poolEntry["in_use"] = pool.inUse;
+    poolEntry["capacity"] = pool.capacity;
+    poolEntry["peak"] = pool.peakInUse;
+    poolEntry["exhausted"] = pool.exhausted;
+    poolEntry["alloc_failures"] = pool.allocFailures;
+    poolEntry["kb"] = static_cast<uint32_t>(pool.allocatedBytes / 1024);
+
+    CameraManager::ProfileStats camera = CameraManager::getInstance().getProfileStats(CameraProfile::DATASET);
+    JsonObject cameraEntry = doc["camera"].to<JsonObject>();
+    cameraEntry["switches"] = camera.switches;
+    cameraEntry["restarts"] = camera.reallocations;
+    cameraEntry["first_frame_ms"] = camera.lastFirstFrameUs / 1000;
+    cameraEntry["max_first_frame_ms"] = camera.maxFirstFrameUs / 1000;
+
+    SDWriteCache::Stats sd = SDManager::getInstance().writeCache().getStats();
+    JsonObject sdEntry = doc["sd"].to<JsonObject>();
+    sdEntry["kbps"] = sd.bytesPerSecond / 1024;
+    sdEntry["write_p99_us"] = sd.writeP99Us;
+    sdEntry["queue"] = sd.queueDepth;
+    sdEntry["max_queue"] = sd.maxQueueDepth;
+    sdEntry["stalls"] = sd.stalls;
+
+    AlertScheduler::Stats alerts = AlertScheduler::getInstance().getStats();
+    JsonObject alertEntry = doc["alerts"].to<JsonObject>();
+    alertEntry["played"] = alerts.played;
+    alertEntry["coalesced"] = alerts.coalesced;
+    alertEntry["rate_limited"] = alerts.rateLimited;
+    alertEntry["suppressed"] = alerts.suppressed;
+    alertEntry["preempted"] = alerts.preemptions;
+    alertEntry["critical_max_us"] = alerts.latency[AlertScheduler::PRIORITY_CRITICAL].maxUs;
+
+    std::string metrics;
+    serializeJsonPretty(doc, metrics);
+    bleService->updateServiceMetrics("collector", metrics);
+}
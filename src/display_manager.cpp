@@ -1,10 +1,25 @@
 #include "display_manager.h"
 #include "Version.h"
+#include <string.h>
 
 const char *DisplayManager::TAG = "DisplayManager";
 
 DisplayManager *DisplayManager::instance = nullptr;
 
+namespace
+{
+    // Holds the frame lock for one scope; released on exceptions too
+    class FrameLock
+    {
+    public:
+        explicit FrameLock(SemaphoreHandle_t mutex) : mutex(mutex) { xSemaphoreTake(mutex, portMAX_DELAY); }
+        ~FrameLock() { xSemaphoreGive(mutex); }
+
+    private:
+        SemaphoreHandle_t mutex;
+    };
+}
+
 DisplayManager &DisplayManager::getInstance()
 {
     if (instance == nullptr)
@@ -14,17 +29,30 @@ DisplayManager &DisplayManager::getInstance()
     return *instance;
 }
 
-DisplayManager::DisplayManager() : display(nullptr), initialized(false)
+DisplayManager::DisplayManager() : display(&defaultDisplayBackend()), initialized(false),
+                                   frontBuffer(nullptr), bufferSize(0), compositorHandle(nullptr),
+                                   forceFullFlush(true), bytesAtWindowStart(0), windowStart(0)
 {
     ESP_LOGI(TAG, "Creating DisplayManager");
+    drawMutex = xSemaphoreCreateMutex();
+    flushRequested = xSemaphoreCreateBinary();
+    statsMutex = xSemaphoreCreateMutex();
+    memset(&stats, 0, sizeof(stats));
 }
 
 DisplayManager::~DisplayManager()
 {
-    if (display)
+    delete[] frontBuffer;
+}
+
+void DisplayManager::setBackend(DisplayBackend *backend)
+{
+    if (initialized)
     {
-        delete display;
+        ESP_LOGW(TAG, "Cannot swap display backend after begin()");
+        return;
     }
+    display = backend ? backend : &defaultDisplayBackend();
 }
 
 bool DisplayManager::begin()
@@ -37,166 +65,151 @@ bool DisplayManager::begin()
         return true;
     }
 
-    display = new DISPLAY_MODEL(U8G2_R0, U8X8_PIN_NONE);
     if (!display || !display->begin())
     {
         ESP_LOGE(TAG, "Display initialization failed");
         return false;
     }
 
-    setupDefaults();
+    bufferSize = static_cast<size_t>(display->width()) * display->height() / 8;
+    frontBuffer = new uint8_t[bufferSize];
+    forceFullFlush = true; // panel contents are unknown until the first flush
+
+    // Low priority: a frame is at most ~25 ms of I2C and nothing waits on it
+    if (xTaskCreatePinnedToCore(compositorTask, "Display_Task", 3072, this, 1, &compositorHandle, 0) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create compositor task");
+        delete[] frontBuffer;
+        frontBuffer = nullptr;
+        return false;
+    }
+
     initialized = true;
+    setupDefaults();
     ESP_LOGI(TAG, "Display initialized successfully");
     return true;
 }
 
-void DisplayManager::setupDefaults()
+void DisplayManager::compositorTask(void *parameter)
 {
-    if (!display)
-        return;
-    display->setFont(u8g2_font_4x6_tf);
-    display->setDrawColor(1);
-    display->setFontPosTop();
-    clear();
-    refresh();
-}
+    DisplayManager *self = static_cast<DisplayManager *>(parameter);
+    self->windowStart = millis();
 
-void DisplayManager::clear()
-{
-    if (!display)
-        return;
-    display->clearBuffer();
-}
+    while (true)
+    {
+        if (xSemaphoreTake(self->flushRequested, pdMS_TO_TICKS(1000)) == pdTRUE)
+        {
+            self->flush();
+            // Requests arriving meanwhile collapse into the next frame
+            vTaskDelay(pdMS_TO_TICKS(MIN_FRAME_INTERVAL_MS));
+        }
 
-void DisplayManager::refresh()
-{
-    if (!display)
-        return;
-    display->sendBuffer();
+        unsigned long now = millis();
+        if (now - self->windowStart >= 1000)
+        {
+            xSemaphoreTake(self->statsMutex, portMAX_DELAY);
+            self->stats.bytesPerSecond = (self->stats.bytesSent - self->bytesAtWindowStart) * 1000 / (now - self->windowStart);
+            self->bytesAtWindowStart = self->stats.bytesSent;
+            xSemaphoreGive(self->statsMutex);
+            self->windowStart = now;
+        }
+    }
 }
 
-void DisplayManager::print(const char *text)
+void DisplayManager::flush()
 {
-    if (!text)
-    {
-        ESP_LOGW(TAG, "Attempted to print null text");
-        return;
-    }
+    const size_t pageBytes = display->width();
+    const int pageCount = bufferSize / pageBytes;
+    uint32_t dirtyPages = 0;
 
-    try
     {
-        checkInit();
-
-        ESP_LOGD(TAG, "Printing text: %s", text);
-
-        if (strlen(text) >= 128)
+        // Copy changed pages to the front buffer, then send without the lock
+        // so drawing tasks are never held up by the bus
+        FrameLock lock(drawMutex);
+        const uint8_t *back = display->buffer();
+        for (int page = 0; page < pageCount; page++)
         {
-            ESP_LOGW(TAG, "Text too long, truncating");
-            return;
+            size_t offset = page * pageBytes;
+            if (forceFullFlush || memcmp(back + offset, frontBuffer + offset, pageBytes) != 0)
+            {
+                memcpy(frontBuffer + offset, back + offset, pageBytes);
+                dirtyPages |= 1UL << page;
+            }
         }
-
-        // Get current cursor position
-        u8g2_uint_t x = display->getCursorX();
-        u8g2_uint_t y = display->getCursorY();
-
-        // Ensure we're within display bounds
-        if (y == 0)
-            y = 10; // minimum y to show text
-        if (x >= display->getDisplayWidth())
-            x = 0;
-
-        display->drawStr(x, y, text);
+        forceFullFlush = false;
     }
-    catch (const std::exception &e)
+
+    int sent = 0;
+    for (int page = 0; page < pageCount; page++)
     {
-        ESP_LOGE(TAG, "Error in print: %s", e.what());
+        if (dirtyPages & (1UL << page))
+        {
+            display->sendPage(page, frontBuffer + page * pageBytes);
+            sent++;
+        }
     }
-}
-
-void DisplayManager::printAt(const char *text, int x, int y)
-{
-    if (!text)
-        return;
 
-    try
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (sent)
     {
-        checkInit();
-        display->drawStr(x, y, text);
+        stats.framesSent++;
+        stats.pagesSent += sent;
+        stats.bytesSent += sent * pageBytes;
     }
-    catch (const std::exception &e)
+    else
     {
-        ESP_LOGE(TAG, "Error in printAt: %s", e.what());
+        stats.framesUnchanged++;
     }
+    xSemaphoreGive(statsMutex);
 }
 
-void DisplayManager::drawXBM(const XBMIcon &icon, int x, int y)
+void DisplayManager::compose(const DrawRequest &draw)
 {
-    try
+    if (!isInitialized())
     {
-        checkInit();
-        display->drawXBM(x, y, icon.width(), icon.height(), icon.getData());
+        ESP_LOGE(TAG, "Display not initialized!");
+        return;
     }
-    catch (const std::exception &e)
+
     {
-        ESP_LOGE(TAG, "Error in drawXBM: %s", e.what());
+        FrameLock lock(drawMutex);
+        display->clearBuffer();
+        draw(*display);
     }
+    refresh();
 }
 
-void DisplayManager::drawXBM(int x, int y, int width, int height, const unsigned char *bitmap)
+DisplayManager::Stats DisplayManager::getStats()
 {
-    if (!display)
-        return;
-    display->drawXBM(x, y, width, height, bitmap);
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(statsMutex);
+    return snapshot;
 }
 
-void DisplayManager::setFont(const uint8_t *font)
+void DisplayManager::setupDefaults()
 {
     if (!display)
         return;
-    display->setFont(font);
-}
-
-void DisplayManager::drawFrame(int x, int y, int width, int height)
-{
-    try
-    {
-        checkInit();
-        display->drawFrame(x, y, width, height);
-    }
-    catch (const std::exception &e)
-    {
-        ESP_LOGE(TAG, "Error in drawFrame: %s", e.what());
-    }
-}
-
-void DisplayManager::drawBox(int x, int y, int width, int height)
-{
-    try
-    {
-        checkInit();
-        display->drawBox(x, y, width, height);
-    }
-    catch (const std::exception &e)
-    {
-        ESP_LOGE(TAG, "Error in drawBox: %s", e.what());
-    }
+    compose([](DisplayBackend &) {});
 }
 
-u8g2_uint_t DisplayManager::getDisplayWidth() const
+void DisplayManager::refresh()
 {
-    return display ? display->getDisplayWidth() : 0;
+    if (!isInitialized())
+        return;
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats.flushRequests++;
+    xSemaphoreGive(statsMutex);
+    xSemaphoreGive(flushRequested);
 }
 
-u8g2_uint_t DisplayManager::getDisplayHeight() const
+uint16_t DisplayManager::getDisplayWidth() const
 {
-    return display ? display->getDisplayHeight() : 0;
+    return display ? display->width() : 0;
 }
 
-void DisplayManager::checkInit()
+uint16_t DisplayManager::getDisplayHeight() const
 {
-    if (!isInitialized())
-    {
-        ESP_LOGE(TAG, "Display not initialized!");
-        throw std::runtime_error("Display not initialized");
-    }
+    return display ? display->height() : 0;
 }
@@ -0,0 +1,89 @@
+#include "duplicate_filter.h"
+#include <string.h>
+#include "rgb565_luma.h"
+
+DuplicateFilter::DuplicateFilter() : maxDistance(CAPTURE_DEDUP_DISTANCE)
+{
+    reset();
+}
+
+void DuplicateFilter::reset()
+{
+    memset(recent, 0, sizeof(recent));
+    count = 0;
+    next = 0;
+}
+
+bool DuplicateFilter::computeHash(const camera_fb_t *fb, uint64_t &hash)
+{
+    if (!fb || fb->format != PIXFORMAT_RGB565 || fb->width < HASH_COLUMNS || fb->height < HASH_ROWS ||
+        fb->len < static_cast<size_t>(fb->width) * fb->height * 2)
+    {
+        return false;
+    }
+
+    uint32_t sums[HASH_ROWS * HASH_COLUMNS] = {};
+    uint32_t counts[HASH_ROWS * HASH_COLUMNS] = {};
+    for (int y = 0; y < static_cast<int>(fb->height); y += SAMPLE_STEP)
+    {
+        const uint8_t *row = fb->buf + static_cast<size_t>(y) * fb->width * 2;
+        int cellRow = y * HASH_ROWS / fb->height * HASH_COLUMNS;
+        for (int x = 0; x < static_cast<int>(fb->width); x += SAMPLE_STEP)
+        {
+            // Same luma as CaptureTrigger
+            int luma = rgb565Luma(row + x * 2);
+            int cell = cellRow + x * HASH_COLUMNS / fb->width;
+            sums[cell] += luma;
+            counts[cell]++;
+        }
+    }
+
+    // Means in 1/16 luma steps
+    uint32_t means[HASH_ROWS * HASH_COLUMNS];
+    for (int i = 0; i < HASH_ROWS * HASH_COLUMNS; i++)
+    {
+        means[i] = counts[i] ? sums[i] * 16 / counts[i] : 0;
+    }
+
+    // A cell has to be brighter by a margin to set its bit, so flat areas
+    // (sky, road) hash to a stable 0 instead of following the noise
+    hash = 0;
+    for (int y = 0; y < HASH_ROWS; y++)
+    {
+        for (int x = 0; x < HASH_COLUMNS - 1; x++)
+        {
+            int left = y * HASH_COLUMNS + x;
+            hash = (hash << 1) | (means[left] > means[left + 1] + EDGE_MARGIN * 16 ? 1 : 0);
+        }
+    }
+    return true;
+}
+
+DuplicateFilter::Result DuplicateFilter::check(const camera_fb_t *fb)
+{
+    Result result = {false, false, 64, 0};
+    int limit = maxDistance.load();
+    if (limit < 0)
+    {
+        return result;
+    }
+    result.hashed = computeHash(fb, result.hash);
+    if (!result.hashed)
+    {
+        return result;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int d = distance(result.hash, recent[i]);
+        result.distance = d < result.distance ? d : result.distance;
+    }
+    result.duplicate = result.distance <= limit;
+    if (!result.duplicate)
+    {
+        recent[next] = result.hash;
+        next = (next + 1) % WINDOW;
+        count = count < WINDOW ? count + 1 : WINDOW;
+    }
+    return result;
+}
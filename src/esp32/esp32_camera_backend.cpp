@@ -0,0 +1,234 @@
+#include "esp32_camera_backend.h"
+#include "camera_manager.h"
+#include "file_camera_backend.h"
+
+const char *Esp32CameraBackend::TAG = "Esp32Camera";
+
+Esp32CameraBackend &Esp32CameraBackend::getInstance()
+{
+    static Esp32CameraBackend instance;
+    return instance;
+}
+
+CameraBackend &defaultCameraBackend()
+{
+#ifdef CAMERA_REPLAY_SOURCE
+    FileCameraBackend &replay = FileCameraBackend::getInstance();
+    replay.setSource(CAMERA_REPLAY_SOURCE);
+    replay.setFrameRate(CAMERA_REPLAY_FPS);
+    return replay;
+#else
+    return Esp32CameraBackend::getInstance();
+#endif
+}
+
+Camera::Camera *CameraManager::getCamera()
+{
+    return Esp32CameraBackend::getInstance().driver();
+}
+
+namespace
+{
+    // Counts sensor writes and remembers whether any was refused
+    struct SettingWriter
+    {
+        int written = 0;
+        bool ok = true;
+
+        void operator()(int result)
+        {
+            written++;
+            ok = ok && result == 0;
+        }
+    };
+}
+
+bool Esp32CameraBackend::init(const CameraProfile &profile)
+{
+    if (!initializePins())
+    {
+        error = "Failed to initialize camera pins";
+        return false;
+    }
+
+    if (!configureCamera(profile))
+    {
+        error = "Failed to configure camera";
+        return false;
+    }
+
+    if (!camera.begin().isOk())
+    {
+        error = camera.exception.toString().c_str();
+        return false;
+    }
+
+    if (applySettings(nullptr, profile) < 0)
+    {
+        esp_camera_deinit();
+        return false;
+    }
+
+    error.clear();
+    return true;
+}
+
+int Esp32CameraBackend::reconfigure(const CameraProfile &running, const CameraProfile &target)
+{
+    return applySettings(&running, target);
+}
+
+int Esp32CameraBackend::applySettings(const CameraProfile *running, const CameraProfile &target)
+{
+    sensor_t *sensor = esp_camera_sensor_get();
+    if (!sensor)
+    {
+        error = "Sensor not available";
+        return -1;
+    }
+
+    // After begin() the sensor already runs at bufferSize with default
+    // settings, so a full write skips only the frame size when they match
+    SettingWriter write;
+    if (running ? running->frameSize != target.frameSize : target.frameSize != target.bufferSize)
+    {
+        write(sensor->set_framesize(sensor, target.frameSize));
+    }
+    if (target.format == PIXFORMAT_JPEG && (!running || running->jpegQuality != target.jpegQuality))
+    {
+        write(sensor->set_quality(sensor, target.jpegQuality));
+    }
+    if (!running || running->autoExposure != target.autoExposure)
+    {
+        write(sensor->set_exposure_ctrl(sensor, target.autoExposure));
+    }
+    if (!running || running->aeLevel != target.aeLevel)
+    {
+        write(sensor->set_ae_level(sensor, target.aeLevel));
+    }
+    if (!running || running->autoGain != target.autoGain)
+    {
+        write(sensor->set_gain_ctrl(sensor, target.autoGain));
+    }
+    if (!running || running->gainCeiling != target.gainCeiling)
+    {
+        write(sensor->set_gainceiling(sensor, static_cast<gainceiling_t>(target.gainCeiling)));
+    }
+    if (!running || running->autoWhiteBalance != target.autoWhiteBalance)
+    {
+        // White balance and its gain stage are one setting
+        write(sensor->set_whitebal(sensor, target.autoWhiteBalance) |
+              sensor->set_awb_gain(sensor, target.autoWhiteBalance));
+    }
+    if (!running || running->brightness != target.brightness)
+    {
+        write(sensor->set_brightness(sensor, target.brightness));
+    }
+    if (!running || running->contrast != target.contrast)
+    {
+        write(sensor->set_contrast(sensor, target.contrast));
+    }
+    if (!running || running->saturation != target.saturation)
+    {
+        write(sensor->set_saturation(sensor, target.saturation));
+    }
+
+    if (!write.ok)
+    {
+        error = std::string("Sensor refused a setting of the ") + target.name + " profile";
+        return -1;
+    }
+    return write.written;
+}
+
+void Esp32CameraBackend::deinit()
+{
+    esp_camera_deinit();
+}
+
+camera_fb_t *Esp32CameraBackend::acquire()
+{
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb)
+    {
+        error = "Frame buffer unavailable";
+        return nullptr;
+    }
+    return fb;
+}
+
+void Esp32CameraBackend::release(camera_fb_t *fb)
+{
+    esp_camera_fb_return(fb);
+}
+
+bool Esp32CameraBackend::initializePins()
+{
+    ESP_LOGD(TAG, "Configuring camera pins");
+    camera.pinout.pins.d0 = Y2_GPIO_NUM;
+    camera.pinout.pins.d1 = Y3_GPIO_NUM;
+    camera.pinout.pins.d2 = Y4_GPIO_NUM;
+    camera.pinout.pins.d3 = Y5_GPIO_NUM;
+    camera.pinout.pins.d4 = Y6_GPIO_NUM;
+    camera.pinout.pins.d5 = Y7_GPIO_NUM;
+    camera.pinout.pins.d6 = Y8_GPIO_NUM;
+    camera.pinout.pins.d7 = Y9_GPIO_NUM;
+    camera.pinout.pins.xclk = XCLK_GPIO_NUM;
+    camera.pinout.pins.pclk = PCLK_GPIO_NUM;
+    camera.pinout.pins.vsync = VSYNC_GPIO_NUM;
+    camera.pinout.pins.href = HREF_GPIO_NUM;
+    camera.pinout.pins.sccb_sda = SIOD_GPIO_NUM;
+    camera.pinout.pins.sccb_scl = SIOC_GPIO_NUM;
+    camera.pinout.pins.pwdn = PWDN_GPIO_NUM;
+    camera.pinout.pins.reset = RESET_GPIO_NUM;
+    return true;
+}
+
+bool Esp32CameraBackend::configureCamera(const CameraProfile &profile)
+{
+    ESP_LOGD(TAG, "Configuring camera for %s profile", profile.name);
+
+    camera.brownout.disable();
+    switch (profile.format)
+    {
+    case PIXFORMAT_JPEG:
+        camera.pixformat.jpeg();
+        camera.quality.high();
+        break;
+    case PIXFORMAT_RGB565:
+        camera.pixformat.rgb565();
+        camera.quality.best();
+        break;
+    default:
+        ESP_LOGE(TAG, "Unsupported pixel format %d", profile.format);
+        return false;
+    }
+
+    // The driver sizes its frame buffers from the resolution given to begin()
+    switch (profile.bufferSize)
+    {
+    case FRAMESIZE_96X96:
+        camera.resolution.yolo();
+        break;
+    case FRAMESIZE_QQVGA:
+        camera.resolution.qqvga();
+        break;
+    case FRAMESIZE_240X240:
+        camera.resolution.face();
+        break;
+    case FRAMESIZE_QVGA:
+        camera.resolution.qvga();
+        break;
+    case FRAMESIZE_VGA:
+        camera.resolution.vga();
+        break;
+    case FRAMESIZE_SVGA:
+        camera.resolution.svga();
+        break;
+    default:
+        ESP_LOGE(TAG, "Unsupported buffer size %d", profile.bufferSize);
+        return false;
+    }
+
+    return true;
+}
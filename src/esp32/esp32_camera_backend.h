@@ -0,0 +1,34 @@
+#pragma once
+
+#include "config.h" // Must be first for camera model selection
+#include <eloquent_esp32cam.h>
+#include "hal/camera_backend.h"
+
+using namespace Eloquent::Esp32cam;
+
+// OV sensor on the XIAO ESP32S3 via EloquentEsp32cam / esp32-camera
+class Esp32CameraBackend : public CameraBackend
+{
+public:
+    static Esp32CameraBackend &getInstance();
+
+    bool init(const CameraProfile &profile) override;
+    void deinit() override;
+    int reconfigure(const CameraProfile &running, const CameraProfile &target) override;
+    camera_fb_t *acquire() override;
+    void release(camera_fb_t *fb) override;
+    const char *lastError() const override { return error.c_str(); }
+
+    Camera::Camera *driver() { return &camera; }
+
+private:
+    Esp32CameraBackend() {}
+    static const char *TAG;
+    Camera::Camera camera;
+    std::string error;
+
+    bool initializePins();
+    bool configureCamera(const CameraProfile &profile);
+    // Writes every setting when running is null
+    int applySettings(const CameraProfile *running, const CameraProfile &target);
+};
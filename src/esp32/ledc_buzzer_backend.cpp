@@ -0,0 +1,69 @@
+#include <Arduino.h>
+#include "hal/buzzer_backend.h"
+
+// Passive buzzer on an LEDC PWM channel. The hardware generates the square
+// wave, so the buzzer task only sleeps for the tone duration.
+class LedcBuzzerBackend : public BuzzerBackend
+{
+public:
+    bool begin(int pin) override
+    {
+        buzzerPin = pin;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+        if (!ledcAttach(buzzerPin, 2000, RESOLUTION_BITS))
+        {
+            return false;
+        }
+#else
+        ledcSetup(CHANNEL, 2000, RESOLUTION_BITS);
+        ledcAttachPin(buzzerPin, CHANNEL);
+#endif
+        silence();
+        return true;
+    }
+
+    void playTone(int halfPeriodUs, int durationMs) override
+    {
+        // Notes arrive in slices; only reprogram the timer on a new pitch
+        if (halfPeriodUs > 0 && halfPeriodUs != currentHalfPeriodUs)
+        {
+            ledcWriteTone(target(), 500000UL / halfPeriodUs);
+            currentHalfPeriodUs = halfPeriodUs;
+        }
+        vTaskDelay(pdMS_TO_TICKS(durationMs));
+    }
+
+    void rest(int durationMs) override
+    {
+        silence();
+        vTaskDelay(pdMS_TO_TICKS(durationMs));
+    }
+
+    void silence() override
+    {
+        ledcWriteTone(target(), 0);
+        currentHalfPeriodUs = 0;
+    }
+
+private:
+    static const uint8_t CHANNEL = 7; // clear of the camera XCLK timer/channel
+    static const uint8_t RESOLUTION_BITS = 10;
+    int buzzerPin = -1;
+    int currentHalfPeriodUs = 0;
+
+    // Core 3 addresses LEDC by pin, core 2 by channel
+    uint8_t target() const
+    {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+        return buzzerPin;
+#else
+        return CHANNEL;
+#endif
+    }
+};
+
+BuzzerBackend &defaultBuzzerBackend()
+{
+    static LedcBuzzerBackend instance;
+    return instance;
+}
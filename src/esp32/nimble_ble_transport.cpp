@@ -0,0 +1,238 @@
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include "ble_service.h"
+#include "hal/ble_transport.h"
+
+// GATT server with the MiddleFox characteristics on NimBLE
+class NimbleBleTransport : public BleTransport
+{
+public:
+    bool begin(const char *deviceName, const std::string &commandMenu) override;
+    void setHandlers(WriteHandler onWrite, ConnectionHandler onConnection) override
+    {
+        writeHandler = onWrite;
+        connectionHandler = onConnection;
+    }
+
+    bool publish(Channel channel, const std::string &value) override;
+    int connectedCount() override { return pServer ? pServer->getConnectedCount() : 0; }
+    bool startAdvertising() override { return NimBLEDevice::getAdvertising()->start(); }
+    bool isAdvertising() override { return NimBLEDevice::getAdvertising()->isAdvertising(); }
+    void stopAdvertising() override
+    {
+        if (pServer)
+        {
+            pServer->stopAdvertising();
+        }
+    }
+
+private:
+    static const char *TAG;
+
+    class ServerCallbacks : public NimBLEServerCallbacks
+    {
+    public:
+        explicit ServerCallbacks(NimbleBleTransport &owner) : owner(owner) {}
+        void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo) override;
+        void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo, int reason) override;
+
+    private:
+        NimbleBleTransport &owner;
+    };
+
+    class ControlCallbacks : public NimBLECharacteristicCallbacks
+    {
+    public:
+        explicit ControlCallbacks(NimbleBleTransport &owner) : owner(owner) {}
+        void onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo) override;
+
+    private:
+        NimbleBleTransport &owner;
+    };
+
+    NimBLEServer *pServer = nullptr;
+    NimBLEService *pService = nullptr;
+    NimBLECharacteristic *pControlCharacteristic = nullptr;
+    NimBLECharacteristic *pStatusCharacteristic = nullptr;
+    NimBLECharacteristic *pPreviewInfoCharacteristic = nullptr;
+    NimBLECharacteristic *pServiceStatusCharacteristic = nullptr;
+    NimBLECharacteristic *pServiceMetricsCharacteristic = nullptr;
+
+    WriteHandler writeHandler;
+    ConnectionHandler connectionHandler;
+
+    NimBLECharacteristic *createNotifyCharacteristic(const char *uuid, const char *label);
+};
+
+const char *NimbleBleTransport::TAG = "BLETransport";
+
+BleTransport &defaultBleTransport()
+{
+    static NimbleBleTransport instance;
+    return instance;
+}
+
+void NimbleBleTransport::ServerCallbacks::onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo)
+{
+    ESP_LOGI(TAG, "Client Connected - Address: %s",
+             connInfo.getAddress().toString().c_str());
+    if (owner.connectionHandler)
+    {
+        owner.connectionHandler(true);
+    }
+}
+
+void NimbleBleTransport::ServerCallbacks::onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo, int reason)
+{
+    ESP_LOGI(TAG, "Client Disconnected - Details:"
+                  "\n\tPeer Address: %s"
+                  "\n\tConnection Handle: %d"
+                  "\n\tReason: %d",
+             connInfo.getAddress().toString().c_str(),
+             connInfo.getConnHandle(),
+             reason);
+
+    if (owner.connectionHandler)
+    {
+        owner.connectionHandler(false);
+    }
+
+    pServer->startAdvertising();
+}
+
+void NimbleBleTransport::ControlCallbacks::onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo)
+{
+    if (owner.writeHandler)
+    {
+        owner.writeHandler(pCharacteristic->getValue());
+    }
+}
+
+NimBLECharacteristic *NimbleBleTransport::createNotifyCharacteristic(const char *uuid, const char *label)
+{
+    ESP_LOGD(TAG, "Creating %s characteristic...", label);
+    NimBLECharacteristic *characteristic = pService->createCharacteristic(
+        uuid,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+    if (!characteristic)
+    {
+        ESP_LOGE(TAG, "❌ Failed to create %s characteristic", label);
+    }
+    return characteristic;
+}
+
+bool NimbleBleTransport::begin(const char *deviceName, const std::string &commandMenu)
+{
+    ESP_LOGI(TAG, "Initializing NimBLE Device...");
+    NimBLEDevice::init(deviceName);
+    ESP_LOGD(TAG, "Setting BLE parameters...");
+    NimBLEDevice::setPower(ESP_PWR_LVL_P9);
+    NimBLEDevice::setSecurityAuth(false, false, true);
+    NimBLEDevice::setMTU(185);
+
+    ESP_LOGI(TAG, "Creating BLE Server...");
+    pServer = NimBLEDevice::createServer();
+    if (!pServer)
+    {
+        ESP_LOGE(TAG, "❌ Failed to create BLE server");
+        return false;
+    }
+    pServer->setCallbacks(new ServerCallbacks(*this));
+
+    ESP_LOGI(TAG, "Creating BLE Service...");
+    pService = pServer->createService(SERVICE_UUID);
+    if (!pService)
+    {
+        ESP_LOGE(TAG, "❌ Failed to create BLE service");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Creating Characteristics...");
+
+    // Control Characteristic
+    ESP_LOGD(TAG, "Creating Control characteristic...");
+    pControlCharacteristic = pService->createCharacteristic(
+        CONTROL_CHAR_UUID,
+        NIMBLE_PROPERTY::WRITE);
+    if (!pControlCharacteristic)
+    {
+        ESP_LOGE(TAG, "❌ Failed to create Control characteristic");
+        return false;
+    }
+    pControlCharacteristic->setCallbacks(new ControlCallbacks(*this));
+
+    pStatusCharacteristic = createNotifyCharacteristic(STATUS_CHAR_UUID, "Status");
+    pPreviewInfoCharacteristic = createNotifyCharacteristic(PREVIEW_INFO_CHAR_UUID, "Preview Info");
+    if (!pStatusCharacteristic || !pPreviewInfoCharacteristic)
+    {
+        return false;
+    }
+
+    // Menu Characteristic
+    ESP_LOGD(TAG, "Creating Menu characteristic...");
+    NimBLECharacteristic *pMenuCharacteristic = pService->createCharacteristic(
+        MENU_CHAR_UUID,
+        NIMBLE_PROPERTY::READ);
+    if (!pMenuCharacteristic)
+    {
+        ESP_LOGE(TAG, "❌ Failed to create Menu characteristic");
+        return false;
+    }
+    pMenuCharacteristic->setValue(commandMenu);
+
+    pServiceStatusCharacteristic = createNotifyCharacteristic(SERVICE_STATUS_CHAR_UUID, "Service Status");
+    pServiceMetricsCharacteristic = createNotifyCharacteristic(SERVICE_METRICS_CHAR_UUID, "Service Metrics");
+    if (!pServiceStatusCharacteristic || !pServiceMetricsCharacteristic)
+    {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Starting BLE Service...");
+    if (!pService->start())
+    {
+        ESP_LOGE(TAG, "❌ Failed to start BLE service");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Starting Advertising...");
+    NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
+    pAdvertising->addServiceUUID(SERVICE_UUID);
+    pAdvertising->enableScanResponse(true);
+    pAdvertising->setMinInterval(0x06);
+    pAdvertising->setMaxInterval(0x12);
+
+    if (!pAdvertising->start())
+    {
+        ESP_LOGE(TAG, "❌ Failed to start advertising");
+        return false;
+    }
+
+    return true;
+}
+
+bool NimbleBleTransport::publish(Channel channel, const std::string &value)
+{
+    NimBLECharacteristic *characteristic = nullptr;
+    switch (channel)
+    {
+    case Channel::STATUS:
+        characteristic = pStatusCharacteristic;
+        break;
+    case Channel::PREVIEW_INFO:
+        characteristic = pPreviewInfoCharacteristic;
+        break;
+    case Channel::SERVICE_STATUS:
+        characteristic = pServiceStatusCharacteristic;
+        break;
+    case Channel::SERVICE_METRICS:
+        characteristic = pServiceMetricsCharacteristic;
+        break;
+    }
+
+    if (!characteristic)
+    {
+        return false;
+    }
+    characteristic->setValue(value);
+    return characteristic->notify();
+}
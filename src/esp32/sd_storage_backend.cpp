@@ -0,0 +1,34 @@
+#include <Arduino.h>
+#include <SD.h>
+#include "hal/storage_backend.h"
+
+// SPI SD card on the XIAO expansion board
+class SdStorageBackend : public StorageBackend
+{
+public:
+    bool mount() override
+    {
+        pinMode(SD_CS_PIN, OUTPUT);
+        if (!SD.begin(SD_CS_PIN))
+        {
+            return false;
+        }
+        return SD.cardType() != CARD_NONE;
+    }
+
+    void unmount() override { SD.end(); }
+
+    File open(const char *path, const char *mode) override { return SD.open(path, mode); }
+    bool exists(const char *path) override { return SD.exists(path); }
+    bool remove(const char *path) override { return SD.remove(path); }
+    bool mkdir(const char *path) override { return SD.mkdir(path); }
+
+private:
+    const int SD_CS_PIN = D2; // XIAO Expansion Board SD CS pin
+};
+
+StorageBackend &defaultStorageBackend()
+{
+    static SdStorageBackend instance;
+    return instance;
+}
@@ -0,0 +1,156 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include <new>
+#include <type_traits>
+#include <TensorFlowLite_ESP32.h>
+#include "esp_log.h"
+#include "hal/inference_backend.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+// TFLM errors (unsupported operator, arena too small) go to the log
+class LogErrorReporter : public tflite::ErrorReporter
+{
+public:
+    int Report(const char *format, va_list args) override
+    {
+        char message[128];
+        int length = vsnprintf(message, sizeof(message), format, args);
+        ESP_LOGE("TFLM", "%s", message);
+        return length;
+    }
+};
+
+// TensorFlow Lite Micro, with whichever kernels the bundled library was
+// built with. The registered operators are exactly the ones the host's
+// reference interpreter implements, so a model that loads on one loads on
+// the other.
+class TflmInferenceBackend : public InferenceBackend
+{
+public:
+    TflmInferenceBackend()
+    {
+        resolver.AddConv2D();
+        resolver.AddDepthwiseConv2D();
+        resolver.AddFullyConnected();
+        resolver.AddAveragePool2D();
+        resolver.AddMaxPool2D();
+        resolver.AddReshape();
+    }
+
+    bool load(const uint8_t *model, size_t modelBytes, uint8_t *arena, size_t arenaBytes) override
+    {
+        unload();
+        // Root table offset and file identifier, read before anything else
+        if (modelBytes < 8)
+        {
+            error = "Model file too short";
+            return false;
+        }
+        const tflite::Model *parsed = tflite::GetModel(model);
+        if (parsed->version() != TFLITE_SCHEMA_VERSION)
+        {
+            error = "Unsupported schema version";
+            return false;
+        }
+        // The interpreter lives in member storage: nothing on the heap
+        interpreter = construct<tflite::MicroInterpreter>(parsed, arena, arenaBytes, TakesErrorReporter());
+        if (interpreter->AllocateTensors() != kTfLiteOk)
+        {
+            error = "Unsupported operator or arena too small";
+            unload();
+            return false;
+        }
+        if (interpreter->inputs_size() != 1 || interpreter->outputs_size() != 1 ||
+            interpreter->input(0)->type != kTfLiteInt8 || interpreter->output(0)->type != kTfLiteInt8)
+        {
+            error = "Input and output must be int8 tensors";
+            unload();
+            return false;
+        }
+        error = "";
+        return true;
+    }
+
+    void unload() override
+    {
+        if (interpreter)
+        {
+            interpreter->~MicroInterpreter();
+            interpreter = nullptr;
+        }
+    }
+
+    Tensor input() override { return interpreter ? view(interpreter->input(0)) : Tensor(); }
+    Tensor output() override { return interpreter ? view(interpreter->output(0)) : Tensor(); }
+
+    bool invoke() override
+    {
+        if (!interpreter)
+        {
+            error = "No model loaded";
+            return false;
+        }
+        if (interpreter->Invoke() != kTfLiteOk)
+        {
+            error = "Invoke failed";
+            return false;
+        }
+        return true;
+    }
+
+    size_t arenaUsedBytes() const override { return interpreter ? interpreter->arena_used_bytes() : 0; }
+    const char *name() const override { return "tflm"; }
+    const char *lastError() const override { return error; }
+
+private:
+    typedef tflite::MicroMutableOpResolver<6> Resolver;
+
+    // TFLM releases before the MicroLog switch take an ErrorReporter as the
+    // fifth constructor argument; later ones take resource variables there
+    typedef std::is_constructible<tflite::MicroInterpreter, const tflite::Model *, Resolver &, uint8_t *, size_t,
+                                  tflite::ErrorReporter *>
+        TakesErrorReporter;
+
+    LogErrorReporter errorReporter;
+    Resolver resolver;
+    alignas(tflite::MicroInterpreter) uint8_t interpreterStorage[sizeof(tflite::MicroInterpreter)];
+    tflite::MicroInterpreter *interpreter = nullptr;
+    const char *error = "";
+
+    // Templates, so only the constructor the library has is instantiated
+    template <typename Interpreter>
+    Interpreter *construct(const tflite::Model *model, uint8_t *arena, size_t arenaBytes, std::true_type)
+    {
+        return new (interpreterStorage) Interpreter(model, resolver, arena, arenaBytes, &errorReporter);
+    }
+
+    template <typename Interpreter>
+    Interpreter *construct(const tflite::Model *model, uint8_t *arena, size_t arenaBytes, std::false_type)
+    {
+        return new (interpreterStorage) Interpreter(model, resolver, arena, arenaBytes);
+    }
+
+    static Tensor view(TfLiteTensor *tensor)
+    {
+        Tensor out = {};
+        out.data = tensor->data.int8;
+        out.dimCount = tensor->dims->size < 4 ? tensor->dims->size : 4;
+        for (int i = 0; i < out.dimCount; i++)
+        {
+            out.dims[i] = tensor->dims->data[i];
+        }
+        out.bytes = tensor->bytes;
+        out.scale = tensor->params.scale;
+        out.zeroPoint = tensor->params.zero_point;
+        return out;
+    }
+};
+
+InferenceBackend &defaultInferenceBackend()
+{
+    static TflmInferenceBackend backend;
+    return backend;
+}
@@ -0,0 +1,56 @@
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include "config.h"
+#include "hal/display_backend.h"
+
+// SSD1306 over hardware I2C through U8g2's full-buffer driver
+class U8g2DisplayBackend : public DisplayBackend
+{
+public:
+    U8g2DisplayBackend() : u8g2(U8G2_R0, U8X8_PIN_NONE) {}
+
+    bool begin() override
+    {
+        if (!u8g2.begin())
+        {
+            return false;
+        }
+        u8g2.setFont(u8g2_font_4x6_tf);
+        u8g2.setDrawColor(1);
+        u8g2.setFontPosTop();
+        return true;
+    }
+
+    void clearBuffer() override { u8g2.clearBuffer(); }
+    void sendBuffer() override { u8g2.sendBuffer(); }
+    void sendPage(uint8_t page, const uint8_t *data) override
+    {
+        // One tile row: width / 8 tiles of 8 bytes each
+        u8x8_DrawTile(u8g2.getU8x8(), 0, page, u8g2.getBufferTileWidth(), const_cast<uint8_t *>(data));
+    }
+
+    void drawStr(int x, int y, const char *text) override { u8g2.drawStr(x, y, text); }
+    void drawXBM(int x, int y, int width, int height, const uint8_t *bitmap) override
+    {
+        u8g2.drawXBM(x, y, width, height, bitmap);
+    }
+    void drawFrame(int x, int y, int width, int height) override { u8g2.drawFrame(x, y, width, height); }
+    void drawBox(int x, int y, int width, int height) override { u8g2.drawBox(x, y, width, height); }
+    void setFont(const uint8_t *font) override { u8g2.setFont(font); }
+
+    int cursorX() const override { return u8g2.getCursorX(); }
+    int cursorY() const override { return u8g2.getCursorY(); }
+    uint16_t width() const override { return u8g2.getDisplayWidth(); }
+    uint16_t height() const override { return u8g2.getDisplayHeight(); }
+    uint8_t *buffer() override { return u8g2.getBufferPtr(); }
+
+private:
+    // U8g2's accessors are not const-qualified
+    mutable DISPLAY_MODEL u8g2;
+};
+
+DisplayBackend &defaultDisplayBackend()
+{
+    static U8g2DisplayBackend instance;
+    return instance;
+}
@@ -0,0 +1,377 @@
+#include "file_camera_backend.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "config.h"
+#include "esp_heap_caps.h"
+#include "rgbz_codec.h"
+#include "sd_manager.h"
+
+const char *FileCameraBackend::TAG = "FileCamera";
+
+namespace
+{
+    // Frame number of "picture<N>.ext"; files without one sort after, by name
+    uint32_t frameNumber(const std::string &path)
+    {
+        size_t slash = path.find_last_of('/');
+        const char *name = path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+        unsigned int number = 0;
+        return sscanf(name, IMAGE_PREFIX "%u", &number) == 1 ? number : UINT32_MAX;
+    }
+
+    bool endsWith(const char *name, const char *suffix)
+    {
+        size_t nameLen = strlen(name);
+        size_t suffixLen = strlen(suffix);
+        return nameLen > suffixLen && strcmp(name + nameLen - suffixLen, suffix) == 0;
+    }
+
+    // Frame size from the first SOF marker of a baseline or progressive JPEG
+    bool jpegDimensions(const uint8_t *data, size_t len, uint16_t &width, uint16_t &height)
+    {
+        size_t pos = 2;
+        while (pos + 9 < len)
+        {
+            if (data[pos] != 0xFF)
+            {
+                return false;
+            }
+            uint8_t marker = data[pos + 1];
+            if (marker >= 0xC0 && marker <= 0xC2)
+            {
+                height = (data[pos + 5] << 8) | data[pos + 6];
+                width = (data[pos + 7] << 8) | data[pos + 8];
+                return true;
+            }
+            pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+        }
+        return false;
+    }
+}
+
+FileCameraBackend &FileCameraBackend::getInstance()
+{
+    static FileCameraBackend instance;
+    return instance;
+}
+
+bool FileCameraBackend::init(const CameraProfile &target)
+{
+    if (target.format != PIXFORMAT_RGB565 && target.format != PIXFORMAT_JPEG)
+    {
+        error = std::string("Profile ") + target.name + " has no recorded frames to replay";
+        return false;
+    }
+    if (!SDManager::getInstance().isReady() && !SDManager::getInstance().begin())
+    {
+        error = "Storage unavailable for replay";
+        return false;
+    }
+
+    profile = target;
+    error.clear();
+    records.clear();
+    files.clear();
+    next = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    unsigned int id = 0;
+    isSession = sscanf(source.c_str(), "/session%u", &id) == 1 || sscanf(source.c_str(), "session%u", &id) == 1;
+    sessionId = id;
+    if (!(isSession ? scanSession() : scanDirectory()))
+    {
+        return false;
+    }
+    if (frameCount() == 0)
+    {
+        error = std::string("No ") + (profile.format == PIXFORMAT_JPEG ? "JPEG" : "raw") + " frames in " + source;
+        return false;
+    }
+
+    // The profile's geometry has to match what was recorded
+    size_t len = 0;
+    if (!readNext(len) || !describe(len) || !CameraProfile::isValidFrame(profile, &frame))
+    {
+        if (error.empty())
+        {
+            error = "Recorded frames do not match the " + std::string(profile.name) + " profile";
+        }
+        deinit();
+        return false;
+    }
+    next = 0;
+    memset(&stats, 0, sizeof(stats));
+    nextFrameDueUs = micros();
+
+    ESP_LOGI(TAG, "Replaying %u frames from %s at %u fps (0 = full speed)", static_cast<unsigned>(frameCount()),
+             source.c_str(), frameRate);
+    error.clear();
+    return true;
+}
+
+bool FileCameraBackend::scanSession()
+{
+    if (!reader.open(sessionId))
+    {
+        error = "Cannot open session " + std::to_string(sessionId);
+        return false;
+    }
+
+    bool jpeg = profile.format == PIXFORMAT_JPEG;
+    for (size_t i = 0; i < reader.recordCount(); i++)
+    {
+        Session::IndexEntry entry;
+        if (!reader.entry(i, entry))
+        {
+            continue;
+        }
+        if (jpeg ? entry.type == Session::RECORD_JPEG
+                 : entry.type == Session::RECORD_RAW || entry.type == Session::RECORD_RAWZ)
+        {
+            records.push_back(entry);
+        }
+    }
+    return true;
+}
+
+bool FileCameraBackend::scanDirectory()
+{
+    File dir = SDManager::getInstance().openDir(source.c_str());
+    if (!dir || !dir.isDirectory())
+    {
+        error = "Cannot open replay directory " + source;
+        return false;
+    }
+
+    bool jpeg = profile.format == PIXFORMAT_JPEG;
+    std::string prefix = source.back() == '/' ? source : source + "/";
+    while (true)
+    {
+        File entry = dir.openNextFile();
+        if (!entry)
+        {
+            break;
+        }
+        bool wanted = jpeg ? endsWith(entry.name(), JPG_EXTENSION)
+                           : endsWith(entry.name(), RGB_EXTENSION) || endsWith(entry.name(), RGBZ_EXTENSION);
+        if (!entry.isDirectory() && wanted)
+        {
+            files.push_back(prefix + entry.name());
+        }
+        entry.close();
+    }
+    dir.close();
+
+    std::sort(files.begin(), files.end(), [](const std::string &a, const std::string &b)
+              {
+                  uint32_t na = frameNumber(a);
+                  uint32_t nb = frameNumber(b);
+                  return na != nb ? na < nb : a < b; });
+    return true;
+}
+
+void FileCameraBackend::deinit()
+{
+    reader.close();
+    records.clear();
+    files.clear();
+    heap_caps_free(buffer);
+    buffer = nullptr;
+    capacity = 0;
+    heap_caps_free(packed);
+    packed = nullptr;
+    packedCapacity = 0;
+    inUse = false;
+}
+
+int FileCameraBackend::reconfigure(const CameraProfile &running, const CameraProfile &target)
+{
+    // Sensor settings mean nothing for recorded frames; a new format or size
+    // needs a rescan, which CameraManager gets by restarting
+    if (CameraProfile::needsReallocation(running, target) || running.frameSize != target.frameSize)
+    {
+        error = "Replay source needs a restart for a new frame format";
+        return -1;
+    }
+    profile = target;
+    return 0;
+}
+
+size_t FileCameraBackend::frameCount() const
+{
+    return isSession ? records.size() : files.size();
+}
+
+camera_fb_t *FileCameraBackend::acquire()
+{
+    if (inUse)
+    {
+        error = "Frame buffer still held by a consumer";
+        return nullptr;
+    }
+    if (next >= frameCount())
+    {
+        if (!looping || frameCount() == 0)
+        {
+            error = "End of replay";
+            return nullptr;
+        }
+        next = 0;
+        stats.loops++;
+    }
+
+    waitForFrameTime();
+
+    size_t len = 0;
+    unsigned long start = micros();
+    bool ok = readNext(len) && describe(len);
+    stats.readUs += micros() - start;
+    if (!ok)
+    {
+        stats.readErrors++;
+        return nullptr;
+    }
+
+    unsigned long now = micros();
+    frame.timestamp.tv_sec = now / 1000000UL;
+    frame.timestamp.tv_usec = now % 1000000UL;
+    stats.served++;
+    stats.bytesRead += len;
+    inUse = true;
+    return &frame;
+}
+
+void FileCameraBackend::release(camera_fb_t *fb)
+{
+    if (fb == &frame)
+    {
+        inUse = false;
+    }
+}
+
+bool FileCameraBackend::reserve(uint8_t *&target, size_t &targetCapacity, size_t bytes)
+{
+    if (bytes <= targetCapacity)
+    {
+        return true;
+    }
+    heap_caps_free(target);
+    target = static_cast<uint8_t *>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    targetCapacity = target ? bytes : 0;
+    if (!target)
+    {
+        error = "No memory for a " + std::to_string(bytes) + " byte replay frame";
+    }
+    return target != nullptr;
+}
+
+bool FileCameraBackend::readNext(size_t &len)
+{
+    size_t index = next++;
+    bool compressed = isSession ? records[index].type == Session::RECORD_RAWZ
+                                : endsWith(files[index].c_str(), RGBZ_EXTENSION);
+    uint8_t *&target = compressed ? packed : buffer;
+    size_t &targetCapacity = compressed ? packedCapacity : capacity;
+
+    if (isSession)
+    {
+        const Session::IndexEntry &entry = records[index];
+        if (!reserve(target, targetCapacity, entry.length))
+        {
+            return false;
+        }
+        if (!reader.read(entry, target))
+        {
+            error = "Unreadable record for frame " + std::to_string(entry.frameIndex);
+            return false;
+        }
+        len = entry.length;
+        return !compressed || unpack(len);
+    }
+
+    File file = SDManager::getInstance().openFile(files[index].c_str(), FILE_READ);
+    if (!file)
+    {
+        error = "Cannot open " + files[index];
+        return false;
+    }
+    len = file.size();
+    if (!reserve(target, targetCapacity, len))
+    {
+        file.close();
+        return false;
+    }
+    bool complete = file.read(target, len) == len;
+    file.close();
+    if (!complete)
+    {
+        error = "Short read from " + files[index];
+    }
+    return complete && (!compressed || unpack(len));
+}
+
+bool FileCameraBackend::unpack(size_t &len)
+{
+    Rgbz::Header header;
+    if (!Rgbz::readHeader(packed, len, header))
+    {
+        error = "Compressed frame has no valid header";
+        return false;
+    }
+    size_t frameLen = Rgbz::frameBytes(header.width, header.height);
+    if (!reserve(buffer, capacity, frameLen))
+    {
+        return false;
+    }
+    if (!Rgbz::decode(packed, len, buffer, capacity))
+    {
+        error = "Corrupt compressed frame";
+        return false;
+    }
+    len = frameLen;
+    return true;
+}
+
+bool FileCameraBackend::describe(size_t len)
+{
+    uint16_t width = 0;
+    uint16_t height = 0;
+    if (profile.format == PIXFORMAT_JPEG)
+    {
+        if (!jpegDimensions(buffer, len, width, height))
+        {
+            error = "Replayed JPEG has no frame header";
+            return false;
+        }
+    }
+    else
+    {
+        // Raw captures carry no header; they are the profile's frame size
+        CameraProfile::dimensions(profile.frameSize, width, height);
+    }
+
+    frame.buf = buffer;
+    frame.len = len;
+    frame.width = width;
+    frame.height = height;
+    frame.format = profile.format;
+    return true;
+}
+
+void FileCameraBackend::waitForFrameTime()
+{
+    if (frameRate == 0)
+    {
+        return;
+    }
+
+    unsigned long now = micros();
+    long remaining = static_cast<long>(nextFrameDueUs - now);
+    if (remaining > 0)
+    {
+        delay((remaining + 999) / 1000);
+        now = micros();
+    }
+    nextFrameDueUs = now + 1000000UL / frameRate;
+}
@@ -0,0 +1,274 @@
+#include "frame_pool.h"
+#include <string.h>
+#include "esp_heap_caps.h"
+
+const char *FramePool::TAG = "FramePool";
+
+// ---- FrameRef ----
+
+FrameRef::FrameRef(const FrameRef &other) : slot(other.slot)
+{
+    if (slot)
+    {
+        slot->refs.fetch_add(1);
+    }
+}
+
+FrameRef::FrameRef(FrameRef &&other) noexcept : slot(other.slot)
+{
+    other.slot = nullptr;
+}
+
+FrameRef &FrameRef::operator=(const FrameRef &other)
+{
+    if (this != &other)
+    {
+        if (other.slot)
+        {
+            other.slot->refs.fetch_add(1);
+        }
+        reset();
+        slot = other.slot;
+    }
+    return *this;
+}
+
+FrameRef &FrameRef::operator=(FrameRef &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+void FrameRef::reset()
+{
+    if (slot)
+    {
+        slot->pool->release(slot);
+    }
+    slot = nullptr;
+}
+
+const camera_fb_t *FrameRef::get() const
+{
+    return slot ? &slot->frame : nullptr;
+}
+
+int FrameRef::useCount() const
+{
+    return slot ? slot->refs.load() : 0;
+}
+
+// ---- FramePool ----
+
+FramePool::FramePool()
+{
+    slots = nullptr;
+    slotCount = 0;
+    retiredCount = 0;
+    freeSlots = xQueueCreate(MAX_BUFFERS, sizeof(FrameRef::Slot *));
+    statsMutex = xSemaphoreCreateMutex();
+    memset(&stats, 0, sizeof(stats));
+}
+
+FramePool::~FramePool()
+{
+    end();
+    vQueueDelete(freeSlots);
+    vSemaphoreDelete(statsMutex);
+}
+
+bool FramePool::begin(int bufferCount)
+{
+    // Read together: the last retired handle clears both
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    bool running = slots != nullptr;
+    int retired = retiredCount;
+    xSemaphoreGive(statsMutex);
+    if (retired)
+    {
+        ESP_LOGE(TAG, "%d frames from the ended pool still referenced", retired);
+        return false;
+    }
+    if (running)
+    {
+        return true;
+    }
+    if (bufferCount < 1 || bufferCount > MAX_BUFFERS)
+    {
+        ESP_LOGE(TAG, "Invalid pool size %d (1..%d)", bufferCount, MAX_BUFFERS);
+        return false;
+    }
+
+    slots = new FrameRef::Slot[bufferCount];
+    slotCount = bufferCount;
+    xQueueReset(freeSlots);
+    for (int i = 0; i < slotCount; i++)
+    {
+        FrameRef::Slot *slot = &slots[i];
+        slot->pool = this;
+        memset(&slot->frame, 0, sizeof(slot->frame));
+        slot->capacity = 0;
+        slot->refs.store(0);
+        slot->retired = false;
+        xQueueSend(freeSlots, &slot, 0);
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = slotCount;
+    xSemaphoreGive(statsMutex);
+
+    ESP_LOGI(TAG, "Frame pool ready with %d buffers", slotCount);
+    return true;
+}
+
+void FramePool::end()
+{
+    if (!slots)
+    {
+        return;
+    }
+
+    // Idle buffers go now; referenced ones are freed by their last handle,
+    // and the last of those frees the slots
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (retiredCount)
+    {
+        xSemaphoreGive(statsMutex);
+        return; // already ended
+    }
+    xQueueReset(freeSlots);
+    for (int i = 0; i < slotCount; i++)
+    {
+        FrameRef::Slot &slot = slots[i];
+        if (slot.refs.load() > 0)
+        {
+            slot.retired = true;
+            retiredCount++;
+            continue;
+        }
+        stats.allocatedBytes -= slot.capacity;
+        heap_caps_free(slot.frame.buf);
+        slot.frame.buf = nullptr;
+        slot.capacity = 0;
+    }
+    stats.capacity = 0;
+    int pending = retiredCount;
+    xSemaphoreGive(statsMutex);
+    if (pending)
+    {
+        ESP_LOGW(TAG, "Ending pool with %d frames still referenced; freed as they are released", pending);
+        return;
+    }
+
+    delete[] slots;
+    slots = nullptr;
+    slotCount = 0;
+    xQueueReset(freeSlots);
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats.capacity = 0;
+    stats.inUse = 0;
+    stats.allocatedBytes = 0;
+    xSemaphoreGive(statsMutex);
+}
+
+FrameRef FramePool::acquire(size_t bytes)
+{
+    FrameRef::Slot *slot = nullptr;
+    if (!slots || xQueueReceive(freeSlots, &slot, 0) != pdTRUE)
+    {
+        xSemaphoreTake(statsMutex, portMAX_DELAY);
+        stats.exhausted++;
+        xSemaphoreGive(statsMutex);
+        return FrameRef();
+    }
+
+    if (slot->capacity < bytes)
+    {
+        size_t previous = slot->capacity;
+        heap_caps_free(slot->frame.buf);
+        slot->frame.buf = static_cast<uint8_t *>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        slot->capacity = slot->frame.buf ? bytes : 0;
+
+        xSemaphoreTake(statsMutex, portMAX_DELAY);
+        stats.allocatedBytes = stats.allocatedBytes - previous + slot->capacity;
+        if (!slot->frame.buf)
+        {
+            stats.allocFailures++;
+        }
+        xSemaphoreGive(statsMutex);
+
+        if (!slot->frame.buf)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %u byte frame buffer", bytes);
+            xQueueSend(freeSlots, &slot, 0);
+            return FrameRef();
+        }
+    }
+
+    slot->frame.len = bytes;
+    slot->refs.store(1);
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats.acquired++;
+    stats.inUse++;
+    if (stats.inUse > stats.peakInUse)
+    {
+        stats.peakInUse = stats.inUse;
+    }
+    xSemaphoreGive(statsMutex);
+
+    return FrameRef(slot);
+}
+
+camera_fb_t *FramePool::writable(FrameRef &frame)
+{
+    return frame.slot ? &frame.slot->frame : nullptr;
+}
+
+void FramePool::release(FrameRef::Slot *slot)
+{
+    // The last handle and end() decide a slot's fate under the same lock, so
+    // end() never frees a slot whose final release is still on its way here
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (slot->refs.fetch_sub(1) != 1)
+    {
+        xSemaphoreGive(statsMutex);
+        return;
+    }
+    stats.inUse--;
+    if (!slot->retired)
+    {
+        xSemaphoreGive(statsMutex);
+        xQueueSend(freeSlots, &slot, 0);
+        return;
+    }
+
+    // Pool was ended while this frame was out
+    stats.allocatedBytes -= slot->capacity;
+    heap_caps_free(slot->frame.buf);
+    slot->frame.buf = nullptr;
+    slot->capacity = 0;
+    if (--retiredCount == 0)
+    {
+        delete[] slots;
+        slots = nullptr;
+        slotCount = 0;
+        ESP_LOGI(TAG, "Last frame of the ended pool released");
+    }
+    xSemaphoreGive(statsMutex);
+}
+
+FramePool::Stats FramePool::getStats()
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(statsMutex);
+    return snapshot;
+}
@@ -0,0 +1,192 @@
+#include "frame_preprocessor.h"
+#include <string.h>
+#include "rgb565_luma.h"
+
+const char *FramePreprocessor::TAG = "FramePreprocessor";
+
+FramePreprocessor::FramePreprocessor() : layout(), configured(false)
+{
+    memset(quantize, 0, sizeof(quantize));
+    rgb565LumaTables(lumaHigh, lumaLow);
+    cachedRows[0] = cachedRows[1] = -1;
+}
+
+bool FramePreprocessor::configure(const Layout &requested, const int8_t table[256])
+{
+    configured = false;
+    Layout l = requested;
+    if (l.roi.width == 0 || l.roi.height == 0)
+    {
+        l.roi = {0, 0, l.sourceWidth, l.sourceHeight};
+    }
+    if (l.sourceWidth <= 0 || l.sourceHeight <= 0 || l.sourceWidth > 0xFFFF || l.roi.x < 0 || l.roi.y < 0 ||
+        l.roi.width <= 0 || l.roi.height <= 0 || l.roi.x + l.roi.width > l.sourceWidth ||
+        l.roi.y + l.roi.height > l.sourceHeight)
+    {
+        ESP_LOGE(TAG, "Region %dx%d+%d+%d is outside the %dx%d frame", l.roi.width, l.roi.height, l.roi.x,
+                 l.roi.y, l.sourceWidth, l.sourceHeight);
+        return false;
+    }
+    if (l.width <= 0 || l.width > MAX_WIDTH || l.height <= 0 || (l.channels != 1 && l.channels != 3))
+    {
+        ESP_LOGE(TAG, "Unsupported output %dx%dx%d", l.width, l.height, l.channels);
+        return false;
+    }
+    if (l.resample == AREA && (l.width > l.roi.width || l.height > l.roi.height))
+    {
+        ESP_LOGE(TAG, "Area resampling cannot enlarge %dx%d to %dx%d", l.roi.width, l.roi.height, l.width,
+                 l.height);
+        return false;
+    }
+
+    for (int x = 0; x < l.width; x++)
+    {
+        if (l.resample == AREA)
+        {
+            columnStart[x] = l.roi.x + x * l.roi.width / l.width;
+            columnEnd[x] = l.roi.x + (x + 1) * l.roi.width / l.width;
+            continue;
+        }
+        // Centre of output column x in source columns, 16.16, clamped left
+        int64_t centre = ((2 * x + 1) * (static_cast<int64_t>(l.roi.width) << 16)) / (2 * l.width) - 0x8000;
+        centre = centre < 0 ? 0 : centre;
+        int left = centre >> 16;
+        columnStart[x] = l.roi.x + left;
+        columnEnd[x] = l.roi.x + (left + 1 < l.roi.width ? left + 1 : left);
+        columnWeight[x] = (centre >> 8) & 0xFF;
+    }
+
+    memcpy(quantize, table, sizeof(quantize));
+    layout = l;
+    configured = true;
+    ESP_LOGI(TAG, "%dx%d+%d+%d -> %dx%dx%d, %s", l.roi.width, l.roi.height, l.roi.x, l.roi.y, l.width, l.height,
+             l.channels, l.resample == AREA ? "area" : "bilinear");
+    return true;
+}
+
+void FramePreprocessor::run(const uint8_t *frame, int8_t *out)
+{
+    if (!configured)
+    {
+        return;
+    }
+    const bool area = layout.resample == AREA;
+    if (layout.channels == 1)
+    {
+        area ? runArea<1>(frame, out) : runBilinear<1>(frame, out);
+    }
+    else
+    {
+        area ? runArea<3>(frame, out) : runBilinear<3>(frame, out);
+    }
+}
+
+template <int CHANNELS>
+inline void FramePreprocessor::load(const uint8_t *pixel, int *values) const
+{
+    if (CHANNELS == 1)
+    {
+        values[0] = (lumaHigh[pixel[0]] + lumaLow[pixel[1]]) >> 8;
+    }
+    else
+    {
+        values[0] = pixel[0] & 0xF8;
+        values[1] = ((pixel[0] & 0x07) << 5) | ((pixel[1] >> 3) & 0x1C);
+        values[2] = (pixel[1] & 0x1F) << 3;
+    }
+}
+
+template <int CHANNELS>
+void FramePreprocessor::runArea(const uint8_t *frame, int8_t *out)
+{
+    const size_t stride = static_cast<size_t>(layout.sourceWidth) * 2;
+    for (int y = 0; y < layout.height; y++)
+    {
+        int top = layout.roi.y + y * layout.roi.height / layout.height;
+        int bottom = layout.roi.y + (y + 1) * layout.roi.height / layout.height;
+        memset(sums, 0, sizeof(uint32_t) * layout.width * CHANNELS);
+        for (int sy = top; sy < bottom; sy++)
+        {
+            const uint8_t *row = frame + sy * stride;
+            uint32_t *sum = sums;
+            for (int x = 0; x < layout.width; x++, sum += CHANNELS)
+            {
+                const uint8_t *pixel = row + columnStart[x] * 2;
+                const uint8_t *end = row + columnEnd[x] * 2;
+                for (; pixel < end; pixel += 2)
+                {
+                    int values[CHANNELS];
+                    load<CHANNELS>(pixel, values);
+                    for (int c = 0; c < CHANNELS; c++)
+                    {
+                        sum[c] += values[c];
+                    }
+                }
+            }
+        }
+        const uint32_t *sum = sums;
+        for (int x = 0; x < layout.width; x++, sum += CHANNELS)
+        {
+            uint32_t count = (bottom - top) * (columnEnd[x] - columnStart[x]);
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                *out++ = quantize[(sum[c] + count / 2) / count];
+            }
+        }
+    }
+}
+
+template <int CHANNELS>
+void FramePreprocessor::horizontal(const uint8_t *row, uint16_t *out) const
+{
+    for (int x = 0; x < layout.width; x++)
+    {
+        int left[CHANNELS];
+        int right[CHANNELS];
+        load<CHANNELS>(row + columnStart[x] * 2, left);
+        load<CHANNELS>(row + columnEnd[x] * 2, right);
+        int weight = columnWeight[x];
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            *out++ = left[c] * (256 - weight) + right[c] * weight;
+        }
+    }
+}
+
+template <int CHANNELS>
+void FramePreprocessor::runBilinear(const uint8_t *frame, int8_t *out)
+{
+    const size_t stride = static_cast<size_t>(layout.sourceWidth) * 2;
+    cachedRows[0] = cachedRows[1] = -1;
+    for (int y = 0; y < layout.height; y++)
+    {
+        int64_t centre =
+            ((2 * y + 1) * (static_cast<int64_t>(layout.roi.height) << 16)) / (2 * layout.height) - 0x8000;
+        centre = centre < 0 ? 0 : centre;
+        int top = centre >> 16;
+        int need[2] = {layout.roi.y + top, layout.roi.y + (top + 1 < layout.roi.height ? top + 1 : top)};
+        int weight = (centre >> 8) & 0xFF;
+
+        // Horizontal passes are kept for the next output row: when
+        // enlarging, most rows reuse both
+        const uint16_t *pass[2];
+        int used = -1;
+        for (int k = 0; k < 2; k++)
+        {
+            int slot = cachedRows[0] == need[k] ? 0 : cachedRows[1] == need[k] ? 1 : -1;
+            if (slot < 0)
+            {
+                slot = k == 0 ? (cachedRows[0] == need[1] ? 1 : 0) : 1 - used;
+                horizontal<CHANNELS>(frame + need[k] * stride, rows[slot]);
+                cachedRows[slot] = need[k];
+            }
+            pass[k] = rows[slot];
+            used = slot;
+        }
+
+        for (int i = 0; i < layout.width * CHANNELS; i++)
+        {
+            *out++ = quantize[(pass[0][i] * (256 - weight) + pass[1][i] * weight + 0x8000) >> 16];
+        }
+    }
+}
@@ -4,12 +4,7 @@
 CustomBLEService bleService;
 PreviewService previewService(&bleService);
 DataCollector collector(&bleService);
-
-#ifdef PRODUCTION_MODE
-ModelInference inference;
-#endif
-
-DISPLAY_MODEL u8g2(U8G2_R0, /* reset=*/U8X8_PIN_NONE, /* clock=*/SCL, /* data=*/SDA);
+ModelInference inference(&bleService);
 
 // Define global references
 DisplayManager &display = DisplayManager::getInstance();
@@ -0,0 +1,326 @@
+#include "inverse_perspective_map.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include "crc32.h"
+#include "rgb565_luma.h"
+#include "sd_manager.h"
+
+const char *InversePerspectiveMap::TAG = "InversePerspective";
+
+namespace
+{
+    // Solves the 8x8 system for the homography taking `from` to `to` (h[8]
+    // is 1); false when the points are degenerate
+    bool solveHomography(const double from[4][2], const double to[4][2], double h[9])
+    {
+        double a[8][9];
+        for (int i = 0; i < 4; i++)
+        {
+            double u = from[i][0], v = from[i][1], x = to[i][0], y = to[i][1];
+            double rowX[9] = {u, v, 1, 0, 0, 0, -u * x, -v * x, x};
+            double rowY[9] = {0, 0, 0, u, v, 1, -u * y, -v * y, y};
+            memcpy(a[2 * i], rowX, sizeof(rowX));
+            memcpy(a[2 * i + 1], rowY, sizeof(rowY));
+        }
+        for (int column = 0; column < 8; column++)
+        {
+            int pivot = column;
+            for (int row = column + 1; row < 8; row++)
+            {
+                pivot = fabs(a[row][column]) > fabs(a[pivot][column]) ? row : pivot;
+            }
+            if (fabs(a[pivot][column]) < 1e-9)
+            {
+                return false;
+            }
+            for (int k = 0; k < 9; k++)
+            {
+                double swap = a[column][k];
+                a[column][k] = a[pivot][k];
+                a[pivot][k] = swap;
+            }
+            for (int row = 0; row < 8; row++)
+            {
+                if (row == column)
+                {
+                    continue;
+                }
+                double factor = a[row][column] / a[column][column];
+                for (int k = column; k < 9; k++)
+                {
+                    a[row][k] -= factor * a[column][k];
+                }
+            }
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            h[i] = a[i][8] / a[i][i];
+        }
+        h[8] = 1;
+        return true;
+    }
+}
+
+InversePerspectiveMap::Quad InversePerspectiveMap::Quad::fromVanishingPoint(float vanishX, float vanishY, float top)
+{
+    // Share of the way from the vanishing point down to the bottom row
+    float t = (top - vanishY) / (1 - vanishY);
+    Quad quad = {{vanishX - vanishX * t, vanishX + (1 - vanishX) * t, 1, 0}, {top, top, 1, 1}};
+    return quad;
+}
+
+InversePerspectiveMap::InversePerspectiveMap() : layout(), table(nullptr), loaded(false), firstRow(0), lastRow(-1)
+{
+    rgb565LumaTables(lumaHigh, lumaLow);
+}
+
+InversePerspectiveMap::~InversePerspectiveMap()
+{
+    release();
+}
+
+void InversePerspectiveMap::release()
+{
+    heap_caps_free(table);
+    table = nullptr;
+    loaded = false;
+}
+
+bool InversePerspectiveMap::allocate(const Layout &wanted)
+{
+    release();
+    if (wanted.sourceWidth < 2 || wanted.sourceHeight < 2 || wanted.width <= 0 || wanted.height <= 0 ||
+        static_cast<uint32_t>(wanted.sourceWidth) * wanted.sourceHeight > 0xFFFFFF ||
+        static_cast<uint32_t>(wanted.width) * wanted.height > 0x100000)
+    {
+        ESP_LOGE(TAG, "Unsupported layout %dx%d -> %dx%d", wanted.sourceWidth, wanted.sourceHeight, wanted.width,
+                 wanted.height);
+        return false;
+    }
+    layout = wanted;
+    table = static_cast<uint32_t *>(heap_caps_malloc(tableBytes(), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (!table)
+    {
+        ESP_LOGE(TAG, "No PSRAM for a %u byte remap table", static_cast<unsigned>(tableBytes()));
+        return false;
+    }
+    return true;
+}
+
+bool InversePerspectiveMap::build(const Layout &wanted)
+{
+    unsigned long start = micros();
+    if (!allocate(wanted))
+    {
+        return false;
+    }
+
+    // Output corners (pixel edges) to the quad's corners in source pixels
+    const double from[4][2] = {{0, 0}, {static_cast<double>(layout.width), 0},
+                               {static_cast<double>(layout.width), static_cast<double>(layout.height)},
+                               {0, static_cast<double>(layout.height)}};
+    double to[4][2];
+    for (int i = 0; i < 4; i++)
+    {
+        to[i][0] = layout.quad.x[i] * layout.sourceWidth;
+        to[i][1] = layout.quad.y[i] * layout.sourceHeight;
+    }
+    // The corners must go round a convex quad in the output's order
+    bool convex = true;
+    for (int i = 0; i < 4; i++)
+    {
+        const double *p = to[i], *q = to[(i + 1) % 4], *r = to[(i + 2) % 4];
+        convex = convex && (q[0] - p[0]) * (r[1] - q[1]) - (q[1] - p[1]) * (r[0] - q[0]) > 0;
+    }
+    double h[9];
+    bool solved = convex && solveHomography(from, to, h);
+    for (int i = 0; solved && i < 4; i++)
+    {
+        // Every corner in front of the camera, or the quad folds over
+        solved = h[6] * from[i][0] + h[7] * from[i][1] + h[8] > 0;
+    }
+    if (!solved)
+    {
+        ESP_LOGE(TAG, "Degenerate ground quad");
+        release();
+        return false;
+    }
+
+    const int32_t limitX = (layout.sourceWidth - 1) << FRACTION_BITS;
+    const int32_t limitY = (layout.sourceHeight - 1) << FRACTION_BITS;
+    const float scale = 1 << FRACTION_BITS;
+    float m[9]; // single precision per pixel: the S3's FPU has no doubles
+    for (int i = 0; i < 9; i++)
+    {
+        m[i] = static_cast<float>(h[i]);
+    }
+    uint32_t *entry = table;
+    for (int oy = 0; oy < layout.height; oy++)
+    {
+        float v = oy + 0.5f;
+        for (int ox = 0; ox < layout.width; ox++)
+        {
+            float u = ox + 0.5f;
+            float w = m[6] * u + m[7] * v + m[8];
+            // Sample position in pixel-centre coordinates, 1/16 pixel steps
+            float sx = (m[0] * u + m[1] * v + m[2]) / w - 0.5f;
+            float sy = (m[3] * u + m[4] * v + m[5]) / w - 0.5f;
+            int32_t qx = static_cast<int32_t>(lroundf(sx * scale));
+            int32_t qy = static_cast<int32_t>(lroundf(sy * scale));
+            if (qx < 0 || qy < 0 || qx >= limitX || qy >= limitY)
+            {
+                *entry++ = INVALID;
+                continue;
+            }
+            uint32_t index = static_cast<uint32_t>(qy >> FRACTION_BITS) * layout.sourceWidth + (qx >> FRACTION_BITS);
+            *entry++ = index | static_cast<uint32_t>(qx & 0xF) << 24 | static_cast<uint32_t>(qy & 0xF) << 28;
+        }
+    }
+    findSourceRows();
+    ESP_LOGI(TAG, "Built %dx%d remap table (%u bytes) in %lu us, source rows %d..%d", layout.width, layout.height,
+             static_cast<unsigned>(tableBytes()), micros() - start, firstRow, lastRow);
+    return true;
+}
+
+void InversePerspectiveMap::findSourceRows()
+{
+    firstRow = layout.sourceHeight;
+    lastRow = -1;
+    size_t count = static_cast<size_t>(layout.width) * layout.height;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (table[i] == INVALID)
+        {
+            continue;
+        }
+        int row = (table[i] & 0xFFFFFF) / layout.sourceWidth;
+        firstRow = row < firstRow ? row : firstRow;
+        lastRow = row + 1 > lastRow ? row + 1 : lastRow;
+    }
+}
+
+void InversePerspectiveMap::warp(const uint8_t *frame, uint8_t *out) const
+{
+    if (!table)
+    {
+        return;
+    }
+    const size_t stride = static_cast<size_t>(layout.sourceWidth) * 2;
+    const uint32_t *entry = table;
+    const uint32_t *end = table + static_cast<size_t>(layout.width) * layout.height;
+    for (; entry < end; entry++)
+    {
+        uint32_t e = *entry;
+        if (e == INVALID)
+        {
+            *out++ = 0;
+            continue;
+        }
+        const uint8_t *p = frame + (e & 0xFFFFFF) * 2;
+        const uint8_t *q = p + stride;
+        int fx = (e >> 24) & 0xF;
+        int fy = e >> 28;
+        int a = (lumaHigh[p[0]] + lumaLow[p[1]]) >> 8;
+        int b = (lumaHigh[p[2]] + lumaLow[p[3]]) >> 8;
+        int c = (lumaHigh[q[0]] + lumaLow[q[1]]) >> 8;
+        int d = (lumaHigh[q[2]] + lumaLow[q[3]]) >> 8;
+        int top = (a << FRACTION_BITS) + (b - a) * fx;
+        int bottom = (c << FRACTION_BITS) + (d - c) * fx;
+        *out++ = ((top << FRACTION_BITS) + (bottom - top) * fy + 128) >> (2 * FRACTION_BITS);
+    }
+}
+
+InversePerspectiveMap::FileHeader InversePerspectiveMap::header() const
+{
+    FileHeader header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.sourceWidth = layout.sourceWidth;
+    header.sourceHeight = layout.sourceHeight;
+    header.width = layout.width;
+    header.height = layout.height;
+    memcpy(header.quadX, layout.quad.x, sizeof(header.quadX));
+    memcpy(header.quadY, layout.quad.y, sizeof(header.quadY));
+    header.tableCrc = table ? crc32(table, tableBytes()) : 0;
+    header.crc = crc32(&header, offsetof(FileHeader, crc));
+    return header;
+}
+
+bool InversePerspectiveMap::save(const char *path) const
+{
+    if (!table)
+    {
+        return false;
+    }
+    SDManager &sd = SDManager::getInstance();
+    std::string directory(path, strrchr(path, '/') ? strrchr(path, '/') - path : 0);
+    if (!directory.empty() && !sd.exists(directory.c_str()) && !sd.mkdir(directory.c_str()))
+    {
+        ESP_LOGW(TAG, "Cannot create %s", directory.c_str());
+        return false;
+    }
+    File file = sd.openFile(path, FILE_WRITE);
+    if (!file)
+    {
+        ESP_LOGW(TAG, "Cannot write %s", path);
+        return false;
+    }
+    FileHeader record = header();
+    bool ok = file.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record)) == sizeof(record) &&
+              file.write(reinterpret_cast<const uint8_t *>(table), tableBytes()) == tableBytes();
+    file.close();
+    if (!ok)
+    {
+        ESP_LOGW(TAG, "Short write to %s", path);
+        SDManager::getInstance().remove(path);
+    }
+    return ok;
+}
+
+bool InversePerspectiveMap::load(const char *path, const Layout &wanted)
+{
+    File file = SDManager::getInstance().openFile(path, FILE_READ);
+    if (!file)
+    {
+        return false;
+    }
+    FileHeader stored;
+    bool ok = file.read(reinterpret_cast<uint8_t *>(&stored), sizeof(stored)) == sizeof(stored) &&
+              stored.magic == FILE_MAGIC && stored.version == FILE_VERSION &&
+              stored.crc == crc32(&stored, offsetof(FileHeader, crc)) && stored.sourceWidth == wanted.sourceWidth &&
+              stored.sourceHeight == wanted.sourceHeight && stored.width == wanted.width &&
+              stored.height == wanted.height && memcmp(stored.quadX, wanted.quad.x, sizeof(stored.quadX)) == 0 &&
+              memcmp(stored.quadY, wanted.quad.y, sizeof(stored.quadY)) == 0;
+    ok = ok && allocate(wanted);
+    ok = ok && file.read(reinterpret_cast<uint8_t *>(table), tableBytes()) == tableBytes() &&
+         crc32(table, tableBytes()) == stored.tableCrc;
+    file.close();
+    if (!ok)
+    {
+        release();
+        return false;
+    }
+    findSourceRows();
+    loaded = true;
+    return true;
+}
+
+bool InversePerspectiveMap::begin(const Layout &wanted, const char *path)
+{
+    if (load(path, wanted))
+    {
+        ESP_LOGI(TAG, "Loaded %dx%d remap table from %s", wanted.width, wanted.height, path);
+        return true;
+    }
+    if (!build(wanted))
+    {
+        return false;
+    }
+    if (!save(path))
+    {
+        ESP_LOGW(TAG, "Remap table not cached in %s, rebuilt on every start", path);
+    }
+    return true;
+}
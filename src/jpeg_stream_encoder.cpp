@@ -0,0 +1,514 @@
+#include "jpeg_stream_encoder.h"
+#include <string.h>
+#include "esp_log.h"
+
+const char *JpegStreamEncoder::TAG = "JpegStream";
+
+namespace
+{
+    const uint8_t ZIGZAG[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+    // ITU T.81 Annex K, natural order
+    const uint8_t LUMA_QUANT[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+    const uint8_t CHROMA_QUANT[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+    const uint8_t DC_LUMA_COUNTS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    const uint8_t DC_CHROMA_COUNTS[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    const uint8_t DC_VALUES[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    const uint8_t AC_LUMA_COUNTS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 125};
+    const uint8_t AC_LUMA_VALUES[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa};
+
+    const uint8_t AC_CHROMA_COUNTS[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 119};
+    const uint8_t AC_CHROMA_VALUES[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa};
+
+    const float AAN_SCALE[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                                1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+
+    struct HuffmanCodes
+    {
+        uint16_t code[256];
+        uint8_t length[256];
+
+        void build(const uint8_t *counts, const uint8_t *values)
+        {
+            memset(length, 0, sizeof(length));
+            uint16_t next = 0;
+            int k = 0;
+            for (int bits = 1; bits <= 16; bits++)
+            {
+                for (int i = 0; i < counts[bits - 1]; i++)
+                {
+                    code[values[k]] = next++;
+                    length[values[k]] = bits;
+                    k++;
+                }
+                next <<= 1;
+            }
+        }
+    };
+
+    // Built once, shared by every encoder (about 2.5 KB). RGB565 has only
+    // 32/64/32 levels per channel, so the colour transform is three lookups
+    // and two adds per output sample; the -128 level shift is folded into Y.
+    struct Tables
+    {
+        HuffmanCodes dc[2];
+        HuffmanCodes ac[2];
+        float yR[32], yG[64], yB[32];
+        float cbR[32], cbG[64], cbB[32];
+        float crR[32], crG[64], crB[32];
+
+        Tables()
+        {
+            dc[0].build(DC_LUMA_COUNTS, DC_VALUES);
+            dc[1].build(DC_CHROMA_COUNTS, DC_VALUES);
+            ac[0].build(AC_LUMA_COUNTS, AC_LUMA_VALUES);
+            ac[1].build(AC_CHROMA_COUNTS, AC_CHROMA_VALUES);
+            for (int i = 0; i < 32; i++)
+            {
+                float v = static_cast<float>((i << 3) | (i >> 2));
+                yR[i] = 0.299f * v;
+                yB[i] = 0.114f * v;
+                cbR[i] = -0.168736f * v;
+                cbB[i] = 0.5f * v;
+                crR[i] = 0.5f * v;
+                crB[i] = -0.081312f * v;
+            }
+            for (int i = 0; i < 64; i++)
+            {
+                float v = static_cast<float>((i << 2) | (i >> 4));
+                yG[i] = 0.587f * v - 128.0f;
+                cbG[i] = -0.331264f * v;
+                crG[i] = -0.418688f * v;
+            }
+        }
+    };
+
+    const Tables &tables()
+    {
+        static const Tables instance;
+        return instance;
+    }
+
+    // AAN float DCT (IJG jfdctflt), in place; outputs carry the AAN scale
+    void forwardDct(float *data)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            // Rows on the first pass, columns on the second
+            int step = pass == 0 ? 1 : 8;
+            int next = pass == 0 ? 8 : 1;
+            for (int line = 0; line < 8; line++)
+            {
+                float *d = data + line * next;
+                float tmp0 = d[0] + d[7 * step];
+                float tmp7 = d[0] - d[7 * step];
+                float tmp1 = d[1 * step] + d[6 * step];
+                float tmp6 = d[1 * step] - d[6 * step];
+                float tmp2 = d[2 * step] + d[5 * step];
+                float tmp5 = d[2 * step] - d[5 * step];
+                float tmp3 = d[3 * step] + d[4 * step];
+                float tmp4 = d[3 * step] - d[4 * step];
+
+                float tmp10 = tmp0 + tmp3;
+                float tmp13 = tmp0 - tmp3;
+                float tmp11 = tmp1 + tmp2;
+                float tmp12 = tmp1 - tmp2;
+                d[0] = tmp10 + tmp11;
+                d[4 * step] = tmp10 - tmp11;
+                float z1 = (tmp12 + tmp13) * 0.707106781f;
+                d[2 * step] = tmp13 + z1;
+                d[6 * step] = tmp13 - z1;
+
+                tmp10 = tmp4 + tmp5;
+                tmp11 = tmp5 + tmp6;
+                tmp12 = tmp6 + tmp7;
+                float z5 = (tmp10 - tmp12) * 0.382683433f;
+                float z2 = 0.541196100f * tmp10 + z5;
+                float z4 = 1.306562965f * tmp12 + z5;
+                float z3 = tmp11 * 0.707106781f;
+                float z11 = tmp7 + z3;
+                float z13 = tmp7 - z3;
+                d[5 * step] = z13 + z2;
+                d[3 * step] = z13 - z2;
+                d[1 * step] = z11 + z4;
+                d[7 * step] = z11 - z4;
+            }
+        }
+    }
+
+    int bitLength(int value)
+    {
+        unsigned magnitude = value < 0 ? -value : value;
+        int bits = 0;
+        while (magnitude)
+        {
+            magnitude >>= 1;
+            bits++;
+        }
+        return bits;
+    }
+}
+
+JpegStreamEncoder::JpegStreamEncoder(uint8_t quality, Subsampling subsampling) : subsampling(subsampling)
+{
+    tables();
+    setQuality(quality);
+}
+
+void JpegStreamEncoder::setQuality(uint8_t value)
+{
+    quality = value < 1 ? 1 : value > 100 ? 100 : value;
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int i = 0; i < 64; i++)
+    {
+        int luma = (LUMA_QUANT[i] * scale + 50) / 100;
+        int chroma = (CHROMA_QUANT[i] * scale + 50) / 100;
+        lumaTable[i] = luma < 1 ? 1 : luma > 255 ? 255 : luma;
+        chromaTable[i] = chroma < 1 ? 1 : chroma > 255 ? 255 : chroma;
+        float aan = AAN_SCALE[i / 8] * AAN_SCALE[i % 8] * 8.0f;
+        lumaScale[i] = 1.0f / (lumaTable[i] * aan);
+        chromaScale[i] = 1.0f / (chromaTable[i] * aan);
+    }
+}
+
+bool JpegStreamEncoder::isEncodable(const camera_fb_t *fb)
+{
+    return fb && fb->buf && fb->format == PIXFORMAT_RGB565 && fb->width > 0 && fb->height > 0 &&
+           fb->width <= 0xFFFF && fb->height <= 0xFFFF && fb->len >= static_cast<size_t>(fb->width) * fb->height * 2;
+}
+
+bool JpegStreamEncoder::encode(const camera_fb_t *fb, Sink output, void *arg)
+{
+    if (!isEncodable(fb) || !output)
+    {
+        ESP_LOGE(TAG, "Not an RGB565 frame");
+        return false;
+    }
+
+    startOutput(output, arg);
+    writeHeaders(fb->width, fb->height, 0);
+    writeRows(fb, 0, (fb->height + mcuSize() - 1) / mcuSize());
+    putByte(0xFF);
+    putByte(0xD9);
+    return finishOutput();
+}
+
+bool JpegStreamEncoder::encodeHeaders(const camera_fb_t *fb, uint16_t restartInterval, Sink output, void *arg)
+{
+    if (!isEncodable(fb) || !output)
+    {
+        ESP_LOGE(TAG, "Not an RGB565 frame");
+        return false;
+    }
+    startOutput(output, arg);
+    writeHeaders(fb->width, fb->height, restartInterval);
+    return finishOutput();
+}
+
+bool JpegStreamEncoder::encodeRows(const camera_fb_t *fb, int firstRow, int rowCount, Sink output, void *arg)
+{
+    if (!isEncodable(fb) || !output)
+    {
+        return false;
+    }
+    startOutput(output, arg);
+    writeRows(fb, firstRow, rowCount);
+    return finishOutput();
+}
+
+void JpegStreamEncoder::startOutput(Sink output, void *arg)
+{
+    sink = output;
+    sinkArg = arg;
+    fill = 0;
+    emitted = 0;
+    failed = false;
+}
+
+bool JpegStreamEncoder::finishOutput()
+{
+    flushChunk();
+    sink = nullptr;
+    sinkArg = nullptr;
+    return !failed;
+}
+
+void JpegStreamEncoder::writeRows(const camera_fb_t *fb, int firstRow, int rowCount)
+{
+    bitBuffer = 0;
+    bitCount = 0;
+    previousDc[0] = previousDc[1] = previousDc[2] = 0;
+
+    int width = fb->width;
+    int height = fb->height;
+    int size = mcuSize();
+    int lumaBlocks = subsampling == SUBSAMPLE_420 ? 4 : 1;
+    int lastRow = firstRow + rowCount;
+    for (int y = firstRow * size; y < lastRow * size && y < height && !failed; y += size)
+    {
+        for (int x = 0; x < width && !failed; x += size)
+        {
+            loadMcu(fb->buf, width, height, x, y);
+            for (int b = 0; b < lumaBlocks; b++)
+            {
+                encodeBlock(blocks[b], lumaScale, 0);
+            }
+            encodeBlock(blocks[4], chromaScale, 1);
+            encodeBlock(blocks[5], chromaScale, 2);
+        }
+    }
+    flushBits();
+}
+
+void JpegStreamEncoder::writeHeaders(uint16_t width, uint16_t height, uint16_t restartInterval)
+{
+    putByte(0xFF);
+    putByte(0xD8);
+
+    static const uint8_t JFIF[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    putMarker(0xE0, 2 + sizeof(JFIF));
+    putBytes(JFIF, sizeof(JFIF));
+
+    putMarker(0xDB, 2 + 2 * 65);
+    putByte(0);
+    for (int k = 0; k < 64; k++)
+    {
+        putByte(lumaTable[ZIGZAG[k]]);
+    }
+    putByte(1);
+    for (int k = 0; k < 64; k++)
+    {
+        putByte(chromaTable[ZIGZAG[k]]);
+    }
+
+    putMarker(0xC0, 17);
+    const uint8_t frame[15] = {8, static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+                               static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width), 3,
+                               1, static_cast<uint8_t>(subsampling == SUBSAMPLE_420 ? 0x22 : 0x11), 0,
+                               2, 0x11, 1,
+                               3, 0x11, 1};
+    putBytes(frame, sizeof(frame));
+
+    putMarker(0xC4, 2 + 4 * 17 + 2 * sizeof(DC_VALUES) + sizeof(AC_LUMA_VALUES) + sizeof(AC_CHROMA_VALUES));
+    putByte(0x00);
+    putBytes(DC_LUMA_COUNTS, 16);
+    putBytes(DC_VALUES, sizeof(DC_VALUES));
+    putByte(0x10);
+    putBytes(AC_LUMA_COUNTS, 16);
+    putBytes(AC_LUMA_VALUES, sizeof(AC_LUMA_VALUES));
+    putByte(0x01);
+    putBytes(DC_CHROMA_COUNTS, 16);
+    putBytes(DC_VALUES, sizeof(DC_VALUES));
+    putByte(0x11);
+    putBytes(AC_CHROMA_COUNTS, 16);
+    putBytes(AC_CHROMA_VALUES, sizeof(AC_CHROMA_VALUES));
+
+    if (restartInterval)
+    {
+        putMarker(0xDD, 4);
+        putByte(restartInterval >> 8);
+        putByte(restartInterval & 0xFF);
+    }
+
+    putMarker(0xDA, 12);
+    static const uint8_t SCAN[10] = {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0};
+    putBytes(SCAN, sizeof(SCAN));
+}
+
+void JpegStreamEncoder::loadMcu(const uint8_t *pixels, int width, int height, int mcuX, int mcuY)
+{
+    const Tables &t = tables();
+    bool subsampled = subsampling == SUBSAMPLE_420;
+    int size = subsampled ? 16 : 8;
+    if (subsampled)
+    {
+        memset(blocks[4], 0, sizeof(blocks[4]));
+        memset(blocks[5], 0, sizeof(blocks[5]));
+    }
+
+    for (int dy = 0; dy < size; dy++)
+    {
+        // Edge MCUs repeat the last row and column
+        int y = mcuY + dy < height ? mcuY + dy : height - 1;
+        const uint8_t *row = pixels + static_cast<size_t>(y) * width * 2;
+        for (int dx = 0; dx < size; dx++)
+        {
+            int x = mcuX + dx < width ? mcuX + dx : width - 1;
+            uint16_t px = (row[x * 2] << 8) | row[x * 2 + 1];
+            int r = px >> 11;
+            int g = (px >> 5) & 0x3F;
+            int b = px & 0x1F;
+
+            float luma = t.yR[r] + t.yG[g] + t.yB[b];
+            float cb = t.cbR[r] + t.cbG[g] + t.cbB[b];
+            float cr = t.crR[r] + t.crG[g] + t.crB[b];
+            if (subsampled)
+            {
+                blocks[(dy >> 3) * 2 + (dx >> 3)][(dy & 7) * 8 + (dx & 7)] = luma;
+                int c = (dy >> 1) * 8 + (dx >> 1);
+                blocks[4][c] += 0.25f * cb;
+                blocks[5][c] += 0.25f * cr;
+            }
+            else
+            {
+                int c = dy * 8 + dx;
+                blocks[0][c] = luma;
+                blocks[4][c] = cb;
+                blocks[5][c] = cr;
+            }
+        }
+    }
+}
+
+void JpegStreamEncoder::encodeBlock(float *block, const float *scale, int component)
+{
+    forwardDct(block);
+
+    int coefficients[64];
+    for (int k = 0; k < 64; k++)
+    {
+        float v = block[ZIGZAG[k]] * scale[ZIGZAG[k]];
+        coefficients[k] = static_cast<int>(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+
+    const Tables &t = tables();
+    const HuffmanCodes &dc = t.dc[component ? 1 : 0];
+    const HuffmanCodes &ac = t.ac[component ? 1 : 0];
+
+    int diff = coefficients[0] - previousDc[component];
+    previousDc[component] = coefficients[0];
+    int bits = bitLength(diff);
+    putBits(dc.code[bits], dc.length[bits]);
+    putBits(diff < 0 ? diff - 1 : diff, bits);
+
+    int run = 0;
+    for (int k = 1; k < 64; k++)
+    {
+        int v = coefficients[k];
+        if (v == 0)
+        {
+            run++;
+            continue;
+        }
+        while (run >= 16)
+        {
+            putBits(ac.code[0xF0], ac.length[0xF0]);
+            run -= 16;
+        }
+        bits = bitLength(v);
+        int symbol = (run << 4) | bits;
+        putBits(ac.code[symbol], ac.length[symbol]);
+        putBits(v < 0 ? v - 1 : v, bits);
+        run = 0;
+    }
+    if (run > 0)
+    {
+        putBits(ac.code[0x00], ac.length[0x00]);
+    }
+}
+
+void JpegStreamEncoder::putBits(uint32_t code, int length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+    bitBuffer = (bitBuffer << length) | (code & ((1u << length) - 1));
+    bitCount += length;
+    while (bitCount >= 8)
+    {
+        uint8_t byte = static_cast<uint8_t>(bitBuffer >> (bitCount - 8));
+        putByte(byte);
+        if (byte == 0xFF)
+        {
+            putByte(0x00); // stuffing, so entropy data never forms a marker
+        }
+        bitCount -= 8;
+    }
+}
+
+void JpegStreamEncoder::flushBits()
+{
+    if (bitCount > 0)
+    {
+        putBits((1u << (8 - bitCount)) - 1, 8 - bitCount);
+    }
+}
+
+void JpegStreamEncoder::putMarker(uint8_t marker, uint16_t length)
+{
+    putByte(0xFF);
+    putByte(marker);
+    putByte(length >> 8);
+    putByte(length & 0xFF);
+}
+
+void JpegStreamEncoder::putBytes(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        putByte(data[i]);
+    }
+}
+
+void JpegStreamEncoder::putByte(uint8_t byte)
+{
+    chunk[fill++] = byte;
+    if (fill == CHUNK_BYTES)
+    {
+        flushChunk();
+    }
+}
+
+void JpegStreamEncoder::flushChunk()
+{
+    if (fill == 0 || failed)
+    {
+        fill = 0;
+        return;
+    }
+    if (sink(sinkArg, emitted, chunk, fill) != fill)
+    {
+        ESP_LOGE(TAG, "Sink refused %u bytes at offset %u", static_cast<unsigned>(fill),
+                 static_cast<unsigned>(emitted));
+        failed = true;
+    }
+    emitted += fill;
+    fill = 0;
+}
@@ -0,0 +1,289 @@
+#include "lane_detector.h"
+#include <string.h>
+
+const char *LaneDetector::TAG = "LaneDetector";
+
+LaneDetector::LaneDetector() : edgeThreshold(LANE_EDGE_THRESHOLD), roadTop(LaneResult::ROI_TOP), resultRow(-0.5f)
+{
+    memset(luma, 0, sizeof(luma));
+    memset(rowPoints, 0, sizeof(rowPoints));
+}
+
+void LaneDetector::setRoadTop(float fraction)
+{
+    roadTop = fraction < MIN_ROAD_TOP ? MIN_ROAD_TOP : fraction > MAX_ROAD_TOP ? MAX_ROAD_TOP : fraction;
+}
+
+bool LaneDetector::prepare(const camera_fb_t *fb)
+{
+    if (!fb || fb->format != PIXFORMAT_RGB565 || fb->len < static_cast<size_t>(fb->width) * fb->height * 2)
+    {
+        return false;
+    }
+    int width = fb->width;
+    int top = static_cast<int>(fb->height * roadTop + 0.5f);
+    int height = fb->height - top;
+    if (width < 3 || height < 3)
+    {
+        return false;
+    }
+    // Lines are reported at ROI_TOP even when the crop starts elsewhere
+    resultRow = (fb->height * LaneResult::ROI_TOP - top) / height * WORK_HEIGHT - 0.5f;
+
+    const FramePreprocessor::Layout &layout = preprocessor.getLayout();
+    if (!preprocessor.isConfigured() || layout.sourceWidth != width ||
+        layout.sourceHeight != static_cast<int>(fb->height) || layout.roi.y != top)
+    {
+        // The working image keeps luma - 128, so the tensor path serves as is
+        int8_t table[256];
+        for (int value = 0; value < 256; value++)
+        {
+            table[value] = static_cast<int8_t>(value - 128);
+        }
+        bool shrink = WORK_WIDTH <= width && WORK_HEIGHT <= height;
+        FramePreprocessor::Layout wanted = {width,
+                                            static_cast<int>(fb->height),
+                                            {0, top, width, height},
+                                            WORK_WIDTH,
+                                            WORK_HEIGHT,
+                                            1,
+                                            shrink ? FramePreprocessor::AREA : FramePreprocessor::BILINEAR};
+        if (!preprocessor.configure(wanted, table))
+        {
+            ESP_LOGE(TAG, "Cannot work on %ux%u frames", fb->width, fb->height);
+            return false;
+        }
+    }
+    preprocessor.run(fb->buf, luma);
+    return true;
+}
+
+void LaneDetector::findMarkings()
+{
+    memset(rowPoints, 0, sizeof(rowPoints));
+    for (int y = 1; y < WORK_HEIGHT - 1; y++)
+    {
+        const int8_t *up = luma + (y - 1) * WORK_WIDTH;
+        const int8_t *row = luma + y * WORK_WIDTH;
+        const int8_t *down = luma + (y + 1) * WORK_WIDTH;
+        int rising = -1;
+        for (int x = 1; x < WORK_WIDTH - 1; x++)
+        {
+            int gx = (up[x + 1] + 2 * row[x + 1] + down[x + 1]) - (up[x - 1] + 2 * row[x - 1] + down[x - 1]);
+            int strength = gx < 0 ? -gx : gx;
+            if (strength < edgeThreshold)
+            {
+                continue;
+            }
+            int gy = (down[x - 1] + 2 * down[x] + down[x + 1]) - (up[x - 1] + 2 * up[x] + up[x + 1]);
+            if (2 * strength < (gy < 0 ? -gy : gy))
+            {
+                continue; // flatter than about 27 degrees
+            }
+            if (gx > 0)
+            {
+                rising = x; // the last column of a rising run is the stripe's left edge
+            }
+            else if (rising >= 0)
+            {
+                if (x - rising <= MAX_MARKING_WIDTH && rowPoints[y] < MAX_ROW_POINTS)
+                {
+                    points[y][rowPoints[y]++] = rising + x;
+                }
+                rising = -1;
+            }
+        }
+    }
+}
+
+// Work column with the most points nearby in the bottom third (the lower
+// two thirds when that is empty), or -1; `row` is those points' mean row
+int LaneDetector::findBase(int from, int to, int &row) const
+{
+    for (int rows = WORK_HEIGHT / 3; rows <= 2 * WORK_HEIGHT / 3; rows += WORK_HEIGHT / 3)
+    {
+        uint16_t histogram[WORK_WIDTH] = {0};
+        for (int y = WORK_HEIGHT - rows; y < WORK_HEIGHT; y++)
+        {
+            for (int i = 0; i < rowPoints[y]; i++)
+            {
+                histogram[points[y][i] / 2]++;
+            }
+        }
+        int best = -1;
+        int bestCount = MIN_WINDOW_POINTS - 1;
+        for (int x = from; x < to; x++)
+        {
+            int count = 0;
+            for (int dx = -2; dx <= 2; dx++)
+            {
+                count += x + dx >= 0 && x + dx < WORK_WIDTH ? histogram[x + dx] : 0;
+            }
+            if (count > bestCount)
+            {
+                best = x;
+                bestCount = count;
+            }
+        }
+        if (best < 0)
+        {
+            continue;
+        }
+        int count = 0, sum = 0;
+        for (int y = WORK_HEIGHT - rows; y < WORK_HEIGHT; y++)
+        {
+            for (int i = 0; i < rowPoints[y]; i++)
+            {
+                int x = points[y][i] / 2;
+                if (x >= best - 2 && x <= best + 2)
+                {
+                    count++;
+                    sum += y;
+                }
+            }
+        }
+        row = sum / count;
+        return best;
+    }
+    return -1;
+}
+
+void LaneDetector::trace(int base, int baseRow, LaneLine &line) const
+{
+    const int windowRows = WORK_HEIGHT / WINDOWS;
+    int hits = 0;
+    int64_t n = 0, sumY = 0, sumX = 0, sumYY = 0, sumXY = 0;
+    // Re-centres window w (0 at the bottom) on its points within `margin`
+    // work pixels and adds them to the fit; false when it holds too few
+    auto visit = [&](int w, int margin, int &centre)
+    {
+        int bottom = WORK_HEIGHT - w * windowRows;
+        int count = 0, wY = 0, wX = 0, wYY = 0, wXY = 0;
+        for (int y = bottom - windowRows; y < bottom; y++)
+        {
+            for (int i = 0; i < rowPoints[y]; i++)
+            {
+                int x = points[y][i];
+                if (x >= centre - 2 * margin && x <= centre + 2 * margin)
+                {
+                    count++;
+                    wY += y;
+                    wX += x;
+                    wYY += y * y;
+                    wXY += x * y;
+                }
+            }
+        }
+        if (count < MIN_WINDOW_POINTS)
+        {
+            return false;
+        }
+        centre = wX / count;
+        hits++;
+        n += count;
+        sumY += wY;
+        sumX += wX;
+        sumYY += wYY;
+        sumXY += wXY;
+        return true;
+    };
+
+    // Climb from the window holding the base, then descend from it. A
+    // window without paint is moved along the last step between two windows
+    // with paint, so the search follows the line across a dash gap; the
+    // window after a miss searches twice as wide, as the step may be stale.
+    const int start = (WORK_HEIGHT - 1 - baseRow) / windowRows;
+    int startCentre = 2 * base; // half pixels, like the points
+    int climbStep = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const int direction = pass == 0 ? 1 : -1;
+        int centre = startCentre;
+        int step = pass == 0 ? 0 : -climbStep;
+        bool previousHit = pass == 1;
+        for (int w = pass == 0 ? start : start - 1; w >= 0 && w < WINDOWS; w += direction)
+        {
+            int expected = w == start ? centre : centre + step;
+            int found = expected;
+            if (visit(w, previousHit || w == start ? WINDOW_MARGIN : 2 * WINDOW_MARGIN, found))
+            {
+                if (previousHit && w != start)
+                {
+                    step = found - centre;
+                }
+                if (w == start)
+                {
+                    startCentre = found;
+                }
+                centre = found;
+                previousHit = true;
+            }
+            else
+            {
+                centre = expected;
+                previousHit = false;
+            }
+        }
+        climbStep = step;
+    }
+
+    memset(&line, 0, sizeof(line));
+    int64_t spread = n * sumYY - sumY * sumY;
+    if (hits < 2 || spread <= 0)
+    {
+        return;
+    }
+    // x = a + b y in half pixels over row indices; rows are centred at y + 0.5
+    float b = static_cast<float>(n * sumXY - sumX * sumY) / spread;
+    float a = (sumX - b * sumY) / n;
+    auto fraction = [&](float y)
+    { return ((a + b * y) / 2 + 0.5f) / WORK_WIDTH; };
+    line.bottomX = fraction(WORK_HEIGHT - 0.5f);
+    line.topX = fraction(resultRow);
+    line.confidence = static_cast<float>(hits) / WINDOWS;
+    line.found = hits >= MIN_WINDOWS;
+}
+
+bool LaneDetector::detect(const camera_fb_t *fb, LaneResult &result)
+{
+    unsigned long startMs = millis();
+    unsigned long start = micros();
+    if (!prepare(fb))
+    {
+        return false;
+    }
+    findMarkings();
+
+    memset(&result, 0, sizeof(result));
+    int leftRow = 0, rightRow = 0;
+    int left = findBase(0, WORK_WIDTH / 2, leftRow);
+    int right = findBase(WORK_WIDTH / 2, WORK_WIDTH, rightRow);
+    if (left >= 0)
+    {
+        trace(left, leftRow, result.left);
+    }
+    if (right >= 0)
+    {
+        trace(right, rightRow, result.right);
+    }
+    // Both stacks climbed onto the same paint: keep the better one
+    if (result.valid() && result.left.bottomX >= result.right.bottomX)
+    {
+        LaneLine &weaker = result.left.confidence < result.right.confidence ? result.left : result.right;
+        weaker.found = false;
+    }
+
+    result.frameMs = startMs;
+    result.latencyUs = micros() - start;
+    return true;
+}
+
+int LaneDetector::pointCount() const
+{
+    int count = 0;
+    for (int y = 0; y < WORK_HEIGHT; y++)
+    {
+        count += rowPoints[y];
+    }
+    return count;
+}
@@ -0,0 +1,135 @@
+#include "lane_tracker.h"
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    float secondsBetween(unsigned long fromMs, unsigned long toMs)
+    {
+        return static_cast<long>(toMs - fromMs) / 1000.0f;
+    }
+}
+
+LaneTracker::LaneTracker() : interval(LANE_TRACK_INTERVAL)
+{
+    reset();
+}
+
+void LaneTracker::setInterval(int frames)
+{
+    interval = frames < 1 ? 1 : frames;
+    reset();
+}
+
+void LaneTracker::reset()
+{
+    predicted = 0;
+    jumped = false;
+    memset(tracks, 0, sizeof(tracks));
+}
+
+LaneTracker::Reason LaneTracker::check(unsigned long frameMs) const
+{
+    if (interval <= 1 || predicted + 1 >= interval)
+    {
+        return REASON_SCHEDULED;
+    }
+    if (!tracks[0].active || !tracks[1].active)
+    {
+        return REASON_NO_TRACK;
+    }
+    if (jumped)
+    {
+        return REASON_JUMP;
+    }
+    if (confidence(tracks[0], frameMs) < LANE_TRACK_MIN_CONFIDENCE ||
+        confidence(tracks[1], frameMs) < LANE_TRACK_MIN_CONFIDENCE)
+    {
+        return REASON_CONFIDENCE;
+    }
+    return REASON_NONE;
+}
+
+void LaneTracker::update(LaneResult &result)
+{
+    predicted = 0;
+    if (interval <= 1)
+    {
+        return;
+    }
+    jumped = false;
+    correct(tracks[0], result.left, result.frameMs);
+    correct(tracks[1], result.right, result.frameMs);
+    fill(tracks[0], result.frameMs, result.left);
+    fill(tracks[1], result.frameMs, result.right);
+}
+
+void LaneTracker::predict(unsigned long frameMs, LaneResult &result)
+{
+    predicted++;
+    memset(&result, 0, sizeof(result));
+    fill(tracks[0], frameMs, result.left);
+    fill(tracks[1], frameMs, result.right);
+    result.frameMs = frameMs;
+}
+
+float LaneTracker::confidence(const Track &track, unsigned long frameMs) const
+{
+    if (!track.active)
+    {
+        return 0;
+    }
+    float fade = 1 - static_cast<float>(static_cast<long>(frameMs - track.updatedMs)) / LANE_TRACK_MAX_AGE_MS;
+    return fade > 0 ? track.confidence * fade : 0;
+}
+
+void LaneTracker::correct(Track &track, const LaneLine &line, unsigned long frameMs)
+{
+    if (!line.found)
+    {
+        // Coast on the prediction until it fades out
+        if (track.active && confidence(track, frameMs) <= 0)
+        {
+            track.active = false;
+        }
+        return;
+    }
+
+    float dt = secondsBetween(track.updatedMs, frameMs);
+    float heading = line.topX - line.bottomX;
+    float bottomResidual = line.bottomX - track.bottom.at(dt);
+    float headingResidual = heading - track.heading.at(dt);
+    if (!track.active || fabsf(bottomResidual) > LANE_TRACK_GATE || fabsf(headingResidual) > LANE_TRACK_GATE)
+    {
+        jumped = jumped || track.active;
+        track.bottom = {line.bottomX, 0};
+        track.heading = {heading, 0};
+    }
+    else
+    {
+        Filter *filters[2] = {&track.bottom, &track.heading};
+        float residuals[2] = {bottomResidual, headingResidual};
+        for (int i = 0; i < 2; i++)
+        {
+            filters[i]->value = filters[i]->at(dt) + LANE_TRACK_ALPHA * residuals[i];
+            // Frames captured within the same millisecond say nothing about rate
+            if (dt > 0)
+            {
+                filters[i]->rate += LANE_TRACK_BETA * residuals[i] / dt;
+            }
+        }
+    }
+    track.active = true;
+    track.confidence = line.confidence;
+    track.updatedMs = frameMs;
+}
+
+void LaneTracker::fill(const Track &track, unsigned long frameMs, LaneLine &line) const
+{
+    float dt = secondsBetween(track.updatedMs, frameMs);
+    float faded = confidence(track, frameMs);
+    line.found = track.active && faded >= LANE_TRACK_MIN_CONFIDENCE;
+    line.bottomX = track.active ? track.bottom.at(dt) : 0;
+    line.topX = track.active ? line.bottomX + track.heading.at(dt) : 0;
+    line.confidence = faded;
+}
@@ -14,8 +14,7 @@ int sdCardLogOutput(const char *format, va_list args)
   return ret;
 }
 
-extern DISPLAY_MODEL u8g2;
-MenuHandler menuHandler(u8g2);
+MenuHandler menuHandler(DisplayManager::getInstance());
 
 void setup()
 {
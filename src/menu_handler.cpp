@@ -2,6 +2,7 @@
 #include "global_instances.h"
 #include "Version.h"
 #include "wifi_config_handler.h"
+#include "xbm_icon.h"
 
 const char *TAG = "MenuHandler";
 
@@ -21,10 +22,10 @@ const char *const MenuHandler::stopMenuItems[2] = {
 
 const uint8_t MenuHandler::STOP_MENU_ITEMS_COUNT = 2;
 
-MenuHandler::MenuHandler(U8G2 &display) : display(display),
-                                          menuPosition(0),
-                                          is_redraw(1),
-                                          menuActive(false)
+MenuHandler::MenuHandler(DisplayManager &display) : display(display),
+                                                    menuPosition(0),
+                                                    is_redraw(1),
+                                                    menuActive(false)
 {
     instance = this;
 }
@@ -101,27 +102,8 @@ void MenuHandler::executeMenuItem()
     {
         if (menuPosition == 0)
         { // "Stop Service"
-            ESP_LOGI(TAG, "Stopping active service and restarting device");
-
-            // Stop all services
-            if (bleService.isPreviewEnabled())
-            {
-                bleService.handleControlCommand(CustomBLEService::Command::STOP_PREVIEW);
-            }
-            if (bleService.isCaptureEnabled())
-            {
-                bleService.handleControlCommand(CustomBLEService::Command::STOP_DATA_COLLECTION);
-            }
-            if (bleService.isInferenceEnabled())
-            {
-                bleService.handleControlCommand(CustomBLEService::Command::STOP_INFERENCE);
-            }
-
-            // Wait a moment for services to stop
-            delay(1000);
-
-            // Restart device
-            ESP.restart();
+            ESP_LOGI(TAG, "Stopping active service");
+            CommandBus::getInstance().post(CommandBus::STOP_ACTIVE, CommandBus::SOURCE_MENU);
         }
         menuActive = false;
         return;
@@ -132,44 +114,34 @@ void MenuHandler::executeMenuItem()
     {
     case 0: // Start Preview
         ESP_LOGI(TAG, "Starting preview from menu");
-        bleService.handleControlCommand(CustomBLEService::Command::START_PREVIEW);
+        bleService.postCommand(CustomBLEService::Command::START_PREVIEW, CommandBus::SOURCE_MENU);
         menuActive = false;
         break;
 
     case 1: // Start Capturing
         ESP_LOGI(TAG, "Starting data collection from menu");
-        bleService.handleControlCommand(CustomBLEService::Command::START_DATA_COLLECTION);
+        bleService.postCommand(CustomBLEService::Command::START_DATA_COLLECTION, CommandBus::SOURCE_MENU);
         menuActive = false;
         break;
 
     case 2: // Start Inferring
-#ifdef PRODUCTION_MODE
         ESP_LOGI(TAG, "Starting inference from menu");
-        bleService.handleControlCommand(CustomBLEService::Command::START_INFERENCE);
-#endif
+        bleService.postCommand(CustomBLEService::Command::START_INFERENCE, CommandBus::SOURCE_MENU);
         menuActive = false;
         break;
 
     case 3: // Sync Time (WiFi)
         ESP_LOGI(TAG, "Starting WiFi time sync");
-        display.clearBuffer();
-        display.setFont(u8g2_font_4x6_tf);
-        display.drawStr(0, 20, "Syncing time...");
-        display.sendBuffer();
+        showMessage("Syncing time...");
 
         if (WiFiConfigHandler::syncTimeFromWiFi())
         {
-            display.clearBuffer();
-            display.drawStr(0, 20, "Time synced!");
-            display.sendBuffer();
+            showMessage("Time synced!");
             delay(2000);
-            ESP.restart();
         }
         else
         {
-            display.clearBuffer();
-            display.drawStr(0, 20, "Sync failed!");
-            display.sendBuffer();
+            showMessage("Sync failed!");
             delay(2000);
         }
         menuActive = false;
@@ -181,11 +153,18 @@ void MenuHandler::executeMenuItem()
     }
 }
 
-void MenuHandler::drawMenu()
+void MenuHandler::showMessage(const char *text)
 {
-    display.clearBuffer();
-    display.setFont(u8g2_font_4x6_tf);
-    display.drawStr(0, 6, "Menu");
+    display.compose([text](DisplayBackend &canvas)
+                    {
+        canvas.setFont(u8g2_font_4x6_tf);
+        canvas.drawStr(0, 20, text); });
+}
+
+void MenuHandler::drawMenu(DisplayBackend &canvas)
+{
+    canvas.setFont(u8g2_font_4x6_tf);
+    canvas.drawStr(0, 6, "Menu");
 
     const char *const *currentMenuItems;
     uint8_t itemCount;
@@ -212,72 +191,77 @@ void MenuHandler::drawMenu()
     {
         if (i == menuPosition)
         {
-            display.drawStr(0, 20 + (i * 10), ">");
+            canvas.drawStr(0, 20 + (i * 10), ">");
         }
-        display.drawStr(8, 20 + (i * 10), currentMenuItems[i]);
+        canvas.drawStr(8, 20 + (i * 10), currentMenuItems[i]);
     }
 
-    display.drawStr(0, 63, "Click: Next  Long: Select");
-    display.sendBuffer();
+    canvas.drawStr(0, 63, "Click: Next  Long: Select");
 }
 
-void MenuHandler::drawDefaultScreen()
+void MenuHandler::drawDefaultScreen(DisplayBackend &canvas)
 {
     ESP_LOGV("MenuHandler", "Drawing default screen");
-    display.clearBuffer();
-
-    // Cache icon data to avoid reloading every frame
-    static uint8_t *iconData = nullptr;
-    static bool iconLoaded = false;
-
-    if (!iconLoaded)
-    {
-        Icons::IconInfo iconInfo = Icons::getIconXBM(Icons::Type::FOX_3, Icons::Polarity::POSITIVE);
-        if (iconInfo.data != nullptr)
-        {
-            iconData = const_cast<uint8_t *>(iconInfo.data);
-            iconLoaded = true;
-            ESP_LOGI("MenuHandler", "Fox icon loaded successfully");
-        }
-    }
 
-    // Draw the icon if loaded
-    if (iconData)
+    // Flash-resident table lookup, no conversion
+    Icons::IconInfo fox = Icons::getIconXBM(Icons::Type::FOX_3, Icons::Polarity::POSITIVE);
+    if (fox.data)
     {
-        display.drawXBM(64, 0, 64, 64, iconData);
+        canvas.drawXBM(64, 0, fox.width, fox.height, fox.data);
     }
 
     // Use smaller font for all text
-    display.setFont(u8g2_font_4x6_tf);
+    canvas.setFont(u8g2_font_4x6_tf);
 
     // Draw version and build info
-    display.drawStr(0, 6, ("MiddleFox v" + String(VERSION)).c_str());
-    display.drawStr(0, 12, ("b:" + String(BUILD_TIMESTAMP)).c_str());
+    canvas.drawStr(0, 6, ("MiddleFox v" + String(VERSION)).c_str());
+    canvas.drawStr(0, 12, ("b:" + String(BUILD_TIMESTAMP)).c_str());
     // Get current time from RTC singleton
-    display.drawStr(0, 18, rtc.getFormattedDateTime().c_str());
+    canvas.drawStr(0, 18, rtc.getFormattedDateTime().c_str());
 
     // Draw status information
-    display.drawStr(0, 24, "BLE:");
-    display.drawStr(20, 24, bleService.isConnected() ? "Connected" : "---");
+    canvas.drawStr(0, 24, "BLE:");
+    canvas.drawStr(20, 24, bleService.isConnected() ? "Connected" : "---");
 
-    display.drawStr(0, 32, "Mode:");
+    canvas.drawStr(0, 32, "Mode:");
     if (bleService.isCaptureEnabled())
     {
-        display.drawStr(20, 32, "Capturing");
+        canvas.drawStr(20, 32, "Capturing");
     }
     else if (bleService.isInferenceEnabled())
     {
-        display.drawStr(20, 32, "Inferring");
+        canvas.drawStr(20, 32, inference.isClassical() ? "Lanes (classic)" : "Inferring");
+        drawLane(canvas, inference.getLastResult());
     }
     else
     {
-        display.drawStr(20, 32, "Ready");
+        canvas.drawStr(20, 32, "Ready");
     }
 
     // Draw hint at bottom
-    display.drawStr(0, 63, "Long press for menu");
+    canvas.drawStr(0, 63, "Long press for menu");
+}
 
-    display.sendBuffer();
+// Lane gauge under the mode line: the boundaries found and where the
+// camera sits between them
+void MenuHandler::drawLane(DisplayBackend &canvas, const LaneResult &result)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "Lane %c %c", result.left.found ? 'L' : '-', result.right.found ? 'R' : '-');
+    canvas.drawStr(0, 40, text);
+    canvas.drawFrame(0, 44, 61, 7);
+    if (result.valid())
+    {
+        float offset = result.offset();
+        offset = offset < -1 ? -1 : offset > 1 ? 1 : offset;
+        canvas.drawBox(29 + static_cast<int>(offset * 28), 45, 3, 5);
+        snprintf(text, sizeof(text), "Off %+.2f", offset);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "Off ---");
+    }
+    canvas.drawStr(0, 57, text);
 }
 
 void MenuHandler::update()
@@ -293,14 +277,17 @@ void MenuHandler::update()
     { // Update every second or when needed
         ESP_LOGV("MenuHandler", "Updating display");
 
-        if (menuActive)
-        {
-            drawMenu();
-        }
-        else
-        {
-            drawDefaultScreen();
-        }
+        // Unchanged pages (most of the screen on a clock tick) are not resent
+        display.compose([this](DisplayBackend &canvas)
+                        {
+            if (menuActive)
+            {
+                drawMenu(canvas);
+            }
+            else
+            {
+                drawDefaultScreen(canvas);
+            } });
 
         lastUpdate = millis();
         firstDraw = false;
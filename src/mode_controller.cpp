@@ -0,0 +1,299 @@
+#include "mode_controller.h"
+#include <stdio.h>
+#include <string.h>
+#include "camera_manager.h"
+
+const char *ModeController::TAG = "ModeController";
+
+// Client notifications kept from the pre-state-machine protocol
+static const char *const START_MESSAGES[ModeController::MODE_COUNT] = {
+    "Idle", "Preview Starting", "Operation Started", "Inference Started"};
+static const char *const STOP_MESSAGES[ModeController::MODE_COUNT] = {
+    "Idle", "Preview Stopped", "Operation Stopped", "Inference Stopped"};
+
+ModeController::ModeController() : current(MODE_IDLE)
+{
+    statsMutex = xSemaphoreCreateMutex();
+    memset(&stats, 0, sizeof(stats));
+    memset(lastSequence, 0, sizeof(lastSequence));
+    memset(seen, 0, sizeof(seen));
+}
+
+void ModeController::setHandlers(Mode mode, EnterHandler enter, ExitHandler exit)
+{
+    if (mode >= MODE_COUNT)
+    {
+        return;
+    }
+    if (taskHandle)
+    {
+        ESP_LOGW(TAG, "Handlers for %s set after begin()", modeName(mode));
+    }
+    handlers[mode].enter = enter;
+    handlers[mode].exit = exit;
+}
+
+bool ModeController::begin(CustomBLEService &bleService)
+{
+    if (taskHandle)
+    {
+        return true;
+    }
+    service = &bleService;
+
+    // Mode callbacks bring up the camera and SD card, hence the stack size;
+    // above Main_Task so a switch is not held up behind a capture pass
+    if (xTaskCreatePinnedToCore(controllerTask, "Control_Task", 8192, this, 3, &taskHandle, 0) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create controller task");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Controller started, %u commands waiting", static_cast<unsigned>(CommandBus::getInstance().depth()));
+    return true;
+}
+
+void ModeController::controllerTask(void *parameter)
+{
+    ModeController *self = static_cast<ModeController *>(parameter);
+    CommandBus &bus = CommandBus::getInstance();
+    CommandBus::Message message;
+
+    while (true)
+    {
+        if (bus.receive(message, portMAX_DELAY))
+        {
+            self->apply(message);
+        }
+    }
+}
+
+void ModeController::apply(const CommandBus::Message &message)
+{
+    ESP_LOGD(TAG, "Applying %s command 0x%02x (#%u)", CommandBus::sourceName(message.source),
+             message.code, static_cast<unsigned>(message.sequence));
+
+    Mode target;
+    bool settings = message.code == CommandBus::APPLY_SETTINGS;
+    bool known = settings || targetFor(message.code, target);
+    if (settings)
+    {
+        service->applySettings(message.payload);
+    }
+    else if (!known)
+    {
+        ESP_LOGW(TAG, "Unknown control command received: %c (ASCII: %d)", message.code, (int)message.code);
+        service->notifyClients("Unknown Command: " + std::string(1, static_cast<char>(message.code)) +
+                               " (ASCII: " + std::to_string((int)message.code) + ")");
+    }
+    else if (target != current.load())
+    {
+        switchTo(target);
+    }
+    else
+    {
+        ESP_LOGD(TAG, "Already %s", modeName(target));
+    }
+
+    if (message.code == CommandBus::CONNECTION_LOST)
+    {
+        service->handleDisconnection();
+    }
+    uint32_t latencyUs = micros() - message.postedUs;
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    int source = message.source < CommandBus::SOURCE_COUNT ? message.source : CommandBus::SOURCE_SYSTEM;
+    if (seen[source] && message.sequence <= lastSequence[source])
+    {
+        stats.outOfOrder++;
+    }
+    seen[source] = true;
+    lastSequence[source] = message.sequence;
+
+    appliedTotal++;
+    stats.applied++;
+    stats.appliedBySource[source]++;
+    if (!known)
+    {
+        stats.unknown++;
+    }
+    stats.lastLatencyUs = latencyUs;
+    stats.totalLatencyUs += latencyUs;
+    if (latencyUs > stats.maxLatencyUs)
+    {
+        stats.maxLatencyUs = latencyUs;
+    }
+    xSemaphoreGive(statsMutex);
+
+    if (latencyUs > 100000)
+    {
+        ESP_LOGW(TAG, "Command 0x%02x took %lu ms from post to mode change", message.code,
+                 static_cast<unsigned long>(latencyUs / 1000));
+    }
+}
+
+bool ModeController::targetFor(uint8_t code, Mode &target)
+{
+    Mode mode = current.load();
+    switch (code)
+    {
+    case CustomBLEService::START_PREVIEW:
+        target = MODE_PREVIEW;
+        return true;
+    case CustomBLEService::START_DATA_COLLECTION:
+        target = MODE_CAPTURE;
+        return true;
+    case CustomBLEService::START_INFERENCE:
+        target = MODE_INFERENCE;
+        return true;
+    // A stop for a mode that is not running changes nothing
+    case CustomBLEService::STOP_PREVIEW:
+        target = mode == MODE_PREVIEW ? MODE_IDLE : mode;
+        return true;
+    case CustomBLEService::STOP_DATA_COLLECTION:
+        target = mode == MODE_CAPTURE ? MODE_IDLE : mode;
+        return true;
+    case CustomBLEService::STOP_INFERENCE:
+        target = mode == MODE_INFERENCE ? MODE_IDLE : mode;
+        return true;
+    case CommandBus::STOP_ACTIVE:
+    case CommandBus::CONNECTION_LOST:
+        target = MODE_IDLE;
+        return true;
+    default:
+        target = mode;
+        return false;
+    }
+}
+
+void ModeController::switchTo(Mode target)
+{
+    Mode from = current.load();
+    unsigned long start = micros();
+    ESP_LOGI(TAG, "Switching %s -> %s", modeName(from), modeName(target));
+
+    if (from != MODE_IDLE)
+    {
+        // Published first so the main task stops calling into the mode
+        // while its exit handler waits for the call in progress
+        current = MODE_IDLE;
+        if (handlers[from].exit)
+        {
+            handlers[from].exit();
+        }
+    }
+
+    // Between active modes the camera stays up so the next mode only
+    // switches its profile; idle, or a mode that failed to start, powers it down
+    bool ok = true;
+    if (target != MODE_IDLE)
+    {
+        ok = !handlers[target].enter || handlers[target].enter();
+        if (ok)
+        {
+            current = target;
+        }
+    }
+    if (target == MODE_IDLE || !ok)
+    {
+        CameraManager::getInstance().releaseCamera();
+    }
+    uint32_t switchUs = micros() - start;
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats.switches++;
+    if (!ok)
+    {
+        stats.switchFailures++;
+    }
+    if (switchUs > SWITCH_BUDGET_MS * 1000)
+    {
+        stats.overBudget++;
+    }
+    stats.lastSwitchUs = switchUs;
+    stats.totalSwitchUs += switchUs;
+    if (switchUs > stats.maxSwitchUs)
+    {
+        stats.maxSwitchUs = switchUs;
+    }
+    xSemaphoreGive(statsMutex);
+
+    if (from != MODE_IDLE)
+    {
+        service->notifyClients(STOP_MESSAGES[from]);
+    }
+    if (target != MODE_IDLE)
+    {
+        service->notifyClients(ok ? START_MESSAGES[target] : std::string(modeName(target)) + " failed to start");
+    }
+    service->updateServiceStatus("mode", modeName(current.load()));
+
+    char metrics[96];
+    snprintf(metrics, sizeof(metrics), "{\"from\":\"%s\",\"to\":\"%s\",\"ok\":%s,\"switch_ms\":%lu}",
+             modeName(from), modeName(target), ok ? "true" : "false", static_cast<unsigned long>(switchUs / 1000));
+    service->updateServiceMetrics("mode", metrics);
+
+    if (ok)
+    {
+        ESP_LOGI(TAG, "Now %s (%lu ms)", modeName(target), static_cast<unsigned long>(switchUs / 1000));
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to enter %s, staying idle", modeName(target));
+    }
+}
+
+bool ModeController::drain(unsigned long timeoutMs)
+{
+    CommandBus &bus = CommandBus::getInstance();
+    unsigned long start = millis();
+    while (true)
+    {
+        xSemaphoreTake(statsMutex, portMAX_DELAY);
+        uint32_t applied = appliedTotal;
+        xSemaphoreGive(statsMutex);
+
+        if (bus.depth() == 0 && applied >= bus.totalPosted())
+        {
+            return true;
+        }
+        if (millis() - start > timeoutMs)
+        {
+            return false;
+        }
+        delay(1);
+    }
+}
+
+ModeController::Stats ModeController::getStats()
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(statsMutex);
+    return snapshot;
+}
+
+void ModeController::resetStats()
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    memset(&stats, 0, sizeof(stats));
+    xSemaphoreGive(statsMutex);
+}
+
+const char *ModeController::modeName(Mode mode)
+{
+    switch (mode)
+    {
+    case MODE_IDLE:
+        return "idle";
+    case MODE_PREVIEW:
+        return "preview";
+    case MODE_CAPTURE:
+        return "capture";
+    case MODE_INFERENCE:
+        return "inference";
+    default:
+        return "unknown";
+    }
+}
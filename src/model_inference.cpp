@@ -0,0 +1,475 @@
+#include "model_inference.h"
+#include <ArduinoJson.h>
+#include <math.h>
+#include "alert_scheduler.h"
+#include "crc32.h"
+#include "mode_controller.h"
+#include "mount_calibration.h"
+#include "sd_manager.h"
+
+const char *ModelInference::TAG = "ModelInference";
+static const unsigned long METRICS_INTERVAL_MS = 1000;
+
+// Reserved at link time: the model's plan never depends on what the heap
+// looks like when inference mode starts, and the kernels read activations
+// from internal RAM. One ModelInference owns it.
+alignas(16) static uint8_t tensorArena[INFERENCE_ARENA_BYTES];
+
+// The driver stamps frames from the same clock as micros()
+static unsigned long captureMs(const camera_fb_t *fb)
+{
+    if (fb->timestamp.tv_sec == 0 && fb->timestamp.tv_usec == 0)
+    {
+        return millis();
+    }
+    return fb->timestamp.tv_sec * 1000UL + fb->timestamp.tv_usec / 1000;
+}
+
+ModelInference::ModelInference(CustomBLEService *ble)
+    : backend(defaultInferenceBackend()), bleService(ble), modelFile(nullptr), loaded(false), classical(false),
+      running(false), error(""), lastMetricsUpdate(0), departing(false)
+{
+    statsMutex = xSemaphoreCreateMutex();
+    loopMutex = xSemaphoreCreateMutex();
+    memset(&stats, 0, sizeof(stats));
+    memset(&lastResult, 0, sizeof(lastResult));
+    memset(quantize, 0, sizeof(quantize));
+
+    ModeController::getInstance().setHandlers(
+        ModeController::MODE_INFERENCE,
+        [this]()
+        { return start(); },
+        [this]()
+        { stop(); });
+}
+
+ModelInference::~ModelInference()
+{
+    releaseModel();
+    if (statsMutex)
+    {
+        vSemaphoreDelete(statsMutex);
+        statsMutex = nullptr;
+    }
+    if (loopMutex)
+    {
+        vSemaphoreDelete(loopMutex);
+        loopMutex = nullptr;
+    }
+}
+
+void ModelInference::releaseModel()
+{
+    backend.unload();
+    loaded = false;
+    heap_caps_free(modelFile);
+    modelFile = nullptr;
+}
+
+bool ModelInference::begin()
+{
+    ESP_LOGI(TAG, "Loading %s", INFERENCE_MODEL_PATH);
+    SDManager &sd = SDManager::getInstance();
+    if (!sd.isReady() && !sd.begin())
+    {
+        error = "SD card unavailable";
+        ESP_LOGE(TAG, "%s", error);
+        return false;
+    }
+
+    File file = sd.openFile(INFERENCE_MODEL_PATH, FILE_READ);
+    if (!file)
+    {
+        error = "Model file missing";
+        ESP_LOGE(TAG, "%s: %s", error, INFERENCE_MODEL_PATH);
+        return false;
+    }
+    size_t bytes = file.size();
+    releaseModel();
+    // The interpreter reads weights from the file image for as long as the
+    // model is loaded
+    modelFile = static_cast<uint8_t *>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    bool complete = modelFile && file.read(modelFile, bytes) == bytes;
+    file.close();
+    if (!complete)
+    {
+        error = modelFile ? "Short read from the model file" : "No memory for the model file";
+        ESP_LOGE(TAG, "%s", error);
+        releaseModel();
+        return false;
+    }
+
+    if (!loadModel(modelFile, bytes))
+    {
+        releaseModel();
+        return false;
+    }
+    return true;
+}
+
+bool ModelInference::loadModel(const uint8_t *model, size_t bytes)
+{
+    unsigned long start = millis();
+    backend.unload();
+    loaded = false;
+    if (!backend.load(model, bytes, tensorArena, sizeof(tensorArena)))
+    {
+        error = backend.lastError();
+        ESP_LOGE(TAG, "Model rejected by %s backend: %s", backend.name(), error);
+        return false;
+    }
+    if (!validateModel())
+    {
+        ESP_LOGE(TAG, "%s", error);
+        backend.unload();
+        return false;
+    }
+
+    InferenceBackend::Tensor input = backend.input();
+    // pixel/255 quantised with the input's scale and zero point, once per
+    // channel value instead of once per pixel
+    for (int value = 0; value < 256; value++)
+    {
+        long q = lroundf(value / 255.0f / input.scale) + input.zeroPoint;
+        quantize[value] = static_cast<int8_t>(q < -128 ? -128 : q > 127 ? 127 : q);
+    }
+    preprocessor.reset();
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    memset(&stats, 0, sizeof(stats));
+    stats.arenaUsed = backend.arenaUsedBytes();
+    stats.arenaSize = sizeof(tensorArena);
+    xSemaphoreGive(statsMutex);
+
+    loaded = true;
+    classical = false;
+    error = "";
+    ESP_LOGI(TAG, "Model loaded in %lu ms: %dx%dx%d input, arena %u/%u bytes (%s backend)", millis() - start,
+             input.dims[2], input.dims[1], input.dims[3], static_cast<unsigned>(backend.arenaUsedBytes()),
+             static_cast<unsigned>(sizeof(tensorArena)), backend.name());
+    return true;
+}
+
+bool ModelInference::validateModel()
+{
+    InferenceBackend::Tensor input = backend.input();
+    InferenceBackend::Tensor output = backend.output();
+    if (input.dimCount != 4 || input.dims[0] != 1 || (input.dims[3] != 1 && input.dims[3] != 3) ||
+        input.scale <= 0)
+    {
+        error = "Model input must be [1, H, W, 1 or 3] with a positive scale";
+        return false;
+    }
+    if (input.dims[2] > FramePreprocessor::MAX_WIDTH)
+    {
+        error = "Model input is wider than FramePreprocessor::MAX_WIDTH";
+        return false;
+    }
+    if (output.bytes != OUTPUT_VALUES || output.scale <= 0)
+    {
+        error = "Model output must hold 6 values";
+        return false;
+    }
+    return true;
+}
+
+bool ModelInference::start()
+{
+    ESP_LOGI(TAG, "Starting inference");
+    if (!loaded && !begin())
+    {
+        if (!LANE_DETECTOR_FALLBACK)
+        {
+            bleService->updateServiceStatus("inference", std::string("No model: ") + error);
+            AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR);
+            return false;
+        }
+        ESP_LOGW(TAG, "No model (%s), running the classical lane detector", error);
+        classical = true;
+        xSemaphoreTake(statsMutex, portMAX_DELAY);
+        memset(&stats, 0, sizeof(stats));
+        xSemaphoreGive(statsMutex);
+    }
+    if (!CameraManager::getInstance().begin(CameraProfile::INFERENCE))
+    {
+        ESP_LOGE(TAG, "Failed to switch camera to the inference profile");
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_ERROR);
+        return false;
+    }
+
+    char status[96];
+    if (classical)
+    {
+        snprintf(status, sizeof(status), "Classical lane detector (no model: %s)", error);
+    }
+    else
+    {
+        snprintf(status, sizeof(status), "Running on %s, arena %u of %u KB", backend.name(),
+                 static_cast<unsigned>((backend.arenaUsedBytes() + 1023) / 1024),
+                 static_cast<unsigned>(sizeof(tensorArena) / 1024));
+    }
+    bleService->updateServiceStatus("inference", status);
+    // Read each start: a calibration may have been written since
+    MountCalibration &mount = MountCalibration::getInstance();
+    detector.setRoadTop(mount.load() ? mount.roadTop() : LaneResult::ROI_TOP);
+    tracker.reset();
+    departing = false;
+    lastMetricsUpdate = millis();
+    running = true;
+    return true;
+}
+
+void ModelInference::stop()
+{
+    ESP_LOGI(TAG, "Stopping inference");
+    running = false;
+    // The camera is released or reprofiled once this returns, so a frame
+    // being captured or run on the main task has to finish first
+    xSemaphoreTake(loopMutex, portMAX_DELAY);
+    xSemaphoreGive(loopMutex);
+    publishMetrics();
+}
+
+void ModelInference::loop()
+{
+    xSemaphoreTake(loopMutex, portMAX_DELAY);
+    if (running)
+    {
+        step();
+    }
+    xSemaphoreGive(loopMutex);
+}
+
+void ModelInference::step()
+{
+    FrameRef frame = CameraManager::getInstance().captureShared();
+    LaneResult result;
+    LaneTracker::Reason reason = LaneTracker::REASON_SCHEDULED;
+    bool ok = false;
+    if (frame)
+    {
+        unsigned long frameMs = captureMs(frame.get());
+        reason = tracker.check(frameMs);
+        if (reason != LaneTracker::REASON_NONE)
+        {
+            ok = run(frame.get(), result);
+            if (ok)
+            {
+                result.frameMs = frameMs;
+                tracker.update(result);
+            }
+        }
+        else
+        {
+            unsigned long start = micros();
+            tracker.predict(frameMs, result);
+            result.latencyUs = micros() - start;
+            ok = true;
+        }
+    }
+
+    bool departed = ok && checkDeparture(result);
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (ok)
+    {
+        stats.frames++;
+        stats.tracked += reason == LaneTracker::REASON_NONE ? 1 : 0;
+        stats.forced += reason > LaneTracker::REASON_SCHEDULED ? 1 : 0;
+        stats.departures += departed ? 1 : 0;
+        lastResult = result;
+    }
+    else
+    {
+        stats.failures++;
+    }
+    xSemaphoreGive(statsMutex);
+    if (departed)
+    {
+        AlertScheduler::getInstance().raise(AlertScheduler::ALERT_LANE_DEPARTURE);
+    }
+
+    if (millis() - lastMetricsUpdate >= METRICS_INTERVAL_MS)
+    {
+        lastMetricsUpdate = millis();
+        publishMetrics();
+    }
+}
+
+// True on the frame the offset reaches LANE_DEPARTURE_OFFSET; the alert is
+// armed again once it is back under LANE_DEPARTURE_CLEAR. A frame without
+// both lines leaves the state as it is.
+bool ModelInference::checkDeparture(const LaneResult &result)
+{
+    if (!result.valid())
+    {
+        return false;
+    }
+    float offset = fabsf(result.offset());
+    if (departing)
+    {
+        departing = offset >= LANE_DEPARTURE_CLEAR;
+        return false;
+    }
+    departing = offset >= LANE_DEPARTURE_OFFSET;
+    return departing;
+}
+
+bool ModelInference::run(const camera_fb_t *fb, LaneResult &result)
+{
+    if (!loaded && classical)
+    {
+        return runDetector(fb, result);
+    }
+    if (!loaded || !fb || fb->format != PIXFORMAT_RGB565 || fb->len < static_cast<size_t>(fb->width) * fb->height * 2)
+    {
+        return false;
+    }
+
+    unsigned long startMs = millis();
+    unsigned long start = micros();
+    if (!preprocess(fb, backend.input()))
+    {
+        return false;
+    }
+    unsigned long invokeStart = micros();
+    bool ok = backend.invoke();
+    uint32_t invokeUs = micros() - invokeStart;
+    if (ok)
+    {
+        InferenceBackend::Tensor output = backend.output();
+        decode(output, result);
+        result.frameMs = startMs;
+        result.latencyUs = micros() - start;
+        // Same model and frame give the same checksum on host and device
+        ESP_LOGD(TAG, "Output crc %08x, offset %.2f", static_cast<unsigned>(crc32(output.data, output.bytes)),
+                 result.offset());
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (ok)
+    {
+        stats.invokes++;
+        stats.lastInvokeUs = invokeUs;
+        stats.maxInvokeUs = invokeUs > stats.maxInvokeUs ? invokeUs : stats.maxInvokeUs;
+        stats.totalInvokeUs += invokeUs;
+        stats.totalPreprocessUs += invokeStart - start;
+    }
+    xSemaphoreGive(statsMutex);
+
+    if (!ok)
+    {
+        ESP_LOGE(TAG, "Invoke failed: %s", backend.lastError());
+    }
+    return ok;
+}
+
+bool ModelInference::runDetector(const camera_fb_t *fb, LaneResult &result)
+{
+    if (!detector.detect(fb, result))
+    {
+        return false;
+    }
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats.invokes++;
+    stats.lastInvokeUs = result.latencyUs;
+    stats.maxInvokeUs = result.latencyUs > stats.maxInvokeUs ? result.latencyUs : stats.maxInvokeUs;
+    stats.totalInvokeUs += result.latencyUs;
+    if (result.latencyUs > LANE_DETECTOR_BUDGET_US)
+    {
+        stats.overBudget++;
+    }
+    xSemaphoreGive(statsMutex);
+    return true;
+}
+
+bool ModelInference::preprocess(const camera_fb_t *fb, const InferenceBackend::Tensor &input)
+{
+    const FramePreprocessor::Layout &layout = preprocessor.getLayout();
+    if (!preprocessor.isConfigured() || layout.sourceWidth != static_cast<int>(fb->width) ||
+        layout.sourceHeight != static_cast<int>(fb->height))
+    {
+        // Shrinking averages every source pixel; a model larger than the
+        // frame gets interpolated pixels
+        bool shrink = input.dims[2] <= static_cast<int>(fb->width) && input.dims[1] <= static_cast<int>(fb->height);
+        FramePreprocessor::Layout wanted = {static_cast<int>(fb->width),
+                                            static_cast<int>(fb->height),
+                                            {0, 0, 0, 0},
+                                            input.dims[2],
+                                            input.dims[1],
+                                            input.dims[3],
+                                            shrink ? FramePreprocessor::AREA : FramePreprocessor::BILINEAR};
+        if (!preprocessor.configure(wanted, quantize))
+        {
+            return false;
+        }
+    }
+    preprocessor.run(fb->buf, input.data);
+    return true;
+}
+
+void ModelInference::decode(const InferenceBackend::Tensor &output, LaneResult &result)
+{
+    float values[OUTPUT_VALUES];
+    for (int i = 0; i < OUTPUT_VALUES; i++)
+    {
+        values[i] = output.scale * (output.data[i] - output.zeroPoint);
+    }
+    LaneLine *lines[2] = {&result.left, &result.right};
+    for (int i = 0; i < 2; i++)
+    {
+        const float *line = values + 3 * i;
+        lines[i]->bottomX = line[0];
+        lines[i]->topX = line[1];
+        lines[i]->confidence = 1.0f / (1.0f + expf(-line[2]));
+        lines[i]->found = lines[i]->confidence >= INFERENCE_MIN_CONFIDENCE;
+    }
+}
+
+LaneResult ModelInference::getLastResult()
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    LaneResult result = lastResult;
+    xSemaphoreGive(statsMutex);
+    return result;
+}
+
+ModelInference::Stats ModelInference::getStats()
+{
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(statsMutex);
+    return snapshot;
+}
+
+void ModelInference::publishMetrics()
+{
+    Stats snapshot = getStats();
+    LaneResult result = getLastResult();
+
+    JsonDocument doc;
+    doc["backend"] = classical ? "classical" : backend.name();
+    doc["frames"] = snapshot.frames;
+    doc["tracked"] = snapshot.tracked;
+    doc["forced"] = snapshot.forced;
+    doc["track_interval"] = tracker.getInterval();
+    doc["road_top"] = detector.getRoadTop();
+    doc["invokes"] = snapshot.invokes;
+    doc["failures"] = snapshot.failures;
+    doc["last_us"] = snapshot.lastInvokeUs;
+    doc["max_us"] = snapshot.maxInvokeUs;
+    doc["avg_us"] = snapshot.invokes ? static_cast<uint32_t>(snapshot.totalInvokeUs / snapshot.invokes) : 0;
+    doc["preprocess_us"] = snapshot.invokes ? static_cast<uint32_t>(snapshot.totalPreprocessUs / snapshot.invokes) : 0;
+    doc["arena_used"] = static_cast<uint32_t>(snapshot.arenaUsed);
+    doc["arena_size"] = static_cast<uint32_t>(snapshot.arenaSize);
+    doc["over_budget"] = snapshot.overBudget;
+    doc["departures"] = snapshot.departures;
+
+    JsonObject lane = doc["lane"].to<JsonObject>();
+    lane["left"] = result.left.found;
+    lane["right"] = result.right.found;
+    lane["offset"] = result.offset();
+
+    std::string metrics;
+    serializeJsonPretty(doc, metrics);
+    bleService->updateServiceMetrics("inference", metrics);
+}
@@ -0,0 +1,117 @@
+#include "mount_calibration.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include "config.h"
+#include "crc32.h"
+#include "sd_manager.h"
+
+const char *MountCalibration::TAG = "MountCalibration";
+
+bool MountCalibration::plausible(float vanishX, float vanishY)
+{
+    // Anywhere across the frame, and with road below it to work on
+    return isfinite(vanishX) && isfinite(vanishY) && vanishX >= 0 && vanishX <= 1 && vanishY >= 0.05f &&
+           vanishY <= 0.8f;
+}
+
+bool MountCalibration::load()
+{
+    loaded = true;
+    calibrated = false;
+    mount = {IPM_VANISH_X, IPM_VANISH_Y, 0, 0};
+
+    File file = SDManager::getInstance().openFile(MOUNT_CALIBRATION_PATH, FILE_READ);
+    if (!file)
+    {
+        ESP_LOGI(TAG, "No calibration, horizon at the configured %.2f", mount.vanishY);
+        return false;
+    }
+    Record record;
+    size_t read = file.read(reinterpret_cast<uint8_t *>(&record), sizeof(record));
+    file.close();
+    if (read != sizeof(record) || record.magic != RECORD_MAGIC || record.version != RECORD_VERSION ||
+        record.crc != crc32(&record, offsetof(Record, crc)) || !plausible(record.vanishX, record.vanishY))
+    {
+        ESP_LOGW(TAG, "Invalid calibration in %s, horizon at the configured %.2f", MOUNT_CALIBRATION_PATH,
+                 mount.vanishY);
+        return false;
+    }
+
+    mount = {record.vanishX, record.vanishY, record.spread, record.frames};
+    calibrated = true;
+    ESP_LOGI(TAG, "Vanishing point %.3f, %.3f from %u frames", mount.vanishX, mount.vanishY,
+             static_cast<unsigned>(mount.frames));
+    return true;
+}
+
+bool MountCalibration::save(const Mount &value)
+{
+    if (!plausible(value.vanishX, value.vanishY))
+    {
+        ESP_LOGE(TAG, "Vanishing point %.3f, %.3f out of range", value.vanishX, value.vanishY);
+        return false;
+    }
+    Record record = {};
+    record.magic = RECORD_MAGIC;
+    record.version = RECORD_VERSION;
+    record.vanishX = value.vanishX;
+    record.vanishY = value.vanishY;
+    record.spread = value.spread;
+    record.frames = value.frames;
+    record.crc = crc32(&record, offsetof(Record, crc));
+
+    SDManager &sd = SDManager::getInstance();
+    const char *path = MOUNT_CALIBRATION_PATH;
+    std::string directory(path, strrchr(path, '/') ? strrchr(path, '/') - path : 0);
+    if (!directory.empty() && !sd.exists(directory.c_str()))
+    {
+        sd.mkdir(directory.c_str());
+    }
+    File file = sd.openFile(path, FILE_WRITE);
+    if (!file)
+    {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return false;
+    }
+    size_t written = file.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record));
+    file.close();
+    if (written != sizeof(record))
+    {
+        ESP_LOGE(TAG, "Short write to %s", path);
+        sd.remove(path);
+        return false;
+    }
+
+    loaded = true;
+    calibrated = true;
+    mount = value;
+    return true;
+}
+
+bool MountCalibration::apply(VanishingPointEstimator &estimator)
+{
+    VanishingPointEstimator::Estimate estimate;
+    if (!estimator.estimate(estimate))
+    {
+        ESP_LOGW(TAG, "No estimate from %u frames (rows spread over %.3f)", static_cast<unsigned>(estimate.frames),
+                 estimate.spread);
+        return false;
+    }
+    ESP_LOGI(TAG, "Vanishing point %.3f, %.3f from %u frames (rows spread over %.3f)", estimate.vanishX,
+             estimate.vanishY, static_cast<unsigned>(estimate.frames), estimate.spread);
+    return save({estimate.vanishX, estimate.vanishY, estimate.spread, estimate.frames});
+}
+
+float MountCalibration::roadTop() const
+{
+    return mount.vanishY + MOUNT_ROAD_MARGIN;
+}
+
+InversePerspectiveMap::Layout MountCalibration::ipmLayout(int sourceWidth, int sourceHeight) const
+{
+    float top = mount.vanishY + (IPM_TOP - IPM_VANISH_Y);
+    return {sourceWidth, sourceHeight, IPM_WIDTH, IPM_HEIGHT,
+            InversePerspectiveMap::Quad::fromVanishingPoint(mount.vanishX, mount.vanishY, top)};
+}
@@ -0,0 +1,193 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <functional>
+#include "alert_scheduler.h"
+#include "buzzer_manager.h"
+#include "config.h"
+#include "host_commands.h"
+#include "mock_buzzer_backend.h"
+
+struct PatternCheck
+{
+    const char *name;
+    std::function<void()> play;
+    size_t expectedEvents;
+    unsigned long expectedMs; // length of the rendered timeline
+};
+
+static bool waitIdle(BuzzerManager &buzzer, unsigned long timeoutMs)
+{
+    unsigned long start = millis();
+    while (!buzzer.isIdle())
+    {
+        if (millis() - start > timeoutMs)
+        {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+int runBuzzer(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    BuzzerManager &buzzer = BuzzerManager::getInstance();
+    MockBuzzerBackend &mock = MockBuzzerBackend::getInstance();
+    if (!buzzer.begin(BUZZER_PIN))
+    {
+        fprintf(stderr, "buzzer failed to start\n");
+        return 1;
+    }
+
+    // Durations follow the patterns the blocking implementation played
+    const PatternCheck checks[] = {
+        {"boot", [&] { buzzer.playBootTone(); }, 3, 350},
+        {"low", [&] { buzzer.playLowImportance(); }, 1, 100},
+        {"medium", [&] { buzzer.playMediumImportance(); }, 3, 250},
+        {"high", [&] { buzzer.playHighImportance(); }, 6, 450},
+        {"ambulance", [&] { buzzer.playAmbulanceSiren(300); }, 4, 700},
+        {"critical", [&] { buzzer.playCriticalAlarm(15); }, 12, 180},
+        {"alarm", [&] { buzzer.playAlarmSiren(20); }, 200, 4000},
+        {"increasing", [&] { buzzer.playIncreasingPitch(30); }, 150, 4500},
+        {"fox", [&] { buzzer.playWhatTheFoxSaid(); }, 26, 1960},
+    };
+
+    int failures = 0;
+    printf("%-11s %8s %7s %9s %s\n", "pattern", "call us", "events", "timeline", "result");
+    for (const PatternCheck &check : checks)
+    {
+        mock.reset();
+        unsigned long start = micros();
+        check.play();
+        unsigned long callUs = micros() - start;
+
+        bool idle = waitIdle(buzzer, 2000);
+        size_t events = mock.timeline().size();
+        unsigned long timelineMs = mock.elapsedMs();
+        bool ok = idle && events == check.expectedEvents && timelineMs == check.expectedMs;
+        failures += ok ? 0 : 1;
+        printf("%-11s %8lu %7zu %7lu ms %s\n", check.name, callUs, events, timelineMs, ok ? "ok" : "MISMATCH");
+    }
+
+    // With real-time pacing the queue backs up: a pattern that does not fit
+    // is dropped whole, and stop() cuts the rest short
+    mock.reset();
+    mock.setRealtime(true);
+    uint32_t droppedBefore = buzzer.getStats().patternsDropped;
+    buzzer.playWhatTheFoxSaid();
+    buzzer.playWhatTheFoxSaid();
+    buzzer.playWhatTheFoxSaid();
+    bool dropped = buzzer.getStats().patternsDropped == droppedBefore + 1;
+    printf("overflow:   %s\n", dropped ? "ok" : "MISMATCH");
+
+    unsigned long stopStart = millis();
+    buzzer.stop();
+    bool stopped = waitIdle(buzzer, 500);
+    unsigned long stopMs = millis() - stopStart;
+    printf("stop:       %lu ms, %zu events rendered %s\n", stopMs, mock.timeline().size(),
+           stopped ? "ok" : "MISMATCH");
+    mock.setRealtime(false);
+    failures += (dropped ? 0 : 1) + (stopped ? 0 : 1);
+
+    BuzzerManager::Stats stats = buzzer.getStats();
+    printf("\nqueued %u, dropped %u, notes %u, max depth %u, slowest call %u us\n",
+           stats.patternsQueued, stats.patternsDropped, stats.notesPlayed,
+           stats.maxQueueDepth, stats.maxEnqueueUs);
+    return failures ? 1 : 0;
+}
+
+static void printHistogram(const char *label, const AlertScheduler::Histogram &histogram)
+{
+    printf("%-9s %5u", label, histogram.count);
+    for (int i = 0; i < AlertScheduler::LATENCY_BUCKETS; i++)
+    {
+        printf(" %6u", histogram.buckets[i]);
+    }
+    printf(" %8.2f %8.2f\n", histogram.count ? histogram.totalUs / 1000.0 / histogram.count : 0.0,
+           histogram.maxUs / 1000.0);
+}
+
+int runAlerts(int argc, char **argv)
+{
+    int rounds = argc > 0 ? atoi(argv[0]) : 20;
+
+    BuzzerManager &buzzer = BuzzerManager::getInstance();
+    AlertScheduler &alerts = AlertScheduler::getInstance();
+    MockBuzzerBackend &mock = MockBuzzerBackend::getInstance();
+    if (!buzzer.begin(BUZZER_PIN) || !alerts.begin())
+    {
+        fprintf(stderr, "buzzer failed to start\n");
+        return 1;
+    }
+    mock.setRealtime(true);
+    srand(7);
+
+    // Lane alerts land at a random point of a lower-priority pattern
+    for (int round = 0; round < rounds; round++)
+    {
+        switch (round % 4)
+        {
+        case 0:
+            buzzer.playWhatTheFoxSaid();
+            break;
+        case 1:
+            buzzer.playAlarmSiren();
+            break;
+        case 2:
+            alerts.raise(AlertScheduler::ALERT_BOOT);
+            alerts.raise(AlertScheduler::ALERT_WARNING);
+            break;
+        default:
+            alerts.raise(AlertScheduler::ALERT_ERROR);
+            break;
+        }
+        delay(rand() % 200);
+        alerts.raise(AlertScheduler::ALERT_LANE_DEPARTURE);
+        waitIdle(buzzer, 2000);
+        delay(600); // past the lane alert's minimum spacing
+    }
+    AlertScheduler::Stats preemption = alerts.getStats();
+
+    // Repeats while the alert is sounding collapse into it
+    alerts.resetStats();
+    for (int i = 0; i < 10; i++)
+    {
+        alerts.raise(AlertScheduler::ALERT_LANE_DEPARTURE);
+    }
+    // Lower classes stay quiet while it sounds
+    alerts.raise(AlertScheduler::ALERT_NOTICE);
+    waitIdle(buzzer, 2000);
+    // Too soon after the last one
+    alerts.raise(AlertScheduler::ALERT_LANE_DEPARTURE);
+    waitIdle(buzzer, 2000);
+    AlertScheduler::Stats policy = alerts.getStats();
+    mock.setRealtime(false);
+
+    printf("%-9s %5s", "class", "count");
+    for (int i = 0; i < AlertScheduler::LATENCY_BUCKETS - 1; i++)
+    {
+        printf("  <=%2u", AlertScheduler::BUCKET_LIMITS_MS[i]);
+    }
+    printf("   >%3u   avg ms   max ms\n", AlertScheduler::BUCKET_LIMITS_MS[AlertScheduler::LATENCY_BUCKETS - 2]);
+    for (int i = 0; i < AlertScheduler::PRIORITY_COUNT; i++)
+    {
+        printHistogram(AlertScheduler::priorityName(static_cast<AlertScheduler::Priority>(i)), preemption.latency[i]);
+    }
+
+    const AlertScheduler::Histogram &critical = preemption.latency[AlertScheduler::PRIORITY_CRITICAL];
+    bool withinBudget = critical.count == static_cast<uint32_t>(rounds) &&
+                        preemption.preemptions >= static_cast<uint32_t>(rounds) &&
+                        critical.maxUs <= AlertScheduler::CRITICAL_BUDGET_MS * 1000;
+    bool coalesced = policy.coalesced == 9 && policy.suppressed == 1 && policy.rateLimited == 1 && policy.played == 1;
+
+    printf("\npreemptions:   %u in %d rounds\n", preemption.preemptions, rounds);
+    printf("critical:      worst %.2f ms, budget %lu ms %s\n", critical.maxUs / 1000.0,
+           AlertScheduler::CRITICAL_BUDGET_MS, withinBudget ? "ok" : "MISMATCH");
+    printf("policy:        %u coalesced, %u suppressed, %u rate-limited, %u played %s\n",
+           policy.coalesced, policy.suppressed, policy.rateLimited, policy.played, coalesced ? "ok" : "MISMATCH");
+    return withinBudget && coalesced ? 0 : 1;
+}
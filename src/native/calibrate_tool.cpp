@@ -0,0 +1,276 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "camera_manager.h"
+#include "config.h"
+#include "file_camera_backend.h"
+#include "host_commands.h"
+#include "inverse_perspective_map.h"
+#include "lane_detector.h"
+#include "mount_calibration.h"
+#include "road_scene.h"
+#include "sd_manager.h"
+#include "vanishing_point_estimator.h"
+
+using namespace RoadScene;
+
+namespace
+{
+    const char *MOUNT_DIR = "/mount";
+
+    // Vanishing points of the rendered mounts, fractions of the frame: level,
+    // pitched down, up, up and turned right, well down
+    const double MOUNTS[][2] = {{0.5, 0.4}, {0.56, 0.33}, {0.42, 0.47}, {0.62, 0.52}, {0.45, 0.28}};
+
+    struct Replay
+    {
+        int frames = 0;    // replayed
+        uint64_t addUs = 0; // in addFrame()
+    };
+
+    // Feeds every frame of `source` through the camera to the estimator
+    bool replay(const char *source, VanishingPointEstimator &estimator, Replay &out)
+    {
+        FileCameraBackend &backend = FileCameraBackend::getInstance();
+        backend.setSource(source);
+        backend.setFrameRate(0);
+        backend.setLooping(false);
+        CameraManager &camera = CameraManager::getInstance();
+        camera.releaseCamera();
+        camera.setBackend(&backend);
+        if (!camera.begin(CameraProfile::INFERENCE))
+        {
+            fprintf(stderr, "replay of %s failed to start: %s\n", source, camera.lastError());
+            camera.setBackend(nullptr);
+            return false;
+        }
+        // begin() consumed the first frame to confirm the profile
+        while (FrameRef frame = camera.captureShared())
+        {
+            unsigned long start = micros();
+            estimator.addFrame(frame.get());
+            out.addUs += micros() - start;
+            out.frames++;
+        }
+        camera.releaseCamera();
+        camera.setBackend(nullptr);
+        return out.frames > 0;
+    }
+
+    // Roads as seen from one mount: the vanishing point moves a few pixels
+    // with heading and pitch from frame to frame, the rest is randomRoad()
+    Road mountRoad(int mount, int index, std::mt19937 &random)
+    {
+        std::normal_distribution<double> heading(0, 5), pitch(0, 1.5);
+        Road road = randomRoad(index, random);
+        road.vanishX = MOUNTS[mount][0] * WIDTH + heading(random);
+        road.vanishY = MOUNTS[mount][1] * HEIGHT + pitch(random);
+        return road;
+    }
+
+    bool writeFrames(const char *directory, int frames, std::mt19937 &random, int mount, bool bare)
+    {
+        SDManager &sd = SDManager::getInstance();
+        sd.mkdir(MOUNT_DIR);
+        sd.mkdir(directory);
+        std::vector<uint8_t> pixels;
+        for (int i = 0; i < frames; i++)
+        {
+            Road road = mountRoad(mount, i, random);
+            road.paint = road.paint && !bare;
+            render(road, random, pixels);
+            char path[64];
+            snprintf(path, sizeof(path), "%s/" IMAGE_PREFIX "%d" RGB_EXTENSION, directory, i);
+            File file = sd.openFile(path, FILE_WRITE);
+            bool ok = file && file.write(pixels.data(), pixels.size()) == pixels.size();
+            if (file)
+            {
+                file.close();
+            }
+            if (!ok)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Mean absolute offset error of the detector against the rendered truth
+    // over fresh frames from `mount`, and the frames with both lines
+    double detectorError(LaneDetector &detector, int mount, int frames, int &both)
+    {
+        std::mt19937 random(1000 + mount);
+        std::vector<uint8_t> pixels;
+        double sum = 0;
+        both = 0;
+        for (int i = 0; i < frames; i++)
+        {
+            Road road = mountRoad(mount, i, random);
+            render(road, random, pixels);
+            camera_fb_t fb = {};
+            fb.buf = pixels.data();
+            fb.len = pixels.size();
+            fb.width = WIDTH;
+            fb.height = HEIGHT;
+            fb.format = PIXFORMAT_RGB565;
+            LaneResult result;
+            if (detector.detect(&fb, result) && result.valid())
+            {
+                sum += fabs(result.offset() - truth(road).offset());
+                both++;
+            }
+        }
+        return both ? sum / both : 0;
+    }
+
+    int calibrateSource(const char *source)
+    {
+        static VanishingPointEstimator estimator;
+        Replay run;
+        if (!replay(source, estimator, run))
+        {
+            return 1;
+        }
+        MountCalibration &mount = MountCalibration::getInstance();
+        bool ok = mount.apply(estimator);
+        VanishingPointEstimator::Estimate estimate;
+        estimator.estimate(estimate);
+        printf("source:      %s, %d frames, %u with both lane boundaries, %.0f us per frame\n", source, run.frames,
+               static_cast<unsigned>(estimate.frames), static_cast<double>(run.addUs) / run.frames);
+        printf("estimate:    vanishing point %.3f, %.3f, rows spread over %.1f px\n", estimate.vanishX,
+               estimate.vanishY, estimate.spread * HEIGHT);
+        if (ok)
+        {
+            printf("saved:       %s, road from row fraction %.3f\n", MOUNT_CALIBRATION_PATH, mount.roadTop());
+        }
+        printf("calibrate:   %s\n", ok ? "ok" : "NO ESTIMATE");
+        return ok ? 0 : 1;
+    }
+}
+
+// Estimates the mount of rendered drives through the camera replay and
+// checks the vanishing point against the one they were rendered with, that
+// roads without paint give no estimate, that the record survives a save and
+// load and that a damaged one falls back to the configured mount. Then
+// compares the lane detector cropped at the calibrated road top with the
+// fixed crop, and the rows the calibrated bird's-eye view reads.
+//
+// With a source (a directory of frames or a session on the card) instead,
+// calibrates from those frames and saves the record for the device.
+int runCalibrate(int argc, char **argv)
+{
+    SDManager &sd = SDManager::getInstance();
+    if (!sd.begin())
+    {
+        fprintf(stderr, "host storage unavailable\n");
+        return 1;
+    }
+    if (argc > 0 && atoi(argv[0]) <= 0)
+    {
+        return calibrateSource(argv[0]);
+    }
+    int frames = argc > 0 ? atoi(argv[0]) : 60;
+    if (frames < CALIBRATION_MIN_FRAMES + 1)
+    {
+        fprintf(stderr, "calibrate needs at least %d frames\n", CALIBRATION_MIN_FRAMES + 1);
+        return 2;
+    }
+
+    const int mounts = sizeof(MOUNTS) / sizeof(MOUNTS[0]);
+    std::mt19937 random(11);
+    static VanishingPointEstimator estimator;
+    bool ok = true;
+    printf("%5s %15s %15s %9s %6s %7s %8s\n", "mount", "rendered", "estimated", "error px", "spread", "frames",
+           "us/frame");
+    std::vector<MountCalibration::Mount> estimates;
+    for (int m = 0; m <= mounts; m++)
+    {
+        // The last batch is the first mount without any paint
+        bool bare = m == mounts;
+        int mount = bare ? 0 : m;
+        char directory[32];
+        snprintf(directory, sizeof(directory), "%s/%d", MOUNT_DIR, m);
+        estimator.reset();
+        Replay run;
+        if (!writeFrames(directory, frames, random, mount, bare) || !replay(directory, estimator, run))
+        {
+            fprintf(stderr, "cannot replay %s\n", directory);
+            return 1;
+        }
+        VanishingPointEstimator::Estimate estimate;
+        bool settled = estimator.estimate(estimate);
+        double dx = (estimate.vanishX - MOUNTS[mount][0]) * WIDTH;
+        double dy = (estimate.vanishY - MOUNTS[mount][1]) * HEIGHT;
+        double error = sqrt(dx * dx + dy * dy);
+        char label[8];
+        snprintf(label, sizeof(label), bare ? "bare" : "%d", m);
+        printf("%5s %7.3f, %5.3f %7.3f, %5.3f %9.2f %6.1f %3u/%-3d %8.0f  %s\n", label, MOUNTS[mount][0],
+               MOUNTS[mount][1], estimate.vanishX, estimate.vanishY, bare ? 0 : error, estimate.spread * HEIGHT,
+               static_cast<unsigned>(estimate.frames), run.frames, static_cast<double>(run.addUs) / run.frames,
+               bare ? (settled ? "ESTIMATED" : "no estimate, ok") : (settled && error <= 2 ? "ok" : "MISMATCH"));
+        if (bare)
+        {
+            ok = ok && !settled;
+        }
+        else
+        {
+            ok = ok && settled && error <= 2;
+            estimates.push_back({estimate.vanishX, estimate.vanishY, estimate.spread, estimate.frames});
+        }
+    }
+
+    // The record: round trip, then damaged, then missing
+    MountCalibration &calibration = MountCalibration::getInstance();
+    const MountCalibration::Mount &saved = estimates[1];
+    bool roundTrip = calibration.save(saved) && calibration.load() &&
+                     memcmp(&calibration.get(), &saved, sizeof(saved)) == 0;
+    File file = sd.openFile(MOUNT_CALIBRATION_PATH, FILE_READ);
+    std::vector<uint8_t> record(file ? file.size() : 0);
+    if (file)
+    {
+        file.read(record.data(), record.size());
+        file.close();
+    }
+    record[8] ^= 0x01;
+    file = sd.openFile(MOUNT_CALIBRATION_PATH, FILE_WRITE);
+    file.write(record.data(), record.size());
+    file.close();
+    bool damaged = !calibration.load() && !calibration.isCalibrated() && calibration.get().vanishX == IPM_VANISH_X &&
+                   calibration.get().vanishY == IPM_VANISH_Y;
+    sd.remove(MOUNT_CALIBRATION_PATH);
+    bool missing = !calibration.load() && !calibration.isCalibrated();
+    printf("\nrecord:      round trip %s, damaged falls back %s, missing falls back %s\n", roundTrip ? "ok" : "MISMATCH",
+           damaged ? "ok" : "MISMATCH", missing ? "ok" : "MISMATCH");
+    ok = ok && roundTrip && damaged && missing;
+
+    // Downstream: the detector's crop and the bird's-eye rows per mount
+    printf("\n%5s %9s %21s %21s %15s\n", "mount", "road top", "fixed crop err/both", "calibrated err/both",
+           "ipm rows");
+    for (int m = 0; m < mounts; m++)
+    {
+        calibration.save(estimates[m]);
+        calibration.load();
+        LaneDetector fixed, calibrated;
+        calibrated.setRoadTop(calibration.roadTop());
+        int fixedBoth = 0, calibratedBoth = 0;
+        double fixedError = detectorError(fixed, m, frames, fixedBoth);
+        double calibratedError = detectorError(calibrated, m, frames, calibratedBoth);
+        InversePerspectiveMap ipm;
+        bool built = ipm.build(calibration.ipmLayout(WIDTH, HEIGHT));
+        printf("%5d %9.3f %12.4f %3d/%-3d %12.4f %3d/%-3d %7d..%-3d\n", m, calibration.roadTop(), fixedError,
+               fixedBoth, frames, calibratedError, calibratedBoth, frames, built ? ipm.firstSourceRow() : -1,
+               built ? ipm.lastSourceRow() : -1);
+        ok = ok && built && ipm.firstSourceRow() >= calibration.horizon() * HEIGHT;
+    }
+    sd.remove(MOUNT_CALIBRATION_PATH);
+
+    printf("\nerror px: distance of the estimate from the rendered point on the %dx%d frame; spread: rows' "
+           "interquartile range\n",
+           WIDTH, HEIGHT);
+    printf("calibrate:   %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
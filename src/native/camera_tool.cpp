@@ -0,0 +1,240 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "camera_manager.h"
+#include "crc32.h"
+#include "file_camera_backend.h"
+#include "host_commands.h"
+#include "replay_camera_backend.h"
+#include "rgbz_codec.h"
+#include "sd_manager.h"
+#include "session_container.h"
+
+namespace
+{
+    // capture -> inference -> capture -> preview -> inference, then idle
+    const CameraProfile::Id SEQUENCE[] = {
+        CameraProfile::DATASET, CameraProfile::INFERENCE, CameraProfile::DATASET,
+        CameraProfile::PREVIEW, CameraProfile::INFERENCE};
+    const int SEQUENCE_LENGTH = sizeof(SEQUENCE) / sizeof(SEQUENCE[0]);
+
+    // A pool ended while a frame is still held: idle buffers go at once, the
+    // held one with its last handle, and the pool cannot restart before that
+    bool poolEndsWithHeldFrame()
+    {
+        const size_t bytes = 240 * 240 * 2;
+        FramePool pool;
+        if (!pool.begin(3))
+        {
+            return false;
+        }
+        FrameRef held = pool.acquire(bytes);
+        FrameRef copy = held;
+        pool.acquire(bytes).reset();
+        pool.end();
+        FramePool::Stats ended = pool.getStats();
+        bool ok = held && ended.allocatedBytes == bytes && ended.inUse == 1 && !pool.acquire(bytes) &&
+                  !pool.begin(3);
+        held.reset();
+        ok = ok && pool.getStats().allocatedBytes == bytes;
+        copy.reset();
+        FramePool::Stats released = pool.getStats();
+        ok = ok && released.allocatedBytes == 0 && released.inUse == 0 && pool.begin(3);
+        FrameRef again = pool.acquire(bytes);
+        return ok && again && pool.getStats().allocatedBytes == bytes;
+    }
+
+    // The same through CameraManager: releaseCamera() ends the pool under a
+    // held frame, and shared capture resumes once that frame is let go
+    bool releaseEndsPool(CameraManager &camera)
+    {
+        if (!camera.begin(CameraProfile::DATASET))
+        {
+            return false;
+        }
+        FrameRef held = camera.captureShared();
+        std::vector<uint8_t> pixels(held ? held.data() : nullptr, held ? held.data() + held.size() : nullptr);
+        camera.releaseCamera();
+        FramePool::Stats ended = camera.getPoolStats();
+        bool ok = held && ended.capacity == 0 && ended.inUse == 1 &&
+                  memcmp(held.data(), pixels.data(), pixels.size()) == 0 && camera.begin(CameraProfile::DATASET);
+        ok = ok && !camera.captureShared();
+        held.reset();
+        ok = ok && camera.captureShared() && camera.getPoolStats().capacity > 0;
+        camera.releaseCamera();
+        return ok;
+    }
+}
+
+// Walks the camera through its profiles the way mode switches do. Checks
+// which switches were register deltas and that the first frame handed out
+// after a switch was shot with the new profile, then that a frame pool ended
+// under a held frame, directly or by releaseCamera(), frees it on release.
+int runProfiles(int argc, char **argv)
+{
+    int rounds = argc > 0 ? atoi(argv[0]) : 3;
+    ReplayCameraBackend &replay = ReplayCameraBackend::getInstance();
+    replay.setFrameRate(argc > 1 ? atoi(argv[1]) : 25);
+    CameraManager &camera = CameraManager::getInstance();
+    camera.resetProfileStats();
+
+    int failures = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        bool running = false;
+        CameraProfile::Id previous = CameraProfile::DATASET;
+        for (int step = 0; step < SEQUENCE_LENGTH; step++)
+        {
+            CameraProfile::Id id = SEQUENCE[step];
+            const CameraProfile &profile = CameraProfile::get(id);
+            bool expectRestart = !running || CameraProfile::needsReallocation(CameraProfile::get(previous), profile);
+            uint32_t restartsBefore = camera.getProfileStats(id).reallocations;
+
+            bool switched = camera.begin(id);
+            CameraManager::ProfileStats stats = camera.getProfileStats(id);
+            bool restarted = stats.reallocations != restartsBefore;
+
+            // The next frame a consumer sees must be shot with the new settings
+            camera_fb_t *fb = switched ? camera.capture() : nullptr;
+            bool fresh = fb && CameraProfile::isValidFrame(profile, fb) &&
+                         strcmp(replay.lastFrameProfile(), profile.name) == 0;
+            camera.release(fb);
+
+            bool ok = switched && restarted == expectRestart && fresh;
+            printf("round %d: %-9s -> %-9s %-8s %2u writes, %u dropped, first frame %6.1f ms %s\n", round,
+                   running ? CameraProfile::get(previous).name : "off", profile.name,
+                   restarted ? "restart" : "delta", stats.lastSettingsWritten, stats.lastDiscarded,
+                   stats.lastFirstFrameUs / 1000.0, ok ? "ok" : "MISMATCH");
+            failures += ok ? 0 : 1;
+            running = switched;
+            previous = id;
+        }
+        camera.releaseCamera();
+    }
+
+    printf("\n%-9s %8s %8s %8s %12s %12s\n", "profile", "switches", "restarts", "failures", "avg 1st ms", "max 1st ms");
+    for (int i = 0; i < CameraProfile::COUNT; i++)
+    {
+        CameraProfile::Id id = static_cast<CameraProfile::Id>(i);
+        CameraManager::ProfileStats stats = camera.getProfileStats(id);
+        printf("%-9s %8u %8u %8u %12.1f %12.1f\n", CameraProfile::get(id).name, stats.switches,
+               stats.reallocations, stats.failures,
+               stats.switches ? stats.totalFirstFrameUs / 1000.0 / stats.switches : 0.0,
+               stats.maxFirstFrameUs / 1000.0);
+    }
+    printf("\nhost restarts skip sensor bring-up; on the device they cost the driver init on top\n");
+    bool poolOk = poolEndsWithHeldFrame() && releaseEndsPool(camera);
+    printf("pool end:      %s\n", poolOk ? "held frame freed on release, ok" : "MISMATCH");
+    failures += poolOk ? 0 : 1;
+    printf("switches:      %s\n", failures == 0 ? "ok" : "MISMATCH");
+    return failures == 0 ? 0 : 1;
+}
+
+// Replays recorded frames through CameraManager and checks that they come out
+// unchanged, in order and at the requested rate (0 = as fast as possible).
+int runReplay(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        fprintf(stderr, "replay needs a source: a frame directory or /sessionNNNN under the SD root\n");
+        return 2;
+    }
+    const char *source = argv[0];
+    unsigned int fps = argc > 1 ? atoi(argv[1]) : 0;
+    int frames = argc > 2 ? atoi(argv[2]) : 100;
+
+    if (!SDManager::getInstance().begin())
+    {
+        fprintf(stderr, "host storage unavailable\n");
+        return 1;
+    }
+
+    FileCameraBackend &replay = FileCameraBackend::getInstance();
+    replay.setSource(source);
+    replay.setFrameRate(fps);
+    replay.setLooping(true);
+    CameraManager &camera = CameraManager::getInstance();
+    camera.releaseCamera();
+    camera.setBackend(&replay);
+    if (!camera.begin(CameraProfile::DATASET))
+    {
+        fprintf(stderr, "replay failed to start: %s\n", camera.lastError());
+        camera.setBackend(nullptr);
+        return 1;
+    }
+
+    // Sessions carry a checksum per record, so their frames can be checked
+    // against an independent read of the same records
+    std::vector<uint32_t> expected;
+    unsigned int sessionId = 0;
+    if (sscanf(source, "/session%u", &sessionId) == 1 || sscanf(source, "session%u", &sessionId) == 1)
+    {
+        Session::Reader reader;
+        if (reader.open(sessionId))
+        {
+            std::vector<uint8_t> payload;
+            std::vector<uint8_t> pixels;
+            for (size_t i = 0; i < reader.recordCount(); i++)
+            {
+                Session::IndexEntry entry;
+                if (!reader.entry(i, entry) || (entry.type != Session::RECORD_RAW && entry.type != Session::RECORD_RAWZ))
+                {
+                    continue;
+                }
+                payload.resize(entry.length);
+                bool ok = reader.read(entry, payload.data());
+                if (ok && entry.type == Session::RECORD_RAWZ)
+                {
+                    // Compare decoded pixels, as the replay serves them
+                    Rgbz::Header header;
+                    ok = Rgbz::readHeader(payload.data(), payload.size(), header);
+                    pixels.resize(ok ? Rgbz::frameBytes(header.width, header.height) : 0);
+                    ok = ok && Rgbz::decode(payload.data(), payload.size(), pixels.data(), pixels.size());
+                    payload.swap(pixels);
+                }
+                expected.push_back(ok ? crc32(payload.data(), payload.size()) : 0);
+            }
+        }
+    }
+
+    // begin() consumed the first frame to confirm the profile
+    size_t position = replay.getStats().served;
+    int invalid = 0;
+    int mismatched = 0;
+    const CameraProfile &profile = CameraProfile::get(CameraProfile::DATASET);
+    unsigned long start = micros();
+    for (int i = 0; i < frames; i++)
+    {
+        FrameRef frame = camera.captureShared();
+        if (!frame || !CameraProfile::isValidFrame(profile, frame.get()))
+        {
+            invalid++;
+            continue;
+        }
+        if (!expected.empty() && crc32(frame.data(), frame.size()) != expected[position % expected.size()])
+        {
+            mismatched++;
+        }
+        position++;
+    }
+    unsigned long elapsedUs = micros() - start;
+
+    FileCameraBackend::Stats stats = replay.getStats();
+    double achieved = elapsedUs ? frames * 1e6 / elapsedUs : 0.0;
+    bool paced = fps == 0 || (achieved > fps * 0.95 && achieved < fps * 1.05);
+    printf("source:        %s, %u frames, looped %u times\n", source, static_cast<unsigned>(replay.frameCount()),
+           stats.loops);
+    printf("served:        %u frames, %u invalid, %u read errors\n", stats.served, invalid, stats.readErrors);
+    printf("content:       %s\n", expected.empty() ? "not checked (no session checksums)"
+                                                   : mismatched ? "MISMATCH" : "ok, matches session records");
+    printf("rate:          %.1f fps (%s)\n", achieved, fps ? (paced ? "paced ok" : "pacing MISMATCH") : "unpaced");
+    printf("read:          %.1f MB/s, %.2f ms per frame\n",
+           stats.readUs ? stats.bytesRead / static_cast<double>(stats.readUs) : 0.0,
+           stats.served ? stats.readUs / 1000.0 / stats.served : 0.0);
+
+    camera.releaseCamera();
+    camera.setBackend(nullptr);
+    return invalid == 0 && mismatched == 0 && paced ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "ble_service.h"
+#include "camera_manager.h"
+#include "command_bus.h"
+#include "data_collector.h"
+#include "host_commands.h"
+#include "loopback_ble_transport.h"
+#include "mode_controller.h"
+#include "sd_manager.h"
+
+// Posts start/stop pairs from one producer, retrying when the bus is full,
+// and returns how many posts were refused along the way
+static uint32_t produce(CustomBLEService &ble, CommandBus::Source source, CustomBLEService::Command start,
+                        CustomBLEService::Command stop, int count, unsigned int seed)
+{
+    uint32_t refused = 0;
+    for (int i = 0; i < count; i++)
+    {
+        CustomBLEService::Command command = i % 2 == 0 ? start : stop;
+        while (!ble.postCommand(command, source))
+        {
+            refused++;
+            delay(1);
+        }
+        // Bursts with occasional pauses, like button clicks against a phone
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 8 == 0)
+        {
+            delayMicroseconds((seed >> 8) % 500);
+        }
+    }
+    return refused;
+}
+
+int runCommands(int argc, char **argv)
+{
+    int count = argc > 0 ? atoi(argv[0]) : 2000;
+    count += count % 2; // end on a stop
+
+    LoopbackBleTransport &link = LoopbackBleTransport::getInstance();
+    CustomBLEService ble(link);
+    ModeController &controller = ModeController::getInstance();
+    int settingsApplied = 0;
+    bool settingsOnWriter = false;
+    TaskHandle_t writer = xTaskGetCurrentTaskHandle();
+    ble.setSettingsHandler([&](const JsonDocument &)
+                           {
+        settingsApplied++;
+        settingsOnWriter = settingsOnWriter || xTaskGetCurrentTaskHandle() == writer;
+        return std::string("Settings applied"); });
+    if (!ble.begin() || !controller.begin(ble))
+    {
+        fprintf(stderr, "controller failed to start\n");
+        return 1;
+    }
+    link.connect();
+
+    // Through the transport as a phone write would arrive, including a bad
+    // code, then settings: one valid, one malformed
+    link.write(std::string(1, static_cast<char>(CustomBLEService::START_PREVIEW)));
+    link.write("x");
+    link.write(std::string(1, static_cast<char>(CustomBLEService::STOP_PREVIEW)));
+    link.write("{\"dedup\":{\"max_distance\":3}}");
+    link.write("{\"dedup\":");
+    controller.drain(1000);
+    uint32_t unknown = controller.getStats().unknown;
+    bool settingsOk = settingsApplied == 1 && !settingsOnWriter;
+    controller.resetStats();
+
+    uint32_t postedBefore = CommandBus::getInstance().totalPosted();
+    uint32_t refusedBle = 0;
+    uint32_t refusedMenu = 0;
+    unsigned long start = millis();
+    std::thread bleProducer([&]
+                            { refusedBle = produce(ble, CommandBus::SOURCE_BLE, CustomBLEService::START_PREVIEW,
+                                                   CustomBLEService::STOP_PREVIEW, count, 1); });
+    std::thread menuProducer([&]
+                             { refusedMenu = produce(ble, CommandBus::SOURCE_MENU, CustomBLEService::START_INFERENCE,
+                                                     CustomBLEService::STOP_INFERENCE, count, 2); });
+    bleProducer.join();
+    menuProducer.join();
+    bool drained = controller.drain(5000);
+    unsigned long elapsed = millis() - start;
+
+    ModeController::Stats stats = controller.getStats();
+    CommandBus::Stats bus = CommandBus::getInstance().getStats();
+    uint32_t posted = CommandBus::getInstance().totalPosted() - postedBefore;
+    bool complete = drained && stats.applied == posted && posted == static_cast<uint32_t>(count) * 2;
+    bool ordered = stats.outOfOrder == 0;
+    bool settled = !ble.isPreviewEnabled() && !ble.isInferenceEnabled();
+
+    printf("posted:        %u (ble %u, menu %u) in %lu ms\n", posted, stats.appliedBySource[CommandBus::SOURCE_BLE],
+           stats.appliedBySource[CommandBus::SOURCE_MENU], elapsed);
+    printf("refused:       %u while full (retried), max depth %u/%u\n", refusedBle + refusedMenu, bus.maxDepth,
+           CommandBus::CAPACITY);
+    printf("latency:       avg %.1f us, max %.1f ms (post to mode applied)\n",
+           stats.applied ? static_cast<double>(stats.totalLatencyUs) / stats.applied : 0.0, stats.maxLatencyUs / 1000.0);
+    printf("unknown codes: %u of 3 transport writes\n", unknown);
+    printf("applied:       %s\n", complete ? "ok" : "MISMATCH");
+    printf("order:         %s\n", ordered ? "ok" : "MISMATCH");
+    printf("final mode:    %s\n", settled ? "ok" : "MISMATCH");
+    printf("transport:     %s\n", unknown == 1 ? "ok" : "MISMATCH");
+    printf("settings:      %s\n", settingsOk ? "applied on the controller task, ok" : "MISMATCH");
+    return complete && ordered && settled && unknown == 1 && settingsOk ? 0 : 1;
+}
+
+static bool switchAndWait(CustomBLEService &ble, CustomBLEService::Command command, ModeController::Mode expected)
+{
+    ble.postCommand(command, CommandBus::SOURCE_BLE);
+    return ModeController::getInstance().drain(5000) && ModeController::getInstance().mode() == expected;
+}
+
+int runModes(int argc, char **argv)
+{
+    int cycles = argc > 0 ? atoi(argv[0]) : 5;
+    const uint32_t FRAMES_PER_STINT = 5;
+
+    LoopbackBleTransport &link = LoopbackBleTransport::getInstance();
+    CustomBLEService ble(link);
+    ModeController &controller = ModeController::getInstance();
+    if (!SDManager::getInstance().begin() || !ble.begin())
+    {
+        fprintf(stderr, "host storage or BLE unavailable\n");
+        return 1;
+    }
+
+    // Real capture mode; preview stands in for the MJPEG server, which has no
+    // host build, by switching the sensor to the preview profile
+    DataCollector collector(&ble);
+    controller.setHandlers(
+        ModeController::MODE_PREVIEW,
+        []()
+        { return CameraManager::getInstance().begin(CameraProfile::PREVIEW); },
+        []() {});
+    if (!controller.begin(ble))
+    {
+        fprintf(stderr, "controller failed to start\n");
+        return 1;
+    }
+    link.connect();
+    controller.drain(1000);
+    controller.resetStats();
+
+    int failures = 0;
+    for (int cycle = 0; cycle < cycles; cycle++)
+    {
+        // idle -> capture, capture -> preview, preview -> capture, capture -> idle
+        bool ok = switchAndWait(ble, CustomBLEService::START_DATA_COLLECTION, ModeController::MODE_CAPTURE);
+        unsigned long waitStart = millis();
+        while (ok && collector.getPipelineStats().stages[CapturePipeline::STORE].processed < FRAMES_PER_STINT &&
+               millis() - waitStart < 5000)
+        {
+            delay(5);
+        }
+        uint32_t stored = collector.getPipelineStats().stages[CapturePipeline::STORE].processed;
+        bool captured = stored >= FRAMES_PER_STINT;
+
+        ok = ok && switchAndWait(ble, CustomBLEService::START_PREVIEW, ModeController::MODE_PREVIEW);
+        ok = ok && switchAndWait(ble, CustomBLEService::START_DATA_COLLECTION, ModeController::MODE_CAPTURE);
+        ok = ok && switchAndWait(ble, CustomBLEService::STOP_DATA_COLLECTION, ModeController::MODE_IDLE);
+
+        ModeController::Stats stats = controller.getStats();
+        printf("cycle %d:       %u frames captured, last switch %.1f ms %s\n", cycle, stored,
+               stats.lastSwitchUs / 1000.0, ok && captured ? "ok" : "MISMATCH");
+        failures += ok && captured ? 0 : 1;
+    }
+
+    ModeController::Stats stats = controller.getStats();
+    bool inBudget = stats.overBudget == 0 && stats.switchFailures == 0;
+    printf("\nswitches:      %u, %u failed, %u over %lu ms budget\n", stats.switches, stats.switchFailures,
+           stats.overBudget, ModeController::SWITCH_BUDGET_MS);
+    printf("switch time:   avg %.1f ms, max %.1f ms\n",
+           stats.switches ? stats.totalSwitchUs / 1000.0 / stats.switches : 0.0, stats.maxSwitchUs / 1000.0);
+    printf("command time:  avg %.1f ms, max %.1f ms (post to mode applied)\n",
+           stats.applied ? stats.totalLatencyUs / 1000.0 / stats.applied : 0.0, stats.maxLatencyUs / 1000.0);
+    printf("budget:        %s\n", inBudget ? "ok" : "MISMATCH");
+    return failures == 0 && inBudget ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "capture_trigger.h"
+#include "duplicate_filter.h"
+#include "host_commands.h"
+
+namespace
+{
+    const int WIDTH = 240;
+    const int HEIGHT = 240;
+    const int DEVICE_DISTANCE = 3; // the native build overrides CAPTURE_DEDUP_DISTANCE
+
+    struct Frame
+    {
+        std::vector<uint8_t> pixels;
+        camera_fb_t fb;
+
+        Frame() : pixels(WIDTH * HEIGHT * 2), fb()
+        {
+            fb.buf = pixels.data();
+            fb.len = pixels.size();
+            fb.width = WIDTH;
+            fb.height = HEIGHT;
+            fb.format = PIXFORMAT_RGB565;
+        }
+    };
+
+    // Roadside scene number `scene`: sky, blocks of random width, height and
+    // colour, road with dashed markings. `shift` pans it by a few pixels,
+    // `gain` scales every channel like an exposure step, and every channel
+    // gets +-1 LSB of noise.
+    void renderScene(int scene, int shift, double gain, std::mt19937 &noise, Frame &out)
+    {
+        std::mt19937 random(1000 + scene);
+        std::vector<int> top(WIDTH + 64);
+        std::vector<uint16_t> colour(WIDTH + 64);
+        for (int x = 0; x < static_cast<int>(top.size());)
+        {
+            int blockWidth = 10 + random() % 30;
+            int blockTop = 20 + random() % 90;
+            uint16_t blockColour = random() & 0xFFFF;
+            for (int bx = x; bx < x + blockWidth && bx < static_cast<int>(top.size()); bx++)
+            {
+                top[bx] = blockTop;
+                colour[bx] = blockColour;
+            }
+            x += blockWidth;
+        }
+        int dashPhase = random() % 40;
+
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            for (int x = 0; x < WIDTH; x++)
+            {
+                int wx = x + 32 + shift;
+                uint16_t pixel;
+                if (y < HEIGHT / 2)
+                {
+                    pixel = y < top[wx] ? 0x7D7C : colour[wx]; // sky blue
+                }
+                else
+                {
+                    bool marking = abs(y - 3 * HEIGHT / 4) < 3 && ((wx + dashPhase) / 20) % 2 == 0;
+                    pixel = marking ? 0xF79E : 0x4229;
+                }
+                int channels[3] = {pixel >> 11, (pixel >> 5) & 0x3F, pixel & 0x1F};
+                const int limits[3] = {31, 63, 31};
+                for (int c = 0; c < 3; c++)
+                {
+                    int value = static_cast<int>(channels[c] * gain + 0.5) + static_cast<int>(noise() % 3) - 1;
+                    channels[c] = value < 0 ? 0 : value > limits[c] ? limits[c] : value;
+                }
+                uint16_t value = (channels[0] << 11) | (channels[1] << 5) | channels[2];
+                out.pixels[(y * WIDTH + x) * 2] = value >> 8;
+                out.pixels[(y * WIDTH + x) * 2 + 1] = value & 0xFF;
+            }
+        }
+    }
+
+    struct Check
+    {
+        const char *name;
+        int frames = 0;
+        int rejected = 0;
+        int minDistance = 64;
+        int maxDistance = 0;
+
+        void add(const DuplicateFilter::Result &result)
+        {
+            frames++;
+            rejected += result.duplicate ? 1 : 0;
+            minDistance = result.distance < minDistance ? result.distance : minDistance;
+            maxDistance = result.distance > maxDistance ? result.distance : maxDistance;
+        }
+
+        bool print(bool expectRejected)
+        {
+            bool ok = expectRejected ? rejected == frames : rejected == 0;
+            printf("%-26s %6d %8d %6d %6d  %s\n", name, frames, rejected, minDistance, maxDistance,
+                   ok ? "ok" : "MISMATCH");
+            return ok;
+        }
+    };
+}
+
+// Feeds the duplicate filter frame sequences with a known answer and prints
+// per case how many were rejected and the Hamming distance range to the
+// nearest stored hash: repeats with sensor noise, exposure steps and small
+// shifts must be rejected, distinct scenes admitted, a scene coming back
+// within the window rejected (which CaptureTrigger alone would store) and
+// one coming back after the window admitted. Also checks that unhashable
+// frames and a disabled filter pass everything, and times the hash.
+int runDedup(int argc, char **argv)
+{
+    int maxDistance = argc > 0 ? atoi(argv[0]) : DEVICE_DISTANCE;
+    if (maxDistance < 0 || maxDistance > 64)
+    {
+        fprintf(stderr, "need 0 <= distance <= 64\n");
+        return 2;
+    }
+    DuplicateFilter filter;
+    filter.setMaxDistance(maxDistance);
+    std::mt19937 noise(3);
+    Frame frame;
+    bool ok = true;
+
+    printf("max distance %d bits of 64, window %d frames\n\n", maxDistance, DuplicateFilter::WINDOW);
+    printf("%-26s %6s %8s %6s %6s\n", "case", "frames", "rejected", "min d", "max d");
+
+    // Reference scene, then variations of it
+    renderScene(0, 0, 1.0, noise, frame);
+    filter.check(&frame.fb);
+    Check repeats = {"repeat + noise"};
+    for (int i = 0; i < 20; i++)
+    {
+        renderScene(0, 0, 1.0, noise, frame);
+        repeats.add(filter.check(&frame.fb));
+    }
+    ok = repeats.print(true) && ok;
+
+    Check exposure = {"exposure -15%..+15%"};
+    for (double gain = 0.85; gain <= 1.151; gain += 0.05)
+    {
+        renderScene(0, 0, gain, noise, frame);
+        exposure.add(filter.check(&frame.fb));
+    }
+    ok = exposure.print(true) && ok;
+
+    Check shifts = {"shift 1..3 px"};
+    for (int shift = -3; shift <= 3; shift++)
+    {
+        renderScene(0, shift, 1.0, noise, frame);
+        shifts.add(filter.check(&frame.fb));
+    }
+    ok = shifts.print(true) && ok;
+
+    // Distinct scenes fill the window; scene 0 is still in it
+    Check distinct = {"distinct scenes"};
+    for (int scene = 1; scene < DuplicateFilter::WINDOW; scene++)
+    {
+        renderScene(scene, 0, 1.0, noise, frame);
+        distinct.add(filter.check(&frame.fb));
+    }
+    ok = distinct.print(false) && ok;
+
+    CaptureTrigger trigger;
+    trigger.setIntervals(0, 0);
+    trigger.setThreshold(CAPTURE_CHANGE_THRESHOLD > 0 ? CAPTURE_CHANGE_THRESHOLD : 12);
+    renderScene(DuplicateFilter::WINDOW - 1, 0, 1.0, noise, frame);
+    trigger.shouldStore(&frame.fb, 0);
+    trigger.commit(0);
+    Check revisit = {"scene back within window"};
+    renderScene(0, 0, 1.0, noise, frame);
+    bool triggerStores = trigger.shouldStore(&frame.fb, 1) != CaptureTrigger::SKIP;
+    revisit.add(filter.check(&frame.fb));
+    ok = revisit.print(true) && ok;
+
+    // One more distinct scene pushes scene 0 out of the ring
+    renderScene(DuplicateFilter::WINDOW, 0, 1.0, noise, frame);
+    filter.check(&frame.fb);
+    Check evicted = {"scene back after window"};
+    renderScene(0, 0, 1.0, noise, frame);
+    evicted.add(filter.check(&frame.fb));
+    ok = evicted.print(false) && ok;
+
+    printf("\ntrigger alone:   %s the returning scene (score %u)\n", triggerStores ? "would store" : "skips",
+           trigger.lastScore());
+
+    frame.fb.format = PIXFORMAT_JPEG;
+    DuplicateFilter::Result unhashed = filter.check(&frame.fb);
+    frame.fb.format = PIXFORMAT_RGB565;
+    filter.setMaxDistance(-1);
+    DuplicateFilter::Result disabled = filter.check(&frame.fb);
+    bool passThrough = !unhashed.hashed && !unhashed.duplicate && !disabled.hashed && !disabled.duplicate;
+    printf("pass-through:    %s\n", passThrough ? "JPEG frames and a disabled filter admitted" : "MISMATCH");
+    ok = ok && passThrough;
+
+    // Hash plus a lookup against a full window
+    filter.setMaxDistance(0);
+    const int timed = 200;
+    unsigned long start = micros();
+    for (int i = 0; i < timed; i++)
+    {
+        filter.check(&frame.fb);
+    }
+    printf("hash + lookup:   %.1f us per %dx%d frame\n", static_cast<double>(micros() - start) / timed, WIDTH, HEIGHT);
+
+    printf("dedup:           %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "display_manager.h"
+#include "framebuffer_display_backend.h"
+#include "host_commands.h"
+
+// Same layout as MenuHandler::drawDefaultScreen: a fixed header and icon with
+// a clock line that changes every second
+static void drawStatusScreen(DisplayBackend &canvas, int seconds, bool capturing)
+{
+    static uint8_t icon[64 * 64 / 8];
+    for (size_t i = 0; i < sizeof(icon); i++)
+    {
+        icon[i] = static_cast<uint8_t>(i * 37);
+    }
+    char clock[24];
+    snprintf(clock, sizeof(clock), "2025-01-01 12:%02d:%02d", seconds / 60 % 60, seconds % 60);
+
+    canvas.drawXBM(64, 0, 64, 64, icon);
+    canvas.drawStr(0, 6, "MiddleFox v1.0.0");
+    canvas.drawStr(0, 12, "b:20250101");
+    canvas.drawStr(0, 18, clock);
+    canvas.drawStr(0, 24, "BLE:");
+    canvas.drawStr(20, 24, "Connected");
+    canvas.drawStr(0, 32, "Mode:");
+    canvas.drawStr(20, 32, capturing ? "Capturing" : "Ready");
+    canvas.drawStr(0, 63, "Long press for menu");
+}
+
+static void drawMenuScreen(DisplayBackend &canvas, int position)
+{
+    static const char *const items[] = {"Start Preview", "Start Capturing", "Start Inferring", "Sync Time (WiFi)", "Back"};
+    canvas.drawStr(0, 6, "Menu");
+    for (int i = 0; i < 5; i++)
+    {
+        if (i == position)
+        {
+            canvas.drawStr(0, 20 + i * 10, ">");
+        }
+        canvas.drawStr(8, 20 + i * 10, items[i]);
+    }
+    canvas.drawStr(0, 63, "Click: Next  Long: Select");
+}
+
+// Replays a session of the status screen with a few menu visits, running the
+// UI loop at the 20 ms main task cadence, and compares the I2C traffic with
+// the previous scheme of sending the whole buffer on every loop.
+int runDisplay(int argc, char **argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 10;
+    const unsigned long LOOP_MS = 20;
+
+    DisplayManager &display = DisplayManager::getInstance();
+    FramebufferDisplayBackend &panel = FramebufferDisplayBackend::getInstance();
+    if (!display.begin())
+    {
+        fprintf(stderr, "display failed to start\n");
+        return 1;
+    }
+    delay(100);
+    panel.resetBus();
+    DisplayManager::Stats before = display.getStats();
+
+    unsigned long loops = 0;
+    unsigned long redraws = 0;
+    int lastSecond = -1;
+    int lastMenuState = -2;
+    unsigned long start = millis();
+    while (millis() - start < static_cast<unsigned long>(seconds) * 1000)
+    {
+        int second = (millis() - start) / 1000;
+        // Menu open for the first half of every fourth second, cursor moving
+        int elapsed = millis() - start;
+        int menuState = second % 4 == 3 && elapsed % 1000 < 500 ? (elapsed % 1000) / 100 : -1;
+
+        if (second != lastSecond || menuState != lastMenuState)
+        {
+            display.compose([&](DisplayBackend &canvas)
+                            {
+                if (menuState >= 0)
+                {
+                    drawMenuScreen(canvas, menuState % 5);
+                }
+                else
+                {
+                    drawStatusScreen(canvas, second, second >= seconds / 2);
+                } });
+            redraws++;
+            lastSecond = second;
+            lastMenuState = menuState;
+        }
+        loops++;
+        delay(LOOP_MS);
+    }
+    unsigned long elapsedMs = millis() - start;
+    delay(DisplayManager::MIN_FRAME_INTERVAL_MS * 5);
+
+    DisplayManager::Stats stats = display.getStats();
+    uint32_t framesSent = stats.framesSent - before.framesSent;
+    uint32_t pagesSent = stats.pagesSent - before.pagesSent;
+    uint64_t sent = panel.busBytes();
+    // Old firmware: mainTask refreshed every loop and each redraw sent again
+    uint64_t previous = static_cast<uint64_t>(loops + redraws) * FramebufferDisplayBackend::BUFFER_SIZE;
+    bool matches = memcmp(panel.panel(), panel.buffer(), FramebufferDisplayBackend::BUFFER_SIZE) == 0;
+    bool accounted = sent == stats.bytesSent - before.bytesSent;
+
+    printf("ui loops:      %lu over %lu ms, %lu redraws\n", loops, elapsedMs, redraws);
+    printf("frames sent:   %u (%u unchanged), %u pages, %.1f pages/frame\n", framesSent,
+           stats.framesUnchanged - before.framesUnchanged, pagesSent,
+           framesSent ? static_cast<double>(pagesSent) / framesSent : 0.0);
+    printf("bus bytes:     %llu (%.0f B/s, last window %u B/s)\n", static_cast<unsigned long long>(sent),
+           elapsedMs ? sent * 1000.0 / elapsedMs : 0.0, stats.bytesPerSecond);
+    printf("full refresh:  %llu (%.0f B/s)\n", static_cast<unsigned long long>(previous),
+           elapsedMs ? previous * 1000.0 / elapsedMs : 0.0);
+    printf("saved:         %.1f%%\n", previous ? 100.0 * (previous - sent) / previous : 0.0);
+    printf("panel:         %s\n", matches ? "ok" : "MISMATCH");
+    printf("accounting:    %s\n", accounted ? "ok" : "MISMATCH");
+    return matches && accounted ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "framebuffer_display_backend.h"
+
+#include <string.h>
+
+FramebufferDisplayBackend &FramebufferDisplayBackend::getInstance()
+{
+    static FramebufferDisplayBackend instance;
+    return instance;
+}
+
+DisplayBackend &defaultDisplayBackend()
+{
+    return FramebufferDisplayBackend::getInstance();
+}
+
+bool FramebufferDisplayBackend::begin()
+{
+    clearBuffer();
+    return true;
+}
+
+void FramebufferDisplayBackend::clearBuffer()
+{
+    memset(framebuffer, 0, sizeof(framebuffer));
+}
+
+void FramebufferDisplayBackend::sendBuffer()
+{
+    memcpy(gram, framebuffer, sizeof(gram));
+    flushes++;
+    pages += HEIGHT / 8;
+    bytes += BUFFER_SIZE;
+}
+
+void FramebufferDisplayBackend::sendPage(uint8_t page, const uint8_t *data)
+{
+    if (page >= HEIGHT / 8)
+    {
+        return;
+    }
+    memcpy(gram + page * WIDTH, data, WIDTH);
+    pages++;
+    bytes += WIDTH;
+}
+
+void FramebufferDisplayBackend::resetBus()
+{
+    flushes = 0;
+    pages = 0;
+    bytes = 0;
+}
+
+void FramebufferDisplayBackend::setPixel(int x, int y, bool on)
+{
+    if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT)
+    {
+        return;
+    }
+    uint8_t mask = 1 << (y & 7);
+    uint8_t &cell = framebuffer[(y / 8) * WIDTH + x];
+    cell = on ? (cell | mask) : (cell & ~mask);
+}
+
+bool FramebufferDisplayBackend::getPixel(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT)
+    {
+        return false;
+    }
+    return framebuffer[(y / 8) * WIDTH + x] & (1 << (y & 7));
+}
+
+void FramebufferDisplayBackend::drawStr(int x, int y, const char *text)
+{
+    if (!text)
+    {
+        return;
+    }
+    for (; *text; text++, x += 4)
+    {
+        uint16_t pattern = static_cast<uint16_t>((static_cast<uint8_t>(*text) * 0x9E37u) >> 1) & 0x7FFF;
+        for (int bit = 0; bit < 15; bit++)
+        {
+            if (pattern & (1 << bit))
+            {
+                setPixel(x + bit % 3, y + bit / 3, true);
+            }
+        }
+    }
+}
+
+void FramebufferDisplayBackend::drawXBM(int x, int y, int width, int height, const uint8_t *bitmap)
+{
+    if (!bitmap)
+    {
+        return;
+    }
+    int bytesPerRow = (width + 7) / 8;
+    for (int row = 0; row < height; row++)
+    {
+        for (int col = 0; col < width; col++)
+        {
+            bool on = bitmap[row * bytesPerRow + col / 8] & (1 << (col & 7));
+            setPixel(x + col, y + row, on);
+        }
+    }
+}
+
+void FramebufferDisplayBackend::drawFrame(int x, int y, int width, int height)
+{
+    for (int i = 0; i < width; i++)
+    {
+        setPixel(x + i, y, true);
+        setPixel(x + i, y + height - 1, true);
+    }
+    for (int j = 0; j < height; j++)
+    {
+        setPixel(x, y + j, true);
+        setPixel(x + width - 1, y + j, true);
+    }
+}
+
+void FramebufferDisplayBackend::drawBox(int x, int y, int width, int height)
+{
+    for (int j = 0; j < height; j++)
+    {
+        for (int i = 0; i < width; i++)
+        {
+            setPixel(x + i, y + j, true);
+        }
+    }
+}
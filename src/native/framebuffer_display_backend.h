@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hal/display_backend.h"
+
+// In-memory 128x64 SSD1306 framebuffer in U8g2 page layout. There are no
+// fonts on the host, so each character is rendered as a 3x5 pattern derived
+// from its code: text changes still change pixels without claiming to look
+// like the real font. Flushes go over a simulated bus into a copy of the
+// panel's display RAM, counting the bytes that would cross the I2C link.
+class FramebufferDisplayBackend : public DisplayBackend
+{
+public:
+    static const uint16_t WIDTH = 128;
+    static const uint16_t HEIGHT = 64;
+    static const size_t BUFFER_SIZE = WIDTH * HEIGHT / 8;
+
+    static FramebufferDisplayBackend &getInstance();
+
+    bool begin() override;
+    void clearBuffer() override;
+    void sendBuffer() override;
+    void sendPage(uint8_t page, const uint8_t *data) override;
+
+    void drawStr(int x, int y, const char *text) override;
+    void drawXBM(int x, int y, int width, int height, const uint8_t *bitmap) override;
+    void drawFrame(int x, int y, int width, int height) override;
+    void drawBox(int x, int y, int width, int height) override;
+    void setFont(const uint8_t *font) override { (void)font; }
+
+    int cursorX() const override { return 0; }
+    int cursorY() const override { return 0; }
+    uint16_t width() const override { return WIDTH; }
+    uint16_t height() const override { return HEIGHT; }
+    uint8_t *buffer() override { return framebuffer; }
+
+    bool getPixel(int x, int y) const;
+    unsigned long flushCount() const { return flushes; }
+    unsigned long pageWrites() const { return pages; }
+    uint64_t busBytes() const { return bytes; }
+    // What the panel shows, as last sent over the bus
+    const uint8_t *panel() const { return gram; }
+    void resetBus();
+
+private:
+    FramebufferDisplayBackend() {}
+    uint8_t framebuffer[BUFFER_SIZE] = {};
+    uint8_t gram[BUFFER_SIZE] = {};
+    unsigned long flushes = 0;
+    unsigned long pages = 0;
+    uint64_t bytes = 0;
+
+    void setPixel(int x, int y, bool on);
+};
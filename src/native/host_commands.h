@@ -0,0 +1,67 @@
+#pragma once
+
+// Subcommands of the native host program (see host_main.cpp). Each takes the
+// arguments following its name and returns the process exit code. Checks of
+// single modules against a reference are Unity suites in test/ instead.
+
+// extract <session> [out_dir]: unpack a packed capture session into loose files
+int runExtract(int argc, char **argv);
+
+// buzzer: queue every buzzer pattern, check caller latency and the rendered timeline
+int runBuzzer(int argc, char **argv);
+
+// alerts [rounds]: preempt lower patterns with lane alerts, print latency histograms
+int runAlerts(int argc, char **argv);
+
+// display [seconds]: drive the compositor with a status/menu session, compare bus traffic
+int runDisplay(int argc, char **argv);
+
+// commands [count]: post from BLE and menu producers at once, check nothing is lost or reordered and where settings apply
+int runCommands(int argc, char **argv);
+
+// modes [cycles]: switch capture/preview/idle in place, check frames resume and switch times
+int runModes(int argc, char **argv);
+
+// profiles [rounds] [camera_fps]: cycle camera profiles, check delta vs restart and first valid frame
+int runProfiles(int argc, char **argv);
+
+// replay <source> [fps] [frames]: serve recorded frames through CameraManager, check content and pacing
+int runReplay(int argc, char **argv);
+
+// storage [frames] [sync_ms]: write a session-shaped stream four ways, compare caller cost, check content and short writes
+int runStorage(int argc, char **argv);
+
+// jpeg [frames] [quality]: compare the streaming encoder with frame2jpg for time, size and decoded PSNR
+int runJpeg(int argc, char **argv);
+
+// parallel_jpeg [frames] [quality] [max_workers]: encode restart-interval stripes on 1..N workers, print the speed-up
+int runParallelJpeg(int argc, char **argv);
+
+// rgbz [frames]: losslessly compress dataset frames, print ratio and MB/s
+// rgbz unpack <file.rgbz>...: convert extracted frames back to .rgb
+int runRgbz(int argc, char **argv);
+
+// trigger [min_ms] [max_ms] [threshold]: simulate a trip, compare adaptive capture with a fixed interval
+int runTrigger(int argc, char **argv);
+
+// dedup [distance]: feed the duplicate filter known near-duplicates and distinct scenes, check and time it
+int runDedup(int argc, char **argv);
+
+// inference [frames] [model.tflite]: run inference mode on a generated int8 model, check it against float
+int runInference(int argc, char **argv);
+
+// preprocess [repeats]: time the fused frame-to-tensor kernel against the multi-pass reference
+int runPreprocess(int argc, char **argv);
+
+// lanes [frames]: benchmark the classical lane detector on rendered roads, then run the no-model fallback
+int runLanes(int argc, char **argv);
+
+// track [frames]: replay a drive and compare the lane tracker at several intervals with detecting every frame
+int runTrack(int argc, char **argv);
+
+// ipm [layouts]: time building, loading and warping through the bird's-eye remap table
+int runIpm(int argc, char **argv);
+
+// calibrate [frames]: estimate the vanishing point of rendered mounts, check it, the record and the cropped detector
+// calibrate <source>: estimate the mount from recorded frames or a session and save the calibration
+int runCalibrate(int argc, char **argv);
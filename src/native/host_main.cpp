@@ -0,0 +1,274 @@
+// Entry point for the [env:native] build. Runs the firmware modules on the
+// host against the fakes in src/native so capture, storage and BLE flows can
+// be exercised and measured without hardware.
+//
+//   .pio/build/native/program collect [frames] [camera_fps]
+//   .pio/build/native/program extract <session> [out_dir]
+//   .pio/build/native/program buzzer
+//   .pio/build/native/program alerts [rounds]
+//   .pio/build/native/program display [seconds]
+//   .pio/build/native/program commands [count]
+//   .pio/build/native/program modes [cycles]
+//   .pio/build/native/program profiles [rounds] [camera_fps]
+//   .pio/build/native/program replay <source> [fps] [frames]
+//   .pio/build/native/program storage [frames] [sync_ms]
+//   .pio/build/native/program jpeg [frames] [quality]
+//   .pio/build/native/program parallel_jpeg [frames] [quality] [max_workers]
+//   .pio/build/native/program rgbz [frames] | rgbz unpack <file.rgbz>...
+//   .pio/build/native/program trigger [min_ms] [max_ms] [threshold]
+//   .pio/build/native/program dedup [distance]
+//   .pio/build/native/program inference [frames] [model.tflite]
+//   .pio/build/native/program preprocess [repeats]
+//   .pio/build/native/program lanes [frames]
+//   .pio/build/native/program track [frames]
+//   .pio/build/native/program ipm [layouts]
+//   .pio/build/native/program calibrate [frames | source]
+//
+// Environment: MIDDLEFOX_SD_ROOT (default ./sdcard), MIDDLEFOX_REPLAY_DIR,
+// MIDDLEFOX_CAMERA_FPS (simulated sensor rate, 0 = unpaced),
+// MIDDLEFOX_REPLAY_SOURCE (collect from recorded frames under the SD root).
+//
+// `pio test -e native` builds the same sources into the Unity suites under
+// test/, which bring their own main().
+
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "alert_scheduler.h"
+#include "ble_service.h"
+#include "buzzer_manager.h"
+#include "data_collector.h"
+#include "display_manager.h"
+#include "sd_manager.h"
+#include "host_commands.h"
+#include "loopback_ble_transport.h"
+#include "mode_controller.h"
+#include "file_camera_backend.h"
+#include "mock_buzzer_backend.h"
+#include "replay_camera_backend.h"
+
+static const char *TAG = "HostMain";
+
+static int runCollect(int frames, int cameraFps)
+{
+    if (cameraFps >= 0)
+    {
+        ReplayCameraBackend::getInstance().setFrameRate(cameraFps);
+        FileCameraBackend::getInstance().setFrameRate(cameraFps);
+    }
+    const char *replaySource = getenv("MIDDLEFOX_REPLAY_SOURCE");
+    if (replaySource)
+    {
+        FileCameraBackend::getInstance().setSource(replaySource);
+        CameraManager::getInstance().setBackend(&FileCameraBackend::getInstance());
+    }
+
+    if (!SDManager::getInstance().begin())
+    {
+        ESP_LOGE(TAG, "Host storage unavailable");
+        return 1;
+    }
+    BuzzerManager::getInstance().begin(BUZZER_PIN);
+    AlertScheduler::getInstance().begin();
+    DisplayManager::getInstance().begin();
+
+    LoopbackBleTransport &link = LoopbackBleTransport::getInstance();
+    CustomBLEService ble(link);
+    if (!ble.begin())
+    {
+        ESP_LOGE(TAG, "BLE service failed to start");
+        return 1;
+    }
+
+    DataCollector collector(&ble);
+    ModeController &controller = ModeController::getInstance();
+    controller.begin(ble);
+    link.connect();
+    link.write(std::string(1, static_cast<char>(CustomBLEService::START_DATA_COLLECTION)));
+
+    // Same cadence as TaskManager::mainTask; the pipeline runs in its own tasks
+    unsigned long start = millis();
+    while (collector.getPipelineStats().stages[CapturePipeline::STORE].processed < static_cast<uint32_t>(frames))
+    {
+        collector.loop();
+        ble.loop();
+        delay(20);
+    }
+    unsigned long elapsed = millis() - start;
+    CapturePipeline::Stats stats = collector.getPipelineStats();
+
+    link.write(std::string(1, static_cast<char>(CustomBLEService::STOP_DATA_COLLECTION)));
+    controller.drain(5000);
+
+    CaptureManifest &manifest = CaptureManifest::getInstance();
+    printf("manifest:      next frame %u, next session %u (loaded in %lu ms%s)\n",
+           static_cast<unsigned>(manifest.nextFrame()), static_cast<unsigned>(manifest.nextSession()),
+           manifest.loadTimeMs(), manifest.wasRebuilt() ? ", rebuilt by scan" : "");
+    uint32_t stored = stats.stages[CapturePipeline::STORE].processed;
+    printf("session:       %u (%llu bytes)\n", static_cast<unsigned>(stats.sessionId),
+           static_cast<unsigned long long>(stats.storedBytes));
+    printf("frames stored: %u\n", stored);
+    printf("raw frames:    %llu bytes packed to %llu (%.2fx)\n", static_cast<unsigned long long>(stats.rawBytes),
+           static_cast<unsigned long long>(stats.rawPacked),
+           stats.rawPacked ? static_cast<double>(stats.rawBytes) / stats.rawPacked : 0.0);
+    printf("trigger:       %u probes, %u skipped, %u on change, %u on max interval\n", stats.trigger.probes,
+           stats.trigger.skipped, stats.trigger.changeStores, stats.trigger.maxIntervalStores);
+    printf("duplicates:    %u hashed, %u rejected, %.1f us per hash\n", stats.dedup.checked, stats.dedup.rejected,
+           stats.dedup.checked ? static_cast<double>(stats.dedup.hashUs) / stats.dedup.checked : 0.0);
+    printf("elapsed:       %lu ms\n", elapsed);
+    printf("fps:           %.2f\n", elapsed ? stored * 1000.0 / elapsed : 0.0);
+    printf("\n%-8s %9s %6s %6s %9s %7s\n", "stage", "processed", "errors", "stalls", "max depth", "avg ms");
+    for (int i = 0; i < CapturePipeline::STAGE_COUNT; i++)
+    {
+        const CapturePipeline::StageStats &stage = stats.stages[i];
+        printf("%-8s %9u %6u %6u %9u %7.1f\n",
+               CapturePipeline::stageName(static_cast<CapturePipeline::Stage>(i)),
+               stage.processed, stage.errors, stage.stalls, stage.maxQueueDepth,
+               stage.processed ? static_cast<double>(stage.busyMs) / stage.processed : 0.0);
+    }
+    FramePool::Stats pool = CameraManager::getInstance().getPoolStats();
+    printf("\nframe pool:    %u/%u in use, peak %u, %u acquired, %u exhausted, %u alloc failures, %zu KB\n",
+           pool.inUse, pool.capacity, pool.peakInUse, pool.acquired, pool.exhausted,
+           pool.allocFailures, pool.allocatedBytes / 1024);
+    printf("\nnotifications: %zu\n", link.notificationCount());
+    printf("buzzer events: %zu\n", MockBuzzerBackend::getInstance().timeline().size());
+    return 0;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s collect [frames] [camera_fps]\n", argv0);
+    fprintf(stderr, "       %s extract <session> [out_dir]\n", argv0);
+    fprintf(stderr, "       %s buzzer\n", argv0);
+    fprintf(stderr, "       %s alerts [rounds]\n", argv0);
+    fprintf(stderr, "       %s display [seconds]\n", argv0);
+    fprintf(stderr, "       %s commands [count]\n", argv0);
+    fprintf(stderr, "       %s modes [cycles]\n", argv0);
+    fprintf(stderr, "       %s profiles [rounds] [camera_fps]\n", argv0);
+    fprintf(stderr, "       %s replay <source> [fps] [frames]\n", argv0);
+    fprintf(stderr, "       %s storage [frames] [sync_ms]\n", argv0);
+    fprintf(stderr, "       %s jpeg [frames] [quality]\n", argv0);
+    fprintf(stderr, "       %s parallel_jpeg [frames] [quality] [max_workers]\n", argv0);
+    fprintf(stderr, "       %s rgbz [frames] | rgbz unpack <file.rgbz>...\n", argv0);
+    fprintf(stderr, "       %s trigger [min_ms] [max_ms] [threshold]\n", argv0);
+    fprintf(stderr, "       %s dedup [distance]\n", argv0);
+    fprintf(stderr, "       %s inference [frames] [model.tflite]\n", argv0);
+    fprintf(stderr, "       %s preprocess [rounds]\n", argv0);
+    fprintf(stderr, "       %s lanes [frames]\n", argv0);
+    fprintf(stderr, "       %s track [frames]\n", argv0);
+    fprintf(stderr, "       %s ipm [layouts]\n", argv0);
+    fprintf(stderr, "       %s calibrate [frames | source]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *command = argc > 1 ? argv[1] : "collect";
+
+    if (strcmp(command, "collect") == 0)
+    {
+        return runCollect(argc > 2 ? atoi(argv[2]) : 10, argc > 3 ? atoi(argv[3]) : -1);
+    }
+
+    if (strcmp(command, "extract") == 0)
+    {
+        return runExtract(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "buzzer") == 0)
+    {
+        return runBuzzer(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "alerts") == 0)
+    {
+        return runAlerts(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "display") == 0)
+    {
+        return runDisplay(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "commands") == 0)
+    {
+        return runCommands(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "modes") == 0)
+    {
+        return runModes(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "profiles") == 0)
+    {
+        return runProfiles(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "replay") == 0)
+    {
+        return runReplay(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "storage") == 0)
+    {
+        return runStorage(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "jpeg") == 0)
+    {
+        return runJpeg(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "parallel_jpeg") == 0)
+    {
+        return runParallelJpeg(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "rgbz") == 0)
+    {
+        return runRgbz(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "trigger") == 0)
+    {
+        return runTrigger(argc - 2, argv + 2);
+    }
+
+    if (strcmp(command, "dedup") == 0)
+    {
+        return runDedup(argc - 2, argv + 2);
+    }
+    if (strcmp(command, "inference") == 0)
+    {
+        return runInference(argc - 2, argv + 2);
+    }
+    if (strcmp(command, "preprocess") == 0)
+    {
+        return runPreprocess(argc - 2, argv + 2);
+    }
+    if (strcmp(command, "lanes") == 0)
+    {
+        return runLanes(argc - 2, argv + 2);
+    }
+    if (strcmp(command, "track") == 0)
+    {
+        return runTrack(argc - 2, argv + 2);
+    }
+    if (strcmp(command, "ipm") == 0)
+    {
+        return runIpm(argc - 2, argv + 2);
+    }
+    if (strcmp(command, "calibrate") == 0)
+    {
+        return runCalibrate(argc - 2, argv + 2);
+    }
+
+    usage(argv[0]);
+    return 2;
+}
+
+#endif // PIO_UNIT_TESTING
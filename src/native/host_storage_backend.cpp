@@ -0,0 +1,82 @@
+#include "host_storage_backend.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+const char *HostStorageBackend::TAG = "HostStorage";
+
+HostStorageBackend &HostStorageBackend::getInstance()
+{
+    static HostStorageBackend instance;
+    return instance;
+}
+
+StorageBackend &defaultStorageBackend()
+{
+    return HostStorageBackend::getInstance();
+}
+
+HostStorageBackend::HostStorageBackend()
+{
+    const char *dir = getenv("MIDDLEFOX_SD_ROOT");
+    root = dir ? dir : "sdcard";
+}
+
+bool HostStorageBackend::mount()
+{
+    struct stat st;
+    if (stat(root.c_str(), &st) != 0 && ::mkdir(root.c_str(), 0755) != 0)
+    {
+        ESP_LOGE(TAG, "Cannot create card root %s", root.c_str());
+        return false;
+    }
+    mounted = true;
+    ESP_LOGI(TAG, "Card root mounted at %s", root.c_str());
+    return true;
+}
+
+void HostStorageBackend::unmount()
+{
+    mounted = false;
+}
+
+std::string HostStorageBackend::hostPath(const char *path) const
+{
+    std::string result = root;
+    if (path && path[0] != '/')
+    {
+        result += '/';
+    }
+    if (path)
+    {
+        result += path;
+    }
+    return result;
+}
+
+File HostStorageBackend::open(const char *path, const char *mode)
+{
+    if (!mounted)
+    {
+        return File();
+    }
+    return File::openHost(hostPath(path), path ? path : "/", mode);
+}
+
+bool HostStorageBackend::exists(const char *path)
+{
+    struct stat st;
+    return mounted && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool HostStorageBackend::remove(const char *path)
+{
+    return mounted && ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool HostStorageBackend::mkdir(const char *path)
+{
+    return mounted && ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
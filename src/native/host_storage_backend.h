@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include "hal/storage_backend.h"
+
+// Maps the SD card root onto a host directory (MIDDLEFOX_SD_ROOT, default
+// ./sdcard) so captures land in plain files that can be inspected directly.
+class HostStorageBackend : public StorageBackend
+{
+public:
+    static HostStorageBackend &getInstance();
+
+    bool mount() override;
+    void unmount() override;
+    File open(const char *path, const char *mode) override;
+    bool exists(const char *path) override;
+    bool remove(const char *path) override;
+    bool mkdir(const char *path) override;
+
+    void setRoot(const std::string &dir) { root = dir; }
+    const std::string &getRoot() const { return root; }
+
+private:
+    HostStorageBackend();
+    static const char *TAG;
+    std::string root;
+    bool mounted = false;
+
+    std::string hostPath(const char *path) const;
+};
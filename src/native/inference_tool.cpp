@@ -0,0 +1,977 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ble_service.h"
+#include "camera_manager.h"
+#include "crc32.h"
+#include "host_commands.h"
+#include "loopback_ble_transport.h"
+#include "mode_controller.h"
+#include "model_inference.h"
+#include "sd_manager.h"
+
+namespace
+{
+    // Forward-only FlatBuffer writer for the TFLite schema: every object is
+    // appended after the one that references it, and the reference is
+    // patched once the target's position is known.
+    class FlatWriter
+    {
+    public:
+        struct Field
+        {
+            int index;
+            int size; // 1 or 4 bytes; 0 for a reference, patched with link()
+            int64_t value;
+        };
+
+        struct Table
+        {
+            size_t pos;
+            size_t refs[8]; // position of each reference field, by index
+        };
+
+        std::vector<uint8_t> bytes;
+
+        FlatWriter()
+        {
+            put<uint32_t>(0); // root offset
+            for (char c : {'T', 'F', 'L', '3'})
+            {
+                bytes.push_back(c);
+            }
+        }
+
+        template <typename T>
+        size_t put(T value)
+        {
+            size_t pos = bytes.size();
+            bytes.resize(pos + sizeof(T));
+            memcpy(&bytes[pos], &value, sizeof(T));
+            return pos;
+        }
+
+        void align(size_t alignment)
+        {
+            while (bytes.size() % alignment)
+            {
+                bytes.push_back(0);
+            }
+        }
+
+        void link(size_t from, size_t to)
+        {
+            uint32_t offset = to - from;
+            memcpy(&bytes[from], &offset, 4);
+        }
+
+        Table table(std::initializer_list<Field> fields)
+        {
+            int slots = 0;
+            for (const Field &field : fields)
+            {
+                slots = std::max(slots, field.index + 1);
+            }
+            align(2);
+            size_t vtable = put<uint16_t>(4 + 2 * slots);
+            put<uint16_t>(0);
+            for (int i = 0; i < slots; i++)
+            {
+                put<uint16_t>(0);
+            }
+            align(4);
+            Table result = {bytes.size(), {}};
+            put<int32_t>(result.pos - vtable);
+            for (const Field &field : fields)
+            {
+                size_t pos;
+                if (field.size == 1)
+                {
+                    pos = put<int8_t>(field.value);
+                }
+                else
+                {
+                    align(4);
+                    pos = put<int32_t>(field.size ? field.value : 0);
+                }
+                uint16_t offset = pos - result.pos;
+                memcpy(&bytes[vtable + 4 + 2 * field.index], &offset, 2);
+                if (!field.size)
+                {
+                    result.refs[field.index] = pos;
+                }
+            }
+            uint16_t tableSize = bytes.size() - result.pos;
+            memcpy(&bytes[vtable + 2], &tableSize, 2);
+            return result;
+        }
+
+        template <typename T>
+        size_t vector(const std::vector<T> &values, size_t alignment = sizeof(T))
+        {
+            alignment = std::max<size_t>(alignment, 4);
+            while ((bytes.size() + 4) % alignment)
+            {
+                bytes.push_back(0);
+            }
+            size_t pos = put<uint32_t>(values.size());
+            for (const T &value : values)
+            {
+                put<T>(value);
+            }
+            return pos;
+        }
+
+        // Vector of tables: slots patched with link(slot(vector, i), table)
+        size_t tableVector(size_t count)
+        {
+            align(4);
+            size_t pos = put<uint32_t>(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                put<uint32_t>(0);
+            }
+            return pos;
+        }
+
+        static size_t slot(size_t vector, size_t i) { return vector + 4 + 4 * i; }
+    };
+
+    // TFLite schema values used by the test model
+    const int TYPE_INT32 = 2;
+    const int TYPE_INT8 = 9;
+    const int OP_AVERAGE_POOL_2D = 1;
+    const int OP_CONV_2D = 3;
+    const int OP_DEPTHWISE_CONV_2D = 4;
+    const int OP_FULLY_CONNECTED = 9;
+    const int OP_LOGISTIC = 14;
+    const int OP_MAX_POOL_2D = 17;
+    const int OP_RESHAPE = 22;
+    const int OPTIONS_CONV = 1, OPTIONS_DEPTHWISE = 2, OPTIONS_POOL = 5, OPTIONS_FULLY_CONNECTED = 8,
+              OPTIONS_RESHAPE = 17;
+    const int PADDING_SAME = 0, PADDING_VALID = 1;
+    const int ACT_NONE = 0, ACT_RELU = 1, ACT_RELU6 = 3;
+
+    struct TensorSpec
+    {
+        std::vector<int32_t> shape;
+        int type;
+        int buffer; // 0: activation
+        std::vector<float> scales;
+        std::vector<int64_t> zeroPoints;
+        int quantizedDimension;
+    };
+
+    struct OpSpec
+    {
+        int code;
+        std::vector<int32_t> inputs;
+        int output;
+        int optionsType;
+        std::vector<FlatWriter::Field> options;
+        std::vector<int32_t> newShape; // reshape
+    };
+
+    std::vector<uint8_t> writeModel(const std::vector<TensorSpec> &tensors, const std::vector<OpSpec> &ops,
+                                    const std::vector<std::vector<uint8_t>> &buffers, int input, int output)
+    {
+        std::vector<int> codes;
+        for (const OpSpec &op : ops)
+        {
+            if (std::find(codes.begin(), codes.end(), op.code) == codes.end())
+            {
+                codes.push_back(op.code);
+            }
+        }
+
+        FlatWriter w;
+        FlatWriter::Table model = w.table({{0, 4, 3}, {1, 0, 0}, {2, 0, 0}, {4, 0, 0}});
+        w.link(0, model.pos);
+
+        size_t codeVector = w.tableVector(codes.size());
+        w.link(model.refs[1], codeVector);
+        for (size_t i = 0; i < codes.size(); i++)
+        {
+            FlatWriter::Table code = w.table({{0, 1, std::min(codes[i], 127)}, {2, 4, 1}, {3, 4, codes[i]}});
+            w.link(FlatWriter::slot(codeVector, i), code.pos);
+        }
+
+        size_t graphVector = w.tableVector(1);
+        w.link(model.refs[2], graphVector);
+        FlatWriter::Table graph = w.table({{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {3, 0, 0}});
+        w.link(FlatWriter::slot(graphVector, 0), graph.pos);
+
+        size_t tensorVector = w.tableVector(tensors.size());
+        w.link(graph.refs[0], tensorVector);
+        for (size_t i = 0; i < tensors.size(); i++)
+        {
+            const TensorSpec &spec = tensors[i];
+            FlatWriter::Table tensor = w.table({{0, 0, 0}, {1, 1, spec.type}, {2, 4, spec.buffer}, {4, 0, 0}});
+            w.link(FlatWriter::slot(tensorVector, i), tensor.pos);
+            w.link(tensor.refs[0], w.vector(spec.shape));
+            FlatWriter::Table quantization = w.table({{2, 0, 0}, {3, 0, 0}, {6, 4, spec.quantizedDimension}});
+            w.link(tensor.refs[4], quantization.pos);
+            w.link(quantization.refs[2], w.vector(spec.scales));
+            w.link(quantization.refs[3], w.vector(spec.zeroPoints));
+        }
+        w.link(graph.refs[1], w.vector(std::vector<int32_t>{input}));
+        w.link(graph.refs[2], w.vector(std::vector<int32_t>{output}));
+
+        size_t opVector = w.tableVector(ops.size());
+        w.link(graph.refs[3], opVector);
+        for (size_t i = 0; i < ops.size(); i++)
+        {
+            const OpSpec &spec = ops[i];
+            int codeIndex = std::find(codes.begin(), codes.end(), spec.code) - codes.begin();
+            FlatWriter::Table op = w.table({{0, 4, codeIndex}, {1, 0, 0}, {2, 0, 0}, {3, 1, spec.optionsType}, {4, 0, 0}});
+            w.link(FlatWriter::slot(opVector, i), op.pos);
+            w.link(op.refs[1], w.vector(spec.inputs));
+            w.link(op.refs[2], w.vector(std::vector<int32_t>{spec.output}));
+            if (spec.code == OP_RESHAPE)
+            {
+                FlatWriter::Table options = w.table({{0, 0, 0}});
+                w.link(op.refs[4], options.pos);
+                w.link(options.refs[0], w.vector(spec.newShape));
+            }
+            else if (!spec.options.empty())
+            {
+                // Fields are given as {index, size, value}
+                std::vector<FlatWriter::Field> fields = spec.options;
+                FlatWriter::Table options = {0, {}};
+                switch (fields.size())
+                {
+                case 1:
+                    options = w.table({fields[0]});
+                    break;
+                case 4:
+                    options = w.table({fields[0], fields[1], fields[2], fields[3]});
+                    break;
+                case 5:
+                    options = w.table({fields[0], fields[1], fields[2], fields[3], fields[4]});
+                    break;
+                default:
+                    options = w.table({fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]});
+                    break;
+                }
+                w.link(op.refs[4], options.pos);
+            }
+        }
+
+        size_t bufferVector = w.tableVector(buffers.size());
+        w.link(model.refs[4], bufferVector);
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            if (buffers[i].empty())
+            {
+                w.link(FlatWriter::slot(bufferVector, i), w.table({}).pos);
+                continue;
+            }
+            FlatWriter::Table buffer = w.table({{0, 0, 0}});
+            w.link(FlatWriter::slot(bufferVector, i), buffer.pos);
+            // TFLM reads biases in place: keep data 16-byte aligned
+            w.link(buffer.refs[0], w.vector(buffers[i], 16));
+        }
+        return w.bytes;
+    }
+
+    // The test network, in float: a lane-model-shaped stack covering every
+    // supported operator
+    enum LayerType
+    {
+        CONV,
+        DEPTHWISE,
+        MAX_POOL,
+        AVERAGE_POOL,
+        RESHAPE,
+        FULLY_CONNECTED
+    };
+
+    struct Shape
+    {
+        int h, w, c;
+        int size() const { return h * w * c; }
+    };
+
+    struct Quant
+    {
+        float scale;
+        int zeroPoint;
+        float dequantize(int8_t q) const { return scale * (q - zeroPoint); }
+    };
+
+    struct Layer
+    {
+        LayerType type;
+        int kernel;
+        int stride;
+        bool same;
+        int outC;
+        int activation;
+        // Filled in by buildNetwork() and calibration
+        std::vector<float> weights = {}; // conv [oc][k][k][ic], depthwise [k][k][c], fc [out][in]
+        std::vector<float> bias = {};
+        Shape in = {}, out = {};
+        float low = 0, high = 0; // calibrated output range
+        Quant output = {};
+    };
+
+    const Shape INPUT_SHAPE = {48, 64, 1};
+    const Quant INPUT_QUANT = {1.0f / 255, -128};
+
+    int outSize(bool same, int in, int kernel, int stride)
+    {
+        return same ? (in + stride - 1) / stride : (in + stride - kernel) / stride;
+    }
+
+    int padding(int stride, int in, int kernel, int out)
+    {
+        int pad = ((out - 1) * stride + kernel - in) / 2;
+        return pad > 0 ? pad : 0;
+    }
+
+    std::vector<Layer> buildNetwork()
+    {
+        std::mt19937 random(2024);
+        std::vector<Layer> layers = {
+            {CONV, 3, 2, true, 8, ACT_RELU},
+            {DEPTHWISE, 3, 2, true, 8, ACT_RELU6},
+            {CONV, 1, 1, false, 16, ACT_RELU},
+            {MAX_POOL, 2, 2, false, 16, ACT_NONE},
+            {AVERAGE_POOL, 2, 2, false, 16, ACT_NONE},
+            {RESHAPE, 0, 0, false, 0, ACT_NONE},
+            {FULLY_CONNECTED, 0, 0, false, ModelInference::OUTPUT_VALUES, ACT_NONE},
+        };
+        Shape shape = INPUT_SHAPE;
+        for (Layer &layer : layers)
+        {
+            layer.in = shape;
+            int fanIn = 0;
+            switch (layer.type)
+            {
+            case CONV:
+                layer.out = {outSize(layer.same, shape.h, layer.kernel, layer.stride),
+                             outSize(layer.same, shape.w, layer.kernel, layer.stride), layer.outC};
+                fanIn = layer.kernel * layer.kernel * shape.c;
+                layer.weights.resize(layer.outC * fanIn);
+                break;
+            case DEPTHWISE:
+                layer.out = {outSize(layer.same, shape.h, layer.kernel, layer.stride),
+                             outSize(layer.same, shape.w, layer.kernel, layer.stride), shape.c};
+                fanIn = layer.kernel * layer.kernel;
+                layer.weights.resize(fanIn * shape.c);
+                break;
+            case MAX_POOL:
+            case AVERAGE_POOL:
+                layer.out = {outSize(layer.same, shape.h, layer.kernel, layer.stride),
+                             outSize(layer.same, shape.w, layer.kernel, layer.stride), shape.c};
+                break;
+            case RESHAPE:
+                layer.out = {1, 1, shape.size()};
+                break;
+            case FULLY_CONNECTED:
+                layer.out = {1, 1, layer.outC};
+                fanIn = shape.size();
+                layer.weights.resize(layer.outC * fanIn);
+                break;
+            }
+            if (fanIn)
+            {
+                std::uniform_real_distribution<float> weight(-sqrtf(6.0f / fanIn), sqrtf(6.0f / fanIn));
+                std::uniform_real_distribution<float> bias(-0.1f, 0.1f);
+                for (float &w : layer.weights)
+                {
+                    w = weight(random);
+                }
+                layer.bias.resize(layer.out.c);
+                for (float &b : layer.bias)
+                {
+                    b = bias(random);
+                }
+            }
+            shape = layer.out;
+        }
+        return layers;
+    }
+
+    float activate(int activation, float value)
+    {
+        if (activation == ACT_RELU || activation == ACT_RELU6)
+        {
+            value = std::max(value, 0.0f);
+        }
+        return activation == ACT_RELU6 ? std::min(value, 6.0f) : value;
+    }
+
+    // Float forward pass of one layer on HWC data
+    std::vector<float> forward(const Layer &layer, const std::vector<float> &in)
+    {
+        std::vector<float> out(layer.out.size());
+        const Shape &s = layer.in;
+        const Shape &o = layer.out;
+        int padH = padding(layer.stride, s.h, layer.kernel, o.h);
+        int padW = padding(layer.stride, s.w, layer.kernel, o.w);
+        switch (layer.type)
+        {
+        case CONV:
+        case DEPTHWISE:
+            for (int oy = 0; oy < o.h; oy++)
+            {
+                for (int ox = 0; ox < o.w; ox++)
+                {
+                    for (int oc = 0; oc < o.c; oc++)
+                    {
+                        float acc = layer.bias[oc];
+                        for (int ky = 0; ky < layer.kernel; ky++)
+                        {
+                            int iy = oy * layer.stride - padH + ky;
+                            for (int kx = 0; kx < layer.kernel; kx++)
+                            {
+                                int ix = ox * layer.stride - padW + kx;
+                                if (iy < 0 || iy >= s.h || ix < 0 || ix >= s.w)
+                                {
+                                    continue;
+                                }
+                                const float *pixel = &in[(iy * s.w + ix) * s.c];
+                                if (layer.type == DEPTHWISE)
+                                {
+                                    acc += pixel[oc] * layer.weights[(ky * layer.kernel + kx) * o.c + oc];
+                                    continue;
+                                }
+                                const float *w = &layer.weights[((oc * layer.kernel + ky) * layer.kernel + kx) * s.c];
+                                for (int ic = 0; ic < s.c; ic++)
+                                {
+                                    acc += pixel[ic] * w[ic];
+                                }
+                            }
+                        }
+                        out[(oy * o.w + ox) * o.c + oc] = activate(layer.activation, acc);
+                    }
+                }
+            }
+            break;
+        case MAX_POOL:
+        case AVERAGE_POOL:
+            for (int oy = 0; oy < o.h; oy++)
+            {
+                for (int ox = 0; ox < o.w; ox++)
+                {
+                    for (int c = 0; c < o.c; c++)
+                    {
+                        float acc = layer.type == MAX_POOL ? -1e30f : 0;
+                        int count = 0;
+                        for (int ky = 0; ky < layer.kernel; ky++)
+                        {
+                            for (int kx = 0; kx < layer.kernel; kx++)
+                            {
+                                int iy = oy * layer.stride - padH + ky;
+                                int ix = ox * layer.stride - padW + kx;
+                                if (iy < 0 || iy >= s.h || ix < 0 || ix >= s.w)
+                                {
+                                    continue;
+                                }
+                                float value = in[(iy * s.w + ix) * s.c + c];
+                                acc = layer.type == MAX_POOL ? std::max(acc, value) : acc + value;
+                                count++;
+                            }
+                        }
+                        out[(oy * o.w + ox) * o.c + c] = layer.type == MAX_POOL ? acc : acc / count;
+                    }
+                }
+            }
+            break;
+        case RESHAPE:
+            out = in;
+            break;
+        case FULLY_CONNECTED:
+            for (int u = 0; u < o.c; u++)
+            {
+                float acc = layer.bias[u];
+                for (int d = 0; d < s.size(); d++)
+                {
+                    acc += in[d] * layer.weights[u * s.size() + d];
+                }
+                out[u] = activate(layer.activation, acc);
+            }
+            break;
+        }
+        return out;
+    }
+
+    // Runs the network. Calibrating records each layer's output range;
+    // otherwise every output is rounded to its int8 grid, as the integer
+    // kernels do, so the result differs from theirs only by rounding order.
+    std::vector<float> forwardAll(std::vector<Layer> &layers, std::vector<float> values, bool calibrate)
+    {
+        for (Layer &layer : layers)
+        {
+            values = forward(layer, values);
+            for (float &v : values)
+            {
+                if (calibrate)
+                {
+                    layer.low = std::min(layer.low, v);
+                    layer.high = std::max(layer.high, v);
+                    continue;
+                }
+                // Average pooling rounds the mean of the raw int8 values
+                long q = layer.type == AVERAGE_POOL ? lroundf(v / layer.output.scale + layer.output.zeroPoint)
+                                                    : lroundf(v / layer.output.scale) + layer.output.zeroPoint;
+                v = layer.output.dequantize(static_cast<int8_t>(std::min(127L, std::max(-128L, q))));
+            }
+        }
+        return values;
+    }
+
+    // Output quantisation from the calibrated ranges, with 10% headroom;
+    // pools and reshape keep their input's, as TFLM requires
+    void quantizeActivations(std::vector<Layer> &layers)
+    {
+        Quant previous = INPUT_QUANT;
+        for (Layer &layer : layers)
+        {
+            if (layer.type == MAX_POOL || layer.type == AVERAGE_POOL || layer.type == RESHAPE)
+            {
+                layer.output = previous;
+                continue;
+            }
+            float low = std::min(0.0f, layer.low) * 1.1f;
+            float high = std::max(0.0f, layer.high) * 1.1f;
+            if (layer.activation == ACT_RELU6)
+            {
+                high = std::min(high, 6.0f);
+            }
+            float scale = std::max(high - low, 1e-3f) / 255;
+            layer.output = {scale, static_cast<int>(lroundf(-128 - low / scale))};
+            previous = layer.output;
+        }
+    }
+
+    struct QuantizedModel
+    {
+        std::vector<uint8_t> bytes;
+        std::vector<Layer> dequantized; // float network with the int8 weights the model holds
+    };
+
+    template <typename T>
+    std::vector<uint8_t> raw(const std::vector<T> &values)
+    {
+        std::vector<uint8_t> out(values.size() * sizeof(T));
+        memcpy(out.data(), values.data(), out.size());
+        return out;
+    }
+
+    // Per-channel symmetric int8 weights and int32 biases, written as a model
+    QuantizedModel quantizeModel(const std::vector<Layer> &layers, int extraOp = -1)
+    {
+        QuantizedModel result;
+        result.dequantized = layers;
+        std::vector<TensorSpec> tensors;
+        std::vector<OpSpec> ops;
+        std::vector<std::vector<uint8_t>> buffers(1);
+
+        auto shape4 = [](const Shape &s)
+        { return std::vector<int32_t>{1, s.h, s.w, s.c}; };
+        tensors.push_back({shape4(INPUT_SHAPE), TYPE_INT8, 0, {INPUT_QUANT.scale}, {INPUT_QUANT.zeroPoint}, 0});
+        int current = 0;
+        Quant inQuant = INPUT_QUANT;
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            const Layer &layer = layers[i];
+            Layer &dq = result.dequantized[i];
+            OpSpec op = {};
+            op.inputs.push_back(current);
+            if (!layer.weights.empty())
+            {
+                int channels = layer.out.c;
+                int perChannel = layer.weights.size() / channels;
+                std::vector<float> scales(channels);
+                std::vector<int8_t> q(layer.weights.size());
+                for (int c = 0; c < channels; c++)
+                {
+                    // Depthwise weights are [1, k, k, c]: the channel is innermost
+                    auto index = [&](int k)
+                    { return layer.type == DEPTHWISE ? k * channels + c : c * perChannel + k; };
+                    float peak = 0;
+                    for (int k = 0; k < perChannel; k++)
+                    {
+                        peak = std::max(peak, fabsf(layer.weights[index(k)]));
+                    }
+                    scales[c] = std::max(peak, 1e-6f) / 127;
+                    for (int k = 0; k < perChannel; k++)
+                    {
+                        q[index(k)] = static_cast<int8_t>(lroundf(layer.weights[index(k)] / scales[c]));
+                        dq.weights[index(k)] = q[index(k)] * scales[c];
+                    }
+                }
+                std::vector<int32_t> bias(channels);
+                std::vector<float> biasScales(channels);
+                for (int c = 0; c < channels; c++)
+                {
+                    biasScales[c] = inQuant.scale * scales[c];
+                    bias[c] = static_cast<int32_t>(lround(layer.bias[c] / biasScales[c]));
+                    dq.bias[c] = bias[c] * biasScales[c];
+                }
+
+                std::vector<int32_t> filterShape;
+                int dimension = 0;
+                if (layer.type == CONV)
+                {
+                    filterShape = {channels, layer.kernel, layer.kernel, layer.in.c};
+                }
+                else if (layer.type == DEPTHWISE)
+                {
+                    filterShape = {1, layer.kernel, layer.kernel, channels};
+                    dimension = 3;
+                }
+                else
+                {
+                    filterShape = {channels, layer.in.size()};
+                }
+                buffers.push_back(raw(q));
+                tensors.push_back({filterShape, TYPE_INT8, static_cast<int>(buffers.size() - 1), scales,
+                                   std::vector<int64_t>(channels, 0), dimension});
+                op.inputs.push_back(tensors.size() - 1);
+                buffers.push_back(raw(bias));
+                tensors.push_back({{channels}, TYPE_INT32, static_cast<int>(buffers.size() - 1), biasScales,
+                                   std::vector<int64_t>(channels, 0), 0});
+                op.inputs.push_back(tensors.size() - 1);
+            }
+
+            std::vector<int32_t> outShape = layer.type == RESHAPE || layer.type == FULLY_CONNECTED
+                                                ? std::vector<int32_t>{1, layer.out.c}
+                                                : shape4(layer.out);
+            tensors.push_back({outShape, TYPE_INT8, 0, {layer.output.scale}, {layer.output.zeroPoint}, 0});
+            op.output = tensors.size() - 1;
+
+            int pad = layer.same ? PADDING_SAME : PADDING_VALID;
+            switch (layer.type)
+            {
+            case CONV:
+                op.code = OP_CONV_2D;
+                op.optionsType = OPTIONS_CONV;
+                op.options = {{0, 1, pad}, {1, 4, layer.stride}, {2, 4, layer.stride}, {3, 1, layer.activation}};
+                break;
+            case DEPTHWISE:
+                op.code = OP_DEPTHWISE_CONV_2D;
+                op.optionsType = OPTIONS_DEPTHWISE;
+                op.options = {{0, 1, pad}, {1, 4, layer.stride}, {2, 4, layer.stride}, {3, 4, 1}, {4, 1, layer.activation}};
+                break;
+            case MAX_POOL:
+            case AVERAGE_POOL:
+                op.code = layer.type == MAX_POOL ? OP_MAX_POOL_2D : OP_AVERAGE_POOL_2D;
+                op.optionsType = OPTIONS_POOL;
+                op.options = {{0, 1, pad}, {1, 4, layer.stride}, {2, 4, layer.stride},
+                              {3, 4, layer.kernel}, {4, 4, layer.kernel}, {5, 1, layer.activation}};
+                break;
+            case RESHAPE:
+                op.code = OP_RESHAPE;
+                op.optionsType = OPTIONS_RESHAPE;
+                op.newShape = outShape;
+                break;
+            case FULLY_CONNECTED:
+                op.code = OP_FULLY_CONNECTED;
+                op.optionsType = OPTIONS_FULLY_CONNECTED;
+                op.options = {{0, 1, layer.activation}};
+                break;
+            }
+            ops.push_back(op);
+            current = op.output;
+            inQuant = layer.output;
+        }
+
+        if (extraOp >= 0)
+        {
+            // An operator the interpreters do not register, for the rejection check
+            tensors.push_back({{1, ModelInference::OUTPUT_VALUES}, TYPE_INT8, 0, {1.0f / 256}, {-128}, 0});
+            ops.push_back({extraOp, {current}, static_cast<int>(tensors.size() - 1), 0, {}, {}});
+            current = tensors.size() - 1;
+        }
+        result.bytes = writeModel(tensors, ops, buffers, 0, current);
+        return result;
+    }
+
+    bool readFile(const char *path, std::vector<uint8_t> &out)
+    {
+        FILE *f = fopen(path, "rb");
+        if (!f)
+        {
+            return false;
+        }
+        uint8_t chunk[4096];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        {
+            out.insert(out.end(), chunk, chunk + read);
+        }
+        fclose(f);
+        return true;
+    }
+
+    bool writeToCard(const char *path, const std::vector<uint8_t> &data)
+    {
+        SDManager &sd = SDManager::getInstance();
+        sd.mkdir("/models");
+        File file = sd.openFile(path, FILE_WRITE);
+        if (!file)
+        {
+            return false;
+        }
+        bool ok = file.write(data.data(), data.size()) == data.size();
+        file.close();
+        return ok;
+    }
+
+    std::vector<float> dequantizeTensor(const InferenceBackend::Tensor &tensor)
+    {
+        std::vector<float> values(tensor.bytes);
+        for (size_t i = 0; i < tensor.bytes; i++)
+        {
+            values[i] = tensor.scale * (tensor.data[i] - tensor.zeroPoint);
+        }
+        return values;
+    }
+
+    void printResult(int frame, const InferenceBackend::Tensor &output, const LaneResult &result)
+    {
+        printf("frame %3d: crc %08x  left %s %.2f..%.2f  right %s %.2f..%.2f  offset %+.2f\n", frame,
+               static_cast<unsigned>(crc32(output.data, output.bytes)), result.left.found ? "yes" : "no ",
+               result.left.bottomX, result.left.topX, result.right.found ? "yes" : "no ", result.right.bottomX,
+               result.right.topX, result.offset());
+    }
+
+    // Runs a model file from the host on camera frames and prints each
+    // output's checksum, for comparison with the device log
+    int runModelFile(ModelInference &inference, const char *path, int frames)
+    {
+        std::vector<uint8_t> model;
+        if (!readFile(path, model))
+        {
+            fprintf(stderr, "cannot read %s\n", path);
+            return 2;
+        }
+        if (!inference.loadModel(model.data(), model.size()) ||
+            !CameraManager::getInstance().begin(CameraProfile::INFERENCE))
+        {
+            fprintf(stderr, "%s\n", inference.lastError());
+            return 1;
+        }
+        for (int i = 0; i < frames; i++)
+        {
+            FrameRef frame = CameraManager::getInstance().captureShared();
+            LaneResult result;
+            if (!frame || !inference.run(frame.get(), result))
+            {
+                fprintf(stderr, "frame %d failed\n", i);
+                return 1;
+            }
+            printResult(i, inference.getBackend().output(), result);
+        }
+        ModelInference::Stats stats = inference.getStats();
+        printf("\ninvoke:        avg %.1f us, max %u us\n", static_cast<double>(stats.totalInvokeUs) / stats.invokes,
+               stats.maxInvokeUs);
+        printf("arena:         %zu of %zu bytes\n", stats.arenaUsed, stats.arenaSize);
+        return 0;
+    }
+}
+
+// Builds a small lane-shaped int8 model (every supported operator, weights
+// quantised per channel, activations calibrated on preprocessed camera
+// frames), writes it to INFERENCE_MODEL_PATH on the host card and runs
+// inference mode on it through the mode controller. Each frame's output
+// must be within one step of a float pass of the same weights that rounds
+// every layer's output to its int8 grid; also checks that
+// invokes are deterministic, that a short arena, an unregistered operator
+// and truncated files are rejected, and prints latency and arena use. With
+// a model file, runs that model instead and prints each output's checksum.
+int runInference(int argc, char **argv)
+{
+    int frames = argc > 0 ? atoi(argv[0]) : 20;
+    const char *modelPath = argc > 1 ? argv[1] : nullptr;
+    const int CALIBRATION_FRAMES = 8;
+
+    LoopbackBleTransport &link = LoopbackBleTransport::getInstance();
+    CustomBLEService ble(link);
+    ModeController &controller = ModeController::getInstance();
+    if (!SDManager::getInstance().begin() || !ble.begin())
+    {
+        fprintf(stderr, "host storage or BLE unavailable\n");
+        return 1;
+    }
+    if (modelPath)
+    {
+        ModelInference inference(&ble);
+        return runModelFile(inference, modelPath, frames);
+    }
+
+    // Calibration inputs: the model's own preprocessing of real frames,
+    // taken from a provisional model (the input quantisation is fixed)
+    std::vector<Layer> layers = buildNetwork();
+    for (Layer &layer : layers)
+    {
+        layer.low = 0;
+        layer.high = 1;
+    }
+    quantizeActivations(layers);
+    {
+        QuantizedModel provisional = quantizeModel(layers);
+        ModelInference calibration(&ble);
+        if (!calibration.loadModel(provisional.bytes.data(), provisional.bytes.size()) ||
+            !CameraManager::getInstance().begin(CameraProfile::INFERENCE))
+        {
+            fprintf(stderr, "provisional model: %s\n", calibration.lastError());
+            return 1;
+        }
+        for (Layer &layer : layers)
+        {
+            layer.low = 1e30f;
+            layer.high = -1e30f;
+        }
+        for (int i = 0; i < CALIBRATION_FRAMES; i++)
+        {
+            FrameRef frame = CameraManager::getInstance().captureShared();
+            if (!frame)
+            {
+                fprintf(stderr, "calibration frame %d failed\n", i);
+                return 1;
+            }
+            calibration.preprocess(frame.get(), calibration.getBackend().input());
+            forwardAll(layers, dequantizeTensor(calibration.getBackend().input()), true);
+        }
+    }
+    quantizeActivations(layers);
+    QuantizedModel model = quantizeModel(layers);
+    if (!writeToCard(INFERENCE_MODEL_PATH, model.bytes))
+    {
+        fprintf(stderr, "cannot write %s\n", INFERENCE_MODEL_PATH);
+        return 1;
+    }
+
+    // Inference mode as the device runs it: BLE command, SD model, main-task loop
+    ModelInference inference(&ble);
+    inference.getTracker().setInterval(1); // every frame is checked against the float pass
+    if (!controller.begin(ble))
+    {
+        fprintf(stderr, "controller failed to start\n");
+        return 1;
+    }
+    link.connect();
+    ble.postCommand(CustomBLEService::START_INFERENCE, CommandBus::SOURCE_BLE);
+    bool started = controller.drain(5000) && controller.mode() == ModeController::MODE_INFERENCE;
+    printf("model:         %zu bytes, %zu layers, %s backend, %s\n", model.bytes.size(), layers.size(),
+           inference.getBackend().name(), started ? "loaded from the card" : inference.lastError());
+    if (!started)
+    {
+        return 1;
+    }
+
+    double maxError = 0; // in output quantisation steps
+    double sumError = 0;
+    int outputs = 0;
+    bool deterministic = true;
+    for (int i = 0; i < frames; i++)
+    {
+        uint32_t before = inference.getStats().invokes;
+        inference.loop();
+        if (inference.getStats().invokes != before + 1)
+        {
+            fprintf(stderr, "frame %d failed\n", i);
+            return 1;
+        }
+        if (i < 3)
+        {
+            printResult(i, inference.getBackend().output(), inference.getLastResult());
+        }
+
+        // The input's memory is reused once it is consumed: check a fresh
+        // frame with its input kept aside
+        InferenceBackend &backend = inference.getBackend();
+        InferenceBackend::Tensor input = backend.input();
+        InferenceBackend::Tensor output = backend.output();
+        FrameRef frame = CameraManager::getInstance().captureShared();
+        if (!frame)
+        {
+            fprintf(stderr, "frame %d failed\n", i);
+            return 1;
+        }
+        inference.preprocess(frame.get(), input);
+        std::vector<int8_t> pixels(input.data, input.data + input.bytes);
+        std::vector<float> expected = forwardAll(model.dequantized, dequantizeTensor(input), false);
+        backend.invoke();
+        std::vector<int8_t> first(output.data, output.data + output.bytes);
+        for (size_t k = 0; k < output.bytes; k++)
+        {
+            double error = fabs(output.scale * (output.data[k] - output.zeroPoint) - expected[k]) / output.scale;
+            maxError = std::max(maxError, error);
+            sumError += error;
+            outputs++;
+        }
+        memcpy(input.data, pixels.data(), pixels.size());
+        backend.invoke();
+        deterministic = deterministic && memcmp(first.data(), output.data, output.bytes) == 0;
+    }
+
+    // Stopped while the main task is still looping, as on the device: no
+    // frame may be captured or run once the camera goes down
+    std::atomic<bool> done(false);
+    std::thread mainTask([&]
+                         {
+                             while (!done)
+                             {
+                                 if (ble.isInferenceEnabled())
+                                 {
+                                     inference.loop();
+                                 }
+                             }
+                         });
+    delay(50);
+    ble.postCommand(CustomBLEService::STOP_INFERENCE, CommandBus::SOURCE_BLE);
+    bool stopped = controller.drain(5000) && controller.mode() == ModeController::MODE_IDLE;
+    done = true;
+    mainTask.join();
+    ModelInference::Stats stats = inference.getStats();
+    bool published = false;
+    for (const LoopbackBleTransport::Notification &n : link.notifications())
+    {
+        published = published || (n.value.find("inference") != std::string::npos &&
+                                   n.value.find("arena_used") != std::string::npos);
+    }
+
+    // Rejections, straight against the backend
+    InferenceBackend &backend = inference.getBackend();
+    alignas(16) static uint8_t shortArena[1024];
+    bool shortRejected = !backend.load(model.bytes.data(), model.bytes.size(), shortArena, sizeof(shortArena));
+    QuantizedModel unsupported = quantizeModel(layers, OP_LOGISTIC);
+    alignas(16) static uint8_t arena[INFERENCE_ARENA_BYTES];
+    bool opRejected = !backend.load(unsupported.bytes.data(), unsupported.bytes.size(), arena, sizeof(arena));
+    int truncatedAccepted = 0;
+    for (int i = 1; i < 16; i++)
+    {
+        size_t len = model.bytes.size() * i / 16;
+        std::vector<uint8_t> cut(model.bytes.begin(), model.bytes.begin() + len);
+        truncatedAccepted += backend.load(cut.data(), cut.size(), arena, sizeof(arena)) ? 1 : 0;
+    }
+
+    bool accurate = maxError < 1.5; // one step: rounding order only
+    bool ok = stopped && published && accurate && deterministic && shortRejected && opRejected &&
+              truncatedAccepted == 0 && stats.failures == 0;
+    printf("\ninvoke:        avg %.1f us, max %u us, preprocess avg %.1f us (%u frames)\n",
+           static_cast<double>(stats.totalInvokeUs) / stats.invokes, stats.maxInvokeUs,
+           static_cast<double>(stats.totalPreprocessUs) / stats.invokes, stats.invokes);
+    printf("arena:         %zu of %zu bytes used\n", stats.arenaUsed, stats.arenaSize);
+    printf("vs float:      max %.2f, mean %.2f output steps %s\n", maxError, outputs ? sumError / outputs : 0.0,
+           accurate ? "ok" : "MISMATCH");
+    printf("repeat invoke: %s\n", deterministic ? "identical" : "MISMATCH");
+    printf("rejected:      short arena %s, unregistered op %s, %d of 15 truncated files accepted\n",
+           shortRejected ? "yes" : "NO", opRejected ? "yes" : "NO", truncatedAccepted);
+    printf("mode:          %s, metrics %s\n", stopped ? "stopped" : "STUCK", published ? "published" : "MISSING");
+    printf("inference:     %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
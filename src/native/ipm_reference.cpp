@@ -0,0 +1,163 @@
+#include "ipm_reference.h"
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "config.h"
+#include "road_scene.h"
+
+namespace
+{
+    int luma(const uint8_t *pixel)
+    {
+        uint16_t value = pixel[0] << 8 | pixel[1];
+        int r = (value >> 8) & 0xF8, g = (value >> 3) & 0xFC, b = (value << 3) & 0xF8;
+        return (77 * r + 150 * g + 29 * b) >> 8;
+    }
+}
+
+namespace IpmReference
+{
+    void reference(const InversePerspectiveMap::Layout &layout, const uint8_t *frame, Reference &out)
+    {
+        double qx[4], qy[4];
+        for (int i = 0; i < 4; i++)
+        {
+            qx[i] = layout.quad.x[i] * layout.sourceWidth;
+            qy[i] = layout.quad.y[i] * layout.sourceHeight;
+        }
+        SquareToQuad mapping(qx, qy);
+        size_t count = static_cast<size_t>(layout.width) * layout.height;
+        out.x.assign(count, 0);
+        out.y.assign(count, 0);
+        out.valid.assign(count, false);
+        out.value.assign(count, 0);
+        out.tolerance.assign(count, 0);
+        auto at = [&](int x, int y)
+        {
+            x = std::min(std::max(x, 0), layout.sourceWidth - 1);
+            y = std::min(std::max(y, 0), layout.sourceHeight - 1);
+            return luma(frame + (static_cast<size_t>(y) * layout.sourceWidth + x) * 2);
+        };
+        for (int oy = 0; oy < layout.height; oy++)
+        {
+            for (int ox = 0; ox < layout.width; ox++)
+            {
+                size_t i = static_cast<size_t>(oy) * layout.width + ox;
+                double sx, sy;
+                mapping.map((ox + 0.5) / layout.width, (oy + 0.5) / layout.height, sx, sy);
+                sx -= 0.5;
+                sy -= 0.5;
+                out.x[i] = sx;
+                out.y[i] = sy;
+                out.valid[i] = sx >= 0 && sy >= 0 && sx < layout.sourceWidth - 1 && sy < layout.sourceHeight - 1;
+                if (!out.valid[i])
+                {
+                    continue;
+                }
+                int x0 = static_cast<int>(sx), y0 = static_cast<int>(sy);
+                double fx = sx - x0, fy = sy - y0;
+                double top = at(x0, y0) * (1 - fx) + at(x0 + 1, y0) * fx;
+                double bottom = at(x0, y0 + 1) * (1 - fx) + at(x0 + 1, y0 + 1) * fx;
+                out.value[i] = top * (1 - fy) + bottom * fy;
+                // The table's position may round into a neighbouring cell
+                int steepest = 0;
+                for (int y = y0 - 1; y <= y0 + 2; y++)
+                {
+                    for (int x = x0 - 1; x <= x0 + 2; x++)
+                    {
+                        steepest = std::max(steepest, abs(at(x + 1, y) - at(x, y)));
+                        steepest = std::max(steepest, abs(at(x, y + 1) - at(x, y)));
+                    }
+                }
+                out.tolerance[i] = 0.5 + steepest * 2 * POSITION_TOLERANCE;
+            }
+        }
+    }
+
+    void floatWarp(const InversePerspectiveMap::Layout &layout, const uint8_t *frame, uint8_t *out)
+    {
+        double qx[4], qy[4];
+        for (int i = 0; i < 4; i++)
+        {
+            qx[i] = layout.quad.x[i] * layout.sourceWidth;
+            qy[i] = layout.quad.y[i] * layout.sourceHeight;
+        }
+        SquareToQuad mapping(qx, qy);
+        const size_t stride = static_cast<size_t>(layout.sourceWidth) * 2;
+        for (int oy = 0; oy < layout.height; oy++)
+        {
+            for (int ox = 0; ox < layout.width; ox++)
+            {
+                double sx, sy;
+                mapping.map((ox + 0.5) / layout.width, (oy + 0.5) / layout.height, sx, sy);
+                sx -= 0.5;
+                sy -= 0.5;
+                if (sx < 0 || sy < 0 || sx >= layout.sourceWidth - 1 || sy >= layout.sourceHeight - 1)
+                {
+                    *out++ = 0;
+                    continue;
+                }
+                int x0 = static_cast<int>(sx), y0 = static_cast<int>(sy);
+                double fx = sx - x0, fy = sy - y0;
+                const uint8_t *p = frame + y0 * stride + x0 * 2;
+                double top = luma(p) * (1 - fx) + luma(p + 2) * fx;
+                double bottom = luma(p + stride) * (1 - fx) + luma(p + stride + 2) * fx;
+                *out++ = static_cast<uint8_t>(top * (1 - fy) + bottom * fy + 0.5);
+            }
+        }
+    }
+
+    void randomFrame(int width, int height, std::mt19937 &random, std::vector<uint8_t> &frame)
+    {
+        std::uniform_real_distribution<double> unit(0, 1);
+        frame.resize(static_cast<size_t>(width) * height * 2);
+        double fx = 0.01 + 0.1 * unit(random), fy = 0.01 + 0.1 * unit(random), phase = 6 * unit(random);
+        int blockSize = 4 + random() % 20;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int value = static_cast<int>(128 + 80 * sin(fx * x + phase) * cos(fy * y));
+                if (((x / blockSize) ^ (y / blockSize)) % 7 == 0)
+                {
+                    value = 255 - value;
+                }
+                int r = value, g = std::min(255, value + static_cast<int>(random() % 30)), b = value / 2;
+                uint16_t pixel = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                frame[(static_cast<size_t>(y) * width + x) * 2] = pixel >> 8;
+                frame[(static_cast<size_t>(y) * width + x) * 2 + 1] = pixel & 0xFF;
+            }
+        }
+    }
+
+    InversePerspectiveMap::Layout defaultLayout()
+    {
+        InversePerspectiveMap::Layout layout = {
+            RoadScene::WIDTH, RoadScene::HEIGHT, IPM_WIDTH, IPM_HEIGHT,
+            InversePerspectiveMap::Quad::fromVanishingPoint(IPM_VANISH_X, IPM_VANISH_Y, IPM_TOP)};
+        return layout;
+    }
+
+    InversePerspectiveMap::Layout randomLayout(std::mt19937 &random)
+    {
+        static const int SOURCES[][2] = {{240, 240}, {320, 240}, {160, 120}, {640, 480}, {96, 96}};
+        std::uniform_real_distribution<double> unit(0, 1);
+        const int *source = SOURCES[random() % 5];
+        float vanishX = 0.3f + 0.4f * unit(random);
+        float vanishY = 0.2f + 0.3f * unit(random);
+        float top = vanishY + 0.05f + (0.9f - vanishY) * 0.8f * unit(random);
+        InversePerspectiveMap::Layout layout = {source[0], source[1], 8 + static_cast<int>(random() % 160),
+                                                8 + static_cast<int>(random() % 200),
+                                                InversePerspectiveMap::Quad::fromVanishingPoint(vanishX, vanishY, top)};
+        if (unit(random) < 0.4)
+        {
+            // A rolled camera or a ground patch off to the side: a general quad
+            for (int i = 0; i < 4; i++)
+            {
+                layout.quad.x[i] += 0.12f * (unit(random) - 0.5f);
+                layout.quad.y[i] = std::min(1.0f, layout.quad.y[i] + 0.06f * static_cast<float>(unit(random) - 0.5));
+            }
+        }
+        return layout;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include "inverse_perspective_map.h"
+
+// Double-precision stand-ins for InversePerspectiveMap, and the frames and
+// layouts the ipm test and benchmark feed it
+namespace IpmReference
+{
+    // Closed-form map from the unit square onto a quad (Heckbert 1989), in
+    // doubles: an independent reference for the table's homography
+    struct SquareToQuad
+    {
+        double a, b, c, d, e, f, g, h;
+
+        explicit SquareToQuad(const double x[4], const double y[4])
+        {
+            double sx = x[0] - x[1] + x[2] - x[3];
+            double sy = y[0] - y[1] + y[2] - y[3];
+            double dx1 = x[1] - x[2], dx2 = x[3] - x[2], dy1 = y[1] - y[2], dy2 = y[3] - y[2];
+            double den = dx1 * dy2 - dx2 * dy1;
+            g = (sx * dy2 - dx2 * sy) / den;
+            h = (dx1 * sy - sx * dy1) / den;
+            a = x[1] - x[0] + g * x[1];
+            b = x[3] - x[0] + h * x[3];
+            c = x[0];
+            d = y[1] - y[0] + g * y[1];
+            e = y[3] - y[0] + h * y[3];
+            f = y[0];
+        }
+
+        void map(double u, double v, double &x, double &y) const
+        {
+            double w = g * u + h * v + 1;
+            x = (a * u + b * v + c) / w;
+            y = (d * u + e * v + f) / w;
+        }
+    };
+
+    // What the warp should produce: the float homography and a float
+    // bilinear sample of the frame's luma
+    struct Reference
+    {
+        std::vector<double> x, y; // sample positions, pixel centres
+        std::vector<bool> valid;
+        std::vector<double> value;
+        std::vector<double> tolerance; // 0.5 rounding + steepest neighbour step x position error
+    };
+
+    const double POSITION_TOLERANCE = 1.0 / 32 + 1e-3; // half a table step
+
+    void reference(const InversePerspectiveMap::Layout &layout, const uint8_t *frame, Reference &out);
+
+    // The warp without a table: homography and bilinear sample per pixel
+    void floatWarp(const InversePerspectiveMap::Layout &layout, const uint8_t *frame, uint8_t *out);
+
+    // Smooth gradients with sharp-edged blocks on top
+    void randomFrame(int width, int height, std::mt19937 &random, std::vector<uint8_t> &frame);
+
+    // The configured mount on the 240x240 frame
+    InversePerspectiveMap::Layout defaultLayout();
+
+    // Frame sizes, vanishing points and output sizes; some general quads
+    InversePerspectiveMap::Layout randomLayout(std::mt19937 &random);
+}
@@ -0,0 +1,86 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+#include "config.h"
+#include "host_commands.h"
+#include "inverse_perspective_map.h"
+#include "ipm_reference.h"
+#include "sd_manager.h"
+
+// Times building the bird's-eye remap table over the default layout and
+// `layouts` random ones, loading it from the card cache, and the warp
+// against a per-pixel float warp. The checks against the float reference
+// are test/test_ipm.
+int runIpm(int argc, char **argv)
+{
+    int layouts = argc > 0 ? atoi(argv[0]) : 100;
+    std::mt19937 random(24);
+    std::vector<uint8_t> frame;
+
+    int built = 0;
+    unsigned long buildUs = 0;
+    for (int i = 0; i <= layouts; i++)
+    {
+        InversePerspectiveMap::Layout layout =
+            i == 0 ? IpmReference::defaultLayout() : IpmReference::randomLayout(random);
+        InversePerspectiveMap ipm;
+        unsigned long start = micros();
+        if (ipm.build(layout))
+        {
+            buildUs += micros() - start;
+            built++;
+        }
+        // The same random sequence as test/test_ipm, which warps a frame per layout
+        IpmReference::randomFrame(layout.sourceWidth, layout.sourceHeight, random, frame);
+    }
+    printf("layouts:       %d of %d built, %.0f us per table\n", built, layouts + 1,
+           built ? static_cast<double>(buildUs) / built : 0.0);
+
+    InversePerspectiveMap ipm;
+    InversePerspectiveMap::Layout layout = IpmReference::defaultLayout();
+    if (!ipm.build(layout))
+    {
+        fprintf(stderr, "default layout not built\n");
+        return 1;
+    }
+    SDManager &sd = SDManager::getInstance();
+    if (sd.begin())
+    {
+        InversePerspectiveMap cached;
+        sd.remove(IPM_LUT_PATH);
+        cached.begin(layout, IPM_LUT_PATH);
+        unsigned long start = micros();
+        bool loaded = cached.begin(layout, IPM_LUT_PATH) && cached.wasLoaded();
+        unsigned long loadUs = micros() - start;
+        printf("cache:         %zu byte table %s in %lu us\n", cached.tableBytes(),
+               loaded ? "loaded" : "NOT LOADED", loadUs);
+    }
+    else
+    {
+        printf("cache:         host storage unavailable\n");
+    }
+
+    // Time per frame: the table against evaluating the homography per pixel
+    IpmReference::randomFrame(layout.sourceWidth, layout.sourceHeight, random, frame);
+    std::vector<uint8_t> view(static_cast<size_t>(layout.width) * layout.height);
+    const int rounds = 200;
+    unsigned long start = micros();
+    for (int i = 0; i < rounds; i++)
+    {
+        ipm.warp(frame.data(), view.data());
+    }
+    double tableUs = static_cast<double>(micros() - start) / rounds;
+    start = micros();
+    for (int i = 0; i < rounds; i++)
+    {
+        IpmReference::floatWarp(layout, frame.data(), view.data());
+    }
+    double floatUs = static_cast<double>(micros() - start) / rounds;
+    printf("warp:          %.1f us per %dx%d view from a %dx%d frame (rows %d..%d), %zu byte table\n", tableUs,
+           layout.width, layout.height, layout.sourceWidth, layout.sourceHeight, ipm.firstSourceRow(),
+           ipm.lastSourceRow(), ipm.tableBytes());
+    printf("per pixel:     %.1f us evaluating the homography and a float bilinear sample per pixel\n", floatUs);
+    return 0;
+}
@@ -0,0 +1,602 @@
+#include "jpeg_decoder.h"
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    const uint8_t ZIGZAG[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+    struct Huffman
+    {
+        bool defined = false;
+        int minCode[17];
+        int maxCode[17];
+        int valuePtr[17];
+        uint8_t values[256];
+    };
+
+    struct Component
+    {
+        int id;
+        int h;
+        int v;
+        int quant;
+        int dcTable;
+        int acTable;
+        int dc;
+        int planeWidth; // samples, padded to whole MCUs
+        int planeHeight;
+        std::vector<uint8_t> plane;
+    };
+
+    class Decoder
+    {
+    public:
+        Decoder(const uint8_t *data, size_t len) : data(data), len(len) {}
+
+        bool run(DecodedJpeg &out, std::string &error);
+
+    private:
+        const uint8_t *data;
+        size_t len;
+        size_t pos = 0;
+        std::string problem;
+
+        uint16_t quant[4][64] = {};
+        bool quantDefined[4] = {};
+        Huffman dcTables[4];
+        Huffman acTables[4];
+        std::vector<Component> components;
+        int width = 0;
+        int height = 0;
+        int restartInterval = 0;
+        int restarts = 0;
+        int maxH = 1;
+        int maxV = 1;
+
+        uint32_t bitBuffer = 0;
+        int bitCount = 0;
+        bool hitMarker = false;
+
+        bool fail(const std::string &message)
+        {
+            if (problem.empty())
+            {
+                problem = message + " at byte " + std::to_string(pos);
+            }
+            return false;
+        }
+        bool need(size_t bytes) { return pos + bytes <= len || fail("truncated"); }
+        uint16_t read16() { uint16_t v = (data[pos] << 8) | data[pos + 1]; pos += 2; return v; }
+
+        bool readQuant(size_t end);
+        bool readFrame(size_t end);
+        bool readHuffman(size_t end);
+        bool readScan(size_t end);
+        bool decodeEntropy();
+        bool decodeBlock(Component &c, int blockX, int blockY);
+        int decodeSymbol(const Huffman &table);
+        int receive(int bits);
+        int readBit();
+        bool restart(int expected);
+        void toRgb(DecodedJpeg &out);
+    };
+
+    bool Decoder::run(DecodedJpeg &out, std::string &error)
+    {
+        bool ok = need(2) && (read16() == 0xFFD8 || fail("no SOI"));
+        bool scanned = false;
+        while (ok)
+        {
+            if (!need(2))
+            {
+                ok = false;
+                break;
+            }
+            if (data[pos] != 0xFF)
+            {
+                ok = fail("expected a marker");
+                break;
+            }
+            uint8_t marker = data[pos + 1];
+            pos += 2;
+            if (marker == 0xD9)
+            {
+                ok = scanned || fail("EOI before any scan");
+                break;
+            }
+            if (!need(2))
+            {
+                ok = false;
+                break;
+            }
+            uint16_t length = read16();
+            size_t end = pos - 2 + length;
+            if (length < 2 || end > len)
+            {
+                ok = fail("segment overruns the data");
+                break;
+            }
+            switch (marker)
+            {
+            case 0xDB:
+                ok = readQuant(end);
+                break;
+            case 0xC0:
+                ok = readFrame(end);
+                break;
+            case 0xC4:
+                ok = readHuffman(end);
+                break;
+            case 0xDD:
+                ok = end - pos == 2 || fail("bad DRI");
+                restartInterval = ok ? read16() : 0;
+                break;
+            case 0xDA:
+                ok = readScan(end) && decodeEntropy();
+                scanned = ok;
+                continue; // decodeEntropy leaves pos at the next marker
+            default:
+                if ((marker & 0xF0) == 0xC0 && marker != 0xC4 && marker != 0xCC)
+                {
+                    ok = fail("only baseline JPEG is supported");
+                }
+                break;
+            }
+            pos = end;
+        }
+
+        if (!ok)
+        {
+            error = problem.empty() ? "decode failed" : problem;
+            return false;
+        }
+        toRgb(out);
+        return true;
+    }
+
+    bool Decoder::readQuant(size_t end)
+    {
+        while (pos < end)
+        {
+            int info = data[pos++];
+            int id = info & 0x0F;
+            if ((info >> 4) != 0 || id > 3 || pos + 64 > end)
+            {
+                return fail("unsupported DQT");
+            }
+            for (int k = 0; k < 64; k++)
+            {
+                quant[id][ZIGZAG[k]] = data[pos++];
+            }
+            quantDefined[id] = true;
+        }
+        return true;
+    }
+
+    bool Decoder::readFrame(size_t end)
+    {
+        if (end - pos < 6 || data[pos] != 8)
+        {
+            return fail("bad SOF0");
+        }
+        height = (data[pos + 1] << 8) | data[pos + 2];
+        width = (data[pos + 3] << 8) | data[pos + 4];
+        int count = data[pos + 5];
+        pos += 6;
+        if ((count != 1 && count != 3) || end - pos != static_cast<size_t>(count) * 3 || width == 0 || height == 0)
+        {
+            return fail("unsupported frame layout");
+        }
+        for (int i = 0; i < count; i++)
+        {
+            Component c = {};
+            c.id = data[pos];
+            c.h = data[pos + 1] >> 4;
+            c.v = data[pos + 1] & 0x0F;
+            c.quant = data[pos + 2];
+            pos += 3;
+            if (c.h < 1 || c.h > 2 || c.v < 1 || c.v > 2 || c.quant > 3)
+            {
+                return fail("unsupported sampling factors");
+            }
+            maxH = c.h > maxH ? c.h : maxH;
+            maxV = c.v > maxV ? c.v : maxV;
+            components.push_back(c);
+        }
+        int mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+        int mcusY = (height + 8 * maxV - 1) / (8 * maxV);
+        for (Component &c : components)
+        {
+            c.planeWidth = mcusX * c.h * 8;
+            c.planeHeight = mcusY * c.v * 8;
+            c.plane.assign(static_cast<size_t>(c.planeWidth) * c.planeHeight, 0);
+        }
+        return true;
+    }
+
+    bool Decoder::readHuffman(size_t end)
+    {
+        while (pos < end)
+        {
+            if (end - pos < 17)
+            {
+                return fail("bad DHT");
+            }
+            int info = data[pos++];
+            int tableClass = info >> 4;
+            int id = info & 0x0F;
+            if (tableClass > 1 || id > 3)
+            {
+                return fail("bad DHT table id");
+            }
+            Huffman &table = tableClass == 0 ? dcTables[id] : acTables[id];
+            const uint8_t *counts = data + pos;
+            pos += 16;
+            int total = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                total += counts[i];
+            }
+            if (total > 256 || pos + total > end)
+            {
+                return fail("DHT value count overruns the segment");
+            }
+            memcpy(table.values, data + pos, total);
+            pos += total;
+
+            int code = 0;
+            int k = 0;
+            for (int bits = 1; bits <= 16; bits++)
+            {
+                table.valuePtr[bits] = k;
+                table.minCode[bits] = code;
+                code += counts[bits - 1];
+                k += counts[bits - 1];
+                table.maxCode[bits] = counts[bits - 1] ? code - 1 : -1;
+                if (code > (1 << bits))
+                {
+                    return fail("DHT code lengths are not a prefix code");
+                }
+                code <<= 1;
+            }
+            table.defined = true;
+        }
+        return true;
+    }
+
+    bool Decoder::readScan(size_t end)
+    {
+        if (components.empty())
+        {
+            return fail("SOS before SOF");
+        }
+        int count = data[pos++];
+        if (count != static_cast<int>(components.size()) || end - pos != static_cast<size_t>(count) * 2 + 3)
+        {
+            return fail("only single interleaved scans are supported");
+        }
+        for (int i = 0; i < count; i++)
+        {
+            Component &c = components[i];
+            if (data[pos] != c.id)
+            {
+                return fail("scan component order differs from the frame");
+            }
+            c.dcTable = data[pos + 1] >> 4;
+            c.acTable = data[pos + 1] & 0x0F;
+            pos += 2;
+            if (c.dcTable > 3 || c.acTable > 3 || !dcTables[c.dcTable].defined || !acTables[c.acTable].defined ||
+                !quantDefined[c.quant])
+            {
+                return fail("scan references an undefined table");
+            }
+        }
+        if (data[pos] != 0 || data[pos + 1] != 63 || data[pos + 2] != 0)
+        {
+            return fail("not a baseline scan");
+        }
+        pos = end;
+        return true;
+    }
+
+    int Decoder::readBit()
+    {
+        if (bitCount == 0)
+        {
+            uint8_t byte = 0;
+            if (!hitMarker && pos < len)
+            {
+                byte = data[pos];
+                if (byte == 0xFF)
+                {
+                    uint8_t next = pos + 1 < len ? data[pos + 1] : 0;
+                    if (next == 0x00)
+                    {
+                        pos += 2;
+                    }
+                    else
+                    {
+                        // A marker ends the entropy data; feed zeros
+                        hitMarker = true;
+                        byte = 0;
+                    }
+                }
+                else
+                {
+                    pos++;
+                }
+            }
+            bitBuffer = byte;
+            bitCount = 8;
+        }
+        bitCount--;
+        return (bitBuffer >> bitCount) & 1;
+    }
+
+    int Decoder::receive(int bits)
+    {
+        int value = 0;
+        for (int i = 0; i < bits; i++)
+        {
+            value = (value << 1) | readBit();
+        }
+        return value;
+    }
+
+    int Decoder::decodeSymbol(const Huffman &table)
+    {
+        int code = 0;
+        for (int bits = 1; bits <= 16; bits++)
+        {
+            code = (code << 1) | readBit();
+            if (table.maxCode[bits] >= 0 && code <= table.maxCode[bits] && code >= table.minCode[bits])
+            {
+                return table.values[table.valuePtr[bits] + code - table.minCode[bits]];
+            }
+        }
+        return -1;
+    }
+
+    bool Decoder::decodeBlock(Component &c, int blockX, int blockY)
+    {
+        int coefficients[64] = {};
+        int t = decodeSymbol(dcTables[c.dcTable]);
+        if (t < 0 || t > 11)
+        {
+            return fail("bad DC code");
+        }
+        int diff = receive(t);
+        if (t && diff < (1 << (t - 1)))
+        {
+            diff -= (1 << t) - 1;
+        }
+        c.dc += diff;
+        coefficients[0] = c.dc * quant[c.quant][0];
+
+        for (int k = 1; k < 64;)
+        {
+            int rs = decodeSymbol(acTables[c.acTable]);
+            if (rs < 0)
+            {
+                return fail("bad AC code");
+            }
+            int run = rs >> 4;
+            int size = rs & 0x0F;
+            if (size == 0)
+            {
+                if (run != 15)
+                {
+                    break; // EOB
+                }
+                k += 16;
+                continue;
+            }
+            k += run;
+            if (k > 63)
+            {
+                return fail("AC run past the end of the block");
+            }
+            int value = receive(size);
+            if (value < (1 << (size - 1)))
+            {
+                value -= (1 << size) - 1;
+            }
+            coefficients[ZIGZAG[k]] = value * quant[c.quant][ZIGZAG[k]];
+            k++;
+        }
+
+        // Straight separable IDCT; this is a checker, not a fast path
+        static float cosines[8][8];
+        static bool ready = false;
+        if (!ready)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                for (int u = 0; u < 8; u++)
+                {
+                    cosines[x][u] = (u == 0 ? sqrtf(0.5f) : 1.0f) * cosf((2 * x + 1) * u * static_cast<float>(M_PI) / 16);
+                }
+            }
+            ready = true;
+        }
+        float rows[64];
+        for (int v = 0; v < 8; v++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                float sum = 0;
+                for (int u = 0; u < 8; u++)
+                {
+                    sum += cosines[x][u] * coefficients[v * 8 + u];
+                }
+                rows[v * 8 + x] = sum / 2;
+            }
+        }
+        for (int y = 0; y < 8; y++)
+        {
+            uint8_t *out = &c.plane[static_cast<size_t>(blockY * 8 + y) * c.planeWidth + blockX * 8];
+            for (int x = 0; x < 8; x++)
+            {
+                float sum = 0;
+                for (int v = 0; v < 8; v++)
+                {
+                    sum += cosines[y][v] * rows[v * 8 + x];
+                }
+                int sample = static_cast<int>(lrintf(sum / 2 + 128));
+                out[x] = sample < 0 ? 0 : sample > 255 ? 255 : sample;
+            }
+        }
+        return true;
+    }
+
+    bool Decoder::restart(int expected)
+    {
+        // Byte-align, then the next thing in the stream must be RSTn
+        bitCount = 0;
+        if (pos + 1 >= len || data[pos] != 0xFF || data[pos + 1] != 0xD0 + expected)
+        {
+            return fail("missing RST" + std::to_string(expected));
+        }
+        pos += 2;
+        hitMarker = false;
+        restarts++;
+        for (Component &c : components)
+        {
+            c.dc = 0;
+        }
+        return true;
+    }
+
+    bool Decoder::decodeEntropy()
+    {
+        int mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+        int mcusY = (height + 8 * maxV - 1) / (8 * maxV);
+        int total = mcusX * mcusY;
+        bitCount = 0;
+        hitMarker = false;
+        for (Component &c : components)
+        {
+            c.dc = 0;
+        }
+
+        for (int mcu = 0; mcu < total; mcu++)
+        {
+            if (restartInterval && mcu > 0 && mcu % restartInterval == 0 &&
+                !restart((mcu / restartInterval - 1) & 7))
+            {
+                return false;
+            }
+            int mx = mcu % mcusX;
+            int my = mcu / mcusX;
+            for (Component &c : components)
+            {
+                for (int by = 0; by < c.v; by++)
+                {
+                    for (int bx = 0; bx < c.h; bx++)
+                    {
+                        if (!decodeBlock(c, mx * c.h + bx, my * c.v + by))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+            if (hitMarker)
+            {
+                return fail("entropy data ended early");
+            }
+        }
+
+        // Skip padding up to the next marker
+        bitCount = 0;
+        while (pos + 1 < len && !(data[pos] == 0xFF && data[pos + 1] != 0x00))
+        {
+            pos++;
+        }
+        return true;
+    }
+
+    void Decoder::toRgb(DecodedJpeg &out)
+    {
+        out.width = width;
+        out.height = height;
+        out.components = components.size();
+        out.restartInterval = restartInterval;
+        out.restarts = restarts;
+        out.rgb.assign(static_cast<size_t>(width) * height * 3, 0);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                float sample[3];
+                for (size_t i = 0; i < components.size(); i++)
+                {
+                    const Component &c = components[i];
+                    int sx = x * c.h / maxH;
+                    int sy = y * c.v / maxV;
+                    sample[i] = c.plane[static_cast<size_t>(sy) * c.planeWidth + sx];
+                }
+                uint8_t *px = &out.rgb[(static_cast<size_t>(y) * width + x) * 3];
+                if (components.size() == 1)
+                {
+                    px[0] = px[1] = px[2] = static_cast<uint8_t>(sample[0]);
+                    continue;
+                }
+                float cb = sample[1] - 128;
+                float cr = sample[2] - 128;
+                float rgb[3] = {sample[0] + 1.402f * cr, sample[0] - 0.344136f * cb - 0.714136f * cr,
+                                sample[0] + 1.772f * cb};
+                for (int i = 0; i < 3; i++)
+                {
+                    int v = static_cast<int>(lrintf(rgb[i]));
+                    px[i] = v < 0 ? 0 : v > 255 ? 255 : v;
+                }
+            }
+        }
+    }
+}
+
+bool decodeJpeg(const uint8_t *data, size_t len, DecodedJpeg &out, std::string &error)
+{
+    if (!data || len < 4)
+    {
+        error = "empty input";
+        return false;
+    }
+    Decoder decoder(data, len);
+    return decoder.run(out, error);
+}
+
+double psnrAgainstRgb565(const std::vector<uint8_t> &rgb, const uint8_t *rgb565, int width, int height)
+{
+    double squared = 0;
+    size_t pixels = static_cast<size_t>(width) * height;
+    if (rgb.size() < pixels * 3)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < pixels; i++)
+    {
+        uint16_t px = (rgb565[i * 2] << 8) | rgb565[i * 2 + 1];
+        int r = px >> 11;
+        int g = (px >> 5) & 0x3F;
+        int b = px & 0x1F;
+        int source[3] = {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+        for (int c = 0; c < 3; c++)
+        {
+            double d = static_cast<double>(rgb[i * 3 + c]) - source[c];
+            squared += d * d;
+        }
+    }
+    if (squared == 0)
+    {
+        return 99.0;
+    }
+    double mse = squared / (pixels * 3);
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
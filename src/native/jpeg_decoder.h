@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Reference decoder for the host tools: baseline Huffman JPEG with one or
+// three components, any sampling factors up to 2x2 and restart intervals.
+// It checks what the encoders under test produce, so it is strict about
+// marker layout and reports the first problem instead of guessing. Speed is
+// not a goal.
+struct DecodedJpeg
+{
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    int restartInterval = 0; // MCUs per interval, 0 without DRI
+    int restarts = 0;        // RSTn markers seen
+    std::vector<uint8_t> rgb; // width * height * 3
+};
+
+bool decodeJpeg(const uint8_t *data, size_t len, DecodedJpeg &out, std::string &error);
+
+// PSNR in dB of an RGB888 image against a big-endian RGB565 frame of the
+// same size; 99 when identical
+double psnrAgainstRgb565(const std::vector<uint8_t> &rgb, const uint8_t *rgb565, int width, int height);
@@ -0,0 +1,160 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "camera_manager.h"
+#include "host_commands.h"
+#include "img_converters.h"
+#include "jpeg_decoder.h"
+#include "jpeg_stream_encoder.h"
+#include "replay_camera_backend.h"
+
+namespace
+{
+    struct Collector
+    {
+        std::vector<uint8_t> bytes;
+        size_t chunks = 0;
+        size_t largestChunk = 0;
+    };
+
+    size_t collect(void *arg, size_t, const void *data, size_t len)
+    {
+        Collector *out = static_cast<Collector *>(arg);
+        out->bytes.insert(out->bytes.end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + len);
+        out->chunks++;
+        out->largestChunk = len > out->largestChunk ? len : out->largestChunk;
+        return len;
+    }
+
+    struct Totals
+    {
+        const char *name;
+        unsigned long encodeUs = 0;
+        uint64_t bytes = 0;
+        double psnr = 0;
+        double worstPsnr = 99;
+        int failures = 0;
+    };
+
+    void check(Totals &totals, const std::vector<uint8_t> &jpeg, const camera_fb_t *fb)
+    {
+        DecodedJpeg decoded;
+        std::string error;
+        if (!decodeJpeg(jpeg.data(), jpeg.size(), decoded, error) || decoded.width != static_cast<int>(fb->width) ||
+            decoded.height != static_cast<int>(fb->height))
+        {
+            fprintf(stderr, "%s: undecodable output: %s\n", totals.name, error.c_str());
+            totals.failures++;
+            return;
+        }
+        double psnr = psnrAgainstRgb565(decoded.rgb, fb->buf, fb->width, fb->height);
+        totals.psnr += psnr;
+        totals.worstPsnr = psnr < totals.worstPsnr ? psnr : totals.worstPsnr;
+    }
+}
+
+// Encodes dataset frames with frame2jpg and with the streaming encoder at
+// both chroma layouts and decodes every output with the reference decoder;
+// prints time, size, PSNR against the source frame and working set. The
+// pass/fail checks of the encoders are test/test_jpeg.
+int runJpeg(int argc, char **argv)
+{
+    int frames = argc > 0 ? atoi(argv[0]) : 30;
+    int quality = argc > 1 ? atoi(argv[1]) : 90;
+    quality = quality < 1 ? 1 : quality > 100 ? 100 : quality;
+
+    ReplayCameraBackend::getInstance().setFrameRate(0);
+    CameraManager &camera = CameraManager::getInstance();
+    if (!camera.begin(CameraProfile::DATASET))
+    {
+        fprintf(stderr, "camera failed to start: %s\n", camera.lastError());
+        return 1;
+    }
+
+    JpegStreamEncoder encoder420(quality, JpegStreamEncoder::SUBSAMPLE_420);
+    JpegStreamEncoder encoder444(quality, JpegStreamEncoder::SUBSAMPLE_444);
+    Totals baseline;
+    Totals stream420;
+    Totals stream444;
+    baseline.name = "frame2jpg";
+    stream420.name = "stream 420";
+    stream444.name = "stream 444";
+    size_t largestChunk = 0;
+    int width = 0;
+    int height = 0;
+
+    for (int i = 0; i < frames; i++)
+    {
+        FrameRef frame = camera.captureShared();
+        if (!frame)
+        {
+            fprintf(stderr, "capture failed: %s\n", camera.lastError());
+            camera.releaseCamera();
+            return 1;
+        }
+        const camera_fb_t *fb = frame.get();
+        width = fb->width;
+        height = fb->height;
+
+        camera_fb_t copy = *fb;
+        uint8_t *jpeg = nullptr;
+        size_t jpegLen = 0;
+        unsigned long start = micros();
+        bool ok = frame2jpg(&copy, quality, &jpeg, &jpegLen);
+        baseline.encodeUs += micros() - start;
+        if (ok)
+        {
+            baseline.bytes += jpegLen;
+            check(baseline, std::vector<uint8_t>(jpeg, jpeg + jpegLen), fb);
+        }
+        else
+        {
+            baseline.failures++;
+        }
+        free(jpeg);
+
+        JpegStreamEncoder *encoders[2] = {&encoder420, &encoder444};
+        Totals *totals[2] = {&stream420, &stream444};
+        for (int e = 0; e < 2; e++)
+        {
+            Collector out;
+            out.bytes.reserve(64 * 1024);
+            start = micros();
+            ok = encoders[e]->encode(fb, collect, &out);
+            totals[e]->encodeUs += micros() - start;
+            if (!ok || out.bytes.size() != encoders[e]->encodedBytes())
+            {
+                totals[e]->failures++;
+                continue;
+            }
+            totals[e]->bytes += out.bytes.size();
+            largestChunk = out.largestChunk > largestChunk ? out.largestChunk : largestChunk;
+            check(*totals[e], out.bytes, fb);
+        }
+    }
+    camera.releaseCamera();
+
+    // frame2jpg converts the whole frame to RGB888 and the device version
+    // allocates its output for the worst case before encoding
+    size_t baselineWorkingSet = static_cast<size_t>(width) * height * 3 + static_cast<size_t>(width) * height * 2;
+    printf("%d frames %dx%d, quality %d\n\n", frames, width, height, quality);
+    printf("%-11s %9s %9s %8s %10s %14s %s\n", "encoder", "ms/frame", "KB/frame", "PSNR dB", "worst dB",
+           "working set", "failures");
+    Totals *rows[3] = {&baseline, &stream420, &stream444};
+    for (int r = 0; r < 3; r++)
+    {
+        Totals &t = *rows[r];
+        int decoded = frames - t.failures;
+        char workingSet[24];
+        snprintf(workingSet, sizeof(workingSet), "%zu B", r == 0 ? baselineWorkingSet : sizeof(JpegStreamEncoder));
+        printf("%-11s %9.2f %9.1f %8.2f %10.2f %14s %d\n", t.name, frames ? t.encodeUs / 1000.0 / frames : 0.0,
+               frames ? t.bytes / 1024.0 / frames : 0.0, decoded ? t.psnr / decoded : 0.0,
+               decoded ? t.worstPsnr : 0.0, workingSet, t.failures);
+    }
+    printf("\nchunks:        largest %zu B (limit %zu)\n", largestChunk, JpegStreamEncoder::CHUNK_BYTES);
+    printf("frame2jpg is toojpeg on the host; the device converter differs in speed, not in working set\n");
+    return 0;
+}
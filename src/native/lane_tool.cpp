@@ -0,0 +1,258 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "alert_scheduler.h"
+#include "ble_service.h"
+#include "buzzer_manager.h"
+#include "camera_manager.h"
+#include "config.h"
+#include "file_camera_backend.h"
+#include "host_commands.h"
+#include "lane_detector.h"
+#include "loopback_ble_transport.h"
+#include "mode_controller.h"
+#include "model_inference.h"
+#include "road_scene.h"
+#include "sd_manager.h"
+
+using namespace RoadScene;
+
+namespace
+{
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+    }
+
+    double mean(const std::vector<double> &values)
+    {
+        double sum = 0;
+        for (double v : values)
+        {
+            sum += v;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    const char *DEPARTURE_DIR = "/departure";
+    const int DEPARTURE_PHASE = 12; // frames per lateral position
+
+    // A drive to /departure: centred, onto the right line, back to a
+    // position between LANE_DEPARTURE_CLEAR and LANE_DEPARTURE_OFFSET, onto
+    // the right line again, centred, onto the left line. Two departures.
+    bool writeDeparture(std::mt19937 &random)
+    {
+        const double half = 60;
+        const double shifts[] = {0, -51, -39, -51, 0, 51};
+        SDManager &sd = SDManager::getInstance();
+        sd.mkdir(DEPARTURE_DIR);
+        std::vector<uint8_t> pixels;
+        int index = 0;
+        for (double shift : shifts)
+        {
+            for (int i = 0; i < DEPARTURE_PHASE; i++, index++)
+            {
+                Road road = {};
+                road.vanishX = WIDTH / 2;
+                road.vanishY = HEIGHT * 0.4;
+                road.leftBottom = WIDTH / 2 + shift - half;
+                road.rightBottom = WIDTH / 2 + shift + half;
+                road.paint = true;
+                road.paintLuma = 220;
+                road.asphaltLuma = 70;
+                render(road, random, pixels);
+                char path[64];
+                snprintf(path, sizeof(path), "%s/" IMAGE_PREFIX "%d" RGB_EXTENSION, DEPARTURE_DIR, index);
+                File file = sd.openFile(path, FILE_WRITE);
+                bool ok = file && file.write(pixels.data(), pixels.size()) == pixels.size();
+                if (file)
+                {
+                    file.close();
+                }
+                if (!ok)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+// Benchmarks LaneDetector on rendered roads with known boundaries (random
+// heading, lateral position and width; dashed, yellow and faded paint; tree
+// shadows, noise and a dark car ahead; every tenth frame unpainted): prints
+// detection rates, bottom/top position and offset errors, false positives
+// and time per frame, and checks that detection is deterministic. Then runs
+// inference mode without a model on the host camera (a replayed session
+// with MIDDLEFOX_REPLAY_SOURCE) to check the classical fallback end to end,
+// and replays a drive onto either line to check the lane departure alert.
+int runLanes(int argc, char **argv)
+{
+    int frames = argc > 0 ? atoi(argv[0]) : 200;
+    LaneDetector detector;
+    std::mt19937 random(42);
+    std::vector<uint8_t> pixels;
+    camera_fb_t fb = {};
+    fb.width = WIDTH;
+    fb.height = HEIGHT;
+    fb.format = PIXFORMAT_RGB565;
+
+    int painted = 0, leftFound = 0, rightFound = 0, bothFound = 0, falsePositives = 0, unpainted = 0;
+    bool deterministic = true;
+    std::vector<double> bottomError, topError, offsetError, timeUs;
+    for (int i = 0; i < frames; i++)
+    {
+        Road road = randomRoad(i, random);
+        render(road, random, pixels);
+        fb.buf = pixels.data();
+        fb.len = pixels.size();
+
+        LaneResult result, again;
+        detector.detect(&fb, result);
+        detector.detect(&fb, again);
+        deterministic = deterministic && memcmp(&result.left, &again.left, sizeof(LaneLine)) == 0 &&
+                        memcmp(&result.right, &again.right, sizeof(LaneLine)) == 0;
+        timeUs.push_back(result.latencyUs);
+
+        if (!road.paint)
+        {
+            unpainted++;
+            falsePositives += result.left.found || result.right.found ? 1 : 0;
+            continue;
+        }
+        painted++;
+        LaneResult expected = truth(road);
+        const LaneLine *found[2] = {&result.left, &result.right};
+        const LaneLine *wanted[2] = {&expected.left, &expected.right};
+        for (int side = 0; side < 2; side++)
+        {
+            if (!found[side]->found)
+            {
+                continue;
+            }
+            (side ? rightFound : leftFound)++;
+            bottomError.push_back(fabs(found[side]->bottomX - wanted[side]->bottomX) * WIDTH);
+            topError.push_back(fabs(found[side]->topX - wanted[side]->topX) * WIDTH);
+        }
+        if (result.valid())
+        {
+            bothFound++;
+            offsetError.push_back(fabs(result.offset() - expected.offset()));
+        }
+    }
+
+    double bothRate = painted ? static_cast<double>(bothFound) / painted : 0;
+    bool accurate = bothRate >= 0.9 && mean(bottomError) <= 3 && mean(offsetError) <= 0.05 &&
+                    falsePositives * 10 <= unpainted;
+    printf("rendered:      %d painted roads, %d bare\n", painted, unpainted);
+    printf("found:         left %.0f%%, right %.0f%%, both %.0f%%; %d of %d bare roads with a line\n",
+           100.0 * leftFound / std::max(painted, 1), 100.0 * rightFound / std::max(painted, 1), 100 * bothRate,
+           falsePositives, unpainted);
+    printf("bottom error:  mean %.1f px, p95 %.1f px (of %d)\n", mean(bottomError), percentile(bottomError, 0.95),
+           WIDTH);
+    printf("top error:     mean %.1f px, p95 %.1f px\n", mean(topError), percentile(topError, 0.95));
+    printf("offset error:  mean %.3f, p95 %.3f (lane half-widths)\n", mean(offsetError),
+           percentile(offsetError, 0.95));
+    printf("time:          mean %.0f us, p95 %.0f us, max %.0f us per %dx%d frame (device budget %d us)\n",
+           mean(timeUs), percentile(timeUs, 0.95), percentile(timeUs, 1.0), WIDTH, HEIGHT, LANE_DETECTOR_BUDGET_US);
+    printf("repeat:        %s\n", deterministic ? "identical" : "MISMATCH");
+
+    // The fallback, end to end: no model on the card
+    LoopbackBleTransport &link = LoopbackBleTransport::getInstance();
+    CustomBLEService ble(link);
+    ModeController &controller = ModeController::getInstance();
+    SDManager &sd = SDManager::getInstance();
+    if (!sd.begin() || !ble.begin())
+    {
+        fprintf(stderr, "host storage or BLE unavailable\n");
+        return 1;
+    }
+    sd.remove(INFERENCE_MODEL_PATH);
+    const char *source = getenv("MIDDLEFOX_REPLAY_SOURCE");
+    if (source)
+    {
+        FileCameraBackend::getInstance().setSource(source);
+        CameraManager::getInstance().setBackend(&FileCameraBackend::getInstance());
+    }
+    ModelInference inference(&ble);
+    if (!controller.begin(ble))
+    {
+        fprintf(stderr, "controller failed to start\n");
+        return 1;
+    }
+    link.connect();
+    ble.postCommand(CustomBLEService::START_INFERENCE, CommandBus::SOURCE_BLE);
+    bool started = controller.drain(5000) && controller.mode() == ModeController::MODE_INFERENCE &&
+                   inference.isClassical();
+    int cameraFrames = std::min(frames, 60), cameraBoth = 0;
+    for (int i = 0; started && i < cameraFrames; i++)
+    {
+        inference.loop();
+        cameraBoth += inference.getLastResult().valid() ? 1 : 0;
+    }
+    ModelInference::Stats stats = inference.getStats();
+    ble.postCommand(CustomBLEService::STOP_INFERENCE, CommandBus::SOURCE_BLE);
+    controller.drain(5000);
+    bool published = false;
+    for (const LoopbackBleTransport::Notification &n : link.notifications())
+    {
+        published = published || n.value.find("\"classical\"") != std::string::npos;
+    }
+    bool fallback = started && static_cast<int>(stats.frames) == cameraFrames && stats.invokes > 0 &&
+                    stats.failures == 0 && published;
+    printf("fallback:      %s on %s, %u frames (%u detected), both lines in %d, mean %.0f us, metrics %s\n",
+           started ? "classical" : "NOT STARTED", source ? source : "synthetic camera", stats.frames, stats.invokes,
+           cameraBoth,
+           stats.invokes ? static_cast<double>(stats.totalInvokeUs) / stats.invokes : 0.0,
+           published ? "published" : "MISSING");
+
+    // Departure: one alert per line reached, none for hovering near it
+    AlertScheduler &alerts = AlertScheduler::getInstance();
+    FileCameraBackend &replay = FileCameraBackend::getInstance();
+    bool departures = false;
+    if (BuzzerManager::getInstance().begin(BUZZER_PIN) && alerts.begin() && writeDeparture(random))
+    {
+        replay.setSource(DEPARTURE_DIR);
+        replay.setFrameRate(0);
+        replay.setLooping(false);
+        CameraManager &camera = CameraManager::getInstance();
+        camera.releaseCamera();
+        camera.setBackend(&replay);
+        alerts.resetStats();
+        if (inference.start())
+        {
+            for (int i = 0; i < 6 * DEPARTURE_PHASE; i++)
+            {
+                inference.loop();
+            }
+            inference.stop();
+        }
+        camera.releaseCamera();
+        camera.setBackend(nullptr);
+        stats = inference.getStats();
+        uint32_t raised = alerts.getStats().raised;
+        departures = stats.departures == 2 && raised == 2;
+        printf("departure:     %u alerts raised of 2 over %u frames, scheduler saw %u\n", stats.departures,
+               stats.frames, raised);
+    }
+    else
+    {
+        fprintf(stderr, "buzzer or departure drive unavailable\n");
+    }
+
+    bool ok = accurate && deterministic && fallback && departures;
+    printf("lanes:         %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
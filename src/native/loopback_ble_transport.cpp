@@ -0,0 +1,88 @@
+#include "loopback_ble_transport.h"
+
+#include <Arduino.h>
+
+const char *LoopbackBleTransport::TAG = "LoopbackBLE";
+
+LoopbackBleTransport &LoopbackBleTransport::getInstance()
+{
+    static LoopbackBleTransport instance;
+    return instance;
+}
+
+BleTransport &defaultBleTransport()
+{
+    return LoopbackBleTransport::getInstance();
+}
+
+bool LoopbackBleTransport::begin(const char *deviceName, const std::string &commandMenu)
+{
+    ESP_LOGI(TAG, "Loopback transport up as %s", deviceName);
+    (void)commandMenu;
+    advertising = true;
+    return true;
+}
+
+void LoopbackBleTransport::setHandlers(WriteHandler onWrite, ConnectionHandler onConnection)
+{
+    writeHandler = onWrite;
+    connectionHandler = onConnection;
+}
+
+bool LoopbackBleTransport::publish(Channel channel, const std::string &value)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    received.push_back({millis(), channel, value});
+    return true;
+}
+
+bool LoopbackBleTransport::startAdvertising()
+{
+    advertising = true;
+    return true;
+}
+
+void LoopbackBleTransport::connect()
+{
+    connected = true;
+    advertising = false;
+    if (connectionHandler)
+    {
+        connectionHandler(true);
+    }
+}
+
+void LoopbackBleTransport::disconnect()
+{
+    connected = false;
+    if (connectionHandler)
+    {
+        connectionHandler(false);
+    }
+}
+
+void LoopbackBleTransport::write(const std::string &value)
+{
+    if (writeHandler)
+    {
+        writeHandler(value);
+    }
+}
+
+std::vector<LoopbackBleTransport::Notification> LoopbackBleTransport::notifications()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return received;
+}
+
+size_t LoopbackBleTransport::notificationCount()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return received.size();
+}
+
+void LoopbackBleTransport::clearNotifications()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    received.clear();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "hal/ble_transport.h"
+
+// In-process stand-in for the NimBLE server. Published values are kept per
+// channel so host runs can inspect what a phone would have received, and
+// control writes / connection changes are injected from the harness.
+class LoopbackBleTransport : public BleTransport
+{
+public:
+    struct Notification
+    {
+        unsigned long timestampMs;
+        Channel channel;
+        std::string value;
+    };
+
+    static LoopbackBleTransport &getInstance();
+
+    bool begin(const char *deviceName, const std::string &commandMenu) override;
+    void setHandlers(WriteHandler onWrite, ConnectionHandler onConnection) override;
+    bool publish(Channel channel, const std::string &value) override;
+    int connectedCount() override { return connected ? 1 : 0; }
+    bool startAdvertising() override;
+    bool isAdvertising() override { return advertising; }
+    void stopAdvertising() override { advertising = false; }
+
+    // Harness side
+    void connect();
+    void disconnect();
+    void write(const std::string &value);
+    std::vector<Notification> notifications();
+    size_t notificationCount();
+    void clearNotifications();
+
+private:
+    LoopbackBleTransport() {}
+    static const char *TAG;
+
+    std::mutex lock;
+    std::vector<Notification> received;
+    WriteHandler writeHandler;
+    ConnectionHandler connectionHandler;
+    bool connected = false;
+    bool advertising = false;
+};
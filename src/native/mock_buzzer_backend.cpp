@@ -0,0 +1,77 @@
+#include "mock_buzzer_backend.h"
+#include <Arduino.h>
+
+MockBuzzerBackend &MockBuzzerBackend::getInstance()
+{
+    static MockBuzzerBackend instance;
+    return instance;
+}
+
+BuzzerBackend &defaultBuzzerBackend()
+{
+    return MockBuzzerBackend::getInstance();
+}
+
+bool MockBuzzerBackend::begin(int pin)
+{
+    return pin >= 0;
+}
+
+void MockBuzzerBackend::playTone(int halfPeriodUs, int durationMs)
+{
+    record(halfPeriodUs, durationMs);
+    if (realtime)
+    {
+        delay(durationMs);
+    }
+}
+
+void MockBuzzerBackend::rest(int durationMs)
+{
+    record(0, durationMs);
+    if (realtime)
+    {
+        delay(durationMs);
+    }
+}
+
+void MockBuzzerBackend::silence()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    toneEnded = true;
+}
+
+void MockBuzzerBackend::record(int halfPeriodUs, int durationMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!events.empty() && events.back().halfPeriodUs == halfPeriodUs && (halfPeriodUs == 0 || !toneEnded))
+    {
+        events.back().durationMs += durationMs;
+    }
+    else
+    {
+        events.push_back({cursorMs, halfPeriodUs, durationMs});
+    }
+    cursorMs += durationMs;
+    toneEnded = halfPeriodUs == 0;
+}
+
+std::vector<MockBuzzerBackend::Event> MockBuzzerBackend::timeline()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return events;
+}
+
+unsigned long MockBuzzerBackend::elapsedMs()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return cursorMs;
+}
+
+void MockBuzzerBackend::reset()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    events.clear();
+    cursorMs = 0;
+    toneEnded = true;
+}
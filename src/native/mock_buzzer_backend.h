@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "hal/buzzer_backend.h"
+
+// Records every tone and rest on a virtual timeline instead of sounding it,
+// so host runs do not sleep through melodies and the output can be checked.
+// Slices of one note (same pitch, back to back) are merged into a single
+// event, as are adjacent rests; sweep steps stay separate.
+class MockBuzzerBackend : public BuzzerBackend
+{
+public:
+    struct Event
+    {
+        unsigned long startMs;   // position on the virtual timeline
+        int halfPeriodUs;        // 0 for a rest
+        int durationMs;
+    };
+
+    static MockBuzzerBackend &getInstance();
+
+    bool begin(int pin) override;
+    void playTone(int halfPeriodUs, int durationMs) override;
+    void rest(int durationMs) override;
+    void silence() override;
+
+    // Sleep for each tone and rest, so queueing and stop() behave as on device
+    void setRealtime(bool enabled) { realtime = enabled; }
+
+    std::vector<Event> timeline();
+    unsigned long elapsedMs();
+    void reset();
+
+private:
+    MockBuzzerBackend() {}
+    std::mutex lock;
+    std::vector<Event> events;
+    unsigned long cursorMs = 0;
+    bool realtime = false;
+    bool toneEnded = true;
+
+    void record(int halfPeriodUs, int durationMs);
+};
@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "camera_manager.h"
+#include "host_commands.h"
+#include "parallel_jpeg_encoder.h"
+#include "replay_camera_backend.h"
+
+namespace
+{
+    struct Image
+    {
+        int width;
+        int height;
+        std::vector<uint8_t> pixels; // big-endian RGB565
+
+        camera_fb_t frame()
+        {
+            camera_fb_t fb = {};
+            fb.buf = pixels.data();
+            fb.len = pixels.size();
+            fb.width = width;
+            fb.height = height;
+            fb.format = PIXFORMAT_RGB565;
+            return fb;
+        }
+    };
+
+    size_t collect(void *arg, size_t index, const void *data, size_t len)
+    {
+        std::vector<uint8_t> *out = static_cast<std::vector<uint8_t> *>(arg);
+        if (index != out->size())
+        {
+            return 0;
+        }
+        out->insert(out->end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + len);
+        return len;
+    }
+
+    // Nearest-neighbour upscale, for a frame the size of the preview profile
+    Image scale(const Image &source, int width, int height)
+    {
+        Image out = {width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 2)};
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                size_t from = (static_cast<size_t>(y * source.height / height) * source.width + x * source.width / width) * 2;
+                size_t to = (static_cast<size_t>(y) * width + x) * 2;
+                out.pixels[to] = source.pixels[from];
+                out.pixels[to + 1] = source.pixels[from + 1];
+            }
+        }
+        return out;
+    }
+}
+
+// Encodes the same frames with 1..max workers and prints time per frame,
+// speed-up over one worker and the bytes the restart markers cost over the
+// single-pass encoding. That the stripes decode to exactly the single-pass
+// pixels is test/test_jpeg.
+int runParallelJpeg(int argc, char **argv)
+{
+    int frames = argc > 0 ? atoi(argv[0]) : 20;
+    int quality = argc > 1 ? atoi(argv[1]) : 100;
+    int maxWorkers = argc > 2 ? atoi(argv[2]) : ParallelJpegEncoder::MAX_WORKERS;
+    maxWorkers = maxWorkers < 1 ? 1 : maxWorkers > ParallelJpegEncoder::MAX_WORKERS ? ParallelJpegEncoder::MAX_WORKERS : maxWorkers;
+
+    ReplayCameraBackend::getInstance().setFrameRate(0);
+    CameraManager &camera = CameraManager::getInstance();
+    if (!camera.begin(CameraProfile::DATASET))
+    {
+        fprintf(stderr, "camera failed to start: %s\n", camera.lastError());
+        return 1;
+    }
+    std::vector<Image> dataset;
+    for (int i = 0; i < frames; i++)
+    {
+        FrameRef frame = camera.captureShared();
+        if (!frame)
+        {
+            fprintf(stderr, "capture failed: %s\n", camera.lastError());
+            camera.releaseCamera();
+            return 1;
+        }
+        dataset.push_back({static_cast<int>(frame->width), static_cast<int>(frame->height),
+                           std::vector<uint8_t>(frame.data(), frame.data() + frame.size())});
+    }
+    camera.releaseCamera();
+    std::vector<Image> vga;
+    for (const Image &image : dataset)
+    {
+        vga.push_back(scale(image, 640, 480));
+    }
+
+    printf("%d frames, quality %d, one MCU row per stripe\n\n", frames, quality);
+    printf("%-8s %-4s %7s %9s %8s %10s %12s\n", "size", "chroma", "workers", "ms/frame", "speedup", "KB/frame",
+           "marker bytes");
+    std::vector<Image> *sets[2] = {&dataset, &vga};
+    for (std::vector<Image> *set : sets)
+    {
+        for (int mode = 0; mode < 2; mode++)
+        {
+            JpegStreamEncoder::Subsampling subsampling = mode == 0 ? JpegStreamEncoder::SUBSAMPLE_420
+                                                                   : JpegStreamEncoder::SUBSAMPLE_444;
+            // The single-pass output size is the baseline for the markers
+            JpegStreamEncoder single(quality, subsampling);
+            size_t referenceBytes = 0;
+            for (Image &image : *set)
+            {
+                camera_fb_t fb = image.frame();
+                std::vector<uint8_t> jpeg;
+                if (!single.encode(&fb, collect, &jpeg))
+                {
+                    fprintf(stderr, "single-pass encoding failed\n");
+                    return 1;
+                }
+                referenceBytes += jpeg.size();
+            }
+
+            double baselineUs = 0;
+            for (int workers = 1; workers <= maxWorkers; workers *= 2)
+            {
+                ParallelJpegEncoder encoder(quality, subsampling, workers);
+                encoder.begin();
+                int width = (*set)[0].width;
+                int height = (*set)[0].height;
+
+                size_t bytes = 0;
+                int failures = 0;
+                unsigned long elapsedUs = 0;
+                for (size_t i = 0; i < set->size(); i++)
+                {
+                    camera_fb_t fb = (*set)[i].frame();
+                    std::vector<uint8_t> jpeg;
+                    jpeg.reserve(256 * 1024);
+                    unsigned long start = micros();
+                    failures += encoder.encode(&fb, collect, &jpeg) ? 0 : 1;
+                    elapsedUs += micros() - start;
+                    bytes += jpeg.size();
+                }
+                encoder.end();
+
+                double perFrameUs = static_cast<double>(elapsedUs) / set->size();
+                baselineUs = workers == 1 ? perFrameUs : baselineUs;
+                char size[16];
+                snprintf(size, sizeof(size), "%dx%d", width, height);
+                printf("%-8s %-6s %7d %9.2f %7.2fx %10.1f %12ld%s\n", size, mode == 0 ? "4:2:0" : "4:4:4", workers,
+                       perFrameUs / 1000.0, perFrameUs > 0 ? baselineUs / perFrameUs : 0.0,
+                       bytes / 1024.0 / set->size(), static_cast<long>(bytes - referenceBytes) / static_cast<long>(set->size()),
+                       failures ? " (encoding failed)" : "");
+            }
+        }
+    }
+
+    printf("\nspeed-up on the host depends on its cores; the device has two\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "preprocess_reference.h"
+
+namespace
+{
+    typedef FramePreprocessor::Layout Layout;
+
+    // Pass 1: 8-bit planes (luma, or interleaved R, G, B) of the whole frame
+    std::vector<uint8_t> unpack(const std::vector<uint8_t> &frame, int pixels, int channels)
+    {
+        std::vector<uint8_t> planes(static_cast<size_t>(pixels) * channels);
+        for (int i = 0; i < pixels; i++)
+        {
+            uint16_t pixel = (frame[i * 2] << 8) | frame[i * 2 + 1];
+            int r = (pixel >> 11) << 3;
+            int g = ((pixel >> 5) & 0x3F) << 2;
+            int b = (pixel & 0x1F) << 3;
+            if (channels == 1)
+            {
+                planes[i] = (77 * r + 150 * g + 29 * b) >> 8;
+            }
+            else
+            {
+                planes[i * 3] = r;
+                planes[i * 3 + 1] = g;
+                planes[i * 3 + 2] = b;
+            }
+        }
+        return planes;
+    }
+
+    // Pass 2: the region of interest
+    std::vector<uint8_t> crop(const std::vector<uint8_t> &planes, const Layout &l)
+    {
+        std::vector<uint8_t> out;
+        for (int y = 0; y < l.roi.height; y++)
+        {
+            const uint8_t *row = &planes[((l.roi.y + y) * l.sourceWidth + l.roi.x) * l.channels];
+            out.insert(out.end(), row, row + l.roi.width * l.channels);
+        }
+        return out;
+    }
+
+    // Bilinear source position of output index i: left index, right index, weight
+    void centre(int i, int size, int roiSize, int &left, int &right, int &weight)
+    {
+        // (i + 0.5) * roiSize / size - 0.5 in 16.16, truncated
+        int64_t fixed = ((2 * i + 1) * (static_cast<int64_t>(roiSize) << 16)) / (2 * size) - 0x8000;
+        if (fixed < 0)
+        {
+            fixed = 0;
+        }
+        left = fixed >> 16;
+        right = left + 1 < roiSize ? left + 1 : left;
+        weight = (fixed >> 8) & 0xFF;
+    }
+
+    // Pass 3: resampling
+    std::vector<uint8_t> resample(const std::vector<uint8_t> &roi, const Layout &l)
+    {
+        std::vector<uint8_t> out(static_cast<size_t>(l.width) * l.height * l.channels);
+        const int w = l.roi.width;
+        for (int y = 0; y < l.height; y++)
+        {
+            for (int x = 0; x < l.width; x++)
+            {
+                for (int c = 0; c < l.channels; c++)
+                {
+                    auto at = [&](int sx, int sy)
+                    { return roi[(sy * w + sx) * l.channels + c]; };
+                    int value;
+                    if (l.resample == FramePreprocessor::AREA)
+                    {
+                        int x0 = x * w / l.width, x1 = (x + 1) * w / l.width;
+                        int y0 = y * l.roi.height / l.height, y1 = (y + 1) * l.roi.height / l.height;
+                        uint32_t sum = 0;
+                        for (int sy = y0; sy < y1; sy++)
+                        {
+                            for (int sx = x0; sx < x1; sx++)
+                            {
+                                sum += at(sx, sy);
+                            }
+                        }
+                        uint32_t count = (x1 - x0) * (y1 - y0);
+                        value = (sum + count / 2) / count;
+                    }
+                    else
+                    {
+                        int left, right, wx, top, bottom, wy;
+                        centre(x, l.width, w, left, right, wx);
+                        centre(y, l.height, l.roi.height, top, bottom, wy);
+                        uint32_t upper = at(left, top) * (256 - wx) + at(right, top) * wx;
+                        uint32_t lower = at(left, bottom) * (256 - wx) + at(right, bottom) * wx;
+                        value = (upper * (256 - wy) + lower * wy + 0x8000) >> 16;
+                    }
+                    out[(y * l.width + x) * l.channels + c] = value;
+                }
+            }
+        }
+        return out;
+    }
+}
+
+namespace PreprocessReference
+{
+    // Pass 4: quantisation
+    std::vector<int8_t> run(const std::vector<uint8_t> &frame, const Layout &l, const int8_t *table)
+    {
+        std::vector<uint8_t> resized =
+            resample(crop(unpack(frame, l.sourceWidth * l.sourceHeight, l.channels), l), l);
+        std::vector<int8_t> out(resized.size());
+        for (size_t i = 0; i < resized.size(); i++)
+        {
+            out[i] = table[resized[i]];
+        }
+        return out;
+    }
+
+    std::vector<uint8_t> randomFrame(int width, int height, std::mt19937 &random)
+    {
+        std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 2);
+        for (uint8_t &byte : frame)
+        {
+            byte = random();
+        }
+        return frame;
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include "frame_preprocessor.h"
+
+// The separate full-frame passes FramePreprocessor fuses (unpack, crop,
+// resample, quantise), written straight from the definitions in
+// frame_preprocessor.h: the reference for the preprocess test and the
+// baseline the preprocess benchmark times
+namespace PreprocessReference
+{
+    std::vector<int8_t> run(const std::vector<uint8_t> &frame, const FramePreprocessor::Layout &layout,
+                            const int8_t *table);
+
+    std::vector<uint8_t> randomFrame(int width, int height, std::mt19937 &random);
+}
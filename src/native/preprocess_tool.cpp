@@ -0,0 +1,68 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "frame_preprocessor.h"
+#include "host_commands.h"
+#include "preprocess_reference.h"
+
+namespace
+{
+    typedef FramePreprocessor::Layout Layout;
+
+    double microsPerFrame(const Layout &l, const int8_t *table, bool fusedPath, int repeats)
+    {
+        std::mt19937 random(7);
+        std::vector<uint8_t> frame = PreprocessReference::randomFrame(l.sourceWidth, l.sourceHeight, random);
+        FramePreprocessor fused;
+        fused.configure(l, table);
+        std::vector<int8_t> out(static_cast<size_t>(l.width) * l.height * l.channels);
+        unsigned long start = micros();
+        for (int i = 0; i < repeats; i++)
+        {
+            if (fusedPath)
+            {
+                fused.run(frame.data(), out.data());
+            }
+            else
+            {
+                out = PreprocessReference::run(frame, fused.getLayout(), table);
+            }
+        }
+        return static_cast<double>(micros() - start) / repeats;
+    }
+}
+
+// Times FramePreprocessor against the four-pass reference (unpack, crop,
+// resample, quantise) it replaces on the inference shapes; the bit-exact
+// comparison is test/test_preprocess.
+int runPreprocess(int argc, char **argv)
+{
+    int repeats = argc > 0 ? atoi(argv[0]) : 200;
+    std::mt19937 random(2025);
+    int8_t table[256];
+    for (int i = 0; i < 256; i++)
+    {
+        table[i] = static_cast<int8_t>(random());
+    }
+
+    const FramePreprocessor::Resample AREA = FramePreprocessor::AREA;
+    const FramePreprocessor::Resample BILINEAR = FramePreprocessor::BILINEAR;
+    printf("%-28s %10s %10s %8s\n", "240x240 RGB565 to", "fused us", "4-pass us", "speed-up");
+    const Layout timed[] = {
+        {240, 240, {0, 0, 0, 0}, 64, 48, 1, AREA},
+        {240, 240, {0, 0, 0, 0}, 64, 48, 1, BILINEAR},
+        {240, 240, {0, 0, 0, 0}, 96, 96, 3, AREA},
+        {240, 240, {0, 120, 240, 120}, 96, 48, 1, AREA},
+    };
+    const char *names[] = {"64x48 luma, area", "64x48 luma, bilinear", "96x96 RGB, area", "bottom half 96x48, area"};
+    for (size_t i = 0; i < sizeof(timed) / sizeof(timed[0]); i++)
+    {
+        double fusedUs = microsPerFrame(timed[i], table, true, repeats);
+        double referenceUs = microsPerFrame(timed[i], table, false, repeats / 10 + 1);
+        printf("%-28s %10.1f %10.1f %7.1fx\n", names[i], fusedUs, referenceUs, referenceUs / fusedUs);
+    }
+    return 0;
+}
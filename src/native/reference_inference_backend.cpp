@@ -0,0 +1,891 @@
+#include "reference_inference_backend.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+    // Builtin operator codes and enums from the TensorFlow Lite schema
+    enum BuiltinOp
+    {
+        BUILTIN_AVERAGE_POOL_2D = 1,
+        BUILTIN_CONV_2D = 3,
+        BUILTIN_DEPTHWISE_CONV_2D = 4,
+        BUILTIN_FULLY_CONNECTED = 9,
+        BUILTIN_MAX_POOL_2D = 17,
+        BUILTIN_RESHAPE = 22
+    };
+
+    const int TYPE_INT32 = 2;
+    const int TYPE_INT8 = 9;
+    const int PADDING_SAME = 0;
+    const int ACTIVATION_NONE = 0;
+    const int ACTIVATION_RELU = 1;
+    const int ACTIVATION_RELU6 = 3;
+
+    // Bounds-checked access to a FlatBuffer: tables hold a signed offset to
+    // their vtable, whose entries give each field's position in the table
+    // (0 when absent); references are unsigned offsets from where they are
+    // stored. Any read outside the buffer clears ok and returns zero.
+    class FlatReader
+    {
+    public:
+        FlatReader(const uint8_t *data, size_t len) : data(data), len(len) {}
+
+        bool ok = true;
+
+        template <typename T>
+        T read(size_t pos)
+        {
+            T value = 0;
+            if (pos + sizeof(T) > len || pos + sizeof(T) < pos)
+            {
+                ok = false;
+                return value;
+            }
+            memcpy(&value, data + pos, sizeof(T));
+            return value;
+        }
+
+        size_t root() { return deref(0); }
+
+        // Position of the field in the table, 0 when absent
+        size_t field(size_t table, int index)
+        {
+            size_t vtable = table - read<int32_t>(table);
+            uint16_t vtableSize = read<uint16_t>(vtable);
+            size_t entry = 4 + index * 2;
+            if (!ok || entry + 2 > vtableSize)
+            {
+                return 0;
+            }
+            uint16_t offset = read<uint16_t>(vtable + entry);
+            return offset ? table + offset : 0;
+        }
+
+        template <typename T>
+        T scalar(size_t table, int index, T fallback)
+        {
+            size_t pos = field(table, index);
+            return pos ? read<T>(pos) : fallback;
+        }
+
+        // Referenced table, vector or string, 0 when absent
+        size_t ref(size_t table, int index)
+        {
+            size_t pos = field(table, index);
+            return pos ? deref(pos) : 0;
+        }
+
+        uint32_t length(size_t vector) { return vector ? read<uint32_t>(vector) : 0; }
+
+        // Element i of a vector of elementSize-byte scalars
+        size_t element(size_t vector, uint32_t i, size_t elementSize)
+        {
+            size_t pos = vector + 4 + static_cast<size_t>(i) * elementSize;
+            if (i >= length(vector) || pos + elementSize > len)
+            {
+                ok = false;
+                return 0;
+            }
+            return pos;
+        }
+
+        // Table i of a vector of tables
+        size_t table(size_t vector, uint32_t i) { return deref(element(vector, i, 4)); }
+
+        const uint8_t *at(size_t pos) const { return data + pos; }
+
+    private:
+        const uint8_t *data;
+        size_t len;
+
+        size_t deref(size_t pos)
+        {
+            uint32_t offset = read<uint32_t>(pos);
+            if (!ok || pos + offset >= len)
+            {
+                ok = false;
+                return 0;
+            }
+            return pos + offset;
+        }
+    };
+
+    // Field indices in the schema tables used here
+    namespace ModelField
+    {
+        const int OPERATOR_CODES = 1, SUBGRAPHS = 2, BUFFERS = 4;
+    }
+    namespace OperatorCodeField
+    {
+        const int DEPRECATED_BUILTIN_CODE = 0, BUILTIN_CODE = 3;
+    }
+    namespace SubGraphField
+    {
+        const int TENSORS = 0, INPUTS = 1, OUTPUTS = 2, OPERATORS = 3;
+    }
+    namespace TensorField
+    {
+        const int SHAPE = 0, TYPE = 1, BUFFER = 2, QUANTIZATION = 4;
+    }
+    namespace QuantizationField
+    {
+        const int SCALE = 2, ZERO_POINT = 3;
+    }
+    namespace OperatorField
+    {
+        const int OPCODE_INDEX = 0, INPUTS = 1, OUTPUTS = 2, BUILTIN_OPTIONS = 4;
+    }
+
+    float readFloat(const uint8_t *p)
+    {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    int32_t readInt32(const int8_t *p)
+    {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // tflite::QuantizeMultiplier
+    void quantizeMultiplier(double real, int32_t &multiplier, int32_t &shift)
+    {
+        if (real == 0)
+        {
+            multiplier = 0;
+            shift = 0;
+            return;
+        }
+        int exponent;
+        double fraction = frexp(real, &exponent);
+        int64_t fixed = static_cast<int64_t>(round(fraction * (1LL << 31)));
+        if (fixed == (1LL << 31))
+        {
+            fixed /= 2;
+            exponent++;
+        }
+        if (exponent < -31)
+        {
+            exponent = 0;
+            fixed = 0;
+        }
+        multiplier = static_cast<int32_t>(fixed);
+        shift = exponent;
+    }
+
+    // gemmlowp::SaturatingRoundingDoublingHighMul
+    int32_t doublingHighMul(int32_t a, int32_t b)
+    {
+        if (a == b && a == INT32_MIN)
+        {
+            return INT32_MAX;
+        }
+        int64_t product = static_cast<int64_t>(a) * b;
+        int32_t nudge = product >= 0 ? (1 << 30) : (1 - (1 << 30));
+        return static_cast<int32_t>((product + nudge) / (1LL << 31));
+    }
+
+    // gemmlowp::RoundingDivideByPOT
+    int32_t roundingDivideByPot(int32_t x, int exponent)
+    {
+        int32_t mask = static_cast<int32_t>((1LL << exponent) - 1);
+        int32_t remainder = x & mask;
+        int32_t threshold = (mask >> 1) + (x < 0 ? 1 : 0);
+        return (x >> exponent) + (remainder > threshold ? 1 : 0);
+    }
+
+    // tflite::MultiplyByQuantizedMultiplier (double rounding)
+    int32_t requantize(int32_t x, int32_t multiplier, int32_t shift)
+    {
+        int leftShift = shift > 0 ? shift : 0;
+        int rightShift = shift > 0 ? 0 : -shift;
+        return roundingDivideByPot(doublingHighMul(x * (1 << leftShift), multiplier), rightShift);
+    }
+
+    // tflite::ComputePaddingHeightWidth, one axis
+    int computePadding(int stride, int dilation, int inSize, int filterSize, int outSize)
+    {
+        int effective = (filterSize - 1) * dilation + 1;
+        int padding = ((outSize - 1) * stride + effective - inSize) / 2;
+        return padding > 0 ? padding : 0;
+    }
+
+    int computeOutSize(int padding, int inSize, int filterSize, int stride, int dilation)
+    {
+        int effective = (filterSize - 1) * dilation + 1;
+        return padding == PADDING_SAME ? (inSize + stride - 1) / stride : (inSize + stride - effective) / stride;
+    }
+
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool ReferenceInferenceBackend::fail(const char *message)
+{
+    error = message;
+    loaded = false;
+    return false;
+}
+
+int32_t ReferenceInferenceBackend::elements(const TensorInfo &tensor) const
+{
+    int32_t count = 1;
+    for (int i = 0; i < tensor.dimCount; i++)
+    {
+        count *= tensor.dims[i];
+    }
+    return count;
+}
+
+InferenceBackend::Tensor ReferenceInferenceBackend::view(int index)
+{
+    Tensor out = {};
+    if (!loaded || index < 0)
+    {
+        return out;
+    }
+    const TensorInfo &tensor = tensors[index];
+    out.data = tensor.data;
+    memcpy(out.dims, tensor.dims, sizeof(out.dims));
+    out.dimCount = tensor.dimCount;
+    out.bytes = tensor.bytes;
+    out.scale = tensor.scale;
+    out.zeroPoint = tensor.zeroPoint;
+    return out;
+}
+
+void ReferenceInferenceBackend::unload()
+{
+    loaded = false;
+    tensorCount = 0;
+    opCount = 0;
+    inputTensor = -1;
+    outputTensor = -1;
+    usedBytes = 0;
+}
+
+bool ReferenceInferenceBackend::load(const uint8_t *model, size_t modelBytes, uint8_t *arena, size_t arenaBytes)
+{
+    unload();
+    error = "";
+    if (!model || modelBytes < 8 || memcmp(model + 4, "TFL3", 4) != 0)
+    {
+        return fail("Not a TFLite model");
+    }
+    if (!arena || reinterpret_cast<uintptr_t>(arena) % ARENA_ALIGNMENT != 0)
+    {
+        return fail("Arena missing or misaligned");
+    }
+
+    FlatReader fb(model, modelBytes);
+    size_t root = fb.root();
+    size_t subgraphs = fb.ref(root, ModelField::SUBGRAPHS);
+    size_t opCodes = fb.ref(root, ModelField::OPERATOR_CODES);
+    size_t buffers = fb.ref(root, ModelField::BUFFERS);
+    if (!fb.ok || fb.length(subgraphs) != 1)
+    {
+        return fail("Model must have exactly one subgraph");
+    }
+    size_t graph = fb.table(subgraphs, 0);
+    size_t tensorVector = fb.ref(graph, SubGraphField::TENSORS);
+    size_t opVector = fb.ref(graph, SubGraphField::OPERATORS);
+    size_t inputs = fb.ref(graph, SubGraphField::INPUTS);
+    size_t outputs = fb.ref(graph, SubGraphField::OUTPUTS);
+    tensorCount = fb.length(tensorVector);
+    opCount = fb.length(opVector);
+    if (!fb.ok || tensorCount > MAX_TENSORS || opCount > MAX_OPS || opCount == 0)
+    {
+        return fail("Too many tensors or operators");
+    }
+    if (fb.length(inputs) != 1 || fb.length(outputs) != 1)
+    {
+        return fail("Model must have one input and one output");
+    }
+
+    // Tensors: shape, type, quantisation, and constant data from the buffers
+    for (int i = 0; i < tensorCount; i++)
+    {
+        TensorInfo &tensor = tensors[i];
+        memset(&tensor, 0, sizeof(tensor));
+        tensor.firstOp = -1;
+        tensor.lastOp = -1;
+        size_t table = fb.table(tensorVector, i);
+        size_t shape = fb.ref(table, TensorField::SHAPE);
+        tensor.dimCount = fb.length(shape);
+        if (tensor.dimCount > 4)
+        {
+            return fail("Tensor with more than 4 dimensions");
+        }
+        for (int d = 0; d < tensor.dimCount; d++)
+        {
+            tensor.dims[d] = fb.read<int32_t>(fb.element(shape, d, 4));
+            if (tensor.dims[d] <= 0)
+            {
+                return fail("Tensor with a dynamic or empty dimension");
+            }
+        }
+        tensor.type = fb.scalar<int8_t>(table, TensorField::TYPE, 0);
+        if (tensor.type != TYPE_INT8 && tensor.type != TYPE_INT32)
+        {
+            return fail("Only int8 tensors and int32 biases are supported");
+        }
+        tensor.bytes = elements(tensor) * (tensor.type == TYPE_INT32 ? 4 : 1);
+
+        size_t quantization = fb.ref(table, TensorField::QUANTIZATION);
+        if (quantization)
+        {
+            size_t scales = fb.ref(quantization, QuantizationField::SCALE);
+            size_t zeroPoints = fb.ref(quantization, QuantizationField::ZERO_POINT);
+            tensor.scaleCount = fb.length(scales);
+            if (tensor.scaleCount > 0)
+            {
+                tensor.scales = fb.at(fb.element(scales, 0, 4));
+                fb.element(scales, tensor.scaleCount - 1, 4);
+                tensor.scale = readFloat(tensor.scales);
+            }
+            if (fb.length(zeroPoints) > 0)
+            {
+                tensor.zeroPoint = static_cast<int>(fb.read<int64_t>(fb.element(zeroPoints, 0, 8)));
+            }
+        }
+
+        uint32_t bufferIndex = fb.scalar<uint32_t>(table, TensorField::BUFFER, 0);
+        size_t data = bufferIndex ? fb.ref(fb.table(buffers, bufferIndex), 0) : 0;
+        if (data && fb.length(data) > 0)
+        {
+            if (fb.length(data) != tensor.bytes)
+            {
+                return fail("Constant tensor size does not match its shape");
+            }
+            fb.element(data, tensor.bytes - 1, 1);
+            tensor.data = reinterpret_cast<int8_t *>(const_cast<uint8_t *>(fb.at(data + 4)));
+            tensor.constant = true;
+        }
+        if (!fb.ok)
+        {
+            return fail("Malformed tensor table");
+        }
+    }
+    inputTensor = fb.read<int32_t>(fb.element(inputs, 0, 4));
+    outputTensor = fb.read<int32_t>(fb.element(outputs, 0, 4));
+    if (inputTensor < 0 || inputTensor >= tensorCount || outputTensor < 0 || outputTensor >= tensorCount ||
+        tensors[inputTensor].type != TYPE_INT8 || tensors[outputTensor].type != TYPE_INT8)
+    {
+        return fail("Input and output must be int8 tensors");
+    }
+    tensors[inputTensor].firstOp = 0;
+    tensors[outputTensor].lastOp = opCount - 1;
+
+    // Operators, with their options and the per-channel multipliers, which
+    // are carved from the arena's tail like TFLM's persistent allocations
+    size_t tail = arenaBytes;
+    for (int i = 0; i < opCount; i++)
+    {
+        Operation &op = ops[i];
+        memset(&op, 0, sizeof(op));
+        size_t table = fb.table(opVector, i);
+        uint32_t codeIndex = fb.scalar<uint32_t>(table, OperatorField::OPCODE_INDEX, 0);
+        size_t codeTable = fb.table(opCodes, codeIndex);
+        int code = std::max<int>(fb.scalar<int8_t>(codeTable, OperatorCodeField::DEPRECATED_BUILTIN_CODE, 0),
+                                 fb.scalar<int32_t>(codeTable, OperatorCodeField::BUILTIN_CODE, 0));
+        size_t opInputs = fb.ref(table, OperatorField::INPUTS);
+        size_t opOutputs = fb.ref(table, OperatorField::OUTPUTS);
+        size_t options = fb.ref(table, OperatorField::BUILTIN_OPTIONS);
+        int inputCount = fb.length(opInputs);
+        if (!fb.ok || inputCount < 1 || inputCount > 3 || fb.length(opOutputs) != 1)
+        {
+            return fail("Malformed operator");
+        }
+        int operands[3] = {-1, -1, -1};
+        for (int k = 0; k < inputCount; k++)
+        {
+            operands[k] = fb.read<int32_t>(fb.element(opInputs, k, 4));
+            if (operands[k] >= tensorCount)
+            {
+                return fail("Operator input out of range");
+            }
+        }
+        op.input = operands[0];
+        op.filter = operands[1];
+        op.bias = operands[2];
+        op.output = fb.read<int32_t>(fb.element(opOutputs, 0, 4));
+        if (op.input < 0 || op.output < 0 || op.output >= tensorCount || tensors[op.output].constant)
+        {
+            return fail("Operator input or output missing");
+        }
+
+        int padding = PADDING_SAME;
+        int activation = ACTIVATION_NONE;
+        op.strideW = op.strideH = op.dilationW = op.dilationH = op.depthMultiplier = 1;
+        switch (code)
+        {
+        case BUILTIN_CONV_2D:
+            op.type = OP_CONV;
+            padding = fb.scalar<int8_t>(options, 0, 0);
+            op.strideW = fb.scalar<int32_t>(options, 1, 1);
+            op.strideH = fb.scalar<int32_t>(options, 2, 1);
+            activation = fb.scalar<int8_t>(options, 3, 0);
+            op.dilationW = fb.scalar<int32_t>(options, 4, 1);
+            op.dilationH = fb.scalar<int32_t>(options, 5, 1);
+            break;
+        case BUILTIN_DEPTHWISE_CONV_2D:
+            op.type = OP_DEPTHWISE;
+            padding = fb.scalar<int8_t>(options, 0, 0);
+            op.strideW = fb.scalar<int32_t>(options, 1, 1);
+            op.strideH = fb.scalar<int32_t>(options, 2, 1);
+            op.depthMultiplier = fb.scalar<int32_t>(options, 3, 1);
+            activation = fb.scalar<int8_t>(options, 4, 0);
+            op.dilationW = fb.scalar<int32_t>(options, 5, 1);
+            op.dilationH = fb.scalar<int32_t>(options, 6, 1);
+            break;
+        case BUILTIN_FULLY_CONNECTED:
+            op.type = OP_FULLY_CONNECTED;
+            activation = fb.scalar<int8_t>(options, 0, 0);
+            break;
+        case BUILTIN_AVERAGE_POOL_2D:
+        case BUILTIN_MAX_POOL_2D:
+            op.type = code == BUILTIN_MAX_POOL_2D ? OP_MAX_POOL : OP_AVERAGE_POOL;
+            padding = fb.scalar<int8_t>(options, 0, 0);
+            op.strideW = fb.scalar<int32_t>(options, 1, 1);
+            op.strideH = fb.scalar<int32_t>(options, 2, 1);
+            op.filterW = fb.scalar<int32_t>(options, 3, 1);
+            op.filterH = fb.scalar<int32_t>(options, 4, 1);
+            activation = fb.scalar<int8_t>(options, 5, 0);
+            break;
+        case BUILTIN_RESHAPE:
+            op.type = OP_RESHAPE;
+            op.filter = -1; // the optional shape operand is not needed
+            op.bias = -1;
+            break;
+        default:
+            return fail("Unsupported operator");
+        }
+        if (!fb.ok || op.strideW < 1 || op.strideH < 1 || op.dilationW < 1 || op.dilationH < 1 ||
+            op.depthMultiplier < 1)
+        {
+            return fail("Malformed operator options");
+        }
+
+        const TensorInfo &in = tensors[op.input];
+        const TensorInfo &out = tensors[op.output];
+        if (in.type != TYPE_INT8 || out.type != TYPE_INT8)
+        {
+            return fail("Operator on a non-int8 tensor");
+        }
+        bool weighted = op.type == OP_CONV || op.type == OP_DEPTHWISE || op.type == OP_FULLY_CONNECTED;
+        if (weighted && (op.filter < 0 || !tensors[op.filter].constant || tensors[op.filter].type != TYPE_INT8 ||
+                         tensors[op.filter].scaleCount < 1))
+        {
+            return fail("Weights must be constant int8 tensors");
+        }
+        if (weighted && op.bias >= 0 && (!tensors[op.bias].constant || tensors[op.bias].type != TYPE_INT32))
+        {
+            return fail("Bias must be a constant int32 tensor");
+        }
+
+        // Shapes
+        int channels = 0;
+        if (op.type == OP_CONV || op.type == OP_DEPTHWISE || op.type == OP_AVERAGE_POOL || op.type == OP_MAX_POOL)
+        {
+            if (in.dimCount != 4 || out.dimCount != 4 || in.dims[0] != 1 || out.dims[0] != 1)
+            {
+                return fail("Spatial operators need single-batch NHWC tensors");
+            }
+            int filterH = op.filterH;
+            int filterW = op.filterW;
+            if (weighted)
+            {
+                const TensorInfo &filter = tensors[op.filter];
+                if (filter.dimCount != 4)
+                {
+                    return fail("Filter must be 4-D");
+                }
+                filterH = filter.dims[1];
+                filterW = filter.dims[2];
+                bool depthOk = op.type == OP_CONV ? filter.dims[0] == out.dims[3] && filter.dims[3] == in.dims[3]
+                                                  : filter.dims[3] == out.dims[3] &&
+                                                        out.dims[3] == in.dims[3] * op.depthMultiplier;
+                if (!depthOk)
+                {
+                    return fail("Filter depth does not match its tensors");
+                }
+            }
+            else if (out.dims[3] != in.dims[3])
+            {
+                return fail("Pool changes the channel count");
+            }
+            if (out.dims[1] != computeOutSize(padding, in.dims[1], filterH, op.strideH, op.dilationH) ||
+                out.dims[2] != computeOutSize(padding, in.dims[2], filterW, op.strideW, op.dilationW))
+            {
+                return fail("Output shape does not match padding and stride");
+            }
+            op.padH = computePadding(op.strideH, op.dilationH, in.dims[1], filterH, out.dims[1]);
+            op.padW = computePadding(op.strideW, op.dilationW, in.dims[2], filterW, out.dims[2]);
+            channels = out.dims[3];
+        }
+        else if (op.type == OP_FULLY_CONNECTED)
+        {
+            const TensorInfo &filter = tensors[op.filter];
+            if (filter.dimCount != 2 || elements(in) % filter.dims[1] != 0 ||
+                elements(out) != elements(in) / filter.dims[1] * filter.dims[0])
+            {
+                return fail("Fully connected shapes do not match");
+            }
+            channels = filter.dims[0];
+        }
+        else if (elements(in) != elements(out))
+        {
+            return fail("Reshape changes the element count");
+        }
+        if (weighted && op.bias >= 0 && elements(tensors[op.bias]) != channels)
+        {
+            return fail("Bias length does not match the output channels");
+        }
+
+        // Fused activation as an int8 clamp (CalculateActivationRangeQuantized)
+        op.activationMin = -128;
+        op.activationMax = 127;
+        if (activation == ACTIVATION_RELU || activation == ACTIVATION_RELU6)
+        {
+            op.activationMin = std::max(-128, out.zeroPoint);
+        }
+        if (activation == ACTIVATION_RELU6)
+        {
+            op.activationMax = std::min(127, out.zeroPoint + static_cast<int>(round(6.0f / out.scale)));
+        }
+        else if (activation != ACTIVATION_NONE && activation != ACTIVATION_RELU)
+        {
+            return fail("Unsupported fused activation");
+        }
+
+        if (weighted)
+        {
+            // One multiplier per output channel (per-tensor weights repeat it)
+            size_t bytes = alignUp(channels * sizeof(int32_t), ARENA_ALIGNMENT);
+            if (tail < 2 * bytes)
+            {
+                return fail("Arena too small");
+            }
+            tail -= 2 * bytes;
+            op.multipliers = reinterpret_cast<int32_t *>(arena + tail);
+            op.shifts = reinterpret_cast<int32_t *>(arena + tail + bytes);
+            const TensorInfo &filter = tensors[op.filter];
+            for (int c = 0; c < channels; c++)
+            {
+                float filterScale = readFloat(filter.scales + 4 * (filter.scaleCount > 1 ? c : 0));
+                if (filter.scaleCount > 1 && filter.scaleCount != channels)
+                {
+                    return fail("Per-channel scales do not match the output channels");
+                }
+                double real = static_cast<double>(in.scale) * static_cast<double>(filterScale) /
+                              static_cast<double>(out.scale);
+                quantizeMultiplier(real, op.multipliers[c], op.shifts[c]);
+            }
+        }
+
+        // Lifetimes of the activations this operator touches
+        int touched[2] = {op.input, op.output};
+        for (int t : touched)
+        {
+            TensorInfo &tensor = tensors[t];
+            tensor.firstOp = tensor.firstOp < 0 ? i : std::min(tensor.firstOp, i);
+            tensor.lastOp = std::max(tensor.lastOp, i);
+        }
+    }
+
+    if (!planArena(arena, tail))
+    {
+        return false;
+    }
+    usedBytes += arenaBytes - tail;
+    loaded = true;
+    return true;
+}
+
+// Greedy first-fit by size: largest buffers first, each at the lowest
+// offset that does not overlap a placed buffer with an overlapping lifetime
+bool ReferenceInferenceBackend::planArena(uint8_t *arena, size_t activationBytes)
+{
+    int order[MAX_TENSORS];
+    int count = 0;
+    for (int i = 0; i < tensorCount; i++)
+    {
+        if (!tensors[i].constant && tensors[i].firstOp >= 0 && tensors[i].type == TYPE_INT8)
+        {
+            order[count++] = i;
+        }
+    }
+    std::stable_sort(order, order + count, [this](int a, int b)
+                     { return tensors[a].bytes > tensors[b].bytes; });
+
+    size_t peak = 0;
+    for (int n = 0; n < count; n++)
+    {
+        TensorInfo &tensor = tensors[order[n]];
+        int conflicts[MAX_TENSORS];
+        int conflictCount = 0;
+        for (int p = 0; p < n; p++)
+        {
+            const TensorInfo &placed = tensors[order[p]];
+            if (placed.firstOp <= tensor.lastOp && tensor.firstOp <= placed.lastOp)
+            {
+                conflicts[conflictCount++] = order[p];
+            }
+        }
+        std::sort(conflicts, conflicts + conflictCount, [this](int a, int b)
+                  { return tensors[a].offset < tensors[b].offset; });
+
+        size_t offset = 0;
+        for (int c = 0; c < conflictCount; c++)
+        {
+            const TensorInfo &placed = tensors[conflicts[c]];
+            if (offset + tensor.bytes <= placed.offset)
+            {
+                break;
+            }
+            offset = std::max(offset, alignUp(placed.offset + placed.bytes, ARENA_ALIGNMENT));
+        }
+        tensor.offset = offset;
+        peak = std::max(peak, offset + tensor.bytes);
+    }
+
+    if (peak > activationBytes)
+    {
+        return fail("Arena too small");
+    }
+    for (int n = 0; n < count; n++)
+    {
+        tensors[order[n]].data = reinterpret_cast<int8_t *>(arena + tensors[order[n]].offset);
+    }
+    usedBytes = alignUp(peak, ARENA_ALIGNMENT);
+    return true;
+}
+
+bool ReferenceInferenceBackend::invoke()
+{
+    if (!loaded)
+    {
+        error = "No model loaded";
+        return false;
+    }
+    for (int i = 0; i < opCount; i++)
+    {
+        const Operation &op = ops[i];
+        switch (op.type)
+        {
+        case OP_CONV:
+            conv(op);
+            break;
+        case OP_DEPTHWISE:
+            depthwise(op);
+            break;
+        case OP_FULLY_CONNECTED:
+            fullyConnected(op);
+            break;
+        case OP_AVERAGE_POOL:
+        case OP_MAX_POOL:
+            pool(op);
+            break;
+        case OP_RESHAPE:
+            memmove(tensors[op.output].data, tensors[op.input].data, tensors[op.output].bytes);
+            break;
+        }
+    }
+    return true;
+}
+
+// reference_integer_ops::ConvPerChannel
+void ReferenceInferenceBackend::conv(const Operation &op)
+{
+    const TensorInfo &in = tensors[op.input];
+    const TensorInfo &filter = tensors[op.filter];
+    const TensorInfo &out = tensors[op.output];
+    const int inH = in.dims[1], inW = in.dims[2], inC = in.dims[3];
+    const int outH = out.dims[1], outW = out.dims[2], outC = out.dims[3];
+    const int filterH = filter.dims[1], filterW = filter.dims[2];
+    const int32_t inputOffset = -in.zeroPoint;
+
+    for (int oy = 0; oy < outH; oy++)
+    {
+        for (int ox = 0; ox < outW; ox++)
+        {
+            const int originY = oy * op.strideH - op.padH;
+            const int originX = ox * op.strideW - op.padW;
+            for (int oc = 0; oc < outC; oc++)
+            {
+                int32_t acc = 0;
+                for (int ky = 0; ky < filterH; ky++)
+                {
+                    const int iy = originY + ky * op.dilationH;
+                    if (iy < 0 || iy >= inH)
+                    {
+                        continue;
+                    }
+                    for (int kx = 0; kx < filterW; kx++)
+                    {
+                        const int ix = originX + kx * op.dilationW;
+                        if (ix < 0 || ix >= inW)
+                        {
+                            continue;
+                        }
+                        const int8_t *pixel = in.data + (iy * inW + ix) * inC;
+                        const int8_t *weights = filter.data + ((oc * filterH + ky) * filterW + kx) * inC;
+                        for (int ic = 0; ic < inC; ic++)
+                        {
+                            acc += (pixel[ic] + inputOffset) * weights[ic];
+                        }
+                    }
+                }
+                if (op.bias >= 0)
+                {
+                    acc += readInt32(tensors[op.bias].data + 4 * oc);
+                }
+                acc = requantize(acc, op.multipliers[oc], op.shifts[oc]) + out.zeroPoint;
+                acc = std::min(std::max(acc, op.activationMin), op.activationMax);
+                out.data[(oy * outW + ox) * outC + oc] = static_cast<int8_t>(acc);
+            }
+        }
+    }
+}
+
+// reference_integer_ops::DepthwiseConvPerChannel
+void ReferenceInferenceBackend::depthwise(const Operation &op)
+{
+    const TensorInfo &in = tensors[op.input];
+    const TensorInfo &filter = tensors[op.filter];
+    const TensorInfo &out = tensors[op.output];
+    const int inH = in.dims[1], inW = in.dims[2], inC = in.dims[3];
+    const int outH = out.dims[1], outW = out.dims[2], outC = out.dims[3];
+    const int filterH = filter.dims[1], filterW = filter.dims[2];
+    const int32_t inputOffset = -in.zeroPoint;
+
+    for (int oy = 0; oy < outH; oy++)
+    {
+        for (int ox = 0; ox < outW; ox++)
+        {
+            const int originY = oy * op.strideH - op.padH;
+            const int originX = ox * op.strideW - op.padW;
+            for (int ic = 0; ic < inC; ic++)
+            {
+                for (int m = 0; m < op.depthMultiplier; m++)
+                {
+                    const int oc = ic * op.depthMultiplier + m;
+                    int32_t acc = 0;
+                    for (int ky = 0; ky < filterH; ky++)
+                    {
+                        const int iy = originY + ky * op.dilationH;
+                        if (iy < 0 || iy >= inH)
+                        {
+                            continue;
+                        }
+                        for (int kx = 0; kx < filterW; kx++)
+                        {
+                            const int ix = originX + kx * op.dilationW;
+                            if (ix < 0 || ix >= inW)
+                            {
+                                continue;
+                            }
+                            acc += (in.data[(iy * inW + ix) * inC + ic] + inputOffset) *
+                                   filter.data[(ky * filterW + kx) * outC + oc];
+                        }
+                    }
+                    if (op.bias >= 0)
+                    {
+                        acc += readInt32(tensors[op.bias].data + 4 * oc);
+                    }
+                    acc = requantize(acc, op.multipliers[oc], op.shifts[oc]) + out.zeroPoint;
+                    acc = std::min(std::max(acc, op.activationMin), op.activationMax);
+                    out.data[(oy * outW + ox) * outC + oc] = static_cast<int8_t>(acc);
+                }
+            }
+        }
+    }
+}
+
+// reference_integer_ops::FullyConnected
+void ReferenceInferenceBackend::fullyConnected(const Operation &op)
+{
+    const TensorInfo &in = tensors[op.input];
+    const TensorInfo &filter = tensors[op.filter];
+    const TensorInfo &out = tensors[op.output];
+    const int depth = filter.dims[1];
+    const int units = filter.dims[0];
+    const int batches = elements(in) / depth;
+    const int32_t inputOffset = -in.zeroPoint;
+
+    for (int b = 0; b < batches; b++)
+    {
+        const int8_t *row = in.data + b * depth;
+        for (int u = 0; u < units; u++)
+        {
+            const int8_t *weights = filter.data + u * depth;
+            int32_t acc = 0;
+            for (int d = 0; d < depth; d++)
+            {
+                acc += (row[d] + inputOffset) * weights[d];
+            }
+            if (op.bias >= 0)
+            {
+                acc += readInt32(tensors[op.bias].data + 4 * u);
+            }
+            acc = requantize(acc, op.multipliers[u], op.shifts[u]) + out.zeroPoint;
+            acc = std::min(std::max(acc, op.activationMin), op.activationMax);
+            out.data[b * units + u] = static_cast<int8_t>(acc);
+        }
+    }
+}
+
+// reference_integer_ops::AveragePool / MaxPool
+void ReferenceInferenceBackend::pool(const Operation &op)
+{
+    const TensorInfo &in = tensors[op.input];
+    const TensorInfo &out = tensors[op.output];
+    const int inH = in.dims[1], inW = in.dims[2], depth = in.dims[3];
+    const int outH = out.dims[1], outW = out.dims[2];
+
+    for (int oy = 0; oy < outH; oy++)
+    {
+        for (int ox = 0; ox < outW; ox++)
+        {
+            const int originY = oy * op.strideH - op.padH;
+            const int originX = ox * op.strideW - op.padW;
+            const int startY = std::max(0, -originY);
+            const int endY = std::min(op.filterH, inH - originY);
+            const int startX = std::max(0, -originX);
+            const int endX = std::min(op.filterW, inW - originX);
+            for (int c = 0; c < depth; c++)
+            {
+                int32_t acc = op.type == OP_MAX_POOL ? -128 : 0;
+                int count = 0;
+                for (int ky = startY; ky < endY; ky++)
+                {
+                    for (int kx = startX; kx < endX; kx++)
+                    {
+                        int32_t value = in.data[((originY + ky) * inW + originX + kx) * depth + c];
+                        acc = op.type == OP_MAX_POOL ? std::max(acc, value) : acc + value;
+                        count++;
+                    }
+                }
+                if (op.type == OP_AVERAGE_POOL && count > 0)
+                {
+                    acc = acc > 0 ? (acc + count / 2) / count : (acc - count / 2) / count;
+                }
+                acc = std::min(std::max(acc, op.activationMin), op.activationMax);
+                out.data[(oy * outW + ox) * depth + c] = static_cast<int8_t>(acc);
+            }
+        }
+    }
+}
+
+InferenceBackend &defaultInferenceBackend()
+{
+    static ReferenceInferenceBackend backend;
+    return backend;
+}
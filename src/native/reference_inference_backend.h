@@ -0,0 +1,97 @@
+#pragma once
+
+#include "hal/inference_backend.h"
+
+// Host interpreter for int8 .tflite models. Follows TensorFlow Lite Micro's
+// reference integer kernels (the arithmetic ESP-NN reproduces): int32
+// accumulation, per-channel requantisation with the same fixed-point
+// multipliers and rounding, fused activations as clamps. Activations are
+// planned into the arena with a greedy first-fit by size, as TFLM's
+// GreedyMemoryPlanner does, and the per-channel multipliers are kept at the
+// arena's tail, so arenaUsedBytes() is comparable with the device figure.
+//
+// Supported: one subgraph with one input and one output; CONV_2D,
+// DEPTHWISE_CONV_2D, FULLY_CONNECTED, AVERAGE_POOL_2D, MAX_POOL_2D and
+// RESHAPE on int8 tensors with int32 biases; NONE, RELU and RELU6
+// activations. The model is read in place and never allocated from.
+class ReferenceInferenceBackend : public InferenceBackend
+{
+public:
+    static const int MAX_TENSORS = 64;
+    static const int MAX_OPS = 32;
+    static const size_t ARENA_ALIGNMENT = 16;
+
+    bool load(const uint8_t *model, size_t modelBytes, uint8_t *arena, size_t arenaBytes) override;
+    void unload() override;
+    Tensor input() override { return view(inputTensor); }
+    Tensor output() override { return view(outputTensor); }
+    bool invoke() override;
+    size_t arenaUsedBytes() const override { return usedBytes; }
+    const char *name() const override { return "reference"; }
+    const char *lastError() const override { return error; }
+
+private:
+    enum OpType
+    {
+        OP_CONV,
+        OP_DEPTHWISE,
+        OP_FULLY_CONNECTED,
+        OP_AVERAGE_POOL,
+        OP_MAX_POOL,
+        OP_RESHAPE
+    };
+
+    struct TensorInfo
+    {
+        int8_t *data;          // arena for activations, model for constants
+        const uint8_t *scales; // little-endian float32 per channel, in the model
+        int scaleCount;
+        int dims[4];
+        int dimCount;
+        size_t bytes;
+        int type;
+        float scale;
+        int zeroPoint;
+        bool constant;
+        int firstOp;  // lifetime, for planning
+        int lastOp;
+        size_t offset;
+    };
+
+    struct Operation
+    {
+        OpType type;
+        int input;
+        int filter; // weights, or -1
+        int bias;   // -1 when absent
+        int output;
+        int strideW, strideH;
+        int dilationW, dilationH;
+        int filterW, filterH; // pools
+        int depthMultiplier;
+        int padW, padH;
+        int activationMin, activationMax;
+        int32_t *multipliers; // per output channel, in the arena tail
+        int32_t *shifts;
+    };
+
+    TensorInfo tensors[MAX_TENSORS];
+    Operation ops[MAX_OPS];
+    int tensorCount = 0;
+    int opCount = 0;
+    int inputTensor = -1;
+    int outputTensor = -1;
+    size_t usedBytes = 0;
+    bool loaded = false;
+    const char *error = "";
+
+    Tensor view(int index);
+    bool fail(const char *message);
+    bool planArena(uint8_t *arena, size_t activationBytes);
+    int32_t elements(const TensorInfo &tensor) const;
+
+    void conv(const Operation &op);
+    void depthwise(const Operation &op);
+    void fullyConnected(const Operation &op);
+    void pool(const Operation &op);
+};
@@ -0,0 +1,287 @@
+#include "replay_camera_backend.h"
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <img_converters.h>
+#include "rgbz_codec.h"
+
+#include <algorithm>
+
+const char *ReplayCameraBackend::TAG = "ReplayCamera";
+
+ReplayCameraBackend &ReplayCameraBackend::getInstance()
+{
+    static ReplayCameraBackend instance;
+    return instance;
+}
+
+CameraBackend &defaultCameraBackend()
+{
+    return ReplayCameraBackend::getInstance();
+}
+
+ReplayCameraBackend::ReplayCameraBackend()
+{
+    const char *dir = getenv("MIDDLEFOX_REPLAY_DIR");
+    if (dir)
+    {
+        replayDir = dir;
+    }
+    const char *fps = getenv("MIDDLEFOX_CAMERA_FPS");
+    if (fps)
+    {
+        frameRate = static_cast<unsigned int>(atoi(fps));
+    }
+}
+
+bool ReplayCameraBackend::init(const CameraProfile &profile)
+{
+    uint16_t width, height;
+    if ((profile.format != PIXFORMAT_RGB565 && profile.format != PIXFORMAT_JPEG) ||
+        !CameraProfile::dimensions(profile.frameSize, width, height))
+    {
+        error = std::string("Profile ") + profile.name + " is not supported by the replay camera";
+        return false;
+    }
+
+    files.clear();
+    nextFile = 0;
+    served = 0;
+    nextFrameDueUs = micros();
+    active = profile;
+    pending = profile;
+    staleLeft = 0;
+    source.assign(FRAME_WIDTH * FRAME_HEIGHT * 2, 0);
+
+    if (!replayDir.empty())
+    {
+        DIR *dir = opendir(replayDir.c_str());
+        if (!dir)
+        {
+            error = "Cannot open replay directory " + replayDir;
+            return false;
+        }
+        while (struct dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if ((name.size() > 4 && name.compare(name.size() - 4, 4, ".rgb") == 0) ||
+                (name.size() > 5 && name.compare(name.size() - 5, 5, ".rgbz") == 0))
+            {
+                files.push_back(replayDir + "/" + name);
+            }
+        }
+        closedir(dir);
+        std::sort(files.begin(), files.end());
+        ESP_LOGI(TAG, "Replaying %u frames from %s", (unsigned)files.size(), replayDir.c_str());
+    }
+
+    error.clear();
+    return true;
+}
+
+void ReplayCameraBackend::deinit()
+{
+    files.clear();
+    source.clear();
+    source.shrink_to_fit();
+    pixels.clear();
+    pixels.shrink_to_fit();
+    free(jpeg);
+    jpeg = nullptr;
+    inUse = false;
+}
+
+int ReplayCameraBackend::reconfigure(const CameraProfile &running, const CameraProfile &target)
+{
+    if (CameraProfile::needsReallocation(running, target))
+    {
+        error = "Profile change needs new frame buffers";
+        return -1;
+    }
+    pending = target;
+    staleLeft = STALE_FRAMES;
+    return CameraProfile::delta(running, target);
+}
+
+camera_fb_t *ReplayCameraBackend::acquire()
+{
+    if (inUse)
+    {
+        error = "Frame buffer still held by a consumer";
+        return nullptr;
+    }
+
+    waitForExposure();
+
+    if (files.empty())
+    {
+        renderSynthetic();
+    }
+    else if (!loadNextFile())
+    {
+        return nullptr;
+    }
+
+    if (staleLeft > 0)
+    {
+        staleLeft--;
+    }
+    else
+    {
+        active = pending;
+    }
+    if (!present(active))
+    {
+        return nullptr;
+    }
+
+    unsigned long now = micros();
+    frame.timestamp.tv_sec = now / 1000000UL;
+    frame.timestamp.tv_usec = now % 1000000UL;
+    served++;
+    inUse = true;
+    return &frame;
+}
+
+void ReplayCameraBackend::release(camera_fb_t *fb)
+{
+    if (fb == &frame)
+    {
+        inUse = false;
+    }
+}
+
+void ReplayCameraBackend::waitForExposure()
+{
+    if (frameRate == 0)
+    {
+        return;
+    }
+
+    unsigned long now = micros();
+    long remaining = static_cast<long>(nextFrameDueUs - now);
+    if (remaining > 0)
+    {
+        delay((remaining + 999) / 1000);
+        now = micros();
+    }
+    // Like the sensor, a late request gets the next frame, not a burst
+    nextFrameDueUs = now + 1000000UL / frameRate;
+}
+
+bool ReplayCameraBackend::loadNextFile()
+{
+    const std::string &path = files[nextFile];
+    nextFile = (nextFile + 1) % files.size();
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        error = "Cannot open " + path;
+        return false;
+    }
+    if (path.compare(path.size() - 5, 5, ".rgbz") != 0)
+    {
+        size_t read = fread(source.data(), 1, source.size(), f);
+        fclose(f);
+        if (read != source.size())
+        {
+            error = "Short replay frame " + path;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> packed;
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    {
+        packed.insert(packed.end(), chunk, chunk + read);
+    }
+    fclose(f);
+
+    Rgbz::Header header;
+    if (!Rgbz::readHeader(packed.data(), packed.size(), header) || header.width != FRAME_WIDTH ||
+        header.height != FRAME_HEIGHT || !Rgbz::decode(packed.data(), packed.size(), source.data(), source.size()))
+    {
+        error = "Bad compressed replay frame " + path;
+        return false;
+    }
+    return true;
+}
+
+void ReplayCameraBackend::renderSynthetic()
+{
+    // Sky over grey road with two lane markings that drift with the frame index
+    int shift = static_cast<int>(served % 40) - 20;
+    for (int y = 0; y < FRAME_HEIGHT; y++)
+    {
+        for (int x = 0; x < FRAME_WIDTH; x++)
+        {
+            uint16_t px;
+            if (y < FRAME_HEIGHT / 3)
+            {
+                px = 0x5D7F; // sky blue
+            }
+            else
+            {
+                int depth = y - FRAME_HEIGHT / 3;
+                int half = 10 + depth;
+                int centre = FRAME_WIDTH / 2 + shift * depth / FRAME_HEIGHT;
+                int left = centre - half;
+                int right = centre + half;
+                bool marking = abs(x - left) < 2 + depth / 40 || abs(x - right) < 2 + depth / 40;
+                px = marking ? 0xFFFF : 0x4208; // white paint on dark grey
+            }
+            source[(y * FRAME_WIDTH + x) * 2] = px >> 8;
+            source[(y * FRAME_WIDTH + x) * 2 + 1] = px & 0xFF;
+        }
+    }
+}
+
+bool ReplayCameraBackend::present(const CameraProfile &profile)
+{
+    uint16_t width, height;
+    CameraProfile::dimensions(profile.frameSize, width, height);
+    lastProfile = profile.name;
+
+    // Nearest-neighbour scale from the scene to the sensor output size
+    pixels.resize(static_cast<size_t>(width) * height * 2);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *row = &source[(y * FRAME_HEIGHT / height) * FRAME_WIDTH * 2];
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t *px = &row[(x * FRAME_WIDTH / width) * 2];
+            pixels[(y * width + x) * 2] = px[0];
+            pixels[(y * width + x) * 2 + 1] = px[1];
+        }
+    }
+
+    frame.buf = pixels.data();
+    frame.len = pixels.size();
+    frame.width = width;
+    frame.height = height;
+    frame.format = PIXFORMAT_RGB565;
+    if (profile.format != PIXFORMAT_JPEG)
+    {
+        return true;
+    }
+
+    // Sensor quality runs 0 (best) to 63; the encoder takes 1 to 100 (best)
+    free(jpeg);
+    jpeg = nullptr;
+    size_t jpegLen = 0;
+    if (!frame2jpg(&frame, 100 - profile.jpegQuality * 99 / 63, &jpeg, &jpegLen))
+    {
+        error = "JPEG encoding failed";
+        return false;
+    }
+    frame.buf = jpeg;
+    frame.len = jpegLen;
+    frame.format = PIXFORMAT_JPEG;
+    return true;
+}
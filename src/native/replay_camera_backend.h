@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "hal/camera_backend.h"
+
+// Host frame source. Replays raw RGB565 captures (*.rgb or compressed *.rgbz,
+// 240x240, as written by DataCollector) from MIDDLEFOX_REPLAY_DIR in name order, looping at the
+// end. Without a replay directory it renders a moving synthetic road scene.
+// Frames are scaled and encoded to the active profile's size and format.
+// A non-zero frame rate (MIDDLEFOX_CAMERA_FPS) paces acquire() like a sensor
+// would; zero serves frames as fast as they are requested.
+//
+// Like the driver's frame ring, the first STALE_FRAMES frames after a
+// reconfigure() still carry the previous profile's settings.
+class ReplayCameraBackend : public CameraBackend
+{
+public:
+    static ReplayCameraBackend &getInstance();
+
+    bool init(const CameraProfile &profile) override;
+    void deinit() override;
+    int reconfigure(const CameraProfile &running, const CameraProfile &target) override;
+    camera_fb_t *acquire() override;
+    void release(camera_fb_t *fb) override;
+    const char *lastError() const override { return error.c_str(); }
+
+    void setReplayDirectory(const std::string &dir) { replayDir = dir; }
+    void setFrameRate(unsigned int fps) { frameRate = fps; }
+    size_t framesServed() const { return served; }
+    // Profile the last acquired frame was produced with
+    const char *lastFrameProfile() const { return lastProfile; }
+
+    static const int FRAME_WIDTH = 240;
+    static const int FRAME_HEIGHT = 240;
+    static const int STALE_FRAMES = 2;
+
+private:
+    ReplayCameraBackend();
+    static const char *TAG;
+
+    std::string replayDir;
+    std::vector<std::string> files;
+    size_t nextFile = 0;
+    size_t served = 0;
+    unsigned int frameRate = 0;
+    unsigned long nextFrameDueUs = 0;
+    bool inUse = false;
+    CameraProfile active = {};  // settings frames are produced with
+    CameraProfile pending = {}; // applied once the stale frames are out
+    int staleLeft = 0;
+    const char *lastProfile = "";
+    std::vector<uint8_t> source; // scene at FRAME_WIDTH x FRAME_HEIGHT
+    std::vector<uint8_t> pixels; // scene at the profile's frame size
+    uint8_t *jpeg = nullptr;
+    camera_fb_t frame = {};
+    std::string error;
+
+    bool loadNextFile();
+    void renderSynthetic();
+    bool present(const CameraProfile &profile);
+    void waitForExposure();
+};
@@ -0,0 +1,175 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "camera_manager.h"
+#include "config.h"
+#include "host_commands.h"
+#include "replay_camera_backend.h"
+#include "rgbz_codec.h"
+
+namespace
+{
+    bool readFile(const std::string &path, std::vector<uint8_t> &out)
+    {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+        {
+            return false;
+        }
+        out.clear();
+        uint8_t chunk[4096];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        {
+            out.insert(out.end(), chunk, chunk + read);
+        }
+        fclose(f);
+        return true;
+    }
+
+    // Writes <name>.rgb next to each <name>.rgbz
+    int unpackFiles(int argc, char **argv)
+    {
+        if (argc < 1)
+        {
+            fprintf(stderr, "usage: rgbz unpack <file.rgbz>...\n");
+            return 2;
+        }
+        int failures = 0;
+        for (int i = 0; i < argc; i++)
+        {
+            std::string path = argv[i];
+            std::vector<uint8_t> packed;
+            Rgbz::Header header;
+            if (!readFile(path, packed) || !Rgbz::readHeader(packed.data(), packed.size(), header))
+            {
+                fprintf(stderr, "%s: not an rgbz file\n", path.c_str());
+                failures++;
+                continue;
+            }
+            std::vector<uint8_t> pixels(Rgbz::frameBytes(header.width, header.height));
+            if (!Rgbz::decode(packed.data(), packed.size(), pixels.data(), pixels.size()))
+            {
+                fprintf(stderr, "%s: corrupt\n", path.c_str());
+                failures++;
+                continue;
+            }
+
+            std::string out = path.size() > 5 && path.compare(path.size() - 5, 5, RGBZ_EXTENSION) == 0
+                                  ? path.substr(0, path.size() - 1)
+                                  : path + RGB_EXTENSION;
+            FILE *f = fopen(out.c_str(), "wb");
+            bool written = f && fwrite(pixels.data(), 1, pixels.size(), f) == pixels.size();
+            if (f)
+            {
+                fclose(f);
+            }
+            if (!written)
+            {
+                fprintf(stderr, "cannot write %s\n", out.c_str());
+                failures++;
+                continue;
+            }
+            printf("%s -> %s (%ux%u, %.2fx)\n", path.c_str(), out.c_str(), header.width, header.height,
+                   static_cast<double>(pixels.size()) / packed.size());
+        }
+        return failures ? 1 : 0;
+    }
+
+    struct Totals
+    {
+        uint64_t raw = 0;
+        uint64_t packed = 0;
+        uint64_t encodeUs = 0;
+        uint64_t decodeUs = 0;
+        int stored = 0;
+    };
+
+    // Encodes and decodes one frame, timing both
+    void measure(const uint8_t *pixels, uint16_t width, uint16_t height, Totals &totals)
+    {
+        size_t raw = Rgbz::frameBytes(width, height);
+        std::vector<uint8_t> packed(Rgbz::maxEncodedSize(width, height));
+        std::vector<uint8_t> decoded(raw);
+
+        unsigned long start = micros();
+        size_t len = Rgbz::encode(pixels, width, height, packed.data(), packed.size());
+        totals.encodeUs += micros() - start;
+        start = micros();
+        Rgbz::decode(packed.data(), len, decoded.data(), decoded.size());
+        totals.decodeUs += micros() - start;
+
+        Rgbz::Header header;
+        totals.raw += raw;
+        totals.packed += len;
+        totals.stored += Rgbz::readHeader(packed.data(), len, header) && header.method == Rgbz::METHOD_STORED ? 1 : 0;
+    }
+
+    void printTotals(const char *name, int frames, const Totals &totals)
+    {
+        printf("%-12s %6d %8.3f %6.2f %10.1f %10.1f %7d\n", name, frames,
+               totals.packed ? static_cast<double>(totals.raw) / totals.packed : 0.0,
+               totals.raw ? totals.packed * 8.0 / (totals.raw / 2) : 0.0,
+               totals.encodeUs ? static_cast<double>(totals.raw) / totals.encodeUs : 0.0,
+               totals.decodeUs ? static_cast<double>(totals.raw) / totals.decodeUs : 0.0, totals.stored);
+    }
+}
+
+// Compresses recorded dataset frames and prints ratio, bits per pixel and
+// encode/decode throughput, next to incompressible noise for scale. The
+// round-trip and damaged-stream checks are test/test_rgbz.
+// "rgbz unpack <file.rgbz>..." converts extracted frames back to .rgb.
+int runRgbz(int argc, char **argv)
+{
+    if (argc > 0 && strcmp(argv[0], "unpack") == 0)
+    {
+        return unpackFiles(argc - 1, argv + 1);
+    }
+    int frames = argc > 0 ? atoi(argv[0]) : 50;
+
+    ReplayCameraBackend::getInstance().setFrameRate(0);
+    CameraManager &camera = CameraManager::getInstance();
+    if (!camera.begin(CameraProfile::DATASET))
+    {
+        fprintf(stderr, "camera failed to start: %s\n", camera.lastError());
+        return 1;
+    }
+
+    printf("%-12s %6s %8s %6s %10s %10s %7s\n", "source", "frames", "ratio", "bpp", "enc MB/s", "dec MB/s", "stored");
+    Totals recorded;
+    uint16_t width = 0, height = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        FrameRef frame = camera.captureShared();
+        if (!frame)
+        {
+            fprintf(stderr, "capture failed: %s\n", camera.lastError());
+            camera.releaseCamera();
+            return 1;
+        }
+        width = frame->width;
+        height = frame->height;
+        measure(frame.data(), width, height, recorded);
+    }
+    camera.releaseCamera();
+    printTotals("dataset", frames, recorded);
+
+    std::mt19937 random(7);
+    std::vector<uint8_t> pixels(Rgbz::frameBytes(width, height));
+    Totals noise;
+    for (int i = 0; i < frames; i++)
+    {
+        for (uint8_t &byte : pixels)
+        {
+            byte = random();
+        }
+        measure(pixels.data(), width, height, noise);
+    }
+    printTotals("noise", frames, noise);
+    printf("\nthroughput is this host's; the device encodes from PSRAM at a fraction of it\n");
+    return 0;
+}
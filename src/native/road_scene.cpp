@@ -0,0 +1,108 @@
+#include "road_scene.h"
+#include <math.h>
+#include <algorithm>
+
+namespace RoadScene
+{
+    double lineX(const Road &road, double bottom, double y)
+    {
+        double t = (y - road.vanishY) / (HEIGHT - road.vanishY);
+        return road.vanishX + (bottom - road.vanishX) * t;
+    }
+
+    LaneResult truth(const Road &road)
+    {
+        LaneResult result = {};
+        double top = HEIGHT * LaneResult::ROI_TOP;
+        result.left = {true, static_cast<float>(road.leftBottom / WIDTH),
+                       static_cast<float>(lineX(road, road.leftBottom, top) / WIDTH), 1};
+        result.right = {true, static_cast<float>(road.rightBottom / WIDTH),
+                        static_cast<float>(lineX(road, road.rightBottom, top) / WIDTH), 1};
+        return result;
+    }
+
+    Road randomRoad(int index, std::mt19937 &random)
+    {
+        std::uniform_real_distribution<double> unit(0, 1);
+        Road road = {};
+        double shift = -30 + 60 * unit(random);
+        double half = 75 + 20 * unit(random);
+        road.vanishX = WIDTH / 2 - 20 + 40 * unit(random);
+        road.vanishY = HEIGHT * (0.36 + 0.1 * unit(random));
+        road.leftBottom = WIDTH / 2 + shift - half;
+        road.rightBottom = WIDTH / 2 + shift + half;
+        road.paint = index % 10 != 9;
+        road.dashedRight = unit(random) < 0.5;
+        road.yellowLeft = unit(random) < 0.3;
+        road.asphaltLuma = 60 + random() % 30;
+        road.paintLuma = unit(random) < 0.2 ? road.asphaltLuma + 60 : 200 + random() % 50;
+        road.dashPhase = 120 * unit(random);
+        road.shadow = unit(random) < 0.4;
+        road.shadowTop = HEIGHT / 2 + random() % (HEIGHT / 3);
+        road.shadowBottom = road.shadowTop + 10 + random() % 30;
+        road.car = unit(random) < 0.3;
+        return road;
+    }
+
+    uint16_t grey(int luma)
+    {
+        luma = luma < 0 ? 0 : luma > 255 ? 255 : luma;
+        return ((luma >> 3) << 11) | ((luma >> 2) << 5) | (luma >> 3);
+    }
+
+    void render(const Road &road, std::mt19937 &random, std::vector<uint8_t> &frame)
+    {
+        frame.resize(WIDTH * HEIGHT * 2);
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            double cy = y + 0.5;
+            double t = (cy - road.vanishY) / (HEIGHT - road.vanishY);
+            double halfWidth = 0.5 + 3.5 * t;
+            double left = lineX(road, road.leftBottom, cy);
+            double right = lineX(road, road.rightBottom, cy);
+            bool dash = fmod(150 / std::max(t, 1e-3) + road.dashPhase, 120) < 60;
+            // Tree shadow with a ragged, mostly horizontal edge
+            int raggedTop = road.shadowTop + static_cast<int>(4 * sin(y * 0.7));
+            for (int x = 0; x < WIDTH; x++)
+            {
+                uint16_t pixel;
+                if (t <= 0)
+                {
+                    pixel = grey(180 - y / 4 + static_cast<int>(random() % 7) - 3); // sky
+                }
+                else
+                {
+                    double cx = x + 0.5;
+                    int luma = road.asphaltLuma;
+                    bool onLeft = fabs(cx - left) < halfWidth;
+                    bool onRight = fabs(cx - right) < halfWidth && (!road.dashedRight || dash);
+                    if (road.paint && (onLeft || onRight))
+                    {
+                        luma = road.paintLuma;
+                    }
+                    if (road.car && y > road.vanishY + 20 && y < road.vanishY + 45 && fabs(cx - road.vanishX) < 25)
+                    {
+                        luma = 25;
+                    }
+                    if (road.shadow && y >= raggedTop + static_cast<int>(6 * sin(x * 0.05)) && y < road.shadowBottom)
+                    {
+                        luma = luma * 6 / 10;
+                    }
+                    luma += static_cast<int>(random() % 13) - 6;
+                    if (road.paint && onLeft && road.yellowLeft && luma > road.asphaltLuma + 30)
+                    {
+                        // Yellow paint: same luma, strong chroma
+                        int r = std::min(255, luma + 40), g = std::min(255, luma + 10), b = luma / 3;
+                        pixel = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                    }
+                    else
+                    {
+                        pixel = grey(luma);
+                    }
+                }
+                frame[(y * WIDTH + x) * 2] = pixel >> 8;
+                frame[(y * WIDTH + x) * 2 + 1] = pixel & 0xFF;
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include "lane_result.h"
+
+// Rendered road scenes with known lane boundaries, for the lane harnesses:
+// 240x240 big-endian RGB565 frames like the dataset and inference profiles
+namespace RoadScene
+{
+    const int WIDTH = 240;
+    const int HEIGHT = 240;
+
+    // A straight road seen from the dashboard: both boundaries run from the
+    // vanishing point to their bottom positions, so the true LaneResult is
+    // known exactly
+    struct Road
+    {
+        double vanishX, vanishY;
+        double leftBottom, rightBottom; // pixels at the bottom edge
+        bool paint;                     // false: bare asphalt
+        bool dashedRight;
+        bool yellowLeft;
+        int paintLuma;
+        int asphaltLuma;
+        double dashPhase;
+        bool shadow;
+        int shadowTop, shadowBottom;
+        bool car; // a dark box ahead with strong horizontal edges
+    };
+
+    // x in pixels of the boundary ending at `bottom` on row y
+    double lineX(const Road &road, double bottom, double y);
+    // The LaneResult a perfect detector reports for the road
+    LaneResult truth(const Road &road);
+    // Random heading, lateral position, width, paint and clutter; every
+    // tenth index is unpainted
+    Road randomRoad(int index, std::mt19937 &random);
+    // Draws the road with sensor noise from `random`
+    void render(const Road &road, std::mt19937 &random, std::vector<uint8_t> &frame);
+}
@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "host_commands.h"
+#include "sd_manager.h"
+#include "session_container.h"
+
+static const char *TAG = "SessionTool";
+
+static const char *extensionFor(uint8_t type)
+{
+    switch (type)
+    {
+    case Session::RECORD_RAW:
+        return RGB_EXTENSION;
+    case Session::RECORD_RAWZ:
+        return RGBZ_EXTENSION;
+    case Session::RECORD_JPEG:
+        return JPG_EXTENSION;
+    case Session::RECORD_META:
+        return ".json";
+    default:
+        return ".bin";
+    }
+}
+
+int runExtract(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        fprintf(stderr, "usage: extract <session> [out_dir]\n");
+        return 2;
+    }
+
+    uint32_t sessionId = static_cast<uint32_t>(atoi(argv[0]));
+    std::string outDir = argc > 1 ? argv[1] : "session" + std::to_string(sessionId);
+
+    if (!SDManager::getInstance().begin())
+    {
+        ESP_LOGE(TAG, "Host storage unavailable");
+        return 1;
+    }
+
+    Session::Reader reader;
+    if (!reader.open(sessionId))
+    {
+        ESP_LOGE(TAG, "Cannot open session %u", static_cast<unsigned>(sessionId));
+        return 1;
+    }
+    mkdir(outDir.c_str(), 0755);
+
+    std::vector<uint8_t> payload;
+    size_t written = 0;
+    size_t corrupt = 0;
+    uint64_t bytes = 0;
+    unsigned long start = millis();
+    for (size_t i = 0; i < reader.recordCount(); i++)
+    {
+        Session::IndexEntry entry;
+        if (!reader.entry(i, entry))
+        {
+            corrupt++;
+            continue;
+        }
+        payload.resize(entry.length);
+        if (!reader.read(entry, payload.data()))
+        {
+            corrupt++;
+            continue;
+        }
+
+        std::string path = outDir + "/" + IMAGE_PREFIX + std::to_string(entry.frameIndex) + extensionFor(entry.type);
+        FILE *out = fopen(path.c_str(), "wb");
+        if (!out || fwrite(payload.data(), 1, payload.size(), out) != payload.size())
+        {
+            ESP_LOGE(TAG, "Cannot write %s", path.c_str());
+            if (out)
+            {
+                fclose(out);
+            }
+            return 1;
+        }
+        fclose(out);
+        written++;
+        bytes += entry.length;
+    }
+    unsigned long elapsed = millis() - start;
+
+    printf("session:   %u%s\n", static_cast<unsigned>(sessionId), reader.recovered() ? " (index rebuilt)" : "");
+    printf("records:   %zu\n", reader.recordCount());
+    printf("extracted: %zu (%llu bytes) to %s\n", written, static_cast<unsigned long long>(bytes), outDir.c_str());
+    printf("corrupt:   %zu\n", corrupt);
+    printf("elapsed:   %lu ms\n", elapsed);
+    return corrupt ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "crc32.h"
+#include "host_commands.h"
+#include "sd_manager.h"
+#include "session_container.h"
+
+namespace
+{
+    // One raw dataset frame per record, plus the record header and index
+    // entry a session writes alongside it
+    const size_t FRAME_BYTES = 240 * 240 * 2;
+    const size_t HEADER_BYTES = 20;
+    const size_t ENTRY_BYTES = 16;
+    const int FLUSH_EVERY = 8;
+
+    enum Method
+    {
+        REOPEN,    // open, append, close per frame
+        KEPT_OPEN, // kept-open File, flushed every FLUSH_EVERY frames
+        STREAM,    // SDStream through the write-behind cache
+        DIRECT,    // SDStream with the cache stopped, written straight through
+        METHOD_COUNT
+    };
+
+    const char *const METHOD_NAMES[METHOD_COUNT] = {"reopen", "kept-open", "stream", "direct"};
+
+    struct Result
+    {
+        unsigned long callerUs;
+        unsigned long totalUs; // caller time plus waiting for the card
+        uint32_t dataCrc;
+        uint32_t indexCrc;
+        bool ok;
+    };
+
+    void fillFrame(std::vector<uint8_t> &frame, uint32_t seed)
+    {
+        uint32_t state = seed * 2654435761u + 1;
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            state = state * 1103515245u + 12345u;
+            frame[i] = state >> 24;
+        }
+    }
+
+    uint32_t fileCrc(const char *path)
+    {
+        File file = SDManager::getInstance().openFile(path, FILE_READ);
+        if (!file)
+        {
+            return 0;
+        }
+        std::vector<uint8_t> buffer(64 * 1024);
+        uint32_t crc = 0;
+        size_t n;
+        while ((n = file.read(buffer.data(), buffer.size())) > 0)
+        {
+            crc = crc32Update(crc, buffer.data(), n);
+        }
+        file.close();
+        return crc;
+    }
+
+    // Appends to a File, or reopens it per frame when path is given
+    bool appendFile(File &file, const char *reopenPath, const uint8_t *data, size_t len)
+    {
+        if (reopenPath)
+        {
+            file = SDManager::getInstance().openFile(reopenPath, FILE_APPEND);
+        }
+        bool ok = file && file.write(data, len) == len;
+        if (reopenPath)
+        {
+            file.close();
+        }
+        return ok;
+    }
+
+    Result runMethod(Method method, int frames, uint32_t &expectedData, uint32_t &expectedIndex)
+    {
+        SDManager &sd = SDManager::getInstance();
+        char dataPath[48];
+        char indexPath[48];
+        snprintf(dataPath, sizeof(dataPath), "/storage_%s.bin", METHOD_NAMES[method]);
+        snprintf(indexPath, sizeof(indexPath), "/storage_%s.idx", METHOD_NAMES[method]);
+        sd.remove(dataPath);
+        sd.remove(indexPath);
+
+        Result result = {};
+        result.ok = true;
+        File dataFile;
+        File indexFile;
+        SDStream dataStream;
+        SDStream indexStream;
+        if (method == REOPEN)
+        {
+            // Created empty so every frame can append
+            sd.openFile(dataPath, FILE_WRITE).close();
+            sd.openFile(indexPath, FILE_WRITE).close();
+        }
+        else if (method == KEPT_OPEN)
+        {
+            dataFile = sd.openFile(dataPath, FILE_WRITE);
+            indexFile = sd.openFile(indexPath, FILE_WRITE);
+        }
+        else
+        {
+            dataStream = sd.openStream(dataPath);
+            indexStream = sd.openStream(indexPath);
+            result.ok = dataStream && indexStream;
+        }
+
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        uint32_t dataCrc = 0;
+        uint32_t indexCrc = 0;
+        uint32_t offset = 0;
+        unsigned long start = micros();
+        for (int i = 0; i < frames && result.ok; i++)
+        {
+            uint8_t header[HEADER_BYTES] = {};
+            uint8_t entry[ENTRY_BYTES] = {};
+            memcpy(header, &i, sizeof(i));
+            memcpy(entry, &offset, sizeof(offset));
+
+            // Frame generation is kept out of the caller time
+            unsigned long pause = micros();
+            fillFrame(frame, i);
+            dataCrc = crc32Update(crc32Update(dataCrc, header, sizeof(header)), frame.data(), frame.size());
+            indexCrc = crc32Update(indexCrc, entry, sizeof(entry));
+            start += micros() - pause;
+
+            const char *reopenData = method == REOPEN ? dataPath : nullptr;
+            const char *reopenIndex = method == REOPEN ? indexPath : nullptr;
+            if (method == STREAM || method == DIRECT)
+            {
+                result.ok = dataStream.write(header, sizeof(header)) == sizeof(header) &&
+                            dataStream.write(frame.data(), frame.size()) == frame.size() &&
+                            indexStream.write(entry, sizeof(entry)) == sizeof(entry);
+                if ((i + 1) % FLUSH_EVERY == 0)
+                {
+                    dataStream.sync();
+                    indexStream.sync();
+                }
+            }
+            else
+            {
+                result.ok = appendFile(dataFile, reopenData, header, sizeof(header)) &&
+                            appendFile(dataFile, reopenData, frame.data(), frame.size()) &&
+                            appendFile(indexFile, reopenIndex, entry, sizeof(entry));
+                if (method == KEPT_OPEN && (i + 1) % FLUSH_EVERY == 0)
+                {
+                    dataFile.flush();
+                    indexFile.flush();
+                }
+            }
+            offset += HEADER_BYTES + FRAME_BYTES;
+        }
+        result.callerUs = micros() - start;
+
+        dataFile.close();
+        indexFile.close();
+        dataStream.close();
+        indexStream.close();
+        result.ok = sd.writeCache().drain(10000) && result.ok;
+        result.totalUs = micros() - start;
+
+        expectedData = dataCrc;
+        expectedIndex = indexCrc;
+        result.dataCrc = fileCrc(dataPath);
+        result.indexCrc = fileCrc(indexPath);
+        sd.remove(dataPath);
+        sd.remove(indexPath);
+        return result;
+    }
+
+    // A stream still open when the cache stops: what it had written reaches
+    // the card and the file is closed; later writes through it are refused
+    bool endClosesStreams()
+    {
+        SDManager &sd = SDManager::getInstance();
+        const char *path = "/storage_end.bin";
+        std::vector<uint8_t> data(FRAME_BYTES / 3);
+        fillFrame(data, 7);
+        SDStream stream = sd.openStream(path);
+        bool ok = stream && stream.write(data.data(), data.size()) == data.size();
+        ok = sd.writeCache().end(10000) && ok;
+        ok = ok && stream.write(data.data(), data.size()) == 0;
+        ok = ok && fileCrc(path) == crc32Update(0, data.data(), data.size());
+        stream.close();
+        sd.remove(path);
+        return ok;
+    }
+
+    // A session whose segment write and, later, index write come back short:
+    // only the torn record fails, the rest read back through the index and
+    // the rebuild that replaces it. Needs the cache stopped, so that short
+    // writes reach the writer.
+    bool shortWritesRecover()
+    {
+        const uint32_t sessionId = 9000;
+        const int records = 24;
+        const int tornRecord = 10;     // cut mid-payload in segment 0
+        const int lastIndexed = 15;    // its successor's entry is cut
+        const size_t payloadBytes = 4096;
+        char segment0[48];
+        char segment1[48];
+        char index[48];
+        char directory[48];
+        Session::segmentPath(segment0, sizeof(segment0), sessionId, 0);
+        Session::segmentPath(segment1, sizeof(segment1), sessionId, 1);
+        Session::indexPath(index, sizeof(index), sessionId);
+        Session::sessionDirPath(directory, sizeof(directory), sessionId);
+
+        Session::Writer writer;
+        bool ok = writer.open(sessionId);
+        std::vector<uint8_t> payload(payloadBytes);
+        for (int i = 0; i < records && ok; i++)
+        {
+            if (i == tornRecord)
+            {
+                fs::injectShortWrite(segment0, sizeof(Session::RecordHeader) + payloadBytes / 2);
+            }
+            if (i == lastIndexed + 1)
+            {
+                fs::injectShortWrite(index, sizeof(Session::IndexEntry) / 2);
+            }
+            fillFrame(payload, i);
+            ok = writer.append(Session::RECORD_RAW, i, payload.data(), payload.size()) == (i != tornRecord);
+        }
+        writer.close();
+
+        Session::Reader reader;
+        ok = ok && reader.open(sessionId) && reader.recovered() && reader.recordCount() == records - 1;
+        for (size_t r = 0; ok && r < reader.recordCount(); r++)
+        {
+            Session::IndexEntry entry;
+            uint32_t frame = r < tornRecord ? r : r + 1;
+            std::vector<uint8_t> expected(payloadBytes);
+            fillFrame(expected, frame);
+            ok = reader.entry(r, entry) && entry.frameIndex == frame && entry.segment == (r < tornRecord ? 0 : 1) &&
+                 reader.read(entry, payload.data()) && payload == expected;
+        }
+        reader.close();
+
+        SDManager &sd = SDManager::getInstance();
+        sd.remove(segment0);
+        sd.remove(segment1);
+        sd.remove(index);
+        sd.remove(directory);
+        return ok;
+    }
+}
+
+// Writes the same session-shaped stream four ways and compares what the
+// caller pays per frame: the last after stopping the cache, as SDManager
+// falls back to when it cannot start, which also checks that stopping it
+// closes a stream left open and that a session survives short writes. Each
+// resulting file is read back and checked
+// against the checksum of what was written.
+int runStorage(int argc, char **argv)
+{
+    int frames = argc > 0 ? atoi(argv[0]) : 200;
+    SDManager &sd = SDManager::getInstance();
+    if (!sd.begin())
+    {
+        fprintf(stderr, "host storage unavailable\n");
+        return 1;
+    }
+    SDWriteCache &cache = sd.writeCache();
+    if (argc > 1)
+    {
+        cache.setSyncInterval(atoi(argv[1]));
+    }
+    cache.resetStats();
+
+    printf("%d frames of %u bytes, flush every %d frames, sync every %lu ms\n\n", frames,
+           static_cast<unsigned>(HEADER_BYTES + FRAME_BYTES), FLUSH_EVERY, cache.getSyncInterval());
+    printf("%-10s %14s %10s %10s %s\n", "method", "caller us/fr", "caller MB/s", "total MB/s", "content");
+    bool allOk = true;
+    SDWriteCache::Stats stats = {};
+    for (int m = 0; m < METHOD_COUNT; m++)
+    {
+        uint32_t expectedData = 0;
+        uint32_t expectedIndex = 0;
+        if (m == DIRECT)
+        {
+            // The fallback when the cache could not start; its stats end here
+            stats = cache.getStats();
+            bool closed = endClosesStreams();
+            printf("%-10s %s\n", "end", closed ? "streams written and closed, ok" : "MISMATCH");
+            bool recovered = shortWritesRecover();
+            printf("%-10s %s\n", "short", recovered ? "torn record sealed its segment, rest recovered, ok" : "MISMATCH");
+            allOk = allOk && closed && recovered && !cache.isRunning();
+        }
+        Result result = runMethod(static_cast<Method>(m), frames, expectedData, expectedIndex);
+        bool ok = result.ok && result.dataCrc == expectedData && result.indexCrc == expectedIndex;
+        double bytes = static_cast<double>(frames) * (HEADER_BYTES + FRAME_BYTES + ENTRY_BYTES);
+        printf("%-10s %14.1f %10.1f %10.1f %s\n", METHOD_NAMES[m],
+               frames ? static_cast<double>(result.callerUs) / frames : 0.0,
+               result.callerUs ? bytes / result.callerUs : 0.0,
+               result.totalUs ? bytes / result.totalUs : 0.0, ok ? "ok" : "MISMATCH");
+        allOk = allOk && ok;
+    }
+    cache.begin();
+
+    printf("\ncache:         %llu bytes accepted, %llu written (%.1f%% rewritten tails)\n",
+           static_cast<unsigned long long>(stats.bytesAccepted), static_cast<unsigned long long>(stats.bytesWritten),
+           stats.bytesAccepted ? 100.0 * (stats.bytesWritten - stats.bytesAccepted) / stats.bytesAccepted : 0.0);
+    printf("writes:        %u (%u aligned chunks, %u tails), %u errors\n", stats.writes, stats.alignedWrites,
+           stats.tailWrites, stats.errors);
+    printf("latency us:    p50 %u, p90 %u, p99 %u, max %u\n", stats.writeP50Us, stats.writeP90Us, stats.writeP99Us,
+           stats.writeMaxUs);
+    printf("queue:         max depth %u, %u stalls, %u metadata syncs\n", stats.maxQueueDepth, stats.stalls,
+           stats.syncs);
+    printf("\nhost files sit in the page cache; on the card the gap between methods is the FAT work per write\n");
+    printf("content:       %s\n", allOk ? "ok" : "MISMATCH");
+    return allOk && stats.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "camera_manager.h"
+#include "file_camera_backend.h"
+#include "host_commands.h"
+#include "lane_detector.h"
+#include "lane_tracker.h"
+#include "road_scene.h"
+#include "sd_manager.h"
+
+using namespace RoadScene;
+
+namespace
+{
+    const int CAMERA_FPS = 30;
+    const char *DRIVE_DIR = "/drive";
+
+    // Ten seconds of driving at CAMERA_FPS: the car weaves in its lane, the
+    // road bends left and right, the dashes stream past, tree shadows and a
+    // car ahead come and go, and from 6 s the car changes into the lane on
+    // its left, so both boundaries jump by a lane width
+    Road driveRoad(int frame)
+    {
+        const double pi = 3.14159265358979;
+        double t = static_cast<double>(frame) / CAMERA_FPS;
+        const double half = 85;
+        double shift = 20 * sin(2 * pi * t / 5);
+        if (t > 6)
+        {
+            double u = std::min((t - 6) / 1.5, 1.0);
+            shift += 2 * half * u * u * (3 - 2 * u);
+        }
+        if (shift > half)
+        {
+            shift -= 2 * half; // past the old left line: that is the right line now
+        }
+
+        Road road = {};
+        road.vanishX = WIDTH / 2 + 25 * sin(2 * pi * t / 8);
+        road.vanishY = 96 + 2 * sin(2 * pi * 1.3 * t);
+        road.leftBottom = WIDTH / 2 + shift - half;
+        road.rightBottom = WIDTH / 2 + shift + half;
+        road.paint = true;
+        road.dashedRight = true;
+        road.asphaltLuma = 75;
+        road.paintLuma = 220;
+        road.dashPhase = fmod(14.0 * frame, 120);
+        double shadowPhase = fmod(t, 3);
+        road.shadow = shadowPhase < 1;
+        road.shadowTop = HEIGHT / 2 + static_cast<int>(shadowPhase * (HEIGHT / 2 - 20));
+        road.shadowBottom = road.shadowTop + 25;
+        road.car = t > 3 && t < 5;
+        return road;
+    }
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+    }
+
+    double mean(const std::vector<double> &values)
+    {
+        double sum = 0;
+        for (double v : values)
+        {
+            sum += v;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    // One tracker interval replayed against the full-rate detections
+    struct Run
+    {
+        int interval;
+        LaneTracker tracker;
+        int detected = 0;
+        int forced = 0;
+        int agreed = 0; // boundaries found (or not) like the full-rate run
+        uint64_t busyUs = 0; // detection and prediction time
+        std::vector<double> bottomError, offsetError, truthError;
+    };
+
+    bool writeDrive(int frames, std::vector<LaneResult> &truths)
+    {
+        SDManager &sd = SDManager::getInstance();
+        sd.mkdir(DRIVE_DIR);
+        std::mt19937 random(7);
+        std::vector<uint8_t> pixels;
+        for (int i = 0; i < frames; i++)
+        {
+            Road road = driveRoad(i);
+            render(road, random, pixels);
+            truths.push_back(truth(road));
+            char path[64];
+            snprintf(path, sizeof(path), "%s/" IMAGE_PREFIX "%d" RGB_EXTENSION, DRIVE_DIR, i);
+            File file = sd.openFile(path, FILE_WRITE);
+            bool ok = file && file.write(pixels.data(), pixels.size()) == pixels.size();
+            if (file)
+            {
+                file.close();
+            }
+            if (!ok)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+// Replays a drive through the camera and compares LaneTracker at several
+// intervals with the classical detector run on every frame: the share of
+// frames and CPU time saved, how far the tracked boundaries and offset are
+// from the full-rate ones (and from the rendered truth where the full-rate
+// run has both lines), and how often the tracker asked for a detection
+// early. Frames are stamped at CAMERA_FPS. The drive is rendered to /drive
+// on the card unless MIDDLEFOX_REPLAY_SOURCE names recorded frames or a
+// session.
+int runTrack(int argc, char **argv)
+{
+    int frames = argc > 0 ? atoi(argv[0]) : 300;
+    SDManager &sd = SDManager::getInstance();
+    if (frames < 2 || !sd.begin())
+    {
+        fprintf(stderr, frames < 2 ? "track needs at least 2 frames\n" : "host storage unavailable\n");
+        return frames < 2 ? 2 : 1;
+    }
+
+    std::vector<LaneResult> truths;
+    const char *source = getenv("MIDDLEFOX_REPLAY_SOURCE");
+    if (!source)
+    {
+        if (!writeDrive(frames, truths))
+        {
+            fprintf(stderr, "cannot write the drive to %s\n", DRIVE_DIR);
+            return 1;
+        }
+        source = DRIVE_DIR;
+    }
+
+    FileCameraBackend &replay = FileCameraBackend::getInstance();
+    replay.setSource(source);
+    replay.setFrameRate(0);
+    replay.setLooping(false);
+    CameraManager &camera = CameraManager::getInstance();
+    camera.releaseCamera();
+    camera.setBackend(&replay);
+    if (!camera.begin(CameraProfile::INFERENCE))
+    {
+        fprintf(stderr, "replay failed to start: %s\n", camera.lastError());
+        camera.setBackend(nullptr);
+        return 1;
+    }
+
+    const int intervals[] = {1, 2, 3, LANE_TRACK_INTERVAL, 6, 8, 12};
+    std::vector<Run> runs;
+    for (int interval : intervals)
+    {
+        if (std::none_of(runs.begin(), runs.end(), [&](const Run &run)
+                         { return run.interval == interval; }))
+        {
+            runs.emplace_back();
+            runs.back().interval = interval;
+            runs.back().tracker.setInterval(interval);
+        }
+    }
+
+    // begin() consumed the first frame to confirm the profile
+    size_t position = replay.getStats().served;
+    LaneDetector detector;
+    int replayed = 0, fullBoth = 0;
+    uint64_t fullUs = 0;
+    std::vector<double> fullTruthError;
+    while (true)
+    {
+        FrameRef frame = camera.captureShared();
+        if (!frame)
+        {
+            break;
+        }
+        unsigned long frameMs = static_cast<unsigned long>(position) * 1000 / CAMERA_FPS;
+        const LaneResult *expected = position < truths.size() ? &truths[position] : nullptr;
+        position++;
+        replayed++;
+
+        LaneResult full;
+        if (!detector.detect(frame.get(), full))
+        {
+            fprintf(stderr, "frame %zu is not a lane frame\n", position - 1);
+            camera.setBackend(nullptr);
+            return 1;
+        }
+        full.frameMs = frameMs;
+        fullUs += full.latencyUs;
+        fullBoth += full.valid() ? 1 : 0;
+        if (expected && full.valid())
+        {
+            fullTruthError.push_back(fabs(full.offset() - expected->offset()));
+        }
+
+        for (Run &run : runs)
+        {
+            LaneResult result;
+            LaneTracker::Reason reason = run.tracker.check(frameMs);
+            if (reason != LaneTracker::REASON_NONE)
+            {
+                // The detector is deterministic: the full-rate result is
+                // what a detection on this frame gives
+                result = full;
+                unsigned long start = micros();
+                run.tracker.update(result);
+                run.busyUs += full.latencyUs + (micros() - start);
+                run.detected++;
+                run.forced += reason > LaneTracker::REASON_SCHEDULED ? 1 : 0;
+            }
+            else
+            {
+                unsigned long start = micros();
+                run.tracker.predict(frameMs, result);
+                run.busyUs += micros() - start;
+            }
+
+            const LaneLine *tracked[2] = {&result.left, &result.right};
+            const LaneLine *reference[2] = {&full.left, &full.right};
+            for (int side = 0; side < 2; side++)
+            {
+                run.agreed += tracked[side]->found == reference[side]->found ? 1 : 0;
+                if (tracked[side]->found && reference[side]->found)
+                {
+                    run.bottomError.push_back(fabs(tracked[side]->bottomX - reference[side]->bottomX) * WIDTH);
+                }
+            }
+            if (result.valid() && full.valid())
+            {
+                run.offsetError.push_back(fabs(result.offset() - full.offset()));
+            }
+            if (expected && result.valid() && full.valid())
+            {
+                run.truthError.push_back(fabs(result.offset() - expected->offset()));
+            }
+        }
+    }
+    camera.releaseCamera();
+    camera.setBackend(nullptr);
+    if (replayed == 0)
+    {
+        fprintf(stderr, "no frames replayed from %s\n", source);
+        return 1;
+    }
+
+    printf("source:        %s, %d frames at %d fps; detecting every frame finds both lines in %d\n", source,
+           replayed, CAMERA_FPS, fullBoth);
+    if (!truths.empty())
+    {
+        printf("full rate:     offset vs rendered truth mean %.3f, p95 %.3f; %.0f us per frame\n",
+               mean(fullTruthError), percentile(fullTruthError, 0.95), static_cast<double>(fullUs) / replayed);
+    }
+    printf("\n%8s %9s %7s %6s %6s %17s %19s %6s %13s\n", "interval", "detected", "frames", "cpu", "early",
+           "bottom px mean/95", "offset mean/95", "agree", "truth offset");
+    bool ok = true;
+    for (const Run &run : runs)
+    {
+        double frameSaving = 1 - static_cast<double>(run.detected) / replayed;
+        double cpuSaving = fullUs ? 1 - static_cast<double>(run.busyUs) / fullUs : 0;
+        double agreement = static_cast<double>(run.agreed) / (2 * replayed);
+        char truthColumn[24] = "-";
+        if (!truths.empty())
+        {
+            snprintf(truthColumn, sizeof(truthColumn), "%.3f", mean(run.truthError));
+        }
+        printf("%8d %9d %6.0f%% %5.0f%% %6d %8.2f / %6.2f %9.3f / %7.3f %5.0f%% %13s\n", run.interval,
+               run.detected, 100 * frameSaving, 100 * cpuSaving, run.forced, mean(run.bottomError),
+               percentile(run.bottomError, 0.95), mean(run.offsetError), percentile(run.offsetError, 0.95),
+               100 * agreement, truthColumn);
+
+        if (run.interval == 1)
+        {
+            // Every frame detected and passed through untouched
+            ok = ok && run.detected == replayed && mean(run.bottomError) == 0 && run.agreed == 2 * replayed;
+        }
+        if (run.interval == LANE_TRACK_INTERVAL && LANE_TRACK_INTERVAL > 1)
+        {
+            ok = ok && frameSaving >= 0.5 && mean(run.bottomError) <= 2 && percentile(run.offsetError, 0.95) <= 0.1 &&
+                 agreement >= 0.95;
+        }
+    }
+    printf("\nsaving in frames and cpu time against detecting every frame; errors against the full-rate run\n");
+    printf("track:         %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "capture_trigger.h"
+#include "host_commands.h"
+
+namespace
+{
+    const int WIDTH = 240;
+    const int HEIGHT = 240;
+    const int WORLD_WIDTH = 4 * WIDTH;
+    const unsigned long FIXED_INTERVAL_MS = 5000; // the old CAPTURE_INTERVAL_MS
+    const uint8_t DEVICE_THRESHOLD = 12;          // the native build overrides CAPTURE_CHANGE_THRESHOLD
+
+    struct Segment
+    {
+        const char *name;
+        unsigned long seconds;
+        int panPerSecond; // world pixels the view moves per second
+    };
+
+    const Segment DRIVE[] = {
+        {"parked", 300, 0},
+        {"cruise", 300, 2},
+        {"bends", 60, 30},
+        {"parked", 240, 0},
+    };
+
+    uint16_t rgb565(int r, int g, int b)
+    {
+        return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    }
+
+    // Roadside blocks over a road with dashed markings, wide enough to pan
+    // across; big-endian RGB565 like the sensor
+    std::vector<uint16_t> buildWorld()
+    {
+        std::vector<uint16_t> world(static_cast<size_t>(WORLD_WIDTH) * HEIGHT);
+        std::mt19937 random(11);
+        for (int x = 0; x < WORLD_WIDTH;)
+        {
+            int blockWidth = 12 + random() % 40;
+            int top = 20 + random() % 80;
+            uint16_t colour = rgb565(random() % 256, random() % 256, random() % 256);
+            for (int bx = x; bx < x + blockWidth && bx < WORLD_WIDTH; bx++)
+            {
+                for (int y = 0; y < HEIGHT / 2; y++)
+                {
+                    world[y * WORLD_WIDTH + bx] = y < top ? rgb565(120, 170, 230) : colour;
+                }
+            }
+            x += blockWidth;
+        }
+        for (int y = HEIGHT / 2; y < HEIGHT; y++)
+        {
+            for (int x = 0; x < WORLD_WIDTH; x++)
+            {
+                bool marking = abs(y - 3 * HEIGHT / 4) < 3 && (x / 30) % 2 == 0;
+                world[y * WORLD_WIDTH + x] = marking ? rgb565(240, 240, 240) : rgb565(70, 70, 75);
+            }
+        }
+        return world;
+    }
+
+    // View at the given pan offset with +-1 LSB of noise on every channel
+    void renderView(const std::vector<uint16_t> &world, int offset, std::mt19937 &random, std::vector<uint8_t> &out)
+    {
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            for (int x = 0; x < WIDTH; x++)
+            {
+                uint16_t pixel = world[y * WORLD_WIDTH + (x + offset) % WORLD_WIDTH];
+                int r = (pixel >> 11) + static_cast<int>(random() % 3) - 1;
+                int g = ((pixel >> 5) & 0x3F) + static_cast<int>(random() % 3) - 1;
+                int b = (pixel & 0x1F) + static_cast<int>(random() % 3) - 1;
+                r = r < 0 ? 0 : r > 31 ? 31 : r;
+                g = g < 0 ? 0 : g > 63 ? 63 : g;
+                b = b < 0 ? 0 : b > 31 ? 31 : b;
+                uint16_t value = (r << 11) | (g << 5) | b;
+                out[(y * WIDTH + x) * 2] = value >> 8;
+                out[(y * WIDTH + x) * 2 + 1] = value & 0xFF;
+            }
+        }
+    }
+
+    struct Policy
+    {
+        int stores = 0;
+        int onChange = 0;
+        int onMax = 0;
+        double maxGap = 0; // most scenery panned past between two stored frames
+        double last = -1;
+
+        void store(double offset)
+        {
+            if (last >= 0)
+            {
+                maxGap = offset - last > maxGap ? offset - last : maxGap;
+            }
+            last = offset;
+            stores++;
+        }
+    };
+}
+
+// Drives the capture trigger through a simulated trip (parked, cruising,
+// bends, parked) on a synthetic roadside panorama with sensor noise, on a
+// simulated clock, and compares it with a fixed 5 s interval: frames stored
+// per segment and the most scenery panned past between two stored frames.
+// Then checks that a store the caller drops does not move the reference.
+int runTrigger(int argc, char **argv)
+{
+    CaptureTrigger trigger;
+    uint32_t minMs = argc > 0 ? atoi(argv[0]) : 500;
+    uint32_t maxMs = argc > 1 ? atoi(argv[1]) : CAPTURE_MAX_INTERVAL_MS;
+    uint8_t threshold = argc > 2 ? atoi(argv[2]) : DEVICE_THRESHOLD;
+    if (minMs == 0 || !trigger.setIntervals(minMs, maxMs))
+    {
+        fprintf(stderr, "need 0 < min_ms <= max_ms\n");
+        return 2;
+    }
+    trigger.setThreshold(threshold);
+    bool rejectsInverted = !trigger.setIntervals(maxMs + 1, maxMs) && trigger.getSettings().minIntervalMs == minMs;
+
+    std::vector<uint16_t> world = buildWorld();
+    std::mt19937 random(5);
+    std::vector<uint8_t> pixels(WIDTH * HEIGHT * 2);
+    camera_fb_t fb = {};
+    fb.buf = pixels.data();
+    fb.len = pixels.size();
+    fb.width = WIDTH;
+    fb.height = HEIGHT;
+    fb.format = PIXFORMAT_RGB565;
+
+    printf("probe every %u ms, store after %u ms at the latest, threshold %u\n\n", static_cast<unsigned>(minMs),
+           static_cast<unsigned>(maxMs), threshold);
+    printf("%-8s %5s %8s | %6s %10s | %6s %7s %6s %10s\n", "segment", "secs", "pan px/s", "fixed", "max gap px",
+           "adapt", "change", "max", "max gap px");
+
+    bool ok = rejectsInverted;
+    int fixedTotal = 0;
+    int adaptiveTotal = 0;
+    double offset = 0;
+    unsigned long now = 0;
+    unsigned long fixedDue = 0;
+    for (const Segment &segment : DRIVE)
+    {
+        Policy fixed;
+        Policy adaptive;
+        unsigned long end = now + segment.seconds * 1000;
+        for (; now < end; now += minMs)
+        {
+            renderView(world, static_cast<int>(offset) % WORLD_WIDTH, random, pixels);
+            if (now >= fixedDue)
+            {
+                fixed.store(offset);
+                fixedDue = now + FIXED_INTERVAL_MS;
+            }
+            CaptureTrigger::Decision decision = trigger.shouldStore(&fb, now);
+            if (decision != CaptureTrigger::SKIP)
+            {
+                trigger.commit(now);
+                adaptive.store(offset);
+                adaptive.onChange += decision == CaptureTrigger::STORE_MAX_INTERVAL ? 0 : 1;
+                adaptive.onMax += decision == CaptureTrigger::STORE_MAX_INTERVAL ? 1 : 0;
+            }
+            offset += segment.panPerSecond * minMs / 1000.0;
+        }
+        printf("%-8s %5lu %8d | %6d %10.1f | %6d %7d %6d %10.1f\n", segment.name, segment.seconds,
+               segment.panPerSecond, fixed.stores, fixed.maxGap, adaptive.stores, adaptive.onChange, adaptive.onMax,
+               adaptive.maxGap);
+        fixedTotal += fixed.stores;
+        adaptiveTotal += adaptive.stores;
+
+        if (segment.panPerSecond == 0)
+        {
+            // Noise alone must not trigger: one frame per max interval, plus
+            // the one that notices the car stopped
+            int allowed = segment.seconds * 1000 / maxMs + 2;
+            ok = ok && adaptive.stores <= allowed && adaptive.stores < fixed.stores;
+        }
+        else if (segment.panPerSecond * FIXED_INTERVAL_MS / 1000 > WIDTH / 8)
+        {
+            // Fast scenes get more frames, and closer together, than the fixed rate
+            ok = ok && adaptive.stores > fixed.stores && adaptive.maxGap < fixed.maxGap;
+        }
+    }
+
+    // A store the caller drops (a near-duplicate) must leave the reference
+    // on the last kept frame: the kept view comes back as unchanged
+    CaptureTrigger dropped;
+    dropped.setIntervals(minMs, maxMs);
+    dropped.setThreshold(threshold);
+    renderView(world, 0, random, pixels);
+    bool firstStored = dropped.shouldStore(&fb, 0) == CaptureTrigger::STORE_FIRST;
+    dropped.commit(0);
+    std::fill(pixels.begin(), pixels.end(), 0xFF); // blown out, e.g. leaving a tunnel
+    bool changeSeen = dropped.shouldStore(&fb, minMs) == CaptureTrigger::STORE_CHANGE;
+    renderView(world, 0, random, pixels);
+    bool keptReference = dropped.shouldStore(&fb, minMs) != CaptureTrigger::STORE_CHANGE;
+    bool droppedOk = threshold == 0 || (firstStored && changeSeen && keptReference);
+    ok = ok && droppedOk;
+
+    printf("\nstored:        %d adaptive vs %d fixed (%.0f%% of the SD writes)\n", adaptiveTotal, fixedTotal,
+           fixedTotal ? 100.0 * adaptiveTotal / fixedTotal : 0.0);
+    printf("settings:      %s\n", rejectsInverted ? "min > max rejected" : "INVERTED BOUNDS ACCEPTED");
+    printf("dropped store: %s\n", threshold == 0 ? "not checked (threshold 0 stores every probe)"
+                                   : droppedOk ? "reference stays on the last kept frame, ok" : "MISMATCH");
+    ok = ok && adaptiveTotal < fixedTotal;
+    printf("trigger:       %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include "parallel_jpeg_encoder.h"
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+const char *ParallelJpegEncoder::TAG = "ParallelJpeg";
+
+ParallelJpegEncoder::ParallelJpegEncoder(uint8_t quality, JpegStreamEncoder::Subsampling subsampling, int count)
+    : nextStripe(0)
+{
+    workers = count < 1 ? 1 : count > MAX_WORKERS ? MAX_WORKERS : count;
+    for (int i = 0; i < MAX_WORKERS; i++)
+    {
+        encoders[i] = i < workers ? new JpegStreamEncoder(quality, subsampling) : nullptr;
+        helpers[i] = {this, i, nullptr, nullptr};
+    }
+    finished = xSemaphoreCreateCounting(MAX_WORKERS, 0);
+    memset(stripes, 0, sizeof(stripes));
+    memset(&stats, 0, sizeof(stats));
+}
+
+ParallelJpegEncoder::~ParallelJpegEncoder()
+{
+    end();
+    for (int i = 0; i < MAX_WORKERS; i++)
+    {
+        delete encoders[i];
+    }
+    vSemaphoreDelete(finished);
+}
+
+bool ParallelJpegEncoder::begin()
+{
+    if (helpersRunning > 0 || workers == 1)
+    {
+        return true;
+    }
+
+    stopping = false;
+    for (int i = 1; i < workers; i++)
+    {
+        Helper &helper = helpers[i];
+        helper.go = xSemaphoreCreateBinary();
+        // Same priority as the encode stage it works for
+        if (!helper.go ||
+            xTaskCreatePinnedToCore(helperTask, "Jpeg_Helper", 4096, &helper, 2, &helper.task, i % 2) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to start encoder helper %d, encoding on %d cores", i, helpersRunning + 1);
+            if (helper.go)
+            {
+                vSemaphoreDelete(helper.go);
+                helper.go = nullptr;
+            }
+            break;
+        }
+        helpersRunning++;
+    }
+    ESP_LOGI(TAG, "Encoding JPEG with %d workers", helpersRunning + 1);
+    return helpersRunning == workers - 1;
+}
+
+void ParallelJpegEncoder::end()
+{
+    if (helpersRunning == 0)
+    {
+        return;
+    }
+
+    stopping = true;
+    for (int i = 1; i <= helpersRunning; i++)
+    {
+        xSemaphoreGive(helpers[i].go);
+    }
+    for (int i = 1; i <= helpersRunning; i++)
+    {
+        xSemaphoreTake(finished, portMAX_DELAY);
+    }
+    for (int i = 1; i <= helpersRunning; i++)
+    {
+        vSemaphoreDelete(helpers[i].go);
+        helpers[i].go = nullptr;
+        helpers[i].task = nullptr;
+    }
+    helpersRunning = 0;
+
+    for (int i = 0; i < MAX_STRIPES; i++)
+    {
+        heap_caps_free(stripes[i].data);
+        stripes[i] = {};
+    }
+}
+
+void ParallelJpegEncoder::setQuality(uint8_t quality)
+{
+    for (int i = 0; i < workers; i++)
+    {
+        encoders[i]->setQuality(quality);
+    }
+}
+
+void ParallelJpegEncoder::helperTask(void *parameter)
+{
+    Helper *helper = static_cast<Helper *>(parameter);
+    ParallelJpegEncoder *self = helper->owner;
+    while (true)
+    {
+        xSemaphoreTake(helper->go, portMAX_DELAY);
+        if (self->stopping)
+        {
+            xSemaphoreGive(self->finished);
+            vTaskDelete(nullptr);
+            return;
+        }
+        self->work(helper->worker);
+        xSemaphoreGive(self->finished);
+    }
+}
+
+size_t ParallelJpegEncoder::appendStripe(void *arg, size_t index, const void *data, size_t len)
+{
+    Stripe *stripe = static_cast<Stripe *>(arg);
+    if (index + len > stripe->capacity)
+    {
+        size_t capacity = stripe->capacity ? stripe->capacity : 4096;
+        while (capacity < index + len)
+        {
+            capacity *= 2;
+        }
+        uint8_t *grown = static_cast<uint8_t *>(heap_caps_realloc(stripe->data, capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (!grown)
+        {
+            return 0;
+        }
+        stripe->data = grown;
+        stripe->capacity = capacity;
+    }
+    memcpy(stripe->data + index, data, len);
+    stripe->len = index + len;
+    return len;
+}
+
+void ParallelJpegEncoder::work(int worker)
+{
+    unsigned long start = micros();
+    while (true)
+    {
+        int s = nextStripe.fetch_add(1);
+        if (s >= stripeCount)
+        {
+            break;
+        }
+        Stripe &stripe = stripes[s];
+        int firstRow = s * frameStripeRows;
+        int rows = frameRows - firstRow < frameStripeRows ? frameRows - firstRow : frameStripeRows;
+        stripe.len = 0;
+        stripe.ok = encoders[worker]->encodeRows(frame, firstRow, rows, appendStripe, &stripe);
+        stats.workerStripes[worker]++;
+    }
+    stats.workerBusyUs[worker] += micros() - start;
+}
+
+bool ParallelJpegEncoder::emit(JpegStreamEncoder::Sink sink, void *arg, size_t &offset, const uint8_t *data, size_t len)
+{
+    for (size_t done = 0; done < len;)
+    {
+        size_t n = len - done < JpegStreamEncoder::CHUNK_BYTES ? len - done : JpegStreamEncoder::CHUNK_BYTES;
+        if (sink(arg, offset, data + done, n) != n)
+        {
+            return false;
+        }
+        offset += n;
+        done += n;
+    }
+    return true;
+}
+
+bool ParallelJpegEncoder::encode(const camera_fb_t *fb, JpegStreamEncoder::Sink sink, void *arg)
+{
+    unsigned long start = micros();
+    bool striped = helpersRunning > 0 && JpegStreamEncoder::isEncodable(fb) && sink;
+    int mcusPerRow = 0;
+    if (striped)
+    {
+        int mcu = encoders[0]->mcuSize();
+        mcusPerRow = (fb->width + mcu - 1) / mcu;
+        frameRows = (fb->height + mcu - 1) / mcu;
+        frameStripeRows = stripeRows;
+        if ((frameRows + frameStripeRows - 1) / frameStripeRows > MAX_STRIPES)
+        {
+            frameStripeRows = (frameRows + MAX_STRIPES - 1) / MAX_STRIPES;
+        }
+        // DRI is 16 bits wide
+        striped = static_cast<long>(mcusPerRow) * frameStripeRows <= 0xFFFF;
+    }
+
+    bool ok = striped ? encodeStriped(fb, mcusPerRow, sink, arg) : encoders[0]->encode(fb, sink, arg);
+
+    uint32_t elapsed = micros() - start;
+    stats.frames++;
+    stats.lastEncodeUs = elapsed;
+    stats.maxEncodeUs = elapsed > stats.maxEncodeUs ? elapsed : stats.maxEncodeUs;
+    return ok;
+}
+
+bool ParallelJpegEncoder::encodeStriped(const camera_fb_t *fb, int mcusPerRow, JpegStreamEncoder::Sink sink, void *arg)
+{
+    stripeCount = (frameRows + frameStripeRows - 1) / frameStripeRows;
+    frame = fb;
+    nextStripe.store(0);
+
+    for (int i = 1; i <= helpersRunning; i++)
+    {
+        xSemaphoreGive(helpers[i].go);
+    }
+    work(0);
+    for (int i = 1; i <= helpersRunning; i++)
+    {
+        xSemaphoreTake(finished, portMAX_DELAY);
+    }
+    frame = nullptr;
+    stats.stripes += stripeCount;
+
+    // Headers go straight through, so the sink's offsets start at zero
+    bool ok = encoders[0]->encodeHeaders(fb, mcusPerRow * frameStripeRows, sink, arg);
+    size_t offset = encoders[0]->encodedBytes();
+    for (int s = 0; s < stripeCount && ok; s++)
+    {
+        ok = stripes[s].ok && emit(sink, arg, offset, stripes[s].data, stripes[s].len);
+        if (ok && s + 1 < stripeCount)
+        {
+            const uint8_t marker[2] = {0xFF, static_cast<uint8_t>(0xD0 + (s & 7))};
+            ok = emit(sink, arg, offset, marker, sizeof(marker));
+        }
+    }
+    static const uint8_t EOI[2] = {0xFF, 0xD9};
+    ok = ok && emit(sink, arg, offset, EOI, sizeof(EOI));
+    if (!ok)
+    {
+        ESP_LOGE(TAG, "Striped encode failed");
+    }
+    return ok;
+}
@@ -9,23 +9,12 @@ PreviewService::PreviewService(CustomBLEService *ble) : streamEnabled(false), ca
 {
     ESP_LOGI(TAG, "Creating PreviewService instance");
     
-    bleService->setPreviewCallback([this](bool enabled) {
-        ESP_LOGI(TAG, "Preview callback triggered: %s", enabled ? "ENABLE" : "DISABLE");
-        if (enabled) {
-            streamEnabled = true;
-        } else {
-            this->disable();
-            streamEnabled = false;
-            
-            // Only restart if explicitly stopped and not disconnecting
-            if (bleService->wasExplicitlyStopped() && !bleService->isDisconnecting()) {
-                ESP_LOGI(TAG, "Explicit stop command received - Triggering restart");
-                bleService->notifyClients("Restarting device to idle state...");
-                delay(1000);
-                ESP.restart();
-            }
-        }
-    });
+    ModeController::getInstance().setHandlers(
+        ModeController::MODE_PREVIEW,
+        [this]()
+        { return start(); },
+        [this]()
+        { disable(); });
 }
 
 bool PreviewService::begin()
@@ -43,8 +32,8 @@ bool PreviewService::begin()
 
     ESP_LOGD(TAG, "Camera instance acquired successfully");
     
-    // Configure camera for preview mode
-    if (!CameraManager::getInstance().begin(true)) // true for preview mode
+    // Switch the sensor to the preview profile (VGA JPEG)
+    if (!CameraManager::getInstance().begin(CameraProfile::PREVIEW))
     {
         ESP_LOGE(TAG, "Failed to initialize camera in preview mode");
         return false;
@@ -66,7 +55,6 @@ bool PreviewService::initWiFi()
         return false;
     }
 
-    delay(100); // Wait for AP to start
     IPAddress ip = WiFi.softAPIP();
     ESP_LOGI(TAG, "WiFi AP started with IP: %s", ip.toString().c_str());
 
@@ -77,13 +65,7 @@ bool PreviewService::initMJPEGServer()
 {
     ESP_LOGD(TAG, "Initializing MJPEG server...");
 
-    // Ensure camera is in preview mode
-    camera->resolution.face();
-    camera->quality.high();
-    camera->pixformat.jpeg();  // Explicitly set JPEG format
-    
-    delay(100); // Small delay to ensure camera settings are applied
-    
+    // Resolution and format come from the preview profile set in begin()
     if (!mjpeg.begin().isOk())
     {
         ESP_LOGE(TAG, "MJPEG server initialization failed: %s", mjpeg.exception.toString().c_str());
@@ -95,59 +77,60 @@ bool PreviewService::initMJPEGServer()
     return true;
 }
 
+bool PreviewService::start()
+{
+    if (streamEnabled)
+    {
+        return true;
+    }
+
+    // Camera first; it was released by whichever mode ran before
+    if (!begin())
+    {
+        ESP_LOGE(TAG, "Failed to initialize preview service");
+        return false;
+    }
+
+    // Initialize WiFi and MJPEG server
+    if (!initWiFi())
+    {
+        ESP_LOGE(TAG, "Failed to start WiFi AP");
+        CameraManager::getInstance().releaseCamera();
+        return false;
+    }
+
+    if (!initMJPEGServer())
+    {
+        ESP_LOGE(TAG, "Failed to start MJPEG server");
+        stopWiFi();
+        CameraManager::getInstance().releaseCamera();
+        return false;
+    }
+    streamEnabled = true;
+
+    // Update BLE with stream info
+    JsonDocument doc;
+    doc["status"] = "enabled";
+    doc["wifi"]["ssid"] = String(HOSTNAME);
+    doc["wifi"]["ip"] = WiFi.softAPIP().toString();
+    doc["stream"]["url"] = String(streamAddress);
+    doc["stream"]["type"] = "MJPEG";
+    doc["stream"]["port"] = 81;
+
+    String output;
+    serializeJson(doc, output);
+    bleService->updatePreviewInfo(output.c_str());
+    bleService->updateServiceStatus("preview", "starting");
+
+    ESP_LOGI(TAG, "Preview service enabled successfully");
+    return true;
+}
+
 void PreviewService::loop()
 {
-    static bool lastState = false;
     static unsigned long lastMetricsLog = 0;
     const unsigned long METRICS_INTERVAL = 30000;
 
-    // Handle state changes
-    if (streamEnabled != lastState) {
-        ESP_LOGI(TAG, "Stream state changed: %s", streamEnabled ? "ENABLED" : "DISABLED");
-        
-        if (streamEnabled) {
-            // Initialize camera first if needed
-            if (!camera && !begin()) {
-                ESP_LOGE(TAG, "Failed to initialize preview service");
-                streamEnabled = false;
-                return;
-            }
-
-            // Initialize WiFi and MJPEG server
-            if (!initWiFi()) {
-                ESP_LOGE(TAG, "Failed to start WiFi AP");
-                streamEnabled = false;
-                return;
-            }
-
-            if (!initMJPEGServer()) {
-                ESP_LOGE(TAG, "Failed to start MJPEG server");
-                stopWiFi();
-                streamEnabled = false;
-                return;
-            }
-
-            // Update BLE with stream info
-            JsonDocument doc;
-            doc["status"] = "enabled";
-            doc["wifi"]["ssid"] = String(HOSTNAME);
-            doc["wifi"]["ip"] = WiFi.softAPIP().toString();
-            doc["stream"]["url"] = String(streamAddress);
-            doc["stream"]["type"] = "MJPEG";
-            doc["stream"]["port"] = 81;
-
-            String output;
-            serializeJson(doc, output);
-            bleService->updatePreviewInfo(output.c_str());
-
-            ESP_LOGI(TAG, "Preview service enabled successfully");
-        } else {
-            disable();
-        }
-        
-        lastState = streamEnabled;
-    }
-
     // Only process stream if enabled
     if (streamEnabled) {
         // Handle metrics logging
@@ -165,22 +148,6 @@ void PreviewService::loop()
     }
 }
 
-void PreviewService::enable()
-{
-    static unsigned long lastEnableAttempt = 0;
-    const unsigned long DEBOUNCE_TIME = 1000;
-    
-    unsigned long currentTime = millis();
-    if (currentTime - lastEnableAttempt < DEBOUNCE_TIME) {
-        ESP_LOGW(TAG, "Enable request ignored - too soon after last attempt");
-        return;
-    }
-    lastEnableAttempt = currentTime;
-    
-    // Just set the flag, let loop() handle the initialization
-    streamEnabled = true;
-}
-
 void PreviewService::disable()
 {
     ESP_LOGI(TAG, "Disabling preview stream");
@@ -195,14 +162,11 @@ void PreviewService::disable()
     streamEnabled = false;
     ESP_LOGV(TAG, "State transition: enabled -> disabled");
 
-    // Stop services in order
+    // Stop services in order. The sensor stays up for the next mode's
+    // profile switch; ModeController powers it down when going idle.
     stopMJPEGServer();
     stopWiFi();
-
-    // Reset camera mode
-    if (camera) {
-        CameraManager::getInstance().begin(false); // false for normal mode
-    }
+    camera = nullptr;
 
     JsonDocument doc;
     doc["status"] = "disabled";
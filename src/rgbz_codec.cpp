@@ -0,0 +1,343 @@
+#include "rgbz_codec.h"
+#include <stdlib.h>
+#include <string.h>
+#include "crc32.h"
+
+namespace
+{
+    // Longest unary prefix; larger residuals are escaped and sent verbatim
+    const uint32_t UNARY_LIMIT = 16;
+    const int MAX_PARAMETER = 7;
+    const int ACTIVITY_LEVELS = 5;
+    const uint16_t ADAPT_WINDOW = 32;
+
+    // Running mean of the mapped residuals for one channel and activity level
+    struct Context
+    {
+        uint16_t sum;
+        uint16_t count;
+
+        int parameter() const
+        {
+            int k = 0;
+            while (k < MAX_PARAMETER && (static_cast<uint32_t>(count) << k) < sum)
+            {
+                k++;
+            }
+            return k;
+        }
+
+        void update(uint32_t mapped)
+        {
+            sum += mapped;
+            if (++count == ADAPT_WINDOW)
+            {
+                sum >>= 1;
+                count >>= 1;
+            }
+        }
+    };
+
+    inline int median(int a, int b, int c)
+    {
+        int lo = a < b ? a : b;
+        int hi = a < b ? b : a;
+        return c >= hi ? lo : c <= lo ? hi : a + b - c;
+    }
+
+    inline int clampChannel(int value, int max)
+    {
+        return value < 0 ? 0 : value > max ? max : value;
+    }
+
+    inline int activityLevel(int activity)
+    {
+        return activity == 0 ? 0 : activity <= 2 ? 1 : activity <= 6 ? 2 : activity <= 14 ? 3 : 4;
+    }
+
+    inline void unpack(const uint8_t *pixel, int *rgb)
+    {
+        uint16_t value = (pixel[0] << 8) | pixel[1];
+        rgb[0] = value >> 11;
+        rgb[1] = (value >> 5) & 0x3F;
+        rgb[2] = value & 0x1F;
+    }
+
+    class Encoder
+    {
+    public:
+        static const bool DECODES = false;
+
+        Encoder(uint8_t *out, size_t limit) : out(out), limit(limit) {}
+
+        int code(Context &context, int bits, int predicted, int value)
+        {
+            int half = 1 << (bits - 1);
+            int error = ((value - predicted + half) & ((1 << bits) - 1)) - half;
+            uint32_t mapped = error >= 0 ? 2 * error : -2 * error - 1;
+            int k = context.parameter();
+            uint32_t quotient = mapped >> k;
+            if (quotient < UNARY_LIMIT)
+            {
+                put((1u << k) | (mapped & ((1u << k) - 1)), quotient + 1 + k);
+            }
+            else
+            {
+                put(1, UNARY_LIMIT + 1);
+                put(mapped, bits);
+            }
+            context.update(mapped);
+            return value;
+        }
+
+        bool ok() const { return !overflow; }
+
+        size_t finish()
+        {
+            if (count > 0)
+            {
+                put(0, 8 - count);
+            }
+            return overflow ? 0 : length;
+        }
+
+    private:
+        uint8_t *out;
+        size_t limit;
+        size_t length = 0;
+        uint32_t bits = 0;
+        int count = 0;
+        bool overflow = false;
+
+        // MSB first; at most 25 bits per call
+        void put(uint32_t value, int n)
+        {
+            bits = (bits << n) | value;
+            count += n;
+            while (count >= 8)
+            {
+                count -= 8;
+                if (length < limit)
+                {
+                    out[length++] = static_cast<uint8_t>(bits >> count);
+                }
+                else
+                {
+                    overflow = true;
+                }
+            }
+        }
+    };
+
+    class Decoder
+    {
+    public:
+        static const bool DECODES = true;
+
+        Decoder(const uint8_t *data, size_t len) : data(data), len(len) {}
+
+        int code(Context &context, int bits, int predicted, int)
+        {
+            refill();
+            uint32_t quotient = window ? __builtin_clz(window) : 32;
+            uint32_t mapped;
+            if (quotient < UNARY_LIMIT)
+            {
+                int k = context.parameter();
+                consume(quotient + 1);
+                mapped = (quotient << k) | (k ? window >> (32 - k) : 0);
+                consume(k);
+            }
+            else if (quotient == UNARY_LIMIT)
+            {
+                consume(UNARY_LIMIT + 1);
+                mapped = window >> (32 - bits);
+                consume(bits);
+            }
+            else
+            {
+                malformed = true;
+                return 0;
+            }
+            context.update(mapped);
+            int error = (mapped & 1) ? -static_cast<int>((mapped + 1) >> 1) : static_cast<int>(mapped >> 1);
+            return (predicted + error) & ((1 << bits) - 1);
+        }
+
+        // Bits consumed must not run past the payload
+        bool ok() const { return !malformed && position * 8 - count <= len * 8; }
+
+    private:
+        const uint8_t *data;
+        size_t len;
+        size_t position = 0; // may run past len; missing bytes read as zero
+        uint32_t window = 0; // next bits, MSB aligned
+        int count = 0;
+        bool malformed = false;
+
+        void refill()
+        {
+            while (count <= 24)
+            {
+                uint32_t byte = position < len ? data[position] : 0;
+                position++;
+                window |= byte << (24 - count);
+                count += 8;
+            }
+        }
+
+        void consume(int n)
+        {
+            window = n < 32 ? window << n : 0;
+            count -= n;
+        }
+    };
+
+    // Walks the frame in raster order. The encoder reads every pixel; the
+    // decoder writes each one once its channels are known, so the rows
+    // above are always available as context.
+    template <typename Coder>
+    bool codePixels(Coder &coder, uint8_t *pixels, int width, int height)
+    {
+        Context contexts[3][ACTIVITY_LEVELS];
+        for (int channel = 0; channel < 3; channel++)
+        {
+            for (int level = 0; level < ACTIVITY_LEVELS; level++)
+            {
+                contexts[channel][level] = {2, 1};
+            }
+        }
+
+        size_t stride = static_cast<size_t>(width) * 2;
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t *row = pixels + y * stride;
+            const uint8_t *above = y > 0 ? row - stride : row;
+            int left[3] = {0, 0, 0};
+            int upLeft[3] = {0, 0, 0};
+            for (int x = 0; x < width; x++)
+            {
+                // Neighbours a (left), b (up), c (up-left); the first row
+                // predicts from the left and the first column from above
+                int up[3];
+                int a[3];
+                int c[3];
+                if (y == 0)
+                {
+                    memcpy(up, left, sizeof(up));
+                    memcpy(a, left, sizeof(a));
+                    memcpy(c, left, sizeof(c));
+                }
+                else
+                {
+                    unpack(above + x * 2, up);
+                    memcpy(a, x == 0 ? up : left, sizeof(a));
+                    memcpy(c, x == 0 ? up : upLeft, sizeof(c));
+                }
+
+                int actual[3] = {0, 0, 0};
+                if (!Coder::DECODES)
+                {
+                    unpack(row + x * 2, actual);
+                }
+
+                int level = activityLevel(abs(a[1] - c[1]) + abs(up[1] - c[1]));
+                int predicted = median(a[1], up[1], c[1]);
+                int green = coder.code(contexts[1][level], 6, predicted, actual[1]);
+                int shift = (green - predicted) >> 1;
+                predicted = clampChannel(median(a[0], up[0], c[0]) + shift, 31);
+                int red = coder.code(contexts[0][level], 5, predicted, actual[0]);
+                predicted = clampChannel(median(a[2], up[2], c[2]) + shift, 31);
+                int blue = coder.code(contexts[2][level], 5, predicted, actual[2]);
+
+                if (Coder::DECODES)
+                {
+                    uint16_t value = (red << 11) | (green << 5) | blue;
+                    row[x * 2] = value >> 8;
+                    row[x * 2 + 1] = value & 0xFF;
+                }
+                left[0] = red;
+                left[1] = green;
+                left[2] = blue;
+                memcpy(upLeft, up, sizeof(upLeft));
+            }
+            if (!coder.ok())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+namespace Rgbz
+{
+    size_t encode(const uint8_t *pixels, uint16_t width, uint16_t height, uint8_t *out, size_t capacity)
+    {
+        size_t raw = frameBytes(width, height);
+        if (!pixels || !out || capacity < HEADER_BYTES || raw == 0)
+        {
+            return 0;
+        }
+
+        Header header = {MAGIC, VERSION, METHOD_RICE, width, height, 0, crc32(pixels, raw), 0};
+
+        // Anything that does not beat the raw frame is stored instead
+        size_t room = capacity - HEADER_BYTES;
+        Encoder encoder(out + HEADER_BYTES, room < raw ? room : raw - 1);
+        bool compressed = codePixels(encoder, const_cast<uint8_t *>(pixels), width, height);
+        size_t length = encoder.finish();
+        if (!compressed || length == 0)
+        {
+            if (room < raw)
+            {
+                return 0;
+            }
+            header.method = METHOD_STORED;
+            memcpy(out + HEADER_BYTES, pixels, raw);
+            length = raw;
+        }
+
+        header.length = length;
+        memcpy(out, &header, sizeof(header));
+        return HEADER_BYTES + length;
+    }
+
+    bool readHeader(const uint8_t *data, size_t len, Header &out)
+    {
+        if (!data || len < HEADER_BYTES)
+        {
+            return false;
+        }
+        memcpy(&out, data, sizeof(out));
+        return out.magic == MAGIC && out.version == VERSION &&
+               (out.method == METHOD_STORED || out.method == METHOD_RICE) && out.width > 0 && out.height > 0 &&
+               out.length <= len - HEADER_BYTES &&
+               (out.method != METHOD_STORED || out.length == frameBytes(out.width, out.height));
+    }
+
+    bool decode(const uint8_t *data, size_t len, uint8_t *pixels, size_t capacity)
+    {
+        Header header;
+        if (!readHeader(data, len, header) || capacity < frameBytes(header.width, header.height))
+        {
+            return false;
+        }
+
+        const uint8_t *payload = data + HEADER_BYTES;
+        size_t raw = frameBytes(header.width, header.height);
+        if (header.method == METHOD_STORED)
+        {
+            memcpy(pixels, payload, raw);
+        }
+        else
+        {
+            Decoder decoder(payload, header.length);
+            if (!codePixels(decoder, pixels, header.width, header.height))
+            {
+                return false;
+            }
+        }
+        return crc32(pixels, raw) == header.crc;
+    }
+}
@@ -1,4 +1,5 @@
 #include "sd_manager.h"
+#include <Arduino.h>
 
 SDManager* SDManager::instance = nullptr;
 const char* SDManager::TAG = "SDManager";
@@ -7,20 +8,19 @@ bool SDManager::begin() {
     if (isInitialized) return true;
 
     ESP_LOGI(TAG, "Initializing SD card...");
-    pinMode(SD_CS_PIN, OUTPUT);
 
     // Try multiple times to initialize SD card
     for (int i = 0; i < 3; i++) {
-        if (SD.begin(SD_CS_PIN)) {
-            uint8_t cardType = SD.cardType();
-            if (cardType != CARD_NONE) {
-                isInitialized = true;
-                ESP_LOGI(TAG, "SD card initialized successfully");
-                return true;
+        if (backend->mount()) {
+            isInitialized = true;
+            ESP_LOGI(TAG, "SD card initialized successfully");
+            if (!cache.begin()) {
+                ESP_LOGW(TAG, "Write-behind cache unavailable, streams write straight to the card");
             }
+            return true;
         }
         delay(1000);
-        SD.end();
+        backend->unmount();
     }
 
     ESP_LOGE(TAG, "SD Card initialization failed");
@@ -29,30 +29,59 @@ bool SDManager::begin() {
 
 bool SDManager::end() {
     if (!isInitialized) return true;
-    SD.end();
+    if (!cache.end(5000)) {
+        ESP_LOGW(TAG, "Unmounting with buffered writes still pending");
+    }
+    backend->unmount();
     isInitialized = false;
     return true;
 }
 
+void SDManager::setBackend(StorageBackend* newBackend) {
+    if (isInitialized) {
+        ESP_LOGW(TAG, "Cannot swap storage backend while mounted");
+        return;
+    }
+    backend = newBackend ? newBackend : &defaultStorageBackend();
+}
+
 File SDManager::openFile(const char* path, const char* mode) {
     if (!isInitialized && !begin()) {
         ESP_LOGE(TAG, "Cannot open file - SD not initialized");
         return File();
     }
-    return SD.open(path, mode);
+    return backend->open(path, mode);
 }
 
 bool SDManager::exists(const char* path) {
     if (!isInitialized && !begin()) return false;
-    return SD.exists(path);
+    return backend->exists(path);
 }
 
 bool SDManager::remove(const char* path) {
     if (!isInitialized && !begin()) return false;
-    return SD.remove(path);
+    return backend->remove(path);
+}
+
+bool SDManager::mkdir(const char* path) {
+    if (!isInitialized && !begin()) return false;
+    return backend->mkdir(path);
 }
 
 File SDManager::openDir(const char* path) {
     if (!isInitialized && !begin()) return File();
-    return SD.open(path);
-} 
\ No newline at end of file
+    return backend->open(path, FILE_READ);
+}
+
+SDStream SDManager::openStream(const char* path) {
+    if (!isInitialized && !begin()) {
+        ESP_LOGE(TAG, "Cannot open stream - SD not initialized");
+        return SDStream();
+    }
+    File file = backend->open(path, FILE_WRITE);
+    if (!cache.isRunning()) {
+        // Unbuffered, as before the cache: slower, but captures keep going
+        return file ? SDStream(file) : SDStream();
+    }
+    return cache.open(file);
+}
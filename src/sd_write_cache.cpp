@@ -0,0 +1,463 @@
+#include "sd_write_cache.h"
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include "esp_heap_caps.h"
+
+const char *SDWriteCache::TAG = "SDWriteCache";
+
+// ---- SDStream ----
+
+SDStream::SDStream(SDStream &&other) noexcept
+    : cache(other.cache), id(other.id), generation(other.generation), direct(other.direct)
+{
+    other.cache = nullptr;
+    other.id = -1;
+    other.direct = File();
+}
+
+SDStream &SDStream::operator=(SDStream &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        cache = other.cache;
+        id = other.id;
+        generation = other.generation;
+        direct = other.direct;
+        other.cache = nullptr;
+        other.id = -1;
+        other.direct = File();
+    }
+    return *this;
+}
+
+size_t SDStream::write(const uint8_t *data, size_t len)
+{
+    if (cache)
+    {
+        return cache->owns(id, generation) ? cache->write(id, data, len) : 0;
+    }
+    return direct ? direct.write(data, len) : 0;
+}
+
+void SDStream::sync()
+{
+    if (cache && cache->owns(id, generation))
+    {
+        cache->sync(id, false);
+    }
+    else if (direct)
+    {
+        direct.flush();
+    }
+}
+
+void SDStream::close()
+{
+    if (cache)
+    {
+        if (cache->owns(id, generation))
+        {
+            cache->close(id);
+        }
+        cache = nullptr;
+        id = -1;
+    }
+    if (direct)
+    {
+        direct.close();
+        direct = File();
+    }
+}
+
+// ---- SDWriteCache ----
+
+SDWriteCache::SDWriteCache() : jobsQueued(0), jobsDone(0)
+{
+    // Every chunk can be queued once, plus a tail and a close per stream and
+    // a few drain syncs; a full queue only blocks the caller briefly
+    freeChunks = xQueueCreate(CHUNK_COUNT, sizeof(Chunk *));
+    jobs = xQueueCreate(CHUNK_COUNT + MAX_STREAMS * 3, sizeof(Job));
+    mutex = xSemaphoreCreateMutex();
+    memset(chunks, 0, sizeof(chunks));
+    for (int i = 0; i < MAX_STREAMS; i++)
+    {
+        streams[i].dirty = false;
+        streams[i].inUse = false;
+        streams[i].generation = 0;
+        streams[i].current = nullptr;
+        streams[i].chunkOffset = 0;
+    }
+    memset(&stats, 0, sizeof(stats));
+    memset(latencies, 0, sizeof(latencies));
+}
+
+bool SDWriteCache::begin()
+{
+    if (taskHandle)
+    {
+        return true;
+    }
+
+    for (int i = 0; i < CHUNK_COUNT; i++)
+    {
+        chunks[i].data = static_cast<uint8_t *>(heap_caps_malloc(CHUNK_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (!chunks[i].data)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %u byte write chunk", static_cast<unsigned>(CHUNK_BYTES));
+            for (int j = 0; j < i; j++)
+            {
+                heap_caps_free(chunks[j].data);
+                chunks[j].data = nullptr;
+            }
+            xQueueReset(freeChunks);
+            return false;
+        }
+        Chunk *chunk = &chunks[i];
+        xQueueSend(freeChunks, &chunk, 0);
+    }
+
+    // Same core and priority as the pipeline's store stage it serves
+    if (xTaskCreatePinnedToCore(writerTask, "SD_Writer", 4096, this, 1, &taskHandle, 1) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Write-behind cache ready: %d x %u KB chunks, sync every %lu ms", CHUNK_COUNT,
+             static_cast<unsigned>(CHUNK_BYTES / 1024), syncIntervalMs);
+    return true;
+}
+
+bool SDWriteCache::end(unsigned long timeoutMs)
+{
+    if (!taskHandle)
+    {
+        return true;
+    }
+
+    // Every open stream's tail, then its close, queued behind its data
+    for (int i = 0; i < MAX_STREAMS; i++)
+    {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        bool open = streams[i].inUse;
+        xSemaphoreGive(mutex);
+        if (open)
+        {
+            close(i);
+        }
+    }
+    if (!drain(timeoutMs))
+    {
+        ESP_LOGW(TAG, "Writes still pending after %lu ms, cache left running", timeoutMs);
+        return false;
+    }
+
+    // Idle in its queue wait: nothing is lost by stopping it here
+    vTaskDelete(taskHandle);
+    taskHandle = nullptr;
+    xQueueReset(freeChunks);
+    for (int i = 0; i < CHUNK_COUNT; i++)
+    {
+        heap_caps_free(chunks[i].data);
+        chunks[i].data = nullptr;
+    }
+    ESP_LOGI(TAG, "Write-behind cache stopped");
+    return true;
+}
+
+bool SDWriteCache::owns(int id, uint32_t generation)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool owned = taskHandle && streams[id].inUse && streams[id].generation == generation;
+    xSemaphoreGive(mutex);
+    return owned;
+}
+
+SDStream SDWriteCache::open(File file)
+{
+    if (!file || !taskHandle)
+    {
+        return SDStream();
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int slot = -1;
+    for (int i = 0; i < MAX_STREAMS && slot < 0; i++)
+    {
+        if (!streams[i].inUse)
+        {
+            slot = i;
+        }
+    }
+    if (slot >= 0)
+    {
+        // The writer task leaves a free slot clean and does not touch it
+        StreamSlot &stream = streams[slot];
+        stream.file = file;
+        stream.inUse = true;
+        stream.generation++;
+        stream.current = nullptr;
+        stream.chunkOffset = 0;
+    }
+    xSemaphoreGive(mutex);
+
+    if (slot < 0)
+    {
+        ESP_LOGE(TAG, "All %d write streams in use", MAX_STREAMS);
+        return SDStream();
+    }
+    return SDStream(this, slot, streams[slot].generation);
+}
+
+size_t SDWriteCache::write(int id, const uint8_t *data, size_t len)
+{
+    StreamSlot &stream = streams[id];
+    size_t done = 0;
+    while (done < len)
+    {
+        if (!stream.current)
+        {
+            Chunk *chunk = nullptr;
+            if (xQueueReceive(freeChunks, &chunk, 0) != pdTRUE)
+            {
+                xSemaphoreTake(mutex, portMAX_DELAY);
+                stats.stalls++;
+                xSemaphoreGive(mutex);
+                if (xQueueReceive(freeChunks, &chunk, pdMS_TO_TICKS(STALL_TIMEOUT_MS)) != pdTRUE)
+                {
+                    ESP_LOGE(TAG, "No write chunk freed within %lu ms", STALL_TIMEOUT_MS);
+                    xSemaphoreTake(mutex, portMAX_DELAY);
+                    stats.errors++;
+                    xSemaphoreGive(mutex);
+                    break;
+                }
+            }
+            chunk->fill = 0;
+            stream.current = chunk;
+        }
+
+        Chunk *chunk = stream.current;
+        size_t n = std::min(len - done, CHUNK_BYTES - chunk->fill);
+        memcpy(chunk->data + chunk->fill, data + done, n);
+        chunk->fill += n;
+        done += n;
+
+        if (chunk->fill == CHUNK_BYTES)
+        {
+            enqueue({JOB_WRITE, static_cast<uint8_t>(id), true, chunk, stream.chunkOffset, CHUNK_BYTES});
+            stream.chunkOffset += CHUNK_BYTES;
+            stream.current = nullptr;
+        }
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    stats.bytesAccepted += done;
+    xSemaphoreGive(mutex);
+    return done;
+}
+
+void SDWriteCache::sync(int id, bool recycle)
+{
+    StreamSlot &stream = streams[id];
+    Chunk *chunk = stream.current;
+    if (chunk && chunk->fill > 0)
+    {
+        // Only bytes below fill are written; appends land above it, so the
+        // caller keeps filling the chunk while the task writes its head
+        enqueue({JOB_WRITE, static_cast<uint8_t>(id), recycle, chunk, stream.chunkOffset,
+                 static_cast<uint32_t>(chunk->fill)});
+    }
+    else if (chunk && recycle)
+    {
+        xQueueSend(freeChunks, &chunk, 0);
+    }
+    if (recycle)
+    {
+        stream.current = nullptr;
+    }
+}
+
+void SDWriteCache::close(int id)
+{
+    sync(id, true);
+    enqueue({JOB_CLOSE, static_cast<uint8_t>(id), false, nullptr, 0, 0});
+}
+
+void SDWriteCache::enqueue(const Job &job)
+{
+    jobsQueued.fetch_add(1);
+    xQueueSend(jobs, &job, portMAX_DELAY);
+
+    uint32_t depth = uxQueueMessagesWaiting(jobs);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (depth > stats.maxQueueDepth)
+    {
+        stats.maxQueueDepth = depth;
+    }
+    xSemaphoreGive(mutex);
+}
+
+void SDWriteCache::writerTask(void *parameter)
+{
+    SDWriteCache *self = static_cast<SDWriteCache *>(parameter);
+    unsigned long lastSync = millis();
+    self->windowStart = lastSync;
+
+    while (true)
+    {
+        Job job;
+        if (xQueueReceive(self->jobs, &job, pdMS_TO_TICKS(100)) == pdTRUE)
+        {
+            self->process(job);
+            self->jobsDone.fetch_add(1);
+        }
+
+        unsigned long now = millis();
+        if (now - lastSync >= self->syncIntervalMs)
+        {
+            self->syncDirty();
+            lastSync = now;
+        }
+        if (now - self->windowStart >= 1000)
+        {
+            xSemaphoreTake(self->mutex, portMAX_DELAY);
+            self->stats.bytesPerSecond = (self->stats.bytesWritten - self->bytesAtWindowStart) * 1000 / (now - self->windowStart);
+            self->bytesAtWindowStart = self->stats.bytesWritten;
+            xSemaphoreGive(self->mutex);
+            self->windowStart = now;
+        }
+    }
+}
+
+void SDWriteCache::process(const Job &job)
+{
+    if (job.kind == JOB_SYNC)
+    {
+        syncDirty();
+        return;
+    }
+
+    StreamSlot &stream = streams[job.stream];
+    if (job.kind == JOB_WRITE)
+    {
+        unsigned long start = micros();
+        bool ok = (stream.file.position() == job.offset || stream.file.seek(job.offset)) &&
+                  stream.file.write(job.chunk->data, job.len) == job.len;
+        uint32_t latencyUs = micros() - start;
+        stream.dirty = true;
+        if (job.recycle)
+        {
+            Chunk *chunk = job.chunk;
+            xQueueSend(freeChunks, &chunk, 0);
+        }
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        stats.writes++;
+        stats.bytesWritten += job.len;
+        if (job.len == CHUNK_BYTES && job.offset % CHUNK_BYTES == 0)
+        {
+            stats.alignedWrites++;
+        }
+        else
+        {
+            stats.tailWrites++;
+        }
+        if (!ok)
+        {
+            stats.errors++;
+        }
+        latencies[latencyCount++ % LATENCY_WINDOW] = latencyUs;
+        xSemaphoreGive(mutex);
+
+        if (!ok)
+        {
+            ESP_LOGE(TAG, "Write of %u bytes at %u failed", static_cast<unsigned>(job.len),
+                     static_cast<unsigned>(job.offset));
+        }
+    }
+    else if (job.kind == JOB_CLOSE)
+    {
+        if (stream.dirty)
+        {
+            stream.file.flush();
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            stats.syncs++;
+            xSemaphoreGive(mutex);
+        }
+        stream.file.close();
+        stream.file = File();
+        stream.dirty = false;
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        stream.inUse = false;
+        xSemaphoreGive(mutex);
+    }
+}
+
+void SDWriteCache::syncDirty()
+{
+    for (int i = 0; i < MAX_STREAMS; i++)
+    {
+        StreamSlot &stream = streams[i];
+        if (stream.dirty)
+        {
+            stream.file.flush();
+            stream.dirty = false;
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            stats.syncs++;
+            xSemaphoreGive(mutex);
+        }
+    }
+}
+
+bool SDWriteCache::drain(unsigned long timeoutMs)
+{
+    if (!taskHandle)
+    {
+        return true;
+    }
+    enqueue({JOB_SYNC, 0, false, nullptr, 0, 0});
+
+    unsigned long start = millis();
+    while (jobsDone.load() != jobsQueued.load())
+    {
+        if (millis() - start > timeoutMs)
+        {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+SDWriteCache::Stats SDWriteCache::getStats()
+{
+    uint32_t window[LATENCY_WINDOW];
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    uint32_t samples = std::min<uint32_t>(latencyCount, LATENCY_WINDOW);
+    memcpy(window, latencies, samples * sizeof(uint32_t));
+    xSemaphoreGive(mutex);
+
+    snapshot.queueDepth = uxQueueMessagesWaiting(jobs);
+    if (samples > 0)
+    {
+        std::sort(window, window + samples);
+        snapshot.writeP50Us = window[samples * 50 / 100];
+        snapshot.writeP90Us = window[samples * 90 / 100];
+        snapshot.writeP99Us = window[samples * 99 / 100];
+        snapshot.writeMaxUs = window[samples - 1];
+    }
+    return snapshot;
+}
+
+void SDWriteCache::resetStats()
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    memset(&stats, 0, sizeof(stats));
+    latencyCount = 0;
+    bytesAtWindowStart = 0;
+    xSemaphoreGive(mutex);
+}
@@ -0,0 +1,464 @@
+#include "session_container.h"
+#include <string.h>
+#include "crc32.h"
+#include "sd_manager.h"
+
+namespace Session
+{
+    const char *Writer::TAG = "SessionWriter";
+    const char *Reader::TAG = "SessionReader";
+
+    void sessionDirPath(char *out, size_t size, uint32_t sessionId)
+    {
+        snprintf(out, size, "/session%04u", static_cast<unsigned>(sessionId));
+    }
+
+    void segmentPath(char *out, size_t size, uint32_t sessionId, uint16_t segment)
+    {
+        snprintf(out, size, "/session%04u/seg%03u.mfs", static_cast<unsigned>(sessionId), segment);
+    }
+
+    void indexPath(char *out, size_t size, uint32_t sessionId)
+    {
+        snprintf(out, size, "/session%04u/index.mfi", static_cast<unsigned>(sessionId));
+    }
+
+    // ---- Writer ----
+
+    bool Writer::open(uint32_t id)
+    {
+        close();
+
+        char path[48];
+        sessionDirPath(path, sizeof(path), id);
+        SDManager &sd = SDManager::getInstance();
+        if (sd.exists(path))
+        {
+            ESP_LOGE(TAG, "Session directory %s already exists", path);
+            return false;
+        }
+        if (!sd.mkdir(path))
+        {
+            ESP_LOGE(TAG, "Failed to create session directory %s", path);
+            return false;
+        }
+
+        sessionId = id;
+        records = 0;
+        totalBytes = 0;
+        framesSinceFlush = 0;
+        indexing = true;
+
+        indexPath(path, sizeof(path), id);
+        indexFile = sd.openStream(path);
+        if (!indexFile)
+        {
+            ESP_LOGE(TAG, "Failed to create index %s", path);
+            return false;
+        }
+        FileHeader header = {INDEX_MAGIC, FORMAT_VERSION, 0, id, 0};
+        if (indexFile.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) != sizeof(header))
+        {
+            ESP_LOGE(TAG, "Failed to write index header");
+            indexFile.close();
+            return false;
+        }
+
+        if (!openSegment(0))
+        {
+            indexFile.close();
+            return false;
+        }
+
+        opened = true;
+        ESP_LOGI(TAG, "Session %u opened", static_cast<unsigned>(id));
+        return true;
+    }
+
+    bool Writer::openSegment(uint16_t number)
+    {
+        char path[48];
+        segmentPath(path, sizeof(path), sessionId, number);
+        segmentFile = SDManager::getInstance().openStream(path);
+        if (!segmentFile)
+        {
+            ESP_LOGE(TAG, "Failed to create segment %s", path);
+            return false;
+        }
+
+        FileHeader header = {SEGMENT_MAGIC, FORMAT_VERSION, number, sessionId, 0};
+        if (segmentFile.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) != sizeof(header))
+        {
+            ESP_LOGE(TAG, "Failed to write segment header");
+            segmentFile.close();
+            return false;
+        }
+
+        segment = number;
+        segmentBytes = sizeof(header);
+        totalBytes += sizeof(header);
+        return true;
+    }
+
+    bool Writer::nextSegment()
+    {
+        // Queue the segment's tail ahead of the index entries pointing at it
+        segmentFile.close();
+        indexFile.sync();
+        if (!openSegment(segment + 1))
+        {
+            indexFile.close();
+            opened = false;
+            return false;
+        }
+        return true;
+    }
+
+    bool Writer::append(RecordType type, uint32_t frameIndex, const uint8_t *data, size_t len)
+    {
+        if (!opened)
+        {
+            return false;
+        }
+
+        size_t recordBytes = sizeof(RecordHeader) + len;
+        if (segmentBytes + recordBytes > SEGMENT_MAX_BYTES && segmentBytes > sizeof(FileHeader) &&
+            !nextSegment())
+        {
+            return false;
+        }
+
+        RecordHeader header = {};
+        header.magic = RECORD_MAGIC;
+        header.type = type;
+        header.frameIndex = frameIndex;
+        header.length = len;
+        header.crc = crc32(data, len);
+
+        IndexEntry entry = {};
+        entry.frameIndex = frameIndex;
+        entry.offset = segmentBytes;
+        entry.length = len;
+        entry.segment = segment;
+        entry.type = type;
+
+        size_t written = segmentFile.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+        if (written == sizeof(header))
+        {
+            written += segmentFile.write(data, len);
+        }
+        segmentBytes += written;
+        totalBytes += written;
+        if (written != recordBytes)
+        {
+            // Whatever reached the card stays unindexed at the end of this
+            // segment; the next record starts a new one
+            ESP_LOGE(TAG, "Short write in segment %u: %u of %u bytes, sealing it", segment,
+                     static_cast<unsigned>(written), static_cast<unsigned>(recordBytes));
+            nextSegment();
+            return false;
+        }
+
+        if (indexing)
+        {
+            size_t indexed = indexFile.write(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry));
+            totalBytes += indexed;
+            if (indexed != sizeof(entry))
+            {
+                // Entries sit at fixed offsets; the reader rebuilds the rest
+                ESP_LOGE(TAG, "Short write in index, no further entries");
+                indexing = false;
+            }
+        }
+        records++;
+        return true;
+    }
+
+    void Writer::endFrame()
+    {
+        if (++framesSinceFlush >= FLUSH_INTERVAL)
+        {
+            flush();
+        }
+    }
+
+    void Writer::flush()
+    {
+        if (!opened)
+        {
+            return;
+        }
+        segmentFile.sync();
+        indexFile.sync();
+        framesSinceFlush = 0;
+    }
+
+    void Writer::close()
+    {
+        if (!opened)
+        {
+            return;
+        }
+        flush();
+        segmentFile.close();
+        indexFile.close();
+        opened = false;
+        ESP_LOGI(TAG, "Session %u closed: %u records, %u segments",
+                 static_cast<unsigned>(sessionId), static_cast<unsigned>(records), segment + 1);
+    }
+
+    // ---- Reader ----
+
+    bool Reader::open(uint32_t id)
+    {
+        close();
+        sessionId = id;
+
+        char path[48];
+        indexPath(path, sizeof(path), id);
+        indexFile = SDManager::getInstance().openFile(path, FILE_READ);
+
+        size_t indexed = 0;
+        FileHeader header = {};
+        if (indexFile &&
+            indexFile.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header) &&
+            header.magic == INDEX_MAGIC && header.sessionId == id)
+        {
+            // A torn final entry is ignored
+            indexed = (indexFile.size() - sizeof(header)) / sizeof(IndexEntry);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Index for session %u missing or damaged", static_cast<unsigned>(id));
+        }
+        count = indexed;
+
+        // Index chunks can reach the card ahead of the segment data they
+        // point at; entries past the end of their segment are dropped here
+        // and recovered by the rebuild below if the data turns up
+        IndexEntry tail = {};
+        while (count > 0 && entry(count - 1, tail) &&
+               (!selectSegment(tail.segment) ||
+                segmentFile.size() < tail.offset + sizeof(RecordHeader) + tail.length))
+        {
+            count--;
+        }
+        indexed = count;
+
+        // Anything past the last indexed record means the index lags the data
+        IndexEntry last = {};
+        uint16_t scanSegment = 0;
+        uint32_t scanOffset = sizeof(FileHeader);
+        if (indexed > 0 && entry(indexed - 1, last))
+        {
+            scanSegment = last.segment;
+            scanOffset = last.offset + sizeof(RecordHeader) + last.length;
+        }
+
+        char segPath[48];
+        bool lagging = false;
+        if (selectSegment(scanSegment))
+        {
+            lagging = segmentFile.size() > scanOffset;
+        }
+        segmentPath(segPath, sizeof(segPath), id, scanSegment + 1);
+        lagging = lagging || SDManager::getInstance().exists(segPath);
+
+        if (lagging && !rebuildIndex(indexed))
+        {
+            close();
+            return false;
+        }
+
+        if (count == 0 && !selectSegment(0))
+        {
+            ESP_LOGE(TAG, "Session %u has no readable data", static_cast<unsigned>(id));
+            close();
+            return false;
+        }
+
+        ESP_LOGI(TAG, "Session %u: %u records%s", static_cast<unsigned>(id),
+                 static_cast<unsigned>(count), recovered() ? " (index rebuilt)" : "");
+        return true;
+    }
+
+    void Reader::close()
+    {
+        if (indexFile)
+        {
+            indexFile.close();
+        }
+        if (segmentFile)
+        {
+            segmentFile.close();
+        }
+        openSegmentNumber = -1;
+        count = 0;
+        rebuilt.clear();
+    }
+
+    bool Reader::entry(size_t record, IndexEntry &out)
+    {
+        if (record >= count)
+        {
+            return false;
+        }
+        if (!rebuilt.empty())
+        {
+            out = rebuilt[record];
+            return true;
+        }
+        return indexFile.seek(sizeof(FileHeader) + record * sizeof(IndexEntry)) &&
+               indexFile.read(reinterpret_cast<uint8_t *>(&out), sizeof(out)) == sizeof(out);
+    }
+
+    bool Reader::selectSegment(uint16_t number)
+    {
+        if (openSegmentNumber == number)
+        {
+            return true;
+        }
+        if (segmentFile)
+        {
+            segmentFile.close();
+        }
+        openSegmentNumber = -1;
+
+        char path[48];
+        segmentPath(path, sizeof(path), sessionId, number);
+        if (!SDManager::getInstance().exists(path))
+        {
+            return false;
+        }
+        segmentFile = SDManager::getInstance().openFile(path, FILE_READ);
+
+        FileHeader header = {};
+        if (!segmentFile ||
+            segmentFile.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) ||
+            header.magic != SEGMENT_MAGIC || header.segment != number)
+        {
+            ESP_LOGE(TAG, "Bad segment header in %s", path);
+            return false;
+        }
+        openSegmentNumber = number;
+        return true;
+    }
+
+    bool Reader::read(const IndexEntry &e, uint8_t *buffer)
+    {
+        if (!selectSegment(e.segment) || !segmentFile.seek(e.offset))
+        {
+            return false;
+        }
+
+        RecordHeader header = {};
+        if (segmentFile.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) ||
+            header.magic != RECORD_MAGIC || header.length != e.length)
+        {
+            ESP_LOGE(TAG, "Record header mismatch at %u:%u", e.segment, static_cast<unsigned>(e.offset));
+            return false;
+        }
+        if (segmentFile.read(buffer, e.length) != e.length)
+        {
+            return false;
+        }
+        if (crc32(buffer, e.length) != header.crc)
+        {
+            ESP_LOGE(TAG, "Checksum mismatch for frame %u", static_cast<unsigned>(e.frameIndex));
+            return false;
+        }
+        return true;
+    }
+
+    bool Reader::findFrame(uint32_t frameIndex, RecordType type, IndexEntry &out)
+    {
+        // Frame indices are non-decreasing in append order
+        size_t lo = 0;
+        size_t hi = count;
+        IndexEntry probe;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (!entry(mid, probe))
+            {
+                return false;
+            }
+            if (probe.frameIndex < frameIndex)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        for (size_t i = lo; i < count && entry(i, probe) && probe.frameIndex == frameIndex; i++)
+        {
+            if (probe.type == type)
+            {
+                out = probe;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Reader::rebuildIndex(size_t indexedRecords)
+    {
+        ESP_LOGW(TAG, "Index lags segment data, rebuilding from record %u",
+                 static_cast<unsigned>(indexedRecords));
+
+        // Entries are read through the index file before rebuilt takes over
+        std::vector<IndexEntry> entries;
+        entries.reserve(indexedRecords + 64);
+        IndexEntry e;
+        for (size_t i = 0; i < indexedRecords; i++)
+        {
+            if (!entry(i, e))
+            {
+                return false;
+            }
+            entries.push_back(e);
+        }
+
+        uint16_t seg = 0;
+        uint32_t offset = sizeof(FileHeader);
+        if (!entries.empty())
+        {
+            const IndexEntry &last = entries.back();
+            seg = last.segment;
+            offset = last.offset + sizeof(RecordHeader) + last.length;
+        }
+
+        while (selectSegment(seg))
+        {
+            size_t segmentSize = segmentFile.size();
+            while (offset + sizeof(RecordHeader) <= segmentSize)
+            {
+                RecordHeader header = {};
+                if (!segmentFile.seek(offset) ||
+                    segmentFile.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) ||
+                    header.magic != RECORD_MAGIC ||
+                    offset + sizeof(header) + header.length > segmentSize)
+                {
+                    break; // torn tail of an interrupted write
+                }
+
+                IndexEntry recoveredEntry = {};
+                recoveredEntry.frameIndex = header.frameIndex;
+                recoveredEntry.offset = offset;
+                recoveredEntry.length = header.length;
+                recoveredEntry.segment = seg;
+                recoveredEntry.type = header.type;
+                entries.push_back(recoveredEntry);
+                offset += sizeof(header) + header.length;
+            }
+            seg++;
+            offset = sizeof(FileHeader);
+        }
+
+        rebuilt.swap(entries);
+        count = rebuilt.size();
+        return true;
+    }
+}
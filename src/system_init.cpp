@@ -1,5 +1,7 @@
 #include "system_init.h"
+#include <U8g2lib.h> // fonts
 #include "global_instances.h"
+#include "alert_scheduler.h"
 #include "xbm_icon.h"
 #include "Version.h"
 
@@ -10,6 +12,7 @@ bool SystemInitializer::initializeBuzzer()
     try
     {
         BuzzerManager::getInstance().begin(BUZZER_PIN);
+        AlertScheduler::getInstance().begin();
         ESP_LOGI(TAG, "Buzzer initialized successfully");
         return true;
     }
@@ -50,7 +53,7 @@ bool SystemInitializer::initializeBLE()
 
 void SystemInitializer::playStartupSequence()
 {
-    buzzer.playBootTone();
+    AlertScheduler::getInstance().raise(AlertScheduler::ALERT_BOOT);
 }
 
 void SystemInitializer::showStartupIcons()
@@ -65,35 +68,24 @@ void SystemInitializer::showStartupIcons()
         return;
     }
 
-    try
-    {
-        display.clear();
-
-        // Get the icon data
-        Icons::IconInfo iconInfo = Icons::getIconXBM(Icons::Type::FOX_3, Icons::Polarity::POSITIVE);
+    // One frame, so the compositor never sends a half-drawn boot screen
+    Icons::IconInfo iconInfo = Icons::getIconXBM(Icons::Type::FOX_3, Icons::Polarity::POSITIVE);
+    String version = "v" + String(VERSION);
+    String build = "b: " + String(BUILD_TIMESTAMP);
+    display.compose([&](DisplayBackend &canvas)
+                    {
         if (iconInfo.data != nullptr)
         {
-            // Calculate Y position to draw from bottom-up
-            int yPos = display.getDisplayHeight() - iconInfo.height;
-            ESP_LOGI(TAG, "Drawing fox icon at %d, %d, %d, %d",
-                     64, yPos, iconInfo.width, iconInfo.height);
-            display.drawXBM(64, yPos, iconInfo.width, iconInfo.height, iconInfo.data);
-            Icons::freeXBMData(iconInfo);
+            // Drawn from the bottom up
+            int yPos = canvas.height() - iconInfo.height;
+            canvas.drawXBM(64, yPos, iconInfo.width, iconInfo.height, iconInfo.data);
         }
-
-        display.printAt(("v" + String(VERSION)).c_str(), 0, 0);
-        display.printAt(("b: " + String(BUILD_TIMESTAMP)).c_str(), 0, 8);
-        display.printAt("",0,16);
-        display.printAt("MiddleFox...", 0, 24);
-        display.printAt("Started!", 0, 32);
-
-        display.refresh();
-        ESP_LOGI(TAG, "Startup icons shown successfully");
-    }
-    catch (const std::exception &e)
-    {
-        ESP_LOGE(TAG, "Error showing startup icons: %s", e.what());
-    }
+        canvas.setFont(u8g2_font_4x6_tf);
+        canvas.drawStr(0, 0, version.c_str());
+        canvas.drawStr(0, 8, build.c_str());
+        canvas.drawStr(0, 24, "MiddleFox...");
+        canvas.drawStr(0, 32, "Started!"); });
+    ESP_LOGI(TAG, "Startup icons shown successfully");
 }
 
 bool initSystem()
@@ -106,7 +98,7 @@ bool initSystem()
     }
 
     // Initialize camera manager
-    if (!CameraManager::getInstance().begin(false))
+    if (!CameraManager::getInstance().begin(CameraProfile::DATASET))
     {
         return false;
     }
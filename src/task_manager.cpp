@@ -1,5 +1,6 @@
 #include "task_manager.h"
 #include "global_instances.h"
+#include "mode_controller.h"
 
 TaskHandle_t TaskManager::bleTaskHandle = nullptr;
 TaskHandle_t TaskManager::mainTaskHandle = nullptr;
@@ -8,6 +9,12 @@ bool TaskManager::startTasks() {
     // Wait for BLE to be fully initialized
     vTaskDelay(pdMS_TO_TICKS(200));
 
+    // Commands received since BLE came up are waiting on the bus
+    if (!ModeController::getInstance().begin(bleService)) {
+        ESP_LOGE("TaskManager", "Failed to start mode controller");
+        return false;
+    }
+
     // Start BLE task
     BaseType_t result = xTaskCreatePinnedToCore(
         bleTask,
@@ -58,13 +65,10 @@ void TaskManager::mainTask(void* parameter) {
         } else if (bleService.isPreviewEnabled()) {
             previewService.loop();
         }
-        #ifdef PRODUCTION_MODE
         else if (bleService.isInferenceEnabled()) {
             inference.loop();
         }
-        #endif
-        
-        display.refresh();
+
         vTaskDelay(pdMS_TO_TICKS(20));
     }
 } 
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "vanishing_point_estimator.h"
+#include <string.h>
+#include <algorithm>
+
+const char *VanishingPointEstimator::TAG = "VanishingPoint";
+
+VanishingPointEstimator::VanishingPointEstimator() : count(0)
+{
+    memset(xs, 0, sizeof(xs));
+    memset(ys, 0, sizeof(ys));
+    detector.setRoadTop(ROAD_TOP);
+}
+
+bool VanishingPointEstimator::addFrame(const camera_fb_t *fb)
+{
+    LaneResult result;
+    if (count >= MAX_FRAMES || !detector.detect(fb, result) || !result.valid())
+    {
+        return false;
+    }
+    // Both boundaries run from their bottom x (row 1) to their top x (row
+    // ROI_TOP); they cross a share u of that distance up
+    float bottom = result.right.bottomX - result.left.bottomX;
+    float top = result.right.topX - result.left.topX;
+    if (bottom <= top)
+    {
+        return false; // parallel or diverging upwards
+    }
+    float u = bottom / (bottom - top);
+    float x = result.left.bottomX + (result.left.topX - result.left.bottomX) * u;
+    float y = 1 - u * (1 - LaneResult::ROI_TOP);
+    if (y < 0 || y >= ROAD_TOP || x < -0.5f || x > 1.5f)
+    {
+        return false;
+    }
+    xs[count] = x;
+    ys[count] = y;
+    count++;
+    if (count == MAX_FRAMES)
+    {
+        ESP_LOGI(TAG, "%d frames in, later ones are ignored", MAX_FRAMES);
+    }
+    return true;
+}
+
+bool VanishingPointEstimator::estimate(Estimate &out)
+{
+    memset(&out, 0, sizeof(out));
+    out.frames = count;
+    if (count == 0)
+    {
+        return false;
+    }
+    std::sort(xs, xs + count);
+    std::sort(ys, ys + count);
+    out.vanishX = count % 2 ? xs[count / 2] : (xs[count / 2 - 1] + xs[count / 2]) / 2;
+    out.vanishY = count % 2 ? ys[count / 2] : (ys[count / 2 - 1] + ys[count / 2]) / 2;
+    out.spread = ys[count * 3 / 4] - ys[count / 4];
+    return count >= static_cast<uint32_t>(CALIBRATION_MIN_FRAMES) && out.spread <= CALIBRATION_MAX_SPREAD;
+}
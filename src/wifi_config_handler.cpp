@@ -70,11 +70,11 @@ bool WiFiConfigHandler::syncTimeFromWiFi() {
 }
 
 bool WiFiConfigHandler::loadWiFiCredentials() {
-    if (!SD.exists(WIFI_CONFIG_FILE)) {
+    if (!SDManager::getInstance().exists(WIFI_CONFIG_FILE)) {
         return false;
     }
 
-    File configFile = SD.open(WIFI_CONFIG_FILE, "r");
+    File configFile = SDManager::getInstance().openFile(WIFI_CONFIG_FILE, "r");
     if (!configFile) {
         return false;
     }
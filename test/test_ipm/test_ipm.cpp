@@ -0,0 +1,215 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <unity.h>
+#include "config.h"
+#include "inverse_perspective_map.h"
+#include "native/ipm_reference.h"
+#include "native/road_scene.h"
+#include "sd_manager.h"
+
+// The bird's-eye remap table against a double-precision homography and
+// float bilinear sampling, impossible quads, a straight road and the card
+// cache
+
+using IpmReference::defaultLayout;
+
+static const int LAYOUTS = 100;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+struct Check
+{
+    double maxPosition = 0; // pixels, table against reference
+    double maxValue = 0;    // luma steps, warp against reference
+    double sumValue = 0;
+    size_t values = 0;
+    int validityMismatches = 0; // away from the frame's edge
+    int valueMismatches = 0;    // beyond the per-pixel tolerance
+};
+
+static void compare(const InversePerspectiveMap &ipm, const uint8_t *frame, Check &check)
+{
+    const InversePerspectiveMap::Layout &layout = ipm.getLayout();
+    IpmReference::Reference expected;
+    IpmReference::reference(layout, frame, expected);
+    std::vector<uint8_t> warped(static_cast<size_t>(layout.width) * layout.height);
+    ipm.warp(frame, warped.data());
+    const double step = 1.0 / (1 << InversePerspectiveMap::FRACTION_BITS);
+    for (size_t i = 0; i < warped.size(); i++)
+    {
+        uint32_t entry = ipm.getTable()[i];
+        bool valid = entry != InversePerspectiveMap::INVALID;
+        if (valid != expected.valid[i])
+        {
+            // Rounding to the table's step may cross the edge
+            double margin = std::min(std::min(expected.x[i], expected.y[i]),
+                                     std::min(layout.sourceWidth - 1 - expected.x[i],
+                                              layout.sourceHeight - 1 - expected.y[i]));
+            check.validityMismatches += fabs(margin) > step ? 1 : 0;
+            continue;
+        }
+        if (!valid)
+        {
+            check.valueMismatches += warped[i] != 0 ? 1 : 0;
+            continue;
+        }
+        uint32_t index = entry & 0xFFFFFF;
+        double x = index % layout.sourceWidth + ((entry >> 24) & 0xF) * step;
+        double y = index / layout.sourceWidth + (entry >> 28) * step;
+        check.maxPosition = std::max(check.maxPosition,
+                                     std::max(fabs(x - expected.x[i]), fabs(y - expected.y[i])));
+        double error = fabs(warped[i] - expected.value[i]);
+        check.maxValue = std::max(check.maxValue, error);
+        check.sumValue += error;
+        check.values++;
+        check.valueMismatches += error > expected.tolerance[i] + 1e-9 ? 1 : 0;
+    }
+}
+
+static void test_table_and_warp_match_the_reference()
+{
+    std::mt19937 random(24);
+    std::vector<uint8_t> frame;
+    Check check;
+    for (int i = 0; i <= LAYOUTS; i++)
+    {
+        InversePerspectiveMap::Layout layout = i == 0 ? defaultLayout() : IpmReference::randomLayout(random);
+        InversePerspectiveMap ipm;
+        char message[64];
+        snprintf(message, sizeof(message), "layout %d: %dx%d -> %dx%d", i, layout.sourceWidth, layout.sourceHeight,
+                 layout.width, layout.height);
+        TEST_ASSERT_TRUE_MESSAGE(ipm.build(layout), message);
+        IpmReference::randomFrame(layout.sourceWidth, layout.sourceHeight, random, frame);
+        compare(ipm, frame.data(), check);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(check.maxPosition <= IpmReference::POSITION_TOLERANCE, "position error");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, check.validityMismatches, "validity away from the edge");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, check.valueMismatches, "values beyond tolerance");
+}
+
+static void test_impossible_quads_are_rejected()
+{
+    InversePerspectiveMap::Layout bad[4] = {defaultLayout(), defaultLayout(), defaultLayout(), defaultLayout()};
+    bad[0].quad = InversePerspectiveMap::Quad::fromVanishingPoint(0.5f, 0.6f, 0.4f); // cut above the horizon
+    bad[1].quad = {{0.2f, 0.4f, 0.6f, 0.8f}, {0.5f, 0.5f, 0.5f, 0.5f}};             // a line
+    std::swap(bad[2].quad.x[0], bad[2].quad.x[1]);                                   // folded
+    bad[3].width = 0;
+    for (const InversePerspectiveMap::Layout &layout : bad)
+    {
+        InversePerspectiveMap ipm;
+        TEST_ASSERT_FALSE(ipm.build(layout));
+    }
+}
+
+// A straight road seen through the default calibration: its boundaries meet
+// at the vanishing point, so they come out as vertical lines at their
+// bottom positions
+static void test_straight_road_comes_out_vertical()
+{
+    std::mt19937 random(24);
+    std::vector<uint8_t> frame;
+    InversePerspectiveMap ipm;
+    InversePerspectiveMap::Layout layout = defaultLayout();
+    ipm.build(layout);
+    RoadScene::Road road = {};
+    road.vanishX = IPM_VANISH_X * RoadScene::WIDTH;
+    road.vanishY = IPM_VANISH_Y * RoadScene::HEIGHT;
+    road.leftBottom = road.vanishX - 85;
+    road.rightBottom = road.vanishX + 85;
+    road.paint = true;
+    road.asphaltLuma = 70;
+    road.paintLuma = 230;
+    RoadScene::render(road, random, frame);
+    std::vector<uint8_t> view(static_cast<size_t>(layout.width) * layout.height);
+    ipm.warp(frame.data(), view.data());
+    double expected[2] = {road.leftBottom / RoadScene::WIDTH * layout.width,
+                          road.rightBottom / RoadScene::WIDTH * layout.width};
+    std::vector<double> lineError[2];
+    for (int y = 0; y < layout.height; y++)
+    {
+        // Centre of the paint on each half of the row
+        for (int side = 0; side < 2; side++)
+        {
+            double sum = 0, weight = 0;
+            for (int x = side * layout.width / 2; x < (side + 1) * layout.width / 2; x++)
+            {
+                int above = view[y * layout.width + x] - (road.asphaltLuma + road.paintLuma) / 2;
+                if (above > 0)
+                {
+                    sum += (x + 0.5) * above;
+                    weight += above;
+                }
+            }
+            if (weight > 0)
+            {
+                lineError[side].push_back(fabs(sum / weight - expected[side]));
+            }
+        }
+    }
+    for (int side = 0; side < 2; side++)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL_INT(layout.height * 9 / 10, static_cast<int>(lineError[side].size()));
+        for (double error : lineError[side])
+        {
+            TEST_ASSERT_TRUE_MESSAGE(error <= 1.0, "line more than a pixel from vertical");
+        }
+    }
+}
+
+// Built and saved, loaded, damaged, stale
+static void test_table_survives_the_card_cache()
+{
+    SDManager &sd = SDManager::getInstance();
+    TEST_ASSERT_TRUE_MESSAGE(sd.begin(), "host storage unavailable");
+    InversePerspectiveMap::Layout layout = defaultLayout();
+    sd.remove(IPM_LUT_PATH);
+    InversePerspectiveMap first, second, third, fourth;
+    TEST_ASSERT_TRUE(first.begin(layout, IPM_LUT_PATH));
+    TEST_ASSERT_FALSE(first.wasLoaded());
+    TEST_ASSERT_TRUE(second.begin(layout, IPM_LUT_PATH));
+    TEST_ASSERT_TRUE(second.wasLoaded());
+    TEST_ASSERT_EQUAL_MEMORY(first.getTable(), second.getTable(), first.tableBytes());
+
+    // Damaged: rebuilt, not loaded
+    File file = sd.openFile(IPM_LUT_PATH, FILE_READ);
+    TEST_ASSERT_TRUE(file);
+    std::vector<uint8_t> bytes(file.size());
+    file.read(bytes.data(), bytes.size());
+    file.close();
+    bytes[bytes.size() / 2] ^= 0x40;
+    file = sd.openFile(IPM_LUT_PATH, FILE_WRITE);
+    TEST_ASSERT_TRUE(file);
+    file.write(bytes.data(), bytes.size());
+    file.close();
+    TEST_ASSERT_TRUE(third.begin(layout, IPM_LUT_PATH));
+    TEST_ASSERT_FALSE(third.wasLoaded());
+    TEST_ASSERT_EQUAL_MEMORY(first.getTable(), third.getTable(), first.tableBytes());
+
+    // Stale: a file for another mount is rebuilt and replaced
+    InversePerspectiveMap::Layout moved = layout;
+    moved.quad = InversePerspectiveMap::Quad::fromVanishingPoint(IPM_VANISH_X + 0.02f, IPM_VANISH_Y, IPM_TOP);
+    TEST_ASSERT_TRUE(fourth.begin(moved, IPM_LUT_PATH));
+    TEST_ASSERT_FALSE(fourth.wasLoaded());
+    TEST_ASSERT_TRUE(second.load(IPM_LUT_PATH, moved));
+    sd.remove(IPM_LUT_PATH);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_table_and_warp_match_the_reference);
+    RUN_TEST(test_impossible_quads_are_rejected);
+    RUN_TEST(test_straight_road_comes_out_vertical);
+    RUN_TEST(test_table_survives_the_card_cache);
+    return UNITY_END();
+}
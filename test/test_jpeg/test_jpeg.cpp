@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "img_converters.h"
+#include "jpeg_stream_encoder.h"
+#include "native/jpeg_decoder.h"
+#include "native/road_scene.h"
+#include "parallel_jpeg_encoder.h"
+
+// The streaming encoder's output decodes, arrives in order in bounded
+// chunks and is as faithful as frame2jpg at 4:4:4; the striped parallel
+// encoding decodes to exactly the pixels of the single-pass one
+
+static const int FRAMES = 8;
+static const int QUALITY = 90;
+
+struct Image
+{
+    int width;
+    int height;
+    std::vector<uint8_t> pixels; // big-endian RGB565
+
+    camera_fb_t frame()
+    {
+        camera_fb_t fb = {};
+        fb.buf = pixels.data();
+        fb.len = pixels.size();
+        fb.width = width;
+        fb.height = height;
+        fb.format = PIXFORMAT_RGB565;
+        return fb;
+    }
+};
+
+struct Collector
+{
+    std::vector<uint8_t> bytes;
+    size_t largestChunk = 0;
+    bool ordered = true;
+};
+
+static std::vector<Image> roads;
+
+static size_t collect(void *arg, size_t index, const void *data, size_t len)
+{
+    Collector *out = static_cast<Collector *>(arg);
+    out->ordered = out->ordered && index == out->bytes.size();
+    out->bytes.insert(out->bytes.end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + len);
+    out->largestChunk = len > out->largestChunk ? len : out->largestChunk;
+    return len;
+}
+
+// Nearest-neighbour upscale, for a frame the size of the preview profile
+static Image scale(const Image &source, int width, int height)
+{
+    Image out = {width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 2)};
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            size_t from =
+                (static_cast<size_t>(y * source.height / height) * source.width + x * source.width / width) * 2;
+            size_t to = (static_cast<size_t>(y) * width + x) * 2;
+            out.pixels[to] = source.pixels[from];
+            out.pixels[to + 1] = source.pixels[from + 1];
+        }
+    }
+    return out;
+}
+
+static DecodedJpeg decode(const std::vector<uint8_t> &jpeg)
+{
+    DecodedJpeg decoded;
+    std::string error;
+    TEST_ASSERT_TRUE_MESSAGE(decodeJpeg(jpeg.data(), jpeg.size(), decoded, error), error.c_str());
+    return decoded;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_stream_output_decodes_in_order()
+{
+    JpegStreamEncoder encoders[2] = {JpegStreamEncoder(QUALITY, JpegStreamEncoder::SUBSAMPLE_420),
+                                     JpegStreamEncoder(QUALITY, JpegStreamEncoder::SUBSAMPLE_444)};
+    for (JpegStreamEncoder &encoder : encoders)
+    {
+        for (Image &image : roads)
+        {
+            camera_fb_t fb = image.frame();
+            Collector out;
+            TEST_ASSERT_TRUE(encoder.encode(&fb, collect, &out));
+            TEST_ASSERT_EQUAL(encoder.encodedBytes(), out.bytes.size());
+            TEST_ASSERT_TRUE(out.ordered);
+            TEST_ASSERT_TRUE(out.largestChunk <= JpegStreamEncoder::CHUNK_BYTES);
+            DecodedJpeg decoded = decode(out.bytes);
+            TEST_ASSERT_EQUAL(image.width, decoded.width);
+            TEST_ASSERT_EQUAL(image.height, decoded.height);
+        }
+    }
+}
+
+// 4:4:4 uses the same tables and layout as toojpeg, so it must be as
+// faithful; 4:2:0 trades chroma detail for size
+static void test_stream_444_is_as_faithful_as_frame2jpg()
+{
+    JpegStreamEncoder encoder(QUALITY, JpegStreamEncoder::SUBSAMPLE_444);
+    for (Image &image : roads)
+    {
+        camera_fb_t fb = image.frame();
+        uint8_t *jpeg = nullptr;
+        size_t jpegLen = 0;
+        TEST_ASSERT_TRUE(frame2jpg(&fb, QUALITY, &jpeg, &jpegLen));
+        DecodedJpeg baseline = decode(std::vector<uint8_t>(jpeg, jpeg + jpegLen));
+        free(jpeg);
+
+        Collector out;
+        TEST_ASSERT_TRUE(encoder.encode(&fb, collect, &out));
+        DecodedJpeg streamed = decode(out.bytes);
+        double baselinePsnr = psnrAgainstRgb565(baseline.rgb, fb.buf, fb.width, fb.height);
+        double streamPsnr = psnrAgainstRgb565(streamed.rgb, fb.buf, fb.width, fb.height);
+        TEST_ASSERT_TRUE_MESSAGE(streamPsnr >= baselinePsnr - 0.5, "PSNR below frame2jpg");
+    }
+}
+
+// Every worker count against the single-pass pixels, with the restart
+// interval and marker count the stripes imply
+static void assertStripesMatchSinglePass(std::vector<Image> &set, JpegStreamEncoder::Subsampling subsampling)
+{
+    JpegStreamEncoder single(QUALITY, subsampling);
+    std::vector<std::vector<uint8_t>> reference;
+    for (Image &image : set)
+    {
+        camera_fb_t fb = image.frame();
+        Collector out;
+        TEST_ASSERT_TRUE(single.encode(&fb, collect, &out));
+        reference.push_back(decode(out.bytes).rgb);
+    }
+
+    int mcu = single.mcuSize();
+    int width = set[0].width;
+    int rows = (set[0].height + mcu - 1) / mcu;
+    for (int workers = 1; workers <= ParallelJpegEncoder::MAX_WORKERS; workers *= 2)
+    {
+        ParallelJpegEncoder encoder(QUALITY, subsampling, workers);
+        TEST_ASSERT_TRUE(encoder.begin());
+        for (size_t i = 0; i < set.size(); i++)
+        {
+            camera_fb_t fb = set[i].frame();
+            Collector out;
+            TEST_ASSERT_TRUE(encoder.encode(&fb, collect, &out));
+            DecodedJpeg decoded = decode(out.bytes);
+            TEST_ASSERT_EQUAL(workers > 1 ? (width + mcu - 1) / mcu : 0, decoded.restartInterval);
+            TEST_ASSERT_EQUAL(workers > 1 ? rows - 1 : 0, decoded.restarts);
+            TEST_ASSERT_TRUE_MESSAGE(decoded.rgb == reference[i], "striped pixels differ from single pass");
+        }
+        encoder.end();
+    }
+}
+
+static void test_parallel_matches_single_pass()
+{
+    std::vector<Image> vga;
+    for (const Image &image : roads)
+    {
+        vga.push_back(scale(image, 640, 480));
+    }
+    assertStripesMatchSinglePass(roads, JpegStreamEncoder::SUBSAMPLE_420);
+    assertStripesMatchSinglePass(roads, JpegStreamEncoder::SUBSAMPLE_444);
+    assertStripesMatchSinglePass(vga, JpegStreamEncoder::SUBSAMPLE_420);
+    assertStripesMatchSinglePass(vga, JpegStreamEncoder::SUBSAMPLE_444);
+}
+
+int main()
+{
+    std::mt19937 random(5);
+    for (int i = 0; i < FRAMES; i++)
+    {
+        Image image = {RoadScene::WIDTH, RoadScene::HEIGHT, {}};
+        RoadScene::render(RoadScene::randomRoad(i, random), random, image.pixels);
+        roads.push_back(image);
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_output_decodes_in_order);
+    RUN_TEST(test_stream_444_is_as_faithful_as_frame2jpg);
+    RUN_TEST(test_parallel_matches_single_pass);
+    return UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <random>
+#include <vector>
+#include <unity.h>
+#include "frame_preprocessor.h"
+#include "native/preprocess_reference.h"
+
+// FramePreprocessor bit for bit against the four-pass reference on random
+// frames: fixed layouts (the inference shapes, bottom-half and odd regions,
+// identity, enlarging), random ones of each filter, and impossible ones
+
+typedef FramePreprocessor::Layout Layout;
+
+static const FramePreprocessor::Resample AREA = FramePreprocessor::AREA;
+static const FramePreprocessor::Resample BILINEAR = FramePreprocessor::BILINEAR;
+static const int ROUNDS = 200;
+
+static std::mt19937 generator(2025);
+static int8_t table[256]; // arbitrary, so a wrong index cannot go unnoticed
+static FramePreprocessor fused;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Runs both paths on a random frame and fails on the first difference,
+// including a write past the output
+static void assertBitExact(const Layout &requested)
+{
+    char message[128];
+    snprintf(message, sizeof(message), "%dx%d -> %dx%dx%d %s", requested.sourceWidth, requested.sourceHeight,
+             requested.width, requested.height, requested.channels,
+             requested.resample == AREA ? "area" : "bilinear");
+    TEST_ASSERT_TRUE_MESSAGE(fused.configure(requested, table), message);
+    const Layout &l = fused.getLayout();
+    std::vector<uint8_t> frame = PreprocessReference::randomFrame(l.sourceWidth, l.sourceHeight, generator);
+    std::vector<int8_t> expected = PreprocessReference::run(frame, l, table);
+    std::vector<int8_t> actual(expected.size() + 16, 0x55);
+    fused.run(frame.data(), actual.data());
+    expected.resize(actual.size(), 0x55);
+    TEST_ASSERT_EQUAL_INT8_ARRAY_MESSAGE(expected.data(), actual.data(), actual.size(), message);
+}
+
+static void assertRandomLayouts(FramePreprocessor::Resample resample)
+{
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        Layout l = {};
+        l.sourceWidth = 1 + generator() % 320;
+        l.sourceHeight = 1 + generator() % 240;
+        l.roi.width = 1 + generator() % l.sourceWidth;
+        l.roi.height = 1 + generator() % l.sourceHeight;
+        l.roi.x = generator() % (l.sourceWidth - l.roi.width + 1);
+        l.roi.y = generator() % (l.sourceHeight - l.roi.height + 1);
+        l.channels = generator() % 2 ? 3 : 1;
+        l.resample = resample;
+        int maxWidth = resample == AREA ? l.roi.width : FramePreprocessor::MAX_WIDTH;
+        int maxHeight = resample == AREA ? l.roi.height : 2 * l.roi.height + 8;
+        l.width = 1 + generator() % maxWidth;
+        l.height = 1 + generator() % maxHeight;
+        assertBitExact(l);
+    }
+}
+
+static void test_fixed_layouts_are_bit_exact()
+{
+    const Layout fixed[] = {
+        {240, 240, {0, 0, 0, 0}, 64, 48, 1, AREA},
+        {240, 240, {0, 0, 0, 0}, 96, 96, 3, AREA},
+        {240, 240, {0, 120, 240, 120}, 64, 32, 1, AREA},
+        {320, 240, {7, 33, 201, 150}, 50, 37, 3, AREA},
+        {160, 120, {0, 0, 0, 0}, 160, 120, 1, AREA},
+        {31, 17, {0, 0, 0, 0}, 7, 5, 3, AREA},
+        {240, 240, {0, 0, 0, 0}, 64, 48, 1, BILINEAR},
+        {240, 240, {13, 101, 97, 77}, 300, 260, 1, BILINEAR},
+        {640, 480, {0, 0, 0, 0}, 320, 240, 3, BILINEAR},
+        {160, 120, {0, 0, 0, 0}, 160, 120, 3, BILINEAR},
+        {1, 1, {0, 0, 0, 0}, 5, 3, 1, BILINEAR},
+    };
+    for (const Layout &layout : fixed)
+    {
+        assertBitExact(layout);
+    }
+}
+
+static void test_random_area_layouts_are_bit_exact()
+{
+    assertRandomLayouts(AREA);
+}
+
+static void test_random_bilinear_layouts_are_bit_exact()
+{
+    assertRandomLayouts(BILINEAR);
+}
+
+static void test_impossible_layouts_are_rejected()
+{
+    const Layout impossible[] = {
+        {240, 240, {200, 0, 50, 10}, 8, 8, 1, AREA},     // region past the right edge
+        {240, 240, {0, 0, 0, 0}, 241, 48, 1, AREA},      // area cannot enlarge
+        {640, 480, {0, 0, 0, 0}, 321, 240, 1, BILINEAR}, // wider than MAX_WIDTH
+        {240, 240, {0, 0, 0, 0}, 64, 48, 2, AREA},       // two channels
+        {0, 240, {0, 0, 0, 0}, 64, 48, 1, AREA},         // empty frame
+    };
+    for (const Layout &layout : impossible)
+    {
+        TEST_ASSERT_FALSE(fused.configure(layout, table));
+    }
+}
+
+int main()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        table[i] = static_cast<int8_t>(generator());
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_layouts_are_bit_exact);
+    RUN_TEST(test_random_area_layouts_are_bit_exact);
+    RUN_TEST(test_random_bilinear_layouts_are_bit_exact);
+    RUN_TEST(test_impossible_layouts_are_rejected);
+    return UNITY_END();
+}
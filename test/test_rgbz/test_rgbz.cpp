@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <unity.h>
+#include "native/road_scene.h"
+#include "rgbz_codec.h"
+
+// Lossless round trips of rendered roads and synthetic edge cases (noise,
+// flat, gradients, sizes without a full neighbourhood), the stored fallback
+// and damaged streams
+
+static const uint16_t SIZES[][2] = {{1, 1}, {1, 9}, {9, 1}, {3, 5}, {240, 240}, {641, 479}};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Encodes and decodes one frame and checks the pixels come back; returns
+// the compression method
+static uint8_t assertRoundTrip(const std::vector<uint8_t> &pixels, uint16_t width, uint16_t height)
+{
+    char message[32];
+    snprintf(message, sizeof(message), "%ux%u", width, height);
+    std::vector<uint8_t> packed(Rgbz::maxEncodedSize(width, height));
+    std::vector<uint8_t> decoded(Rgbz::frameBytes(width, height));
+    size_t len = Rgbz::encode(pixels.data(), width, height, packed.data(), packed.size());
+    TEST_ASSERT_TRUE_MESSAGE(len > 0, message);
+    TEST_ASSERT_TRUE_MESSAGE(Rgbz::decode(packed.data(), len, decoded.data(), decoded.size()), message);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(pixels.data(), decoded.data(), decoded.size(), message);
+    Rgbz::Header header;
+    TEST_ASSERT_TRUE_MESSAGE(Rgbz::readHeader(packed.data(), len, header), message);
+    return header.method;
+}
+
+static void test_rendered_roads_round_trip_and_compress()
+{
+    std::mt19937 random(7);
+    std::vector<uint8_t> pixels;
+    for (int i = 0; i < 20; i++)
+    {
+        RoadScene::render(RoadScene::randomRoad(i, random), random, pixels);
+        TEST_ASSERT_NOT_EQUAL(Rgbz::METHOD_STORED, assertRoundTrip(pixels, RoadScene::WIDTH, RoadScene::HEIGHT));
+    }
+}
+
+// Incompressible noise falls back to stored
+static void test_noise_is_stored()
+{
+    std::mt19937 random(7);
+    for (const uint16_t *size : SIZES)
+    {
+        std::vector<uint8_t> pixels(Rgbz::frameBytes(size[0], size[1]));
+        for (uint8_t &byte : pixels)
+        {
+            byte = random();
+        }
+        TEST_ASSERT_EQUAL(Rgbz::METHOD_STORED, assertRoundTrip(pixels, size[0], size[1]));
+    }
+}
+
+static void test_flat_frames_round_trip()
+{
+    for (const uint16_t *size : SIZES)
+    {
+        std::vector<uint8_t> pixels(Rgbz::frameBytes(size[0], size[1]), 0xFF);
+        assertRoundTrip(pixels, size[0], size[1]);
+    }
+}
+
+// Diagonal ramp that wraps every channel, with a little noise
+static void test_gradients_round_trip()
+{
+    std::mt19937 random(7);
+    for (const uint16_t *size : SIZES)
+    {
+        std::vector<uint8_t> pixels(Rgbz::frameBytes(size[0], size[1]));
+        for (size_t p = 0; p < pixels.size() / 2; p++)
+        {
+            int x = p % size[0];
+            int y = p / size[0];
+            uint16_t value =
+                (((x + y) / 4 & 31) << 11) | (((x + 2 * y + (random() & 1)) / 2 & 63) << 5) | ((y / 3) & 31);
+            pixels[p * 2] = value >> 8;
+            pixels[p * 2 + 1] = value & 0xFF;
+        }
+        assertRoundTrip(pixels, size[0], size[1]);
+    }
+}
+
+// Damaged streams are rejected, never decoded to wrong pixels
+static void test_damaged_streams_are_rejected()
+{
+    std::vector<uint8_t> pixels(Rgbz::frameBytes(240, 240));
+    for (size_t p = 0; p < pixels.size(); p++)
+    {
+        pixels[p] = (p / 480 + (p % 480) / 7) & 0xFF;
+    }
+    std::vector<uint8_t> packed(Rgbz::maxEncodedSize(240, 240));
+    size_t len = Rgbz::encode(pixels.data(), 240, 240, packed.data(), packed.size());
+    TEST_ASSERT_TRUE(len > Rgbz::HEADER_BYTES);
+    std::vector<uint8_t> decoded(pixels.size());
+    for (size_t at = Rgbz::HEADER_BYTES; at < len; at += len / 16 + 1)
+    {
+        std::vector<uint8_t> copy(packed.begin(), packed.begin() + len);
+        copy[at] ^= 0x5A;
+        TEST_ASSERT_FALSE(Rgbz::decode(copy.data(), copy.size(), decoded.data(), decoded.size()));
+    }
+    TEST_ASSERT_FALSE(Rgbz::decode(packed.data(), len / 2, decoded.data(), decoded.size()));
+    TEST_ASSERT_FALSE(Rgbz::decode(packed.data(), len, decoded.data(), decoded.size() - 1));
+
+    // A buffer short of maxEncodedSize() is fine for frames that compress
+    TEST_ASSERT_EQUAL(len, Rgbz::encode(pixels.data(), 240, 240, packed.data(), len));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rendered_roads_round_trip_and_compress);
+    RUN_TEST(test_noise_is_stored);
+    RUN_TEST(test_flat_frames_round_trip);
+    RUN_TEST(test_gradients_round_trip);
+    RUN_TEST(test_damaged_streams_are_rejected);
+    return UNITY_END();
+}